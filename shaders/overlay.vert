@@ -0,0 +1,8 @@
+#version 330 core
+// Prostokąt nakładki profilera bez bufora wierzchołków: 4 wierzchołki z gl_VertexID
+uniform vec4 uRect;   // x, y (lewy dolny róg w NDC), szerokość, wysokość
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = vec4(uRect.xy + corner * uRect.zw, 0.0, 1.0);
+}
@@ -6,38 +6,167 @@ in vec3 vWorldPos;
 out vec4 FragColor;
 
 struct Material {
-    vec3 Kd;   // możesz zostawić, ale najczęściej = (1,1,1)
+    vec3 Kd;   // kolor bazowy, gdy materiał nie ma map_Kd
     vec3 Ks;   // kolor połysku
     float Ns;  // shininess
 };
 
 uniform Material uMat;
+#ifdef HAS_TEXTURE
 uniform sampler2D uDiffuse;
+#endif
+#ifdef HAS_NORMAL_MAP
+uniform sampler2D uNormalMap;
+uniform vec2 uBumpScale;   // -bm z MTL; y ujemne dla UV z v = 0 u góry (glTF)
+#endif
 
-uniform vec3 uViewPos;
+// Dane klatki z UploadRing (binding 0); ten sam blok w phong.vert i phong.frag
+layout(std140) uniform FrameData {
+    mat4 uModel;
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;    float uPad0;
+    vec3 uLightDir;   float uPad1;   // kierunek światła (z którego świeci)
+    vec3 uLightColor; float uPad2;   // zwykle (1,1,1)
+};
+
+#if defined(CLUSTERED_LIGHTS) || defined(HAS_SHADOWS)
+float viewDepth() {
+    return -(uView * vec4(vWorldPos, 1.0)).z;
+}
+#endif
+
+#ifdef HAS_SHADOWS
+// Cascaded shadow maps światła kierunkowego (CascadedShadowMaps)
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMat[4];
+uniform vec4 uCascadeSplits;   // daleka granica każdej kaskady (głębokość widoku)
+uniform int uCascadeCount;
+
+float shadowFactor(vec3 N, vec3 L) {
+    float depth = viewDepth();
+    int c = 0;
+    while (c < uCascadeCount - 1 && depth > uCascadeSplits[c]) c++;
+    if (depth > uCascadeSplits[uCascadeCount - 1]) return 1.0;
+
+    // lekki offset wzdłuż normalnej przeciw "shadow acne" na ostrych kątach
+    vec3 P = vWorldPos + N * (0.002 * (1.0 - dot(N, L)) * float(c + 1));
+    vec4 sc = uShadowMat[c] * vec4(P, 1.0);
+    vec2 texel = 1.0 / vec2(textureSize(uShadowMap, 0).xy);
+
+    // PCF 3x3 (każda próbka to już sprzętowe porównanie 2x2)
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(uShadowMap, vec4(sc.xy + vec2(x, y) * texel, float(c), sc.z));
+    return lit / 9.0;
+}
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+// Listy świateł per klaster liczone na CPU (ClusteredLighting)
+uniform usamplerBuffer uClusterGrid;   // (offset, count)
+uniform usamplerBuffer uLightIndices;
+uniform samplerBuffer  uLightData;     // 3 texele na światło
+uniform vec3 uClusterDims;
+uniform vec3 uClusterZ;                // plaster = log(głębokość) * x + y
+uniform vec3 uScreenSize;
+
+int clusterIndex() {
+    float depth = viewDepth();
+    ivec3 dims = ivec3(uClusterDims);
+    ivec2 tile = ivec2(gl_FragCoord.xy / uScreenSize.xy * uClusterDims.xy);
+    int slice = int(floor(log(max(depth, 1e-4)) * uClusterZ.x + uClusterZ.y));
+    tile = clamp(tile, ivec2(0), dims.xy - 1);
+    slice = clamp(slice, 0, dims.z - 1);
+    return (slice * dims.y + tile.y) * dims.x + tile.x;
+}
+#endif
 
-uniform vec3 uLightDir;    // kierunek światła (z którego świeci)
-uniform vec3 uLightColor;  // zwykle (1,1,1)
+#ifdef HAS_NORMAL_MAP
+// Brak tangentów w Vertex -> baza TBN z pochodnych ekranowych (cotangent frame)
+vec3 perturbNormal(vec3 N, vec3 P, vec2 uv) {
+    vec3 dp1 = dFdx(P);
+    vec3 dp2 = dFdy(P);
+    vec2 duv1 = dFdx(uv);
+    vec2 duv2 = dFdy(uv);
+
+    vec3 dp2perp = cross(dp2, N);
+    vec3 dp1perp = cross(N, dp1);
+    vec3 T = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 B = dp2perp * duv1.y + dp1perp * duv2.y;
+    float invmax = inversesqrt(max(dot(T, T), dot(B, B)));
+    mat3 TBN = mat3(T * invmax, B * invmax, N);
+
+    vec3 n = texture(uNormalMap, uv).xyz * 2.0 - 1.0;
+    n.xy *= uBumpScale;
+    return normalize(TBN * n);
+}
+#endif
 
 void main() {
     vec3 N = normalize(vNrm);
+#ifdef HAS_NORMAL_MAP
+    N = perturbNormal(N, vWorldPos, vUV);
+#endif
     vec3 L = normalize(-uLightDir);                 // "do światła"
-    vec3 V = normalize(uViewPos - vWorldPos);
 
+#ifdef HAS_TEXTURE
     vec3 albedo = texture(uDiffuse, vUV).rgb;       // kolor z tekstury
+#else
+    vec3 albedo = uMat.Kd;
+#endif
 
     // Ambient (żeby nie było czarno w cieniu)
     vec3 ambient = 0.30 * albedo;
 
+#ifdef HAS_SHADOWS
+    vec3 sunColor = uLightColor * shadowFactor(N, L);
+#else
+    vec3 sunColor = uLightColor;
+#endif
+
     // Diffuse (Lambert)
     float diff = max(dot(N, L), 0.0);
-    vec3 diffuse = diff * albedo * uLightColor;
+    vec3 diffuse = diff * albedo * sunColor;
+
+    vec3 color = ambient + diffuse;
 
+    vec3 V = normalize(uViewPos - vWorldPos);
+#ifdef HAS_SPECULAR
     // Specular (Phong)
     vec3 R = reflect(-L, N);
     float spec = pow(max(dot(V, R), 0.0), max(uMat.Ns, 1.0));
-    vec3 specular = spec * uMat.Ks * uLightColor;
+    color += spec * uMat.Ks * sunColor;
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+    uvec2 cell = texelFetch(uClusterGrid, clusterIndex()).xy;
+    for (uint i = 0u; i < cell.y; i++) {
+        int li = int(texelFetch(uLightIndices, int(cell.x + i)).r) * 3;
+        vec4 posR   = texelFetch(uLightData, li);
+        vec4 colIn  = texelFetch(uLightData, li + 1);
+        vec4 dirOut = texelFetch(uLightData, li + 2);
+
+        vec3 toL = posR.xyz - vWorldPos;
+        float d = length(toL);
+        if (d >= posR.w) continue;
+        vec3 Lp = toL / d;
+
+        // gładkie wygaszanie do zera na promieniu
+        float x = d / posR.w;
+        float win = clamp(1.0 - x * x * x * x, 0.0, 1.0);
+        float atten = win * win / (1.0 + 25.0 * x * x);
+        atten *= smoothstep(dirOut.w, colIn.w, dot(-Lp, dirOut.xyz));
+
+        vec3 radiance = colIn.rgb * atten;
+        color += max(dot(N, Lp), 0.0) * albedo * radiance;
+#ifdef HAS_SPECULAR
+        vec3 Rp = reflect(-Lp, N);
+        color += pow(max(dot(V, Rp), 0.0), max(uMat.Ns, 1.0)) * uMat.Ks * radiance;
+#endif
+    }
+#endif
 
-    vec3 color = ambient + diffuse + specular;
     FragColor = vec4(color, 1.0);
 }
@@ -2,19 +2,44 @@
 layout (location=0) in vec3 aPos;
 layout (location=1) in vec2 aUV;
 layout (location=2) in vec3 aNrm;
+#ifdef INSTANCED
+layout (location=3) in mat4 aModel;   // zajmuje lokacje 3..6
+#endif
 
 out vec2 vUV;
 out vec3 vNrm;
 out vec3 vWorldPos;
 
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
+// Dane klatki z UploadRing (binding 0); ten sam blok w phong.vert i phong.frag
+layout(std140) uniform FrameData {
+    mat4 uModel;
+    mat4 uView;
+    mat4 uProj;
+    vec3 uViewPos;    float uPad0;
+    vec3 uLightDir;   float uPad1;   // kierunek światła (z którego świeci)
+    vec3 uLightColor; float uPad2;   // zwykle (1,1,1)
+};
+
+#ifdef QUANTIZED
+// aPos przychodzi jako znormalizowane unorm16 w [0,1] -> wracamy do przestrzeni modelu
+uniform vec3 uQuantScale;
+uniform vec3 uQuantOffset;
+#endif
 
 void main() {
-    vec4 wpos = uModel * vec4(aPos, 1.0);
+#ifdef INSTANCED
+    mat4 model = aModel;
+#else
+    mat4 model = uModel;
+#endif
+#ifdef QUANTIZED
+    vec3 pos = aPos * uQuantScale + uQuantOffset;
+#else
+    vec3 pos = aPos;
+#endif
+    vec4 wpos = model * vec4(pos, 1.0);
     vWorldPos = wpos.xyz;
-    vNrm = mat3(transpose(inverse(uModel))) * aNrm;
+    vNrm = mat3(transpose(inverse(model))) * aNrm;
     vUV = aUV;
     gl_Position = uProj * uView * wpos;
 }
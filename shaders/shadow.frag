@@ -0,0 +1,4 @@
+#version 330 core
+// Głębokość zapisuje sam rasterizer
+void main() {
+}
@@ -0,0 +1,9 @@
+#version 330 core
+// Tylko pozycja: atrybut 0 z VAO areny geometrii, UV i normalnych nie czytamy
+layout (location=0) in vec3 aPos;
+
+uniform mat4 uLightMVP;
+
+void main() {
+    gl_Position = uLightMVP * vec4(aPos, 1.0);
+}
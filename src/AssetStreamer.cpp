@@ -0,0 +1,437 @@
+﻿#include "AssetStreamer.h"
+#include "Renderer.h"
+#include "GltfLoader.h"
+#include "MeshCache.h"
+#include "SharedAssetCache.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+// GeometrySink parsera na wątku tła: osobny bieżący blok na wierzchołki i
+// na indeksy. Gotowe kawałki bloku idą kolejką jako Staged (wątek GL je
+// kopiuje), a po nich submesh jako Geometry ze staged = true.
+class AssetStreamer::StagingSink : public GeometrySink {
+public:
+    StagingSink(AssetStreamer& owner, StagingBuffer& staging)
+        : owner_(owner), staging_(staging) {
+        indices_.indices = true;
+    }
+    // Bloki niedokończone (błąd, anulowanie) też muszą wrócić do puli
+    ~StagingSink() override {
+        flush(vertices_, true);
+        flush(indices_, true);
+    }
+
+    std::span<Vertex> vertexSpace() override { return space<Vertex>(vertices_); }
+    void commitVertices(size_t count) override { commit(vertices_, count, sizeof(Vertex)); }
+    std::span<uint32_t> indexSpace() override { return space<uint32_t>(indices_); }
+    void commitIndices(size_t count) override { commit(indices_, count, sizeof(uint32_t)); }
+
+    bool submesh(const SubMesh& sm, MaterialMap&& materials) override {
+        // bez trwałego mapowania blok kopiuje się tylko raz, więc oddajemy go od razu
+        const bool last = !staging_.partialCopies();
+        flush(vertices_, last);
+        flush(indices_, last);
+
+        auto ev = std::make_unique<AssetEvent>();
+        ev->kind = AssetEvent::Kind::Geometry;
+        ev->chunk.firstVertex = chunkFirstVertex_;
+        ev->chunk.submesh = sm;
+        ev->chunk.materials = std::move(materials);
+        ev->chunk.staged = true;
+        ev->chunk.stagedVertices = vertices_.total - chunkFirstVertex_;
+        chunkFirstVertex_ = vertices_.total;
+        owner_.push(std::move(ev));
+        return !owner_.cancel_.load();
+    }
+
+    void expect(size_t vertices, size_t indices) override {
+        auto ev = std::make_unique<AssetEvent>();
+        ev->kind = AssetEvent::Kind::Expect;
+        ev->expectVertices = (uint32_t)std::min<size_t>(vertices, UINT32_MAX);
+        ev->expectIndices = (uint32_t)std::min<size_t>(indices, UINT32_MAX);
+        owner_.push(std::move(ev));
+    }
+
+private:
+    struct Stream {
+        bool indices = false;
+        StagingBuffer::Block block;
+        size_t used = 0, flushed = 0;   // bajty w bloku
+        uint32_t total = 0;             // elementy potwierdzone w całym modelu
+        size_t elemSize = 0;
+    };
+
+    template <class T>
+    std::span<T> space(Stream& s) {
+        s.elemSize = sizeof(T);
+        if (!s.block || staging_.blockSize() - s.used < sizeof(T)) {
+            flush(s, true);
+            s.block = staging_.acquire(&owner_.cancel_);
+            if (!s.block) throw LoadCancelled();
+            s.used = s.flushed = 0;
+        }
+        return std::span<T>((T*)(s.block.data + s.used), (staging_.blockSize() - s.used) / sizeof(T));
+    }
+
+    void commit(Stream& s, size_t count, size_t elemSize) {
+        s.used += count * elemSize;
+        s.total += (uint32_t)count;
+    }
+
+    // Kawałek [flushed, used) do wątku GL; last = blok wraca do puli po kopii
+    void flush(Stream& s, bool last) {
+        if (!s.block) return;
+        if (s.used == s.flushed && !last) return;
+        auto ev = std::make_unique<AssetEvent>();
+        ev->kind = AssetEvent::Kind::Staged;
+        StagedRange& r = ev->staged;
+        r.block = s.block.index;
+        r.offset = s.flushed;
+        r.indices = s.indices;
+        r.count = s.elemSize ? (uint32_t)((s.used - s.flushed) / s.elemSize) : 0;
+        r.first = s.total - r.count;
+        r.lastInBlock = last;
+        owner_.push(std::move(ev));
+        s.flushed = s.used;
+        if (last) s.block = {};
+    }
+
+    AssetStreamer& owner_;
+    StagingBuffer& staging_;
+    Stream vertices_, indices_;
+    uint32_t chunkFirstVertex_ = 0;
+};
+
+AssetStreamer::AssetStreamer(JobSystem& jobs, const StreamSettings& s)
+    : jobs_(jobs), settings_(s), queue_(s.queueCapacity) {}
+
+AssetStreamer::~AssetStreamer() {
+    cancel_.store(true);
+    jobs_.wait(pending_);   // zadania tła wykonują wątki puli, nie ten
+}
+
+void AssetStreamer::push(std::unique_ptr<AssetEvent> ev) {
+    // render opróżnia kolejkę raz na klatkę, więc krótki sen zamiast kręcenia się
+    while (!queue_.tryPush(ev)) {
+        if (cancel_.load()) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void AssetStreamer::loadModel(const std::string& objPath, const std::string& baseDir) {
+    loading_ = true;
+    error_.clear();
+    stats_ = ObjLoadStats{};
+    start_ = std::chrono::steady_clock::now();
+
+    jobs_.runBackground([this, objPath, baseDir] {
+        try {
+            // MTL i tekstury równolegle z geometrią
+            const bool gltf = IsGLTFPath(objPath);
+            if (!gltf && settings_.sharedCache) {
+                loadShared(objPath, baseDir);
+                return;
+            }
+            if (!gltf && settings_.meshCache) {
+                loadCached(objPath, baseDir);
+                return;
+            }
+            std::vector<std::string> mtlPaths;
+            if (gltf) {
+                jobs_.runBackground([this, objPath] { loadGltfMaterials(objPath); }, &pending_);
+            } else {
+                mtlPaths = FindMtlLibs(objPath, baseDir);
+                jobs_.runBackground([this, mtlPaths, baseDir] { loadMtl(mtlPaths, baseDir); }, &pending_);
+            }
+
+            auto onChunk = [this](ObjChunk&& chunk) {
+                auto ev = std::make_unique<AssetEvent>();
+                ev->kind = AssetEvent::Kind::Geometry;
+                ev->chunk = std::move(chunk);
+                push(std::move(ev));
+                return !cancel_.load();
+            };
+            ObjLoadStats stats;
+            if (settings_.directUpload) {
+                stats = loadStaged(objPath, baseDir, mtlPaths);
+            } else if (gltf) {
+                stats = LoadGLTFStreaming(objPath, onChunk, &cancel_);
+            } else {
+                stats = LoadOBJStreaming(objPath, baseDir, mtlPaths, onChunk);
+            }
+
+            auto done = std::make_unique<AssetEvent>();
+            done->kind = AssetEvent::Kind::ObjDone;
+            done->stats = stats;
+            push(std::move(done));
+        } catch (const std::exception& e) {
+            auto ev = std::make_unique<AssetEvent>();
+            ev->kind = AssetEvent::Kind::Failed;
+            ev->error = e.what();
+            push(std::move(ev));
+        }
+    }, &pending_);
+}
+
+void AssetStreamer::openLazy(const std::string& objPath, const std::string& baseDir, const ObjSubset& subset) {
+    loading_ = true;
+    error_.clear();
+    stats_ = ObjLoadStats{};
+    lazy_.reset();
+    start_ = std::chrono::steady_clock::now();
+
+    jobs_.runBackground([this, objPath, baseDir, subset] {
+        try {
+            if (IsGLTFPath(objPath)) throw std::runtime_error("Stronicowanie tylko dla OBJ: " + objPath);
+            std::vector<std::string> mtlPaths = FindMtlLibs(objPath, baseDir);
+            jobs_.runBackground([this, mtlPaths, baseDir] { loadMtl(mtlPaths, baseDir); }, &pending_);
+
+            auto t0 = std::chrono::steady_clock::now();
+            auto lazy = std::make_shared<const ObjLazyModel>(objPath, subset);
+            std::cout << "OBJ index: " << lazy->submeshes().size() << " submeshes, "
+                      << (lazy->indexFromSidecar() ? "sidecar" : "zbudowany") << " (" << MsSince(t0) << " ms)\n";
+            auto ev = std::make_unique<AssetEvent>();
+            ev->kind = AssetEvent::Kind::Placeholders;
+            ev->lazy = std::move(lazy);
+            push(std::move(ev));
+        } catch (const std::exception& e) {
+            auto ev = std::make_unique<AssetEvent>();
+            ev->kind = AssetEvent::Kind::Failed;
+            ev->error = e.what();
+            push(std::move(ev));
+        }
+    }, &pending_);
+}
+
+StagingBuffer& AssetStreamer::waitForStaging() {
+    // bloki tworzy pierwszy pump() na wątku GL
+    StagingBuffer* staging;
+    while (!(staging = stagingReady_.load())) {
+        if (cancel_.load()) throw LoadCancelled();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return *staging;
+}
+
+ObjLoadStats AssetStreamer::loadStaged(const std::string& objPath, const std::string& baseDir,
+                                       const std::vector<std::string>& mtlPaths) {
+    StagingSink sink(*this, waitForStaging());
+    if (IsGLTFPath(objPath)) return LoadGLTFToSink(objPath, sink, &cancel_);
+    if (settings_.outOfCore.memoryLimit)
+        return LoadOBJOutOfCore(objPath, baseDir, mtlPaths, sink, settings_.outOfCore, &cancel_);
+    return LoadOBJToSink(objPath, baseDir, mtlPaths, sink);
+}
+
+void AssetStreamer::loadCached(const std::string& objPath, const std::string& baseDir) {
+    bool fromCache = false;
+    LoadedModel model = LoadOBJCached(objPath, baseDir, &cancel_, &fromCache);
+    std::cout << "Mesh cache: " << (fromCache ? "trafienie" : "zbudowany") << " (" << model.stats.totalMs << " ms)\n";
+    publishMaterials(std::move(model.materials), model.stats.mtlMs);
+
+    // wszystkie wierzchołki w pierwszym kawałku, dalej same indeksy submeshy
+    const uint32_t vertices = (uint32_t)model.vertices.size();
+    for (size_t i = 0; i < model.submeshes.size() && !cancel_.load(); i++) {
+        const SubMesh& sm = model.submeshes[i];
+        auto ev = std::make_unique<AssetEvent>();
+        ev->kind = AssetEvent::Kind::Geometry;
+        ev->chunk.firstVertex = i ? vertices : 0;
+        if (i == 0) ev->chunk.vertices = std::move(model.vertices);
+        ev->chunk.indices.assign(model.indices.begin() + sm.indexOffset,
+                                 model.indices.begin() + sm.indexOffset + sm.indexCount);
+        ev->chunk.submesh = sm;
+        push(std::move(ev));
+    }
+
+    auto done = std::make_unique<AssetEvent>();
+    done->kind = AssetEvent::Kind::ObjDone;
+    done->stats = model.stats;
+    push(std::move(done));
+}
+
+void AssetStreamer::loadShared(const std::string& objPath, const std::string& baseDir) {
+    const SharedMesh mesh = LoadOBJShared(objPath, baseDir, &cancel_, settings_.meshCache);
+    std::cout << "Shared cache: " << (!mesh.shared ? "niedostepny" : mesh.fromCache ? "trafienie" : "zbudowany")
+              << " (" << mesh.stats.totalMs << " ms)\n";
+    publishMaterials(MaterialMap(mesh.materials), mesh.stats.mtlMs);
+
+    ObjLoadStats stats = mesh.stats;
+    if (settings_.directUpload) {
+        StagingSink sink(*this, waitForStaging());
+        stats = EmitSharedMesh(mesh, sink, &cancel_);
+    } else {
+        // wszystkie wierzchołki w pierwszym kawałku, dalej same indeksy submeshy
+        for (size_t i = 0; i < mesh.submeshes.size() && !cancel_.load(); i++) {
+            const SubMesh& sm = mesh.submeshes[i];
+            const std::span<const uint32_t> indices = mesh.indices.subspan(sm.indexOffset, sm.indexCount);
+            auto ev = std::make_unique<AssetEvent>();
+            ev->kind = AssetEvent::Kind::Geometry;
+            ev->chunk.firstVertex = i ? (uint32_t)mesh.vertices.size() : 0;
+            if (i == 0) ev->chunk.vertices.assign(mesh.vertices.begin(), mesh.vertices.end());
+            ev->chunk.indices.assign(indices.begin(), indices.end());
+            ev->chunk.submesh = sm;
+            push(std::move(ev));
+        }
+    }
+
+    auto done = std::make_unique<AssetEvent>();
+    done->kind = AssetEvent::Kind::ObjDone;
+    done->stats = stats;
+    push(std::move(done));
+}
+
+void AssetStreamer::loadMtl(const std::vector<std::string>& mtlPaths, const std::string& baseDir) {
+    try {
+        auto t0 = std::chrono::steady_clock::now();
+        MaterialMap materials;
+        for (const std::string& path : mtlPaths)
+            for (auto& [name, mat] : LoadMTL(path, baseDir)) materials[name] = std::move(mat);
+        publishMaterials(std::move(materials), MsSince(t0));
+    } catch (const std::exception& e) {
+        auto ev = std::make_unique<AssetEvent>();
+        ev->kind = AssetEvent::Kind::Failed;
+        ev->error = e.what();
+        push(std::move(ev));
+    }
+}
+
+void AssetStreamer::loadGltfMaterials(const std::string& path) {
+    try {
+        auto t0 = std::chrono::steady_clock::now();
+        MaterialMap materials = LoadGLTFMaterials(path);
+        publishMaterials(std::move(materials), MsSince(t0));
+    } catch (const std::exception& e) {
+        auto ev = std::make_unique<AssetEvent>();
+        ev->kind = AssetEvent::Kind::Failed;
+        ev->error = e.what();
+        push(std::move(ev));
+    }
+}
+
+void AssetStreamer::publishMaterials(MaterialMap&& materials, double ms) {
+    const std::map<std::string, bool> files = MaterialTextureFiles(materials);
+    auto ev = std::make_unique<AssetEvent>();
+    ev->kind = AssetEvent::Kind::Materials;
+    ev->materials = std::move(materials);
+    ev->stats.mtlMs = ms;
+    push(std::move(ev));
+    if (!settings_.textures) return;
+
+    for (const auto& [file, flip] : files) {
+        jobs_.runBackground([this, file = file, flip = flip] {
+            if (cancel_.load()) return;
+            auto tex = std::make_unique<AssetEvent>();
+            tex->kind = AssetEvent::Kind::Texture;
+            tex->path = file;
+            tex->image = settings_.sharedCache ? DecodeImageShared(file, flip) : DecodeImage(file, flip);
+            push(std::move(tex));
+        }, &pending_);
+    }
+}
+
+size_t AssetStreamer::pump(Renderer& renderer, double budgetMs) {
+    if (!loading_) return 0;
+    PROFILE_ZONE("AssetStreamer::pump");
+    auto t0 = std::chrono::steady_clock::now();
+    size_t n = 0;
+
+    if (settings_.directUpload && !staging_) {
+        staging_ = std::make_unique<StagingBuffer>(settings_.stagingBlockSize, settings_.stagingBlocks);
+        stagingReady_.store(staging_.get());
+    }
+    if (staging_) staging_->poll();   // bloki, które GPU już skopiowało, wracają do parsera
+
+    if (lazy_) {
+        // submeshe, które kamera zobaczyła w poprzedniej klatce
+        for (uint32_t submesh : renderer.takePageRequests()) {
+            jobs_.runBackground([this, lazy = lazy_, submesh] {
+                if (cancel_.load()) return;
+                auto ev = std::make_unique<AssetEvent>();
+                try {
+                    ev->kind = AssetEvent::Kind::Paged;
+                    ev->submesh = submesh;
+                    ev->chunk = lazy->page(submesh);
+                } catch (const std::exception& e) {
+                    ev->kind = AssetEvent::Kind::Failed;
+                    ev->error = e.what();
+                }
+                push(std::move(ev));
+            }, &pending_);
+        }
+    }
+
+    std::unique_ptr<AssetEvent> ev;
+    for (;;) {
+        if (n > 0 && MsSince(t0) >= budgetMs) break;
+
+        // najpierw licznik, potem kolejka: zadanie wrzuca swoje zdarzenia przed
+        // zejściem licznika, więc zero + pusta kolejka = koniec ładowania
+        const bool allDone = pending_.done();
+        if (!queue_.tryPop(ev)) {
+            if (allDone && !(lazy_ && renderer.missingPages() && !failed())) {
+                loading_ = false;
+                loadMs_ = MsSince(start_);
+                if (!failed()) {
+                    renderer.finishModel(stats_);
+                    PrintLoadSummary(std::cout, renderer.model());
+                    std::cout << "Model streamed: " << loadMs_ << " ms\n";
+                }
+            }
+            break;
+        }
+
+        switch (ev->kind) {
+        case AssetEvent::Kind::Materials:
+            stats_.mtlMs += ev->stats.mtlMs;
+            renderer.addMaterials(std::move(ev->materials));
+            break;
+        case AssetEvent::Kind::Expect:
+            renderer.expectGeometry(ev->expectVertices, ev->expectIndices);
+            break;
+        case AssetEvent::Kind::Placeholders: {
+            lazy_ = ev->lazy;
+            const ObjSectionIndex& idx = lazy_->index();
+            renderer.expectGeometry(lazy_->expectedVertices(), lazy_->expectedIndices());
+            renderer.addPlaceholders(lazy_->submeshes());
+            stats_.lines = idx.lines;
+            stats_.positions = idx.positions;
+            stats_.uvs = idx.uvs;
+            stats_.normals = idx.normals;
+            stats_.faces = idx.faces;
+            break;
+        }
+        case AssetEvent::Kind::Geometry:
+            renderer.addGeometry(std::move(ev->chunk));
+            break;
+        case AssetEvent::Kind::Paged:
+            stats_.vertices += ev->chunk.vertices.size();
+            stats_.indices += ev->chunk.indices.size();
+            renderer.pageGeometry(ev->submesh, std::move(ev->chunk));
+            break;
+        case AssetEvent::Kind::Staged:
+            renderer.copyStaged(*staging_, ev->staged);
+            break;
+        case AssetEvent::Kind::Texture:
+            renderer.addTexture(ev->path, ev->image);
+            break;
+        case AssetEvent::Kind::ObjDone: {
+            const double mtlMs = stats_.mtlMs;
+            stats_ = ev->stats;
+            stats_.mtlMs += mtlMs;
+            break;
+        }
+        case AssetEvent::Kind::Failed:
+            if (error_.empty()) error_ = ev->error;
+            std::cerr << ev->error << "\n";
+            break;
+        }
+        n++;
+    }
+    return n;
+}
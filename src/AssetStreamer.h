@@ -0,0 +1,121 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "JobSystem.h"
+#include "LockFreeQueue.h"
+#include "ObjLoader.h"
+#include "ObjOutOfCore.h"
+#include "ObjIndex.h"
+#include "Texture.h"
+#include "StagingBuffer.h"
+
+class Renderer;
+
+// Zdarzenie od wątków ładujących do pętli renderu
+struct AssetEvent {
+    enum class Kind { Materials, Expect, Placeholders, Geometry, Paged, Staged, Texture, ObjDone, Failed };
+    Kind kind = Kind::Failed;
+    MaterialMap materials;         // Materials
+    uint32_t expectVertices = 0;   // Expect
+    uint32_t expectIndices = 0;
+    std::shared_ptr<const ObjLazyModel> lazy;   // Placeholders
+    ObjChunk chunk;                // Geometry, Paged
+    uint32_t submesh = 0;          // Paged
+    StagedRange staged;            // Staged
+    std::string path;              // Texture
+    DecodedImage image;            // Texture
+    ObjLoadStats stats;            // ObjDone
+    std::string error;             // Failed
+};
+
+// Ładowanie modelu w tle, bez blokowania okna. Zadania JobSystem (tylko
+// wątki puli) parsują MTL i OBJ submesh po submeshu i dekodują tekstury;
+// gotowe kawałki idą kolejką bez blokad do wątku GL, który w pump() raz na
+// klatkę wysyła do renderera tyle, ile zmieści się w budżecie czasu.
+// Pełna kolejka hamuje producentów (czekają, aż render ją opróżni).
+//
+// directUpload: parser pisze wierzchołki i indeksy wprost do bloków
+// StagingBuffer (zmapowana pamięć GL), a pump() kopiuje je na GPU do areny
+// renderera - bez wektorów kawałków na stercie. Bloki tworzy pierwszy
+// pump() (potrzebny GL), parser do tego czasu czeka.
+//
+// outOfCore.memoryLimit > 0 (tylko z directUpload): LoadOBJOutOfCore -
+// dwa przebiegi, atrybuty na dysku, pamięć parsera ograniczona limitem.
+//
+// meshCache: OBJ przez sidecar .zmesh (LoadOBJCached) - cały model naraz,
+// potem kawałki po submeshu; za pierwszym razem parsowanie i zapis sidecara.
+//
+// sharedCache: OBJ i tekstury przez SharedAssetCache - zdekodowane raz na
+// host, kolejne procesy mapują je z pamięci współdzielonej. Geometria idzie
+// z mapowania wprost do bloków staging (albo do kawałków).
+struct StreamSettings {
+    size_t queueCapacity = 64;
+    bool directUpload = true;
+    bool textures = true;          // false: sama geometria (pomiar pamięci)
+    size_t stagingBlockSize = 256 * 1024;   // 8192 wierzchołków
+    unsigned stagingBlocks = 8;
+    OutOfCoreSettings outOfCore{0, {}};
+    bool meshCache = false;
+    bool sharedCache = false;
+};
+
+class AssetStreamer {
+public:
+    explicit AssetStreamer(JobSystem& jobs, const StreamSettings& s = {});
+    // Przerywa ładowanie i czeka na zadania
+    ~AssetStreamer();
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    // Bez GL - można zacząć zanim powstanie okno. Jedno ładowanie naraz.
+    // .gltf / .glb idą przez LoadGLTF* (materiały z JSON, baseDir pomijany).
+    void loadModel(const std::string& objPath, const std::string& baseDir);
+    // Stronicowanie: indeks odcinków (sidecar) i materiały od razu, geometria
+    // submesha dopiero, gdy renderer zgłosi go jako widoczny. loading()
+    // trwa, dopóki jakiś submesh czeka na dysku.
+    void openLazy(const std::string& objPath, const std::string& baseDir, const ObjSubset& subset = {});
+
+    // Wątek GL: przenosi gotowe zdarzenia do renderera, aż skończą się albo
+    // minie budgetMs (zawsze co najmniej jedno). Zwraca liczbę zdarzeń.
+    size_t pump(Renderer& renderer, double budgetMs);
+
+    bool loading() const { return loading_; }
+    bool failed() const { return !error_.empty(); }
+    const std::string& error() const { return error_; }
+    double loadMs() const { return loadMs_; }    // od loadModel do ostatniego zdarzenia
+    const StagingBuffer* staging() const { return staging_.get(); }   // nullptr bez directUpload
+
+private:
+    void push(std::unique_ptr<AssetEvent> ev);   // czeka na miejsce, chyba że anulowano
+    void loadMtl(const std::vector<std::string>& mtlPaths, const std::string& baseDir);
+    // StreamSettings::meshCache: model z sidecara (albo OBJ + zapis), kawałki po submeshu
+    void loadCached(const std::string& objPath, const std::string& baseDir);
+    // StreamSettings::sharedCache: model z pamięci współdzielonej (albo zbudowany i tam zapisany)
+    void loadShared(const std::string& objPath, const std::string& baseDir);
+    void loadGltfMaterials(const std::string& path);
+    // Zdarzenie Materials i dekodowanie tekstur materiałów w tle
+    void publishMaterials(MaterialMap&& materials, double ms);
+    ObjLoadStats loadStaged(const std::string& objPath, const std::string& baseDir,
+                            const std::vector<std::string>& mtlPaths);
+    StagingBuffer& waitForStaging();
+
+    class StagingSink;
+
+    JobSystem& jobs_;
+    StreamSettings settings_;
+    std::unique_ptr<StagingBuffer> staging_;       // wątek GL
+    std::atomic<StagingBuffer*> stagingReady_{nullptr};
+    std::shared_ptr<const ObjLazyModel> lazy_;     // wątek GL, po Placeholders
+    LockFreeQueue<std::unique_ptr<AssetEvent>> queue_;
+    std::atomic<bool> cancel_{false};
+    JobCounter pending_;      // zadania ładujące
+
+    bool loading_ = false;
+    std::string error_;
+    ObjLoadStats stats_;
+    std::chrono::steady_clock::time_point start_;
+    double loadMs_ = 0.0;
+};
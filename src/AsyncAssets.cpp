@@ -0,0 +1,113 @@
+﻿#include "AsyncAssets.h"
+#include "GltfLoader.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <map>
+
+AssetHandle::AssetHandle(int priority) : state_(std::make_shared<State>()) {
+    state_->priority.store(priority);
+}
+
+void AssetHandle::setPriority(int priority) { state_->priority.store(priority); }
+int AssetHandle::priority() const { return state_->priority.load(); }
+void AssetHandle::cancel() { state_->cancelled.store(true); }
+bool AssetHandle::cancelled() const { return state_->cancelled.load(); }
+const std::atomic<bool>* AssetHandle::cancelFlag() const { return &state_->cancelled; }
+
+AsyncAssets::AsyncAssets(JobSystem& jobs, unsigned maxParallel)
+    : jobs_(jobs), maxParallel_(std::max(1u, maxParallel)) {}
+
+AsyncAssets::~AsyncAssets() {
+    closing_ = true;   // wznowione korutyny nie zawieszą się już na onWorker
+    std::vector<Request> queued = std::move(queue_);
+    queue_.clear();
+    for (Request& r : queued) {
+        r.handle.cancel();
+        r.resume.resume();
+    }
+    for (AssetHandle& h : active_) h.cancel();   // parser przerwie pracę
+    // wznowienia zadań z puli czekają w kolejce main - wait() je wykona,
+    // pumpMain() dobiera te wysłane tuż przed zejściem licznika
+    jobs_.wait(pending_);
+    jobs_.pumpMain();
+}
+
+bool AsyncAssets::enqueue(AssetHandle handle, std::function<void()> work, std::coroutine_handle<> resume) {
+    if (closing_) return false;
+    queue_.push_back(Request{std::move(handle), std::move(work), resume, nextOrder_++});
+    dispatch();
+    return true;
+}
+
+void AsyncAssets::dispatch() {
+    while (!closing_ && running_ < maxParallel_ && !queue_.empty()) {
+        // kolejka jest krótka, a priorytety zmieniają się w locie - zamiast
+        // kopca wybieramy maksimum przy każdym wysłaniu
+        auto best = std::min_element(queue_.begin(), queue_.end(), [](const Request& a, const Request& b) {
+            const int pa = a.handle.priority(), pb = b.handle.priority();
+            return pa != pb ? pa > pb : a.order < b.order;
+        });
+        Request r = std::move(*best);
+        queue_.erase(best);
+
+        running_++;
+        active_.push_back(r.handle);
+        jobs_.runBackground([this, r = std::move(r)] {
+            if (!r.handle.cancelled()) r.work();
+            jobs_.runOnMain([this, handle = r.handle, h = r.resume] {
+                running_--;
+                active_.erase(std::find_if(active_.begin(), active_.end(),
+                                           [&](const AssetHandle& a) { return a.same(handle); }));
+                dispatch();
+                h.resume();
+            });
+        }, &pending_);
+    }
+}
+
+void AsyncAssets::pump() {
+    PROFILE_ZONE("AsyncAssets::pump");
+    std::vector<std::coroutine_handle<>> cancelled;
+    for (auto it = queue_.begin(); it != queue_.end();) {
+        if (it->handle.cancelled()) {
+            cancelled.push_back(it->resume);
+            it = queue_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (std::coroutine_handle<> h : cancelled) h.resume();
+
+    dispatch();
+    jobs_.pumpMain();
+}
+
+Task<ModelAsset> LoadModelAsync(AsyncAssets& assets, std::string objPath, std::string baseDir,
+                                AssetHandle handle) {
+    JobSystem& jobs = assets.jobs();
+    auto load = [&jobs, objPath, baseDir, handle] {
+        ModelAsset a;
+        a.model = IsGLTFPath(objPath) ? LoadGLTF(objPath, handle.cancelFlag())
+                                      : LoadOBJ_WithMTL(objPath, baseDir, handle.cancelFlag());
+
+        const std::map<std::string, bool> files = MaterialTextureFiles(a.model.materials);
+        std::vector<std::pair<std::string, bool>> paths(files.begin(), files.end());
+        std::vector<DecodedImage> images(paths.size());
+        jobs.parallelFor(0, paths.size(), 1, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++)
+                if (!handle.cancelled()) images[i] = DecodeImage(paths[i].first, paths[i].second);
+        });
+        if (handle.cancelled()) throw LoadCancelled();
+        for (size_t i = 0; i < paths.size(); i++) a.images[paths[i].first] = std::move(images[i]);
+        return a;
+    };
+    ModelAsset asset = co_await assets.onWorker(handle, std::move(load));
+    co_return std::move(asset);
+}
+
+Task<GLuint> LoadTextureAsync(AsyncAssets& assets, std::string path, AssetHandle handle) {
+    auto decode = [path] { return DecodeImage(path); };
+    DecodedImage img = co_await assets.onWorker(handle, std::move(decode));
+    co_return UploadTexture2D(img);   // już na wątku GL
+}
@@ -0,0 +1,140 @@
+﻿#pragma once
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Coro.h"
+#include "JobSystem.h"
+#include "ObjLoader.h"
+#include "Texture.h"
+
+// Uchwyt żądania: priorytet i anulowanie można zmieniać z dowolnego wątku,
+// także gdy korutyna czeka. Kopie dzielą ten sam stan.
+class AssetHandle {
+public:
+    explicit AssetHandle(int priority = 0);
+
+    // Większy = wcześniej. Działa dla żądań jeszcze w kolejce; to, co już
+    // jest liczone na wątku puli, dokończy się niezależnie od priorytetu.
+    void setPriority(int priority);
+    int priority() const;
+
+    // Np. obiekt wyszedł z widoku. Oczekujące co_await rzuci LoadCancelled,
+    // parser OBJ przerwie pracę przy najbliższym sprawdzeniu flagi.
+    void cancel();
+    bool cancelled() const;
+    const std::atomic<bool>* cancelFlag() const;
+    bool same(const AssetHandle& o) const { return state_ == o.state_; }
+
+private:
+    struct State {
+        std::atomic<int> priority{0};
+        std::atomic<bool> cancelled{false};
+    };
+    std::shared_ptr<State> state_;
+};
+
+// Model gotowy do Renderer::setModel: geometria, materiały i zdekodowane
+// tekstury (jeszcze bez GL)
+struct ModelAsset {
+    LoadedModel model;
+    DecodedTextures images;
+};
+
+// Asynchroniczne ładowanie na korutynach. co_await onWorker(...) zawiesza
+// korutynę, praca idzie do kolejki priorytetowej, a z niej (najwyżej
+// maxParallel naraz) na wątki puli JobSystem. Wznowienie zawsze na wątku GL
+// w pump(), więc po co_await można od razu wysyłać dane do GL.
+// Wszystkie metody poza AssetHandle - tylko wątek główny.
+class AsyncAssets {
+public:
+    explicit AsyncAssets(JobSystem& jobs, unsigned maxParallel = 2);
+    // Anuluje wszystko i wznawia oczekujących (dostaną LoadCancelled)
+    ~AsyncAssets();
+    AsyncAssets(const AsyncAssets&) = delete;
+    AsyncAssets& operator=(const AsyncAssets&) = delete;
+
+    // Raz na klatkę: wznawia anulowane z kolejki, wysyła kolejne żądania
+    // według priorytetu i wykonuje wznowienia (JobSystem::pumpMain).
+    void pump();
+
+    size_t queued() const { return queue_.size(); }
+    unsigned running() const { return running_; }
+    bool idle() const { return queue_.empty() && running_ == 0; }
+    JobSystem& jobs() { return jobs_; }
+
+    // co_await assets.onWorker(handle, fn) -> wynik fn() policzony na wątku
+    // puli; wyjątek z fn wraca do korutyny, anulowanie daje LoadCancelled
+    template <class Fn>
+    auto onWorker(AssetHandle handle, Fn fn);
+
+private:
+    template <class R>
+    friend struct WorkerAwaiter;
+
+    struct Request {
+        AssetHandle handle;
+        std::function<void()> work;       // wątek puli
+        std::coroutine_handle<> resume;   // wątek GL
+        uint64_t order = 0;               // FIFO przy równych priorytetach
+    };
+
+    // false = nie zawieszaj (zamykanie)
+    bool enqueue(AssetHandle handle, std::function<void()> work, std::coroutine_handle<> resume);
+    void dispatch();
+
+    JobSystem& jobs_;
+    unsigned maxParallel_;
+    std::vector<Request> queue_;
+    std::vector<AssetHandle> active_;   // żądania w puli (anulowanie przy zamykaniu)
+    unsigned running_ = 0;
+    uint64_t nextOrder_ = 0;
+    bool closing_ = false;
+    JobCounter pending_;     // zadania w puli
+};
+
+template <class R>
+struct WorkerAwaiter {
+    AsyncAssets& assets;
+    AssetHandle handle;
+    std::function<R()> fn;
+    std::optional<R> result;
+    std::exception_ptr error;
+
+    bool await_ready() const { return handle.cancelled(); }
+    bool await_suspend(std::coroutine_handle<> h) {
+        // ramka korutyny (a z nią ten awaiter) żyje do wznowienia
+        return assets.enqueue(handle, [this] {
+            try {
+                result.emplace(fn());
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }, h);
+    }
+    R await_resume() {
+        if (handle.cancelled() || (!result && !error)) throw LoadCancelled();
+        if (error) std::rethrow_exception(error);
+        return std::move(*result);
+    }
+};
+
+template <class Fn>
+auto AsyncAssets::onWorker(AssetHandle handle, Fn fn) {
+    using R = decltype(fn());
+    return WorkerAwaiter<R>{*this, std::move(handle), std::move(fn), std::nullopt, nullptr};
+}
+
+// OBJ + MTL + dekodowanie tekstur na wątkach puli (LoadOBJ_WithMTL,
+// DecodeImage), wznowienie na wątku GL
+Task<ModelAsset> LoadModelAsync(AsyncAssets& assets, std::string objPath, std::string baseDir,
+                                AssetHandle handle = AssetHandle());
+// Dekodowanie w puli, UploadTexture2D już na wątku GL
+Task<GLuint> LoadTextureAsync(AsyncAssets& assets, std::string path,
+                              AssetHandle handle = AssetHandle());
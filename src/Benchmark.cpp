@@ -0,0 +1,1065 @@
+﻿#include "Benchmark.h"
+#include "Renderer.h"
+#include "Camera.h"
+#include "CpuProfiler.h"
+#include "Window.h"
+#include "Startup.h"
+#include "JobSystem.h"
+#include "CommandBuffer.h"
+#include "AssetStreamer.h"
+#include "ObjScan.h"
+#include "GltfLoader.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "SharedAssetCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MsBetween(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// Cel offscreen: kolor + głębokość w renderbufferach, bez MSAA (stabilniejsze czasy)
+struct OffscreenTarget {
+    GLuint fbo = 0, color = 0, depth = 0;
+
+    bool create(int w, int h) {
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    ~OffscreenTarget() {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (color) glDeleteRenderbuffers(1, &color);
+        if (depth) glDeleteRenderbuffers(1, &depth);
+    }
+};
+
+const char* GLStr(GLenum e) {
+    const char* s = (const char*)glGetString(e);
+    return s ? s : "";
+}
+
+// Fazy startu w kolejności, w jakiej się dzieją
+enum StartupPhase {
+    SP_GLFW_INIT, SP_WINDOW, SP_GLAD, SP_SHADER, SP_OBJ_LOAD, SP_MTL_PARSE, SP_TEXTURE_DECODE,
+    SP_TEXTURE_UPLOAD, SP_VAO_VBO, SP_SHADOW_SETUP, SP_SHADER_VARIANTS,
+    SP_FIRST_FRAME, SP_FIRST_SWAP, SP_TOTAL, SP_COUNT
+};
+
+const char* const kStartupPhaseNames[SP_COUNT] = {
+    "glfw_init", "window", "glad", "shader", "obj_load", "mtl_parse", "texture_decode",
+    "texture_upload", "vao_vbo", "shadow_setup", "shader_variants",
+    "first_frame", "first_swap", "total",
+};
+
+// Wyrzuca pliki z page cache (best effort: tylko czyste strony, tylko Linux).
+// Zwraca liczbę plików, dla których się udało.
+size_t EvictFromPageCache(const std::filesystem::path& p) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::is_directory(p, ec)) {
+        size_t n = 0;
+        for (const auto& e : fs::recursive_directory_iterator(p, ec))
+            if (e.is_regular_file(ec)) n += EvictFromPageCache(e.path());
+        return n;
+    }
+#ifdef __linux__
+    int fd = ::open(p.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+    bool ok = ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    ::close(fd);
+    return ok ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+// Pole z /proc/self/status w kB (VmRSS, VmHWM); -1 poza Linuksem
+long ProcStatusKb(const char* key) {
+#ifdef __linux__
+    std::ifstream f("/proc/self/status");
+    std::string line;
+    const size_t n = std::strlen(key);
+    while (std::getline(f, line))
+        if (line.compare(0, n, key) == 0 && line.size() > n && line[n] == ':') return std::atol(line.c_str() + n + 1);
+#else
+    (void)key;
+#endif
+    return -1;
+}
+
+// Zeruje szczyt RSS (VmHWM := VmRSS), żeby mierzyć jeden przebieg; Linux 4.0+
+bool ResetPeakRss() {
+#ifdef __linux__
+    std::ofstream f("/proc/self/clear_refs");
+    f << "5";
+    return (bool)f;
+#else
+    return false;
+#endif
+}
+
+// Oddaje systemowi zwolnione strony sterty (inaczej poprzedni przebieg zawyża bazę)
+void TrimHeap() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+} // namespace
+
+Percentiles ComputePercentiles(std::vector<double> samples) {
+    Percentiles p;
+    if (samples.empty()) return p;
+    std::sort(samples.begin(), samples.end());
+    // nearest-rank: stabilne i bez interpolacji między próbkami
+    auto rank = [&](double q) {
+        size_t i = (size_t)std::ceil(q * samples.size());
+        return samples[std::min(samples.size() - 1, i > 0 ? i - 1 : 0)];
+    };
+    double sum = 0;
+    for (double v : samples) sum += v;
+    p.mean = sum / samples.size();
+    p.p50 = rank(0.50);
+    p.p90 = rank(0.90);
+    p.p95 = rank(0.95);
+    p.p99 = rank(0.99);
+    p.min = samples.front();
+    p.max = samples.back();
+    return p;
+}
+
+std::string JsonEscape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+            out += buf;
+        } else out += c;
+    }
+    return out;
+}
+
+void WriteJson(std::ostream& os, const Percentiles& p) {
+    os << "{\"mean\":" << p.mean << ",\"p50\":" << p.p50 << ",\"p90\":" << p.p90
+       << ",\"p95\":" << p.p95 << ",\"p99\":" << p.p99
+       << ",\"min\":" << p.min << ",\"max\":" << p.max << "}";
+}
+
+int RunHeadlessBenchmark(Renderer& renderer, const BenchOptions& o, const std::string& modelPath) {
+    OffscreenTarget target;
+    if (!target.create(o.width, o.height)) {
+        std::cerr << "Offscreen FBO niekompletny\n";
+        return 1;
+    }
+
+    CameraPath path;
+    try {
+        path = o.cameraPath.empty()
+             ? CameraPath::Orbit(renderer.worldCenter(), renderer.worldRadius() * 3.f, 10.f)
+             : CameraPath::Load(o.cameraPath);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    // Warianty shaderów muszą być gotowe, inaczej pierwsze klatki mierzą fallback
+    renderer.waitForShaders();
+
+    // Ring zapytań GL_TIME_ELAPSED: wynik klatki i czytamy kQueries-1 klatek później,
+    // więc odczyt nie czeka na GPU, a jednocześnie CPU nie ucieka dalej niż o 3 klatki
+    const int kQueries = 4;
+    GLuint queries[kQueries];
+    glGenQueries(kQueries, queries);
+
+    const int total = o.warmup + o.frames;
+    std::vector<double> cpuMs, gpuMs, frameMs;
+    cpuMs.reserve(o.frames);
+    gpuMs.reserve(o.frames);
+    frameMs.reserve(o.frames);
+
+    auto readGpu = [&](int frame) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[frame % kQueries], GL_QUERY_RESULT, &ns);
+        if (frame >= o.warmup) gpuMs.push_back(ns / 1e6);
+    };
+
+    const float loop = std::max(path.duration(), 1e-3f);
+    for (int i = 0; i < total; i++) {
+        auto t0 = Clock::now();
+
+        float time = i / o.fps;
+        CameraFPS cam = path.sample(std::fmod(time, loop));
+
+        FrameParams fp;
+        fp.view = cam.view();
+        fp.camPos = cam.pos;
+        fp.fovDeg = cam.fov;
+        fp.width = o.width;
+        fp.height = o.height;
+        fp.time = time;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+        glBeginQuery(GL_TIME_ELAPSED, queries[i % kQueries]);
+        renderer.render(fp);
+        glEndQuery(GL_TIME_ELAPSED);
+        glFlush();
+        auto t1 = Clock::now();
+
+        if (i >= kQueries - 1) {
+            PROFILE_ZONE("read GPU query");
+            readGpu(i - (kQueries - 1));
+        }
+        auto t2 = Clock::now();
+
+        if (i >= o.warmup) {
+            cpuMs.push_back(MsBetween(t0, t1));
+            frameMs.push_back(MsBetween(t0, t2));
+        }
+        PROFILE_FRAME();
+    }
+    for (int i = std::max(0, total - (kQueries - 1)); i < total; i++) readGpu(i);
+    glDeleteQueries(kQueries, queries);
+
+    std::ofstream file;
+    if (!o.outPath.empty()) {
+        file.open(o.outPath);
+        if (!file) {
+            std::cerr << "Nie moge zapisac wyniku: " << o.outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& os = o.outPath.empty() ? std::cout : file;
+
+    const LoadedModel& m = renderer.model();
+    os << "{\n"
+       << "  \"mode\": \"headless\",\n"
+       << "  \"gl_renderer\": \"" << JsonEscape(GLStr(GL_RENDERER)) << "\",\n"
+       << "  \"gl_version\": \"" << JsonEscape(GLStr(GL_VERSION)) << "\",\n"
+       << "  \"width\": " << o.width << ",\n"
+       << "  \"height\": " << o.height << ",\n"
+       << "  \"frames\": " << o.frames << ",\n"
+       << "  \"warmup\": " << o.warmup << ",\n"
+       << "  \"camera_path\": \"" << JsonEscape(o.cameraPath.empty() ? "orbit" : o.cameraPath) << "\",\n"
+       << "  \"model\": {\"path\": \"" << JsonEscape(modelPath) << "\", \"vertices\": " << m.stats.vertices
+       << ", \"indices\": " << m.stats.indices << ", \"submeshes\": " << m.submeshes.size() << "},\n"
+       << "  \"lights\": " << renderer.lightCount() << ",\n"
+       << "  \"shadows\": " << (renderer.shadowsEnabled() ? "true" : "false") << ",\n";
+    const UploadRing& ring = renderer.frameRing();
+    os << "  \"upload_ring\": {\"persistent\": " << (ring.persistent() ? "true" : "false")
+       << ", \"regions\": " << ring.regions() << ", \"region_bytes\": " << ring.regionSize()
+       << ", \"peak_bytes\": " << ring.stats().peakBytes << ", \"frames\": " << ring.stats().frames
+       << ", \"cpu_waits\": " << ring.stats().waits << ", \"wait_ms\": " << ring.stats().waitMs << "},\n";
+    const GeometryArena::Stats geo = renderer.geometry().stats();
+    os << "  \"geometry_arena\": {\"ranges\": " << geo.ranges
+       << ", \"vertex_capacity\": " << geo.vertices.capacity << ", \"vertices_used\": " << geo.vertices.used
+       << ", \"index_capacity\": " << geo.indices.capacity << ", \"indices_used\": " << geo.indices.used
+       << ", \"free_regions\": " << geo.vertices.freeRegions + geo.indices.freeRegions
+       << ", \"grows\": " << geo.grows << ", \"compactions\": " << geo.compactions
+       << ", \"copy_ms\": " << geo.copyMs << "},\n";
+    os << "  \"cpu_ms\": "; WriteJson(os, ComputePercentiles(cpuMs)); os << ",\n";
+    os << "  \"gpu_ms\": "; WriteJson(os, ComputePercentiles(gpuMs)); os << ",\n";
+    os << "  \"frame_ms\": "; WriteJson(os, ComputePercentiles(frameMs)); os << "\n";
+    os << "}\n";
+    return 0;
+}
+
+int RunStartupBenchmark(const StartupBenchOptions& o) {
+    namespace fs = std::filesystem;
+
+    // Własny katalog cache programów: zimna iteracja go czyści, ciepłe korzystają
+    // z tego, co zapisała zimna - niezależnie od stanu shader_cache/ aplikacji
+    const fs::path cacheDir = fs::temp_directory_path() / "zadanieNatalia_startup_cache";
+
+    std::vector<std::vector<double>> runs;
+    std::string glRenderer, glVersion;
+    struct {
+        size_t vertices = 0, indices = 0, submeshes = 0, materials = 0;
+        ObjLoadStats stats;
+        ModelUploadStats upload;
+    } info;                        // z zimnej iteracji
+    size_t evicted = 0;
+
+    std::vector<TaskGraph::Timing> coldTasks;
+
+    for (int it = 0; it < std::max(1, o.iterations); it++) {
+        const bool cold = it == 0;
+        if (cold) {
+            std::error_code ec;
+            fs::remove_all(cacheDir, ec);
+            evicted = EvictFromPageCache(o.objPath) + EvictFromPageCache(o.baseDir) + EvictFromPageCache("shaders");
+            if (o.meshCache) evicted += EvictFromPageCache(OBJMeshCachePath(o.objPath));
+            if (o.sharedCache) ClearSharedAssetCache();
+        }
+
+        std::vector<double> ms(SP_COUNT, 0.0);
+        const auto start = Clock::now();
+        auto t = start;
+        auto lap = [&](StartupPhase p) {
+            auto now = Clock::now();
+            ms[p] = MsBetween(t, now);
+            t = now;
+        };
+
+        RenderSettings rs;
+        rs.lights = o.lights;
+        rs.shadows = o.shadows;
+        rs.hotReload = false;
+        rs.shaderCacheDir = cacheDir.string();
+
+        GLFWwindow* win = nullptr;
+        std::unique_ptr<Renderer> renderer;
+        try {
+            if (o.sequential) {
+                // dokładnie jak dawny main(): wszystko po kolei na jednym wątku
+                bool offscreen = false;
+                if (!InitGLFW(true, offscreen)) throw std::runtime_error("GLFW init fail");
+                lap(SP_GLFW_INIT);
+
+                // bez wyświetlacza okno i tak jest niewidoczne (OSMesa), inaczej mierzymy prawdziwe okno
+                win = CreateAppWindow(o.width, o.height, "OBJ Viewer", offscreen, offscreen);
+                if (!win) throw std::runtime_error("Window create fail");
+                lap(SP_WINDOW);
+
+                if (!LoadGL(offscreen)) throw std::runtime_error("GLAD load fail");
+                lap(SP_GLAD);
+
+                renderer = std::make_unique<Renderer>(rs);
+                lap(SP_SHADER);
+
+                LoadedModel model = o.sharedCache ? LoadOBJShared(o.objPath, o.baseDir, nullptr, o.meshCache).copy()
+                                    : o.meshCache ? LoadOBJCached(o.objPath, o.baseDir)
+                                                  : LoadOBJ_WithMTL(o.objPath, o.baseDir);
+                lap(SP_OBJ_LOAD);
+                ms[SP_MTL_PARSE] = model.stats.mtlMs;   // w środku obj_load
+
+                renderer->setModel(std::move(model));
+                t = Clock::now();
+            } else {
+                // pula jest częścią startu aplikacji, więc tworzymy ją w pomiarze
+                JobSystem jobs;
+                StartupConfig sc;
+                sc.objPath = o.objPath;
+                sc.baseDir = o.baseDir;
+                sc.width = o.width;
+                sc.height = o.height;
+                sc.headless = true;   // ukryte okno, bez wyświetlacza fallback na OSMesa
+                sc.meshCache = o.meshCache;
+                sc.sharedCache = o.sharedCache;
+                sc.render = rs;
+                StartupResult su = RunStartup(sc, jobs);
+                win = su.window;
+                renderer = std::move(su.renderer);
+
+                // czasy zadań; przy grafie fazy nakładają się, więc suma != total
+                for (const TaskGraph::Timing& task : su.tasks) {
+                    const double d = task.endMs - task.startMs;
+                    for (int p = 0; p < SP_COUNT; p++)
+                        if (task.name == kStartupPhaseNames[p]) ms[p] += d;
+                    if (task.name == "find_mtllib") ms[SP_MTL_PARSE] += d;
+                }
+                if (cold) coldTasks = su.tasks;
+                t = Clock::now();
+            }
+
+            const ModelUploadStats& us = renderer->uploadStats();
+            if (o.sequential) ms[SP_TEXTURE_DECODE] = us.textureDecodeMs;
+            ms[SP_TEXTURE_UPLOAD] = us.textureUploadMs;
+            ms[SP_VAO_VBO] = us.buffersMs;
+            ms[SP_SHADOW_SETUP] = us.shadowsMs;
+
+            renderer->waitForShaders();
+            lap(SP_SHADER_VARIANTS);
+
+            CameraFPS cam;
+            cam.pos = renderer->worldCenter() + glm::vec3(0.f, 0.f, renderer->worldRadius() * 3.f);
+            cam.lookAt(renderer->worldCenter());
+            FrameParams fp;
+            fp.view = cam.view();
+            fp.camPos = cam.pos;
+            fp.fovDeg = cam.fov;
+            fp.width = o.width;
+            fp.height = o.height;
+            renderer->render(fp);
+            lap(SP_FIRST_FRAME);
+
+            // glFinish: swap tylko kolejkuje, a liczy się klatka na ekranie
+            glfwSwapBuffers(win);
+            glFinish();
+            lap(SP_FIRST_SWAP);
+            ms[SP_TOTAL] = MsBetween(start, t);
+
+            if (cold) {
+                glRenderer = GLStr(GL_RENDERER);
+                glVersion = GLStr(GL_VERSION);
+                const LoadedModel& m = renderer->model();
+                info.vertices = m.stats.vertices;
+                info.indices = m.stats.indices;
+                info.submeshes = m.submeshes.size();
+                info.materials = m.materials.size();
+                info.stats = m.stats;
+                info.upload = us;
+            }
+        } catch (const std::exception& e) {
+            // RunStartup sprząta sam; w trybie sekwencyjnym robimy to tutaj
+            std::cerr << e.what() << "\n";
+            if (o.sequential) {
+                renderer.reset();
+                if (win) glfwDestroyWindow(win);
+                glfwTerminate();
+            }
+            return 1;
+        }
+
+        renderer.reset();
+        glfwDestroyWindow(win);
+        glfwTerminate();
+        runs.push_back(ms);
+    }
+
+    std::error_code ec;
+    fs::remove_all(cacheDir, ec);
+
+    std::ofstream file;
+    if (!o.outPath.empty()) {
+        file.open(o.outPath);
+        if (!file) {
+            std::cerr << "Nie moge zapisac wyniku: " << o.outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& os = o.outPath.empty() ? std::cout : file;
+
+    const ObjLoadStats& st = info.stats;
+    os << "{\n"
+       << "  \"mode\": \"startup\",\n"
+       << "  \"gl_renderer\": \"" << JsonEscape(glRenderer) << "\",\n"
+       << "  \"gl_version\": \"" << JsonEscape(glVersion) << "\",\n"
+       << "  \"startup\": \"" << (o.sequential ? "sequential" : "task_graph") << "\",\n"
+       << "  \"mesh_cache\": " << (o.meshCache ? "true" : "false") << ",\n"
+       << "  \"shared_cache\": " << (o.sharedCache ? "true" : "false") << ",\n"
+       << "  \"iterations\": " << runs.size() << ",\n"
+       << "  \"cold_evicted_files\": " << evicted << ",\n"
+       << "  \"model\": {\"path\": \"" << JsonEscape(o.objPath) << "\""
+       << ", \"vertices\": " << info.vertices
+       << ", \"indices\": " << info.indices
+       << ", \"submeshes\": " << info.submeshes
+       << ", \"materials\": " << info.materials
+       << ", \"textures\": " << info.upload.textures
+       << ", \"obj_lines\": " << st.lines
+       << ", \"positions\": " << st.positions
+       << ", \"uvs\": " << st.uvs
+       << ", \"normals\": " << st.normals
+       << ", \"faces\": " << st.faces
+       << ", \"mtl_ms\": " << st.mtlMs << "},\n";
+
+    os << "  \"cold_ms\": {";
+    for (int p = 0; p < SP_COUNT; p++)
+        os << (p ? ", " : "") << "\"" << kStartupPhaseNames[p] << "\": " << runs[0][p];
+    os << "},\n";
+
+    os << "  \"warm_ms\": {";
+    for (int p = 0; p < SP_COUNT; p++) {
+        std::vector<double> samples;
+        for (size_t r = 1; r < runs.size(); r++) samples.push_back(runs[r][p]);
+        os << (p ? ",\n    " : "\n    ") << "\"" << kStartupPhaseNames[p] << "\": ";
+        WriteJson(os, ComputePercentiles(samples));
+    }
+    os << "\n  },\n";
+
+    os << "  \"runs\": [";
+    for (size_t r = 0; r < runs.size(); r++) {
+        os << (r ? ",\n    [" : "\n    [");
+        for (int p = 0; p < SP_COUNT; p++) os << (p ? ", " : "") << runs[r][p];
+        os << "]";
+    }
+    os << "\n  ],\n";
+    if (!coldTasks.empty()) {
+        // oś czasu zimnego startu: które zadanie, na jakim wątku, kiedy
+        os << "  \"cold_tasks\": [";
+        for (size_t i = 0; i < coldTasks.size(); i++) {
+            const TaskGraph::Timing& task = coldTasks[i];
+            os << (i ? ",\n    " : "\n    ")
+               << "{\"name\": \"" << JsonEscape(task.name) << "\", \"thread\": \""
+               << (task.affinity == TaskGraph::Affinity::Main ? "main" : "worker")
+               << "\", \"start_ms\": " << task.startMs << ", \"end_ms\": " << task.endMs << "}";
+        }
+        os << "\n  ],\n";
+    }
+    os << "  \"phases\": [";
+    for (int p = 0; p < SP_COUNT; p++) os << (p ? ", " : "") << "\"" << kStartupPhaseNames[p] << "\"";
+    os << "]\n}\n";
+    return 0;
+}
+
+namespace {
+
+// Jądro do parallelFor: trochę liczenia na element, żeby nie mierzyć samej pamięci
+void JobKernel(std::vector<float>& data, size_t b, size_t e) {
+    for (size_t i = b; i < e; i++) {
+        float x = data[i];
+        for (int k = 0; k < 16; k++) x = std::sqrt(x * x + 1.f) * 0.5f;
+        data[i] = x;
+    }
+}
+
+// Nagrywanie jak w Renderer::recordDraws, na sztucznej scenie: draw i
+// komplet jego stanu (wariant, materiał, tekstury) z tablic wejściowych
+struct FakeDraw {
+    GLuint program, tex, bump;
+    glm::vec3 kd, ks;
+    float ns;
+    uint32_t count, first;
+};
+
+void RecordFakeDraws(CommandList& list, unsigned thread, const std::vector<FakeDraw>& draws, size_t b, size_t e) {
+    CommandBuffer& cb = list.buffer(thread);
+    for (size_t i = b; i < e; i++) {
+        const FakeDraw& d = draws[i];
+        cb.begin(((uint64_t)d.program << 56) | ((uint64_t)(d.tex & 0xFFFF) << 40) | (uint64_t)(i & 0xFFFFFF));
+        cb.useProgram(d.program);
+        cb.uniform3f(0, d.kd);
+        cb.uniform3f(1, d.ks);
+        cb.uniform1f(2, d.ns);
+        cb.bindTexture(0, d.tex);
+        cb.bindTexture(1, d.bump);
+        cb.drawElements(d.count, d.first, 0, (uint32_t)i);
+        cb.end();
+    }
+}
+
+template <class Fn>
+double MedianMs(int repeats, Fn&& fn) {
+    std::vector<double> ms;
+    for (int r = 0; r < std::max(1, repeats); r++) {
+        const auto t0 = Clock::now();
+        fn();
+        ms.push_back(MsBetween(t0, Clock::now()));
+    }
+    return ComputePercentiles(ms).p50;
+}
+
+} // namespace
+
+int RunJobBenchmark(const JobBenchOptions& o) {
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned maxWorkers = o.maxWorkers ? o.maxWorkers : hw;
+    std::vector<unsigned> counts;
+    for (unsigned w = 1; w < maxWorkers; w *= 2) counts.push_back(w);
+    counts.push_back(maxWorkers);
+
+    std::vector<float> data(o.elements, 1.f);
+    const double serialMs = MedianMs(o.repeats, [&] { JobKernel(data, 0, data.size()); });
+
+    std::vector<FakeDraw> draws(o.draws);
+    for (size_t i = 0; i < draws.size(); i++) {
+        draws[i] = FakeDraw{GLuint(1 + i % 5), GLuint(1 + (i * 7) % 64), GLuint(1 + (i * 13) % 64),
+                            glm::vec3((float)(i % 10) * 0.1f), glm::vec3(0.2f), 32.f,
+                            (uint32_t)(3 + i % 300), (uint32_t)(i * 3)};
+    }
+    CommandList serialList(1);
+    const double recordSerialMs = MedianMs(o.repeats, [&] {
+        serialList.reset(1);
+        RecordFakeDraws(serialList, 0, draws, 0, draws.size());
+        serialList.sort();
+    });
+
+    struct Row {
+        unsigned workers = 0;
+        double injectNs = 0, spawnNs = 0, forMs = 0;
+        double recordMs = 0;
+        JobSystem::Stats stats;
+    };
+    std::vector<Row> rows;
+    std::vector<std::pair<size_t, double>> grains;
+
+    for (unsigned w : counts) {
+        JobSystem jobs(w);
+        Row row;
+        row.workers = w;
+
+        // narzut: puste zadania wysłane z wątku głównego (wspólna kolejka)
+        const double injectMs = MedianMs(o.repeats, [&] {
+            JobCounter c;
+            for (size_t i = 0; i < o.tasks; i++) jobs.run([] {}, &c);
+            jobs.wait(c);
+        });
+        row.injectNs = injectMs * 1e6 / (double)std::max<size_t>(1, o.tasks);
+
+        // narzut: te same zadania wysłane z wnętrza zadania (kolejka Chase-Lev)
+        const double spawnMs = MedianMs(o.repeats, [&] {
+            JobCounter c;
+            jobs.run([&] {
+                for (size_t i = 0; i < o.tasks; i++) jobs.run([] {}, &c);
+            }, &c);
+            jobs.wait(c);
+        });
+        row.spawnNs = spawnMs * 1e6 / (double)std::max<size_t>(1, o.tasks);
+
+        row.forMs = MedianMs(o.repeats, [&] {
+            jobs.parallelFor(0, data.size(), 0, [&](size_t b, size_t e) { JobKernel(data, b, e); });
+        });
+
+        // bufor komend na wątek; pierwsza klatka rozgrzewa alokatory
+        CommandList list(jobs.threadSlots());
+        auto recordFrame = [&] {
+            list.reset(jobs.threadSlots());
+            jobs.parallelFor(0, draws.size(), 512, [&](size_t b, size_t e) {
+                RecordFakeDraws(list, jobs.threadIndex(), draws, b, e);
+            });
+            list.sort();
+        };
+        recordFrame();
+        row.recordMs = MedianMs(o.repeats, recordFrame);
+
+        if (w == maxWorkers) {
+            for (size_t grain : {size_t(64), size_t(1024), size_t(16384), size_t(262144)}) {
+                grains.emplace_back(grain, MedianMs(o.repeats, [&] {
+                    jobs.parallelFor(0, data.size(), grain, [&](size_t b, size_t e) { JobKernel(data, b, e); });
+                }));
+            }
+        }
+        row.stats = jobs.stats();
+        rows.push_back(row);
+    }
+
+    std::ofstream file;
+    if (!o.outPath.empty()) {
+        file.open(o.outPath);
+        if (!file) {
+            std::cerr << "Nie moge zapisac wyniku: " << o.outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& os = o.outPath.empty() ? std::cout : file;
+
+    os << "{\n"
+       << "  \"mode\": \"jobs\",\n"
+       << "  \"hardware_threads\": " << hw << ",\n"
+       << "  \"tasks\": " << o.tasks << ",\n"
+       << "  \"elements\": " << o.elements << ",\n"
+       << "  \"serial_ms\": " << serialMs << ",\n"
+       << "  \"draws\": " << o.draws << ",\n"
+       << "  \"record_serial_ms\": " << recordSerialMs << ",\n"
+       << "  \"workers\": [";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const Row& r = rows[i];
+        // wątek główny też wykonuje zadania w wait(), więc liczymy workers + 1
+        os << (i ? ",\n    " : "\n    ")
+           << "{\"workers\": " << r.workers << ", \"inject_ns_per_task\": " << r.injectNs
+           << ", \"spawn_ns_per_task\": " << r.spawnNs << ", \"parallel_for_ms\": " << r.forMs
+           << ", \"speedup\": " << (r.forMs > 0 ? serialMs / r.forMs : 0.0)
+           << ", \"record_ms\": " << r.recordMs
+           << ", \"record_speedup\": " << (r.recordMs > 0 ? recordSerialMs / r.recordMs : 0.0)
+           << ", \"executed\": " << r.stats.executed << ", \"stolen\": " << r.stats.stolen
+           << ", \"sleeps\": " << r.stats.sleeps << "}";
+    }
+    os << "\n  ],\n";
+    os << "  \"grain\": [";
+    for (size_t i = 0; i < grains.size(); i++) {
+        os << (i ? ", " : "") << "{\"grain\": " << grains[i].first << ", \"parallel_for_ms\": " << grains[i].second << "}";
+    }
+    os << "]\n}\n";
+    return 0;
+}
+
+int RunUploadBenchmark(const UploadBenchOptions& o) {
+    const std::vector<std::string> all = {"vectors", "chunks", "direct", "ooc"};
+    std::vector<std::string> modes;
+    if (o.mode.empty()) modes = all;
+    else if (std::find(all.begin(), all.end(), o.mode) != all.end()) modes = {o.mode};
+    else {
+        std::cerr << "Nieznany tryb uploadu: " << o.mode << " (vectors, chunks, direct, ooc)\n";
+        return 1;
+    }
+
+    bool offscreen = false;
+    if (!InitGLFW(true, offscreen)) {
+        std::cerr << "GLFW init fail\n";
+        return 1;
+    }
+    GLFWwindow* win = CreateAppWindow(64, 64, "OBJ Viewer", true, offscreen);
+    if (!win || !LoadGL(true)) {
+        std::cerr << "Nie moge utworzyc kontekstu GL\n";
+        glfwTerminate();
+        return 1;
+    }
+    const std::string glRenderer = GLStr(GL_RENDERER);
+
+    struct Row {
+        std::string mode;
+        double ms = 0.0;
+        long baseKb = -1, peakKb = -1;
+        size_t vertices = 0, indices = 0;
+        StagingBuffer::Stats staging;
+        bool persistent = false;
+        double arenaMb = 0.0;      // pojemność GeometryArena po przebiegu
+        uint64_t arenaGrows = 0;   // przebudowy areny w tym przebiegu
+        uint64_t spillBytes = 0, pageLoads = 0;   // ooc
+        size_t dedupRotations = 0;
+    };
+    std::vector<Row> rows;
+    bool resetOk = true;
+    int code = 0;
+    {
+        RenderSettings rs;
+        rs.shadows = false;
+        rs.hotReload = false;
+        Renderer renderer(rs);
+        JobSystem jobs;
+
+        for (const std::string& mode : modes) {
+            Row row;
+            row.mode = mode;
+            renderer.clearModel();
+            glFinish();
+            TrimHeap();
+            resetOk = ResetPeakRss() && resetOk;
+            row.baseKb = ProcStatusKb("VmRSS");
+            const uint64_t growsBefore = renderer.geometry().stats().grows;
+
+            // sama geometria: MTL bez tekstur we wszystkich trybach
+            const auto t0 = Clock::now();
+            try {
+                if (mode == "vectors") {
+                    // dotychczasowy start: cały model w wektorach, potem glBufferSubData
+                    if (IsGLTFPath(o.objPath)) {
+                        LoadedModel model = LoadGLTF(o.objPath);
+                        model.materials.clear();   // bez tekstur, jak OBJ bez MTL
+                        renderer.setModel(std::move(model));
+                    } else {
+                        renderer.setModel(LoadOBJGeometry(o.objPath, o.baseDir, FindMtlLibs(o.objPath, o.baseDir)));
+                    }
+                } else {
+                    StreamSettings ss;
+                    ss.directUpload = mode != "chunks";
+                    if (mode == "ooc") ss.outOfCore.memoryLimit = o.memoryLimit;
+                    ss.textures = false;
+                    AssetStreamer streamer(jobs, ss);
+                    streamer.loadModel(o.objPath, o.baseDir);
+                    while (streamer.loading()) {
+                        if (!streamer.pump(renderer, 1000.0)) std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    }
+                    if (streamer.failed()) throw std::runtime_error(streamer.error());
+                    if (streamer.staging()) {
+                        row.staging = streamer.staging()->stats();
+                        row.persistent = streamer.staging()->partialCopies();
+                    }
+                }
+                glFinish();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                code = 1;
+                break;
+            }
+            row.ms = MsBetween(t0, Clock::now());
+            row.peakKb = ProcStatusKb("VmHWM");
+            row.vertices = renderer.model().stats.vertices;
+            row.indices = renderer.model().stats.indices;
+            row.spillBytes = renderer.model().stats.spillBytes;
+            row.pageLoads = renderer.model().stats.attributePageLoads;
+            row.dedupRotations = renderer.model().stats.dedupRotations;
+            const GeometryArena::Stats geo = renderer.geometry().stats();
+            row.arenaMb = (geo.vertices.capacity * sizeof(Vertex) + geo.indices.capacity * sizeof(uint32_t)) /
+                          (1024.0 * 1024.0);
+            row.arenaGrows = geo.grows - growsBefore;
+            rows.push_back(row);
+        }
+        renderer.clearModel();
+    }
+    glfwDestroyWindow(win);
+    glfwTerminate();
+    if (code) return code;
+
+    std::ofstream file;
+    if (!o.outPath.empty()) {
+        file.open(o.outPath);
+        if (!file) {
+            std::cerr << "Nie moge zapisac wyniku: " << o.outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& os = o.outPath.empty() ? std::cout : file;
+
+    // peak_rss_delta_mb: szczyt RSS ponad stan sprzed przebiegu. Przy
+    // programowym GL (llvmpipe) bufory GPU też są w RSS procesu - stąd
+    // arena_mb: tryby strumieniowe powiększają arenę w trakcie (x2).
+    os << "{\n"
+       << "  \"mode\": \"upload\",\n"
+       << "  \"gl_renderer\": \"" << JsonEscape(glRenderer) << "\",\n"
+       << "  \"model\": \"" << JsonEscape(o.objPath) << "\",\n"
+       << "  \"peak_reset\": " << (resetOk ? "true" : "false") << ",\n"
+       << "  \"runs\": [";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const Row& r = rows[i];
+        const double meshMb = (r.vertices * sizeof(Vertex) + r.indices * sizeof(uint32_t)) / (1024.0 * 1024.0);
+        os << (i ? ",\n    " : "\n    ")
+           << "{\"path\": \"" << r.mode << "\", \"ms\": " << r.ms
+           << ", \"vertices\": " << r.vertices << ", \"indices\": " << r.indices
+           << ", \"mesh_mb\": " << meshMb << ", \"arena_mb\": " << r.arenaMb
+           << ", \"arena_grows\": " << r.arenaGrows;
+        if (r.baseKb >= 0 && r.peakKb >= 0) {
+            const double delta = (r.peakKb - r.baseKb) / 1024.0;
+            os << ", \"rss_base_mb\": " << r.baseKb / 1024.0 << ", \"peak_rss_mb\": " << r.peakKb / 1024.0
+               << ", \"peak_rss_delta_mb\": " << delta
+               << ", \"peak_over_mesh\": " << (meshMb > 0 ? delta / meshMb : 0.0);
+        } else {
+            os << ", \"peak_rss_mb\": null";
+        }
+        if (r.mode == "ooc") {
+            os << ", \"memory_limit_mb\": " << o.memoryLimit / (1024.0 * 1024.0)
+               << ", \"spill_mb\": " << r.spillBytes / (1024.0 * 1024.0)
+               << ", \"attribute_page_loads\": " << r.pageLoads
+               << ", \"dedup_rotations\": " << r.dedupRotations;
+        }
+        if (r.mode == "direct" || r.mode == "ooc") {
+            os << ", \"persistent\": " << (r.persistent ? "true" : "false")
+               << ", \"staging_copies\": " << r.staging.copies
+               << ", \"staging_waits\": " << r.staging.acquireWaits;
+        }
+        os << "}";
+    }
+    os << "\n  ]\n}\n";
+    return 0;
+}
+
+
+int RunScanBenchmark(const ScanBenchOptions& o) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    for (const std::string& p : o.paths) {
+        std::error_code ec;
+        if (fs::is_directory(p, ec)) {
+            for (auto it = fs::recursive_directory_iterator(p, fs::directory_options::skip_permission_denied, ec);
+                 it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                if (ec) break;
+                std::string ext = it->path().extension().string();
+                for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+                if (ext == ".obj" && it->is_regular_file(ec)) files.push_back(it->path().generic_string());
+            }
+        } else {
+            files.push_back(p);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        std::cerr << "Brak plikow OBJ do skanowania\n";
+        return 1;
+    }
+
+    JobSystem jobs(o.workers);
+    ObjScanStats stats;
+    std::vector<ObjMetadata> meta;
+    try {
+        meta = ScanOBJFiles(jobs, files, &stats);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!o.outPath.empty()) {
+        file.open(o.outPath);
+        if (!file) {
+            std::cerr << "Nie moge zapisac wyniku: " << o.outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& os = o.outPath.empty() ? std::cout : file;
+    auto names = [&](const std::vector<std::string>& v) {
+        os << "[";
+        for (size_t i = 0; i < v.size(); i++) os << (i ? ", " : "") << "\"" << JsonEscape(v[i]) << "\"";
+        os << "]";
+    };
+    auto vec3 = [&](const glm::vec3& v) { os << "[" << v.x << ", " << v.y << ", " << v.z << "]"; };
+
+    os << "{\n"
+       << "  \"mode\": \"scan\",\n"
+       << "  \"workers\": " << jobs.workerCount() << ",\n"
+       << "  \"files\": " << stats.files << ",\n"
+       << "  \"failed\": " << stats.failed << ",\n"
+       << "  \"mb\": " << stats.bytes / (1024.0 * 1024.0) << ",\n"
+       << "  \"ms\": " << stats.ms << ",\n"
+       << "  \"files_per_s\": " << stats.filesPerSecond() << ",\n"
+       << "  \"mb_per_s\": " << stats.mbPerSecond() << ",\n"
+       << "  \"assets\": [";
+    for (size_t i = 0; i < meta.size(); i++) {
+        const ObjMetadata& m = meta[i];
+        os << (i ? ",\n    " : "\n    ") << "{\"path\": \"" << JsonEscape(m.path) << "\"";
+        if (!m.error.empty()) {
+            os << ", \"error\": \"" << JsonEscape(m.error) << "\"}";
+            continue;
+        }
+        os << ", \"ms\": " << m.ms << ", \"bytes\": " << m.fileSize
+           << ", \"positions\": " << m.positions << ", \"uvs\": " << m.uvs << ", \"normals\": " << m.normals
+           << ", \"faces\": " << m.faces << ", \"triangles\": " << m.triangles
+           << ", \"bounds_min\": ";
+        vec3(m.boundsMin);
+        os << ", \"bounds_max\": ";
+        vec3(m.boundsMax);
+        os << ", \"objects\": ";
+        names(m.objects);
+        os << ", \"materials\": ";
+        names(m.materials);
+        os << ", \"textures\": ";
+        names(m.textures);
+        if (!m.missing.empty()) {
+            os << ", \"missing\": ";
+            names(m.missing);
+        }
+        os << "}";
+    }
+    os << "\n  ]\n}\n";
+    return 0;
+}
+
+int RunFormatBenchmark(const FormatBenchOptions& o) {
+    namespace fs = std::filesystem;
+    LoadedModel reference;
+    try {
+        reference = LoadOBJ_WithMTL(o.objPath, o.baseDir);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    struct Row {
+        std::string format;
+        std::string path;
+        uint64_t bytes = 0;
+        double ms = 0.0;
+        uint64_t zeroCopyBytes = 0;
+        double decodeMs = 0.0;     // zmesh: sam MeshCodec
+        bool matches = true;
+    };
+    std::vector<Row> rows(4);
+    rows[0].format = "obj";
+    rows[0].path = o.objPath;
+    rows[0].ms = MedianMs(o.iterations, [&] { LoadOBJ_WithMTL(o.objPath, o.baseDir); });
+
+    // GLB obok siebie w katalogu tymczasowym; URI tekstur względne do niego
+    std::error_code ec;
+    const fs::path dir = fs::temp_directory_path(ec) / ("format-bench-" + std::to_string(Clock::now().time_since_epoch().count()));
+    fs::create_directories(dir, ec);
+    rows[1].format = "glb_interleaved";
+    rows[2].format = "glb_planar";
+    try {
+        for (size_t i = 1; i <= 2; i++) {
+            Row& row = rows[i];
+            row.path = (dir / (row.format + ".glb")).generic_string();
+            SaveGLB(reference, row.path, i == 1);
+            row.bytes = fs::file_size(row.path);
+
+            const LoadedModel m = LoadGLTF(row.path);
+            row.zeroCopyBytes = m.stats.zeroCopyBytes;
+            row.matches = m.indices == reference.indices && m.vertices.size() == reference.vertices.size() &&
+                          m.submeshes.size() == reference.submeshes.size();
+            for (size_t v = 0; row.matches && v < m.vertices.size(); v++) {
+                const Vertex& a = m.vertices[v];
+                const Vertex& b = reference.vertices[v];
+                // v tekstury przechodzi przez 1 - v w obie strony
+                row.matches = a.pos == b.pos && a.nrm == b.nrm && a.uv.x == b.uv.x &&
+                              std::abs((1.f - a.uv.y) - b.uv.y) < 1e-6f;
+            }
+            row.ms = MedianMs(o.iterations, [&] { LoadGLTF(row.path); });
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        fs::remove_all(dir, ec);
+        return 1;
+    }
+    rows[0].bytes = fs::file_size(o.objPath, ec);
+    fs::remove_all(dir, ec);
+
+    // sidecar .zmesh zostaje obok OBJ - to ten sam plik, z którego czyta --mesh-cache
+    Row& cached = rows[3];
+    cached.format = "zmesh";
+    cached.path = OBJMeshCachePath(o.objPath);
+    MeshCacheInfo info;
+    LoadedModel m;
+    if (!SaveMeshCache(reference, o.objPath, o.baseDir, &info) || !LoadMeshCache(o.objPath, o.baseDir, m, &info)) {
+        std::cerr << "Nie moge zapisac ani wczytac " << cached.path << "\n";
+        return 1;
+    }
+    cached.bytes = info.storedBytes;
+    cached.matches = m.vertices.size() == reference.vertices.size() && m.indices == reference.indices &&
+                     m.submeshes.size() == reference.submeshes.size() &&
+                     std::memcmp(m.vertices.data(), reference.vertices.data(), m.vertices.size() * sizeof(Vertex)) == 0;
+    std::vector<double> decodeMs;
+    cached.ms = MedianMs(o.iterations, [&] {
+        LoadMeshCache(o.objPath, o.baseDir, m, &info);
+        decodeMs.push_back(info.decodeMs);
+    });
+    cached.decodeMs = ComputePercentiles(decodeMs).p50;
+    const double rawBytes = (double)info.rawBytes;
+
+    std::ofstream file;
+    if (!o.outPath.empty()) {
+        file.open(o.outPath);
+        if (!file) {
+            std::cerr << "Nie moge zapisac wyniku: " << o.outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& os = o.outPath.empty() ? std::cout : file;
+    os << "{\n"
+       << "  \"mode\": \"format\",\n"
+       << "  \"model\": {\"path\": \"" << JsonEscape(o.objPath) << "\", \"vertices\": " << reference.vertices.size()
+       << ", \"indices\": " << reference.indices.size() << ", \"submeshes\": " << reference.submeshes.size() << "},\n"
+       << "  \"iterations\": " << o.iterations << ",\n"
+       << "  \"codec\": {\"simd\": " << (MeshCodec::SimdDecoder() ? "true" : "false")
+       << ", \"self_check\": " << (MeshCodec::SelfCheck() ? "true" : "false")
+       << ", \"raw_bytes\": " << info.rawBytes << ", \"ratio\": " << rawBytes / std::max<double>(1.0, (double)cached.bytes)
+       << ", \"decode_ms\": " << cached.decodeMs
+       << ", \"decode_gb_per_s\": " << (cached.decodeMs > 0.0 ? rawBytes / (cached.decodeMs * 1e6) : 0.0) << "},\n"
+       << "  \"formats\": [";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const Row& r = rows[i];
+        os << (i ? ",\n    " : "\n    ") << "{\"format\": \"" << r.format << "\", \"bytes\": " << r.bytes
+           << ", \"load_ms\": " << r.ms << ", \"speedup_vs_obj\": " << (r.ms > 0.0 ? rows[0].ms / r.ms : 0.0)
+           << ", \"zero_copy_bytes\": " << r.zeroCopyBytes << ", \"matches_obj\": " << (r.matches ? "true" : "false")
+           << "}";
+    }
+    os << "\n  ]\n}\n";
+    for (const Row& r : rows)
+        if (!r.matches) return 1;
+    return 0;
+}
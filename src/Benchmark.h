@@ -0,0 +1,106 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+
+class Renderer;
+
+struct Percentiles {
+    double mean = 0, p50 = 0, p90 = 0, p95 = 0, p99 = 0, min = 0, max = 0;
+};
+
+// Kopiuje i sortuje, więc można podać oryginalny wektor próbek
+Percentiles ComputePercentiles(std::vector<double> samples);
+
+std::string JsonEscape(const std::string& s);
+void WriteJson(std::ostream& os, const Percentiles& p);
+
+struct BenchOptions {
+    int frames = 300;          // mierzone klatki
+    int warmup = 30;           // odrzucane na początku (cache, kaskady cieni, JIT sterownika)
+    int width = 1280, height = 720;
+    float fps = 60.f;          // stały krok czasu sceny -> powtarzalne klatki
+    std::string cameraPath;    // pusty = orbita wokół modelu
+    std::string outPath;       // pusty = stdout
+};
+
+struct StartupBenchOptions {
+    int iterations = 5;        // pierwsza zimna, reszta ciepła
+    int width = 1280, height = 720;
+    std::string objPath, baseDir;
+    size_t lights = 0;
+    bool shadows = true;
+    std::string outPath;       // pusty = stdout
+    bool sequential = false;   // stary start krok po kroku zamiast grafu zadań (RunStartup)
+    bool meshCache = false;    // OBJ przez sidecar .zmesh (zimny start czyta skompresowaną geometrię)
+    // SharedAssetCache: zimna iteracja czyści wpisy i je buduje, ciepłe mapują
+    // (przy sequential tylko geometria - tekstury dekoduje Renderer)
+    bool sharedCache = false;
+};
+
+// Pełny start aplikacji (GLFW, okno, GLAD, shader, OBJ, tekstury, bufory,
+// pierwsza klatka i swap) powtórzony iterations razy w jednym procesie,
+// z czasem każdej fazy osobno. Zimna iteracja zaczyna z pustym cache
+// programów i (na Linuksie) z plikami wyrzuconymi z page cache. Wynik: JSON;
+// przy grafie zadań dodatkowo oś czasu zadań zimnego startu (cold_tasks).
+int RunStartupBenchmark(const StartupBenchOptions& o);
+
+struct JobBenchOptions {
+    unsigned maxWorkers = 0;   // 0 = liczba rdzeni; mierzymy 1, 2, 4, ... do tej wartości
+    size_t tasks = 200000;     // puste zadania do pomiaru narzutu
+    size_t elements = 1 << 22; // parallelFor: tyle elementów jądra obliczeniowego
+    size_t draws = 50000;      // nagrywanie komend: tyle sztucznych draw na klatkę
+    int repeats = 5;           // mediana z tylu powtórzeń
+    std::string outPath;       // pusty = stdout
+};
+
+// Mikrobenchmark JobSystem (bez GL): narzut na puste zadanie (wysłane spoza
+// puli i z wnętrza zadania), skalowanie parallelFor z liczbą wątków względem
+// pętli szeregowej, wpływ grain i równoległe nagrywanie komend rysowania
+// (CommandList, bez replay). Wynik: JSON.
+int RunJobBenchmark(const JobBenchOptions& o);
+
+struct UploadBenchOptions {
+    std::string objPath, baseDir;
+    std::string mode;          // vectors / chunks / direct / ooc; pusty = wszystkie po kolei
+    std::string outPath;       // pusty = stdout
+    size_t memoryLimit = 64u << 20;   // ooc: OutOfCoreSettings::memoryLimit
+};
+
+// Szczyt pamięci (VmHWM ponad VmRSS sprzed przebiegu, Linux) i czas
+// wczytania samej geometrii modelu do areny trzema drogami: cały model w
+// wektorach i setModel (vectors), kawałki submeshy w wektorach przez
+// AssetStreamer (chunks) i parser piszący prosto do zmapowanych bloków GL
+// (direct), oraz dwuprzebiegowo z limitem pamięci parsera (ooc). Jeden
+// proces na tryb (--upload-mode) daje najczystszy pomiar.
+int RunUploadBenchmark(const UploadBenchOptions& o);
+
+struct ScanBenchOptions {
+    std::vector<std::string> paths;   // pliki .obj albo katalogi (przeszukiwane rekurencyjnie)
+    unsigned workers = 0;      // wątki JobSystem; 0 = domyślnie
+    std::string outPath;       // pusty = stdout
+};
+
+// Metadane wszystkich znalezionych OBJ (ScanOBJFiles, bez GL): liczniki,
+// AABB, obiekty, materiały i tekstury każdego pliku oraz przepustowość
+// całości w plikach/s i MB/s. Wynik: JSON.
+int RunScanBenchmark(const ScanBenchOptions& o);
+
+struct FormatBenchOptions {
+    std::string objPath;
+    std::string baseDir;
+    int iterations = 5;        // mediana z tylu wczytań każdego formatu
+    std::string outPath;       // pusty = stdout
+};
+
+// Ten sam model jako OBJ, GLB (SaveGLB do katalogu tymczasowego: przeplot
+// jak Vertex i osobne widoki) i sidecar .zmesh (MeshCache, zostaje obok
+// OBJ): mediana czasu wczytania, rozmiary plików, bajty skopiowane wprost
+// z mapowania, stopień kompresji i przepustowość dekodera MeshCodec oraz
+// zgodność geometrii z OBJ. Bez GL.
+int RunFormatBenchmark(const FormatBenchOptions& o);
+
+// Renderuje do FBO trasę kamery przez warmup+frames klatek i wypisuje JSON
+// z percentylami czasu CPU (przygotowanie i wysłanie klatki), GPU (GL_TIME_ELAPSED)
+// i całej klatki. Zwraca kod wyjścia dla main().
+int RunHeadlessBenchmark(Renderer& renderer, const BenchOptions& o, const std::string& modelPath);
@@ -0,0 +1,124 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// ---- Prosta kamera FPS ----
+struct CameraFPS {
+    glm::vec3 pos{0.f, 1.2f, 3.0f};
+    float yaw = -90.f;
+    float pitch = 0.f;
+    float fov = 60.f;
+
+    float speed = 3.5f;
+    float sensitivity = 0.12f;
+
+    glm::vec3 front() const {
+        float cy = cos(glm::radians(yaw));
+        float sy = sin(glm::radians(yaw));
+        float cp = cos(glm::radians(pitch));
+        float sp = sin(glm::radians(pitch));
+        glm::vec3 f{cy * cp, sp, sy * cp};
+        return glm::normalize(f);
+    }
+    glm::vec3 right() const {
+        return glm::normalize(glm::cross(front(), glm::vec3(0,1,0)));
+    }
+    glm::mat4 view() const {
+        return glm::lookAt(pos, pos + front(), glm::vec3(0,1,0));
+    }
+
+    void mouseDelta(float dx, float dy) {
+        yaw += dx * sensitivity;
+        pitch -= dy * sensitivity;
+        pitch = std::clamp(pitch, -89.f, 89.f);
+    }
+
+    void lookAt(const glm::vec3& target) {
+        glm::vec3 dir = glm::normalize(target - pos);
+        yaw = glm::degrees(atan2(dir.z, dir.x));
+        pitch = glm::degrees(asin(dir.y));
+    }
+};
+
+// Nagrana albo wygenerowana trasa kamery. Plik tekstowy, jedna klatka kluczowa na linię:
+//   t x y z yaw pitch fov
+// (# = komentarz). Między kluczami interpolacja liniowa.
+struct CameraPath {
+    struct Key {
+        float t = 0.f;
+        glm::vec3 pos{0.f};
+        float yaw = 0.f, pitch = 0.f, fov = 60.f;
+    };
+    std::vector<Key> keys;
+
+    float duration() const { return keys.empty() ? 0.f : keys.back().t; }
+
+    void record(float t, const CameraFPS& cam) {
+        keys.push_back(Key{t, cam.pos, cam.yaw, cam.pitch, cam.fov});
+    }
+
+    CameraFPS sample(float t) const {
+        CameraFPS cam;
+        if (keys.empty()) return cam;
+        auto it = std::upper_bound(keys.begin(), keys.end(), t,
+                                   [](float v, const Key& k) { return v < k.t; });
+        const Key& b = (it == keys.end()) ? keys.back() : *it;
+        const Key& a = (it == keys.begin()) ? keys.front() : *(it - 1);
+        float span = b.t - a.t;
+        float f = span > 0.f ? std::clamp((t - a.t) / span, 0.f, 1.f) : 0.f;
+        cam.pos = glm::mix(a.pos, b.pos, f);
+        cam.yaw = a.yaw + (b.yaw - a.yaw) * f;
+        cam.pitch = a.pitch + (b.pitch - a.pitch) * f;
+        cam.fov = a.fov + (b.fov - a.fov) * f;
+        return cam;
+    }
+
+    void save(const std::string& path) const {
+        std::ofstream f(path);
+        if (!f) throw std::runtime_error("Nie moge zapisac sciezki kamery: " + path);
+        f << "# t x y z yaw pitch fov\n";
+        for (const Key& k : keys)
+            f << k.t << ' ' << k.pos.x << ' ' << k.pos.y << ' ' << k.pos.z << ' '
+              << k.yaw << ' ' << k.pitch << ' ' << k.fov << '\n';
+    }
+
+    static CameraPath Load(const std::string& path) {
+        std::ifstream f(path);
+        if (!f) throw std::runtime_error("Nie moge otworzyc sciezki kamery: " + path);
+        CameraPath p;
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream iss(line);
+            Key k;
+            if (iss >> k.t >> k.pos.x >> k.pos.y >> k.pos.z >> k.yaw >> k.pitch >> k.fov)
+                p.keys.push_back(k);
+        }
+        if (p.keys.empty()) throw std::runtime_error("Pusta sciezka kamery: " + path);
+        std::stable_sort(p.keys.begin(), p.keys.end(), [](const Key& a, const Key& b) { return a.t < b.t; });
+        return p;
+    }
+
+    // Domyślna trasa: pełny obrót wokół celu z lekkim falowaniem wysokości i odległości
+    static CameraPath Orbit(const glm::vec3& target, float dist, float seconds, int steps = 120) {
+        CameraPath p;
+        for (int i = 0; i <= steps; i++) {
+            float t = seconds * i / steps;
+            float a = 6.2831853f * i / steps;
+            float d = dist * (1.f + 0.25f * std::sin(a * 2.f));
+            CameraFPS cam;
+            cam.pos = target + glm::vec3(std::sin(a) * d, dist * 0.2f * std::sin(a * 3.f), std::cos(a) * d);
+            cam.lookAt(target);
+            p.record(t, cam);
+        }
+        return p;
+    }
+};
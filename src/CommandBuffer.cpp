@@ -0,0 +1,74 @@
+﻿#include "CommandBuffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void CommandBuffer::reset() {
+    arena_.reset();
+    first_ = last_ = nullptr;
+    items_ = 0;
+    open_ = nullptr;
+    openCount_ = 0;
+}
+
+void CommandBuffer::begin(uint64_t key) {
+    if (open_) throw std::logic_error("CommandBuffer::begin bez end");
+    // miejsce na cały element z góry; end() oddaje niewykorzystaną część
+    open_ = arena_.allocateArray<Command>(kMaxItemCommands);
+    openCount_ = 0;
+    openKey_ = key;
+}
+
+Command& CommandBuffer::push(Command::Type type, uint32_t slot) {
+    if (!open_) throw std::logic_error("CommandBuffer: komenda poza begin/end");
+    if (openCount_ == kMaxItemCommands) throw std::length_error("CommandBuffer: za duzo komend w elemencie");
+    Command& c = open_[openCount_++];
+    c.type = type;
+    c.slot = slot;
+    return c;
+}
+
+void CommandBuffer::end() {
+    if (!open_) throw std::logic_error("CommandBuffer::end bez begin");
+    arena_.shrinkLast(sizeof(Command) * (kMaxItemCommands - openCount_));
+
+    if (!last_ || last_->count == kPageItems) {
+        Page* p = arena_.allocateArray<Page>(1);
+        p->next = nullptr;
+        p->count = 0;
+        if (last_) last_->next = p;
+        else first_ = p;
+        last_ = p;
+    }
+    last_->items[last_->count++] = CommandItem{openKey_, open_, openCount_};
+    items_++;
+    open_ = nullptr;
+}
+
+CommandList::CommandList(unsigned threads) {
+    reset(threads);
+}
+
+void CommandList::reset(unsigned threads) {
+    threads = std::max(1u, threads);
+    while (buffers_.size() < threads) buffers_.push_back(std::make_unique<CommandBuffer>());
+    buffers_.resize(threads);
+    for (auto& b : buffers_) b->reset();
+    sorted_.clear();
+}
+
+void CommandList::sort() {
+    size_t total = 0;
+    for (const auto& b : buffers_) total += b->itemCount();
+    sorted_.clear();
+    sorted_.reserve(total);
+    for (const auto& b : buffers_) b->forEachItem([&](const CommandItem& it) { sorted_.push_back(it); });
+    std::sort(sorted_.begin(), sorted_.end(),
+              [](const CommandItem& a, const CommandItem& b) { return a.key < b.key; });
+}
+
+size_t CommandList::bytesUsed() const {
+    size_t n = 0;
+    for (const auto& b : buffers_) n += b->bytesUsed();
+    return n;
+}
@@ -0,0 +1,193 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "LinearAllocator.h"
+
+// Jedna komenda GL zapisana bez wołania GL (dowolny wątek)
+struct Command {
+    enum class Type : uint8_t { UseProgram, BindTexture, Uniform1f, Uniform2f, Uniform3f, DrawElements };
+    Type type;
+    uint32_t slot;            // BindTexture: jednostka; Uniform*: location
+    union {
+        GLuint name;          // UseProgram, BindTexture
+        float f;              // Uniform1f
+        float v[3];           // Uniform2f, Uniform3f
+        struct {
+            uint32_t count, firstIndex, tag;   // tag: dowolny identyfikator (np. submesh)
+            int32_t baseVertex;
+        } draw;
+    };
+};
+
+// Element sortowany: ciąg komend zakończony draw, klucz ustala kolejność
+struct CommandItem {
+    uint64_t key;
+    const Command* commands;
+    uint32_t count;
+};
+
+// Bufor komend jednego wątku. Komendy i lista elementów idą do jego
+// LinearAllocator, więc nagrywanie nie alokuje na stercie (poza
+// pierwszymi klatkami, gdy przybywa bloków).
+class CommandBuffer {
+public:
+    static constexpr uint32_t kMaxItemCommands = 8;
+
+    explicit CommandBuffer(size_t blockSize = 64 * 1024) : arena_(blockSize) {}
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    void reset();
+
+    // begin(key) ... end(): najwyżej kMaxItemCommands komend jednego elementu
+    void begin(uint64_t key);
+    void useProgram(GLuint program) { push(Command::Type::UseProgram, 0).name = program; }
+    void bindTexture(uint32_t unit, GLuint tex) { push(Command::Type::BindTexture, unit).name = tex; }
+    void uniform1f(GLint loc, float v) { push(Command::Type::Uniform1f, (uint32_t)loc).f = v; }
+    void uniform2f(GLint loc, const glm::vec2& v) {
+        Command& c = push(Command::Type::Uniform2f, (uint32_t)loc);
+        c.v[0] = v.x; c.v[1] = v.y;
+    }
+    void uniform3f(GLint loc, const glm::vec3& v) {
+        Command& c = push(Command::Type::Uniform3f, (uint32_t)loc);
+        c.v[0] = v.x; c.v[1] = v.y; c.v[2] = v.z;
+    }
+    void drawElements(uint32_t count, uint32_t firstIndex, int32_t baseVertex, uint32_t tag) {
+        Command& c = push(Command::Type::DrawElements, 0);
+        c.draw.count = count;
+        c.draw.firstIndex = firstIndex;
+        c.draw.tag = tag;
+        c.draw.baseVertex = baseVertex;
+    }
+    void end();
+
+    size_t itemCount() const { return items_; }
+    size_t bytesUsed() const { return arena_.bytesUsed(); }
+
+    // Elementy w kolejności nagrania
+    template <class Fn>
+    void forEachItem(Fn&& fn) const {
+        for (const Page* p = first_; p; p = p->next)
+            for (uint32_t i = 0; i < p->count; i++) fn(p->items[i]);
+    }
+
+private:
+    static constexpr uint32_t kPageItems = 256;
+    struct Page {
+        Page* next;
+        uint32_t count;
+        CommandItem items[kPageItems];
+    };
+
+    Command& push(Command::Type type, uint32_t slot);
+
+    LinearAllocator arena_;
+    Page* first_ = nullptr;
+    Page* last_ = nullptr;
+    size_t items_ = 0;
+
+    Command* open_ = nullptr;   // komendy elementu między begin() i end()
+    uint32_t openCount_ = 0;
+    uint64_t openKey_ = 0;
+};
+
+// Liczniki z replay (po odfiltrowaniu powtórzeń stanu)
+struct ReplayStats {
+    uint32_t draws = 0;
+    uint32_t programBinds = 0;
+    uint32_t textureBinds = 0;
+    uint32_t uniforms = 0;
+};
+
+// Komendy całej klatki: bufor na wątek (JobSystem::threadIndex, buforów
+// threadSlots()), po nagraniu sort() składa elementy wszystkich wątków i
+// sortuje po kluczu. CommandBuffer nie ma blokad: do wspólnego bufora
+// wątków spoza puli (poza głównym) wołający pisze pod własnym mutexem.
+// Klucz powinien być unikalny (np. kończyć się indeksem obiektu), wtedy
+// kolejność nie zależy od tego, który wątek co nagrał.
+class CommandList {
+public:
+    explicit CommandList(unsigned threads = 1);
+
+    // Początek klatki; liczbę wątków można zmienić tylko tu
+    void reset(unsigned threads);
+    CommandBuffer& buffer(unsigned threadIndex) { return *buffers_[threadIndex]; }
+    unsigned threads() const { return (unsigned)buffers_.size(); }
+
+    void sort();
+    const std::vector<CommandItem>& items() const { return sorted_; }
+    size_t bytesUsed() const;
+
+    // Wątek GL: wykonuje posortowane komendy, pomijając wiązania, które
+    // niczego nie zmieniają. Sam draw robi onDraw(cmd, stateChanges), żeby
+    // wołający mógł go obudować (profiler, liczniki).
+    template <class DrawFn>
+    ReplayStats replay(DrawFn&& onDraw) const;
+
+private:
+    std::vector<std::unique_ptr<CommandBuffer>> buffers_;
+    std::vector<CommandItem> sorted_;   // pojemność zostaje między klatkami
+};
+
+template <class DrawFn>
+ReplayStats CommandList::replay(DrawFn&& onDraw) const {
+    constexpr uint32_t kUnits = 8;
+    constexpr GLuint kUnknown = ~0u;   // stan sprzed replay nieznany - pierwsze wiązanie zawsze idzie
+    GLuint program = kUnknown;
+    GLuint textures[kUnits];
+    for (GLuint& t : textures) t = kUnknown;
+    uint32_t activeUnit = kUnknown;
+
+    ReplayStats stats;
+    uint32_t stateChanges = 0;
+    for (const CommandItem& item : sorted_) {
+        for (uint32_t i = 0; i < item.count; i++) {
+            const Command& c = item.commands[i];
+            switch (c.type) {
+            case Command::Type::UseProgram:
+                if (c.name != program) {
+                    glUseProgram(c.name);
+                    program = c.name;
+                    stats.programBinds++;
+                    stateChanges++;
+                }
+                break;
+            case Command::Type::BindTexture:
+                if (c.slot >= kUnits || c.name != textures[c.slot]) {
+                    if (c.slot != activeUnit) {
+                        glActiveTexture(GL_TEXTURE0 + c.slot);
+                        activeUnit = c.slot;
+                    }
+                    glBindTexture(GL_TEXTURE_2D, c.name);
+                    if (c.slot < kUnits) textures[c.slot] = c.name;
+                    stats.textureBinds++;
+                    stateChanges++;
+                }
+                break;
+            case Command::Type::Uniform1f:
+                glUniform1f((GLint)c.slot, c.f);
+                stats.uniforms++;
+                break;
+            case Command::Type::Uniform2f:
+                glUniform2fv((GLint)c.slot, 1, c.v);
+                stats.uniforms++;
+                break;
+            case Command::Type::Uniform3f:
+                glUniform3fv((GLint)c.slot, 1, c.v);
+                stats.uniforms++;
+                break;
+            case Command::Type::DrawElements:
+                onDraw(c, stateChanges);
+                stats.draws++;
+                stateChanges = 0;
+                break;
+            }
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,283 @@
+﻿#include "CompressedInput.h"
+#include "CpuProfiler.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef OBJ_GZIP
+#include <zlib.h>
+#endif
+#ifdef OBJ_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Pierwsze bajty pliku; strumień wraca na początek
+InputCompression Detect(std::ifstream& f) {
+    unsigned char m[4] = {0, 0, 0, 0};
+    f.read((char*)m, sizeof(m));
+    const std::streamsize n = f.gcount();
+    f.clear();
+    f.seekg(0);
+    if (n >= 2 && m[0] == 0x1f && m[1] == 0x8b) return InputCompression::Gzip;
+    if (n >= 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd) return InputCompression::Zstd;
+    return InputCompression::None;
+}
+
+} // namespace
+
+InputCompression DetectCompression(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return f ? Detect(f) : InputCompression::None;
+}
+
+bool CompressionSupported(InputCompression c) {
+    switch (c) {
+    case InputCompression::None: return true;
+#ifdef OBJ_GZIP
+    case InputCompression::Gzip: return true;
+#endif
+#ifdef OBJ_ZSTD
+    case InputCompression::Zstd: return true;
+#endif
+    default: return false;
+    }
+}
+
+const char* CompressionName(InputCompression c) {
+    switch (c) {
+    case InputCompression::Gzip: return "gzip";
+    case InputCompression::Zstd: return "zstd";
+    default: return "none";
+    }
+}
+
+namespace {
+
+constexpr size_t kInputChunk = 256 * 1024;   // skompresowane dane czytane naraz
+
+// Rozpakowanie jednego formatu: decode() wypełnia out od początku, 0 = koniec
+class Decoder {
+public:
+    virtual ~Decoder() = default;
+    virtual size_t decode(char* out, size_t capacity) = 0;
+};
+
+#ifdef OBJ_GZIP
+class GzipDecoder final : public Decoder {
+public:
+    GzipDecoder(std::ifstream&& file) : file_(std::move(file)), in_(kInputChunk) {
+        std::memset(&zs_, 0, sizeof(zs_));
+        // 15 + 32: okno 32 KB, nagłówek gzip albo zlib wykrywany sam
+        if (inflateInit2(&zs_, 15 + 32) != Z_OK) throw std::runtime_error("inflateInit2 nie powiodl sie");
+    }
+    ~GzipDecoder() override { inflateEnd(&zs_); }
+
+    size_t decode(char* out, size_t capacity) override {
+        zs_.next_out = (Bytef*)out;
+        zs_.avail_out = (uInt)capacity;
+        while (zs_.avail_out && !done_) {
+            if (!zs_.avail_in) {
+                file_.read(in_.data(), (std::streamsize)in_.size());
+                zs_.next_in = (Bytef*)in_.data();
+                zs_.avail_in = (uInt)file_.gcount();
+                if (!zs_.avail_in) throw std::runtime_error("Uciety plik gzip");
+            }
+            const int r = inflate(&zs_, Z_NO_FLUSH);
+            if (r == Z_STREAM_END) {
+                // gzip może mieć kilka członów jeden po drugim (cat a.gz b.gz)
+                if (!zs_.avail_in) {
+                    file_.read(in_.data(), (std::streamsize)in_.size());
+                    zs_.next_in = (Bytef*)in_.data();
+                    zs_.avail_in = (uInt)file_.gcount();
+                }
+                if (zs_.avail_in) inflateReset(&zs_);
+                else done_ = true;
+            } else if (r != Z_OK && r != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Blad gzip: ") + (zs_.msg ? zs_.msg : "inflate"));
+            }
+        }
+        return capacity - zs_.avail_out;
+    }
+
+private:
+    std::ifstream file_;
+    std::vector<char> in_;
+    z_stream zs_;
+    bool done_ = false;
+};
+#endif
+
+#ifdef OBJ_ZSTD
+class ZstdDecoder final : public Decoder {
+public:
+    ZstdDecoder(std::ifstream&& file) : file_(std::move(file)), in_(kInputChunk), ds_(ZSTD_createDStream()) {
+        if (!ds_) throw std::runtime_error("ZSTD_createDStream nie powiodl sie");
+        ZSTD_initDStream(ds_);
+    }
+    ~ZstdDecoder() override { ZSTD_freeDStream(ds_); }
+
+    size_t decode(char* out, size_t capacity) override {
+        ZSTD_outBuffer o = {out, capacity, 0};
+        while (o.pos < o.size && !done_) {
+            if (src_.pos == src_.size) {
+                file_.read(in_.data(), (std::streamsize)in_.size());
+                src_ = {in_.data(), (size_t)file_.gcount(), 0};
+                if (!src_.size) {
+                    // 0 po ramce = koniec; inaczej ramka urwana
+                    if (pending_) throw std::runtime_error("Uciety plik zstd");
+                    done_ = true;
+                    break;
+                }
+            }
+            const size_t r = ZSTD_decompressStream(ds_, &o, &src_);
+            if (ZSTD_isError(r)) throw std::runtime_error(std::string("Blad zstd: ") + ZSTD_getErrorName(r));
+            pending_ = r != 0;
+        }
+        return o.pos;
+    }
+
+private:
+    std::ifstream file_;
+    std::vector<char> in_;
+    ZSTD_DStream* ds_;
+    ZSTD_inBuffer src_ = {nullptr, 0, 0};
+    bool pending_ = false;
+    bool done_ = false;
+};
+#endif
+
+// Producent (własny wątek) rozpakowuje do bloków i wrzuca je do kolejki
+// ograniczonej queueBlocks; bloki oddane przez parser wracają do puli,
+// więc po rozgrzaniu nic się nie alokuje.
+class DecompressingStreamBuf final : public std::streambuf {
+public:
+    DecompressingStreamBuf(std::unique_ptr<Decoder> decoder, const DecompressSettings& s)
+        : decoder_(std::move(decoder)), blockSize_(s.blockSize ? s.blockSize : 1u << 20),
+          capacity_(s.queueBlocks ? s.queueBlocks : 1) {
+        thread_ = std::thread([this] { produce(); });
+    }
+    ~DecompressingStreamBuf() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        changed_.notify_all();
+        thread_.join();
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (current_.capacity()) free_.push_back(std::move(current_));
+        changed_.notify_all();
+        changed_.wait(lock, [&] { return !ready_.empty() || finished_; });
+        if (ready_.empty()) {
+            // parser dostaje błąd producenta zamiast końca pliku
+            if (error_) std::rethrow_exception(error_);
+            return traits_type::eof();
+        }
+        current_ = std::move(ready_.front());
+        ready_.pop_front();
+        lock.unlock();
+        setg(current_.data(), current_.data(), current_.data() + current_.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    void produce() {
+        PROFILE_THREAD("decompress");
+        try {
+            for (;;) {
+                std::vector<char> block;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    changed_.wait(lock, [&] { return stop_ || ready_.size() < capacity_; });
+                    if (stop_) break;
+                    if (!free_.empty()) {
+                        block = std::move(free_.back());
+                        free_.pop_back();
+                    }
+                }
+                block.resize(blockSize_);
+                size_t n = 0;
+                {
+                    PROFILE_ZONE("decompress block");
+                    n = decoder_->decode(block.data(), block.size());
+                }
+                if (!n) break;
+                block.resize(n);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ready_.push_back(std::move(block));
+                }
+                changed_.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+        }
+        changed_.notify_all();
+    }
+
+    std::unique_ptr<Decoder> decoder_;
+    const size_t blockSize_;
+    const size_t capacity_;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;   // i dla producenta, i dla parsera
+    std::deque<std::vector<char>> ready_;
+    std::vector<std::vector<char>> free_;
+    bool stop_ = false, finished_ = false;
+    std::exception_ptr error_;
+
+    std::vector<char> current_;         // blok, który czyta parser (tylko jego wątek)
+};
+
+class DecompressingStream final : public std::istream {
+public:
+    DecompressingStream(std::unique_ptr<Decoder> decoder, const DecompressSettings& s)
+        : std::istream(nullptr), buf_(std::move(decoder), s) {
+        rdbuf(&buf_);
+        exceptions(std::ios::badbit);
+    }
+
+private:
+    DecompressingStreamBuf buf_;
+};
+
+} // namespace
+
+std::unique_ptr<std::istream> OpenInputFile(const std::string& path, const DecompressSettings& settings) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return nullptr;
+    const InputCompression c = Detect(f);
+    if (!CompressionSupported(c))
+        throw std::runtime_error(std::string("Brak obslugi ") + CompressionName(c) + " w tym buildzie: " + path);
+
+    std::unique_ptr<Decoder> decoder;
+    switch (c) {
+#ifdef OBJ_GZIP
+    case InputCompression::Gzip: decoder = std::make_unique<GzipDecoder>(std::move(f)); break;
+#endif
+#ifdef OBJ_ZSTD
+    case InputCompression::Zstd: decoder = std::make_unique<ZstdDecoder>(std::move(f)); break;
+#endif
+    default: return std::make_unique<std::ifstream>(std::move(f));
+    }
+    return std::make_unique<DecompressingStream>(std::move(decoder), settings);
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+
+// Skompresowane pliki wejściowe (OBJ, MTL). Format rozpoznajemy po
+// magicznych bajtach, nie po rozszerzeniu, więc "model.obj.gz",
+// "model.obj.zst" i zwykły "model.obj" otwiera się tak samo.
+enum class InputCompression { None, Gzip, Zstd };
+
+InputCompression DetectCompression(const std::string& path);
+// gzip wymaga zlib (OBJ_GZIP), zstd - libzstd (OBJ_ZSTD); None zawsze
+bool CompressionSupported(InputCompression c);
+const char* CompressionName(InputCompression c);
+
+struct DecompressSettings {
+    size_t blockSize = 1u << 20;   // blok rozpakowanych danych
+    unsigned queueBlocks = 4;      // tyle bloków czeka najwyżej na parser
+};
+
+// Strumień do czytania pliku od początku do końca. Zwykły plik to
+// std::ifstream. Skompresowany rozpakowuje osobny wątek do ograniczonej
+// kolejki bloków (razem najwyżej queueBlocks + 1 bloków w pamięci, nigdy
+// cały plik), a parser czyta je przez getline/read jak z pliku. Błąd
+// rozpakowania wychodzi z odczytu jako wyjątek (badbit w exceptions()),
+// nie jako cichy koniec pliku. Bez skoków (seekg) - do tego potrzebny
+// zwykły plik (ObjIndex, LoadOBJOutOfCore).
+// Zawsze binarnie ('\r' z CRLF zostaje w liniach - parsery i tak robią Trim).
+// nullptr, gdy pliku nie da się otworzyć; rzuca, gdy format nieobsługiwany.
+std::unique_ptr<std::istream> OpenInputFile(const std::string& path, const DecompressSettings& settings = {});
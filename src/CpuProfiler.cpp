@@ -0,0 +1,215 @@
+﻿#include "CpuProfiler.h"
+#include "Benchmark.h"   // JsonEscape
+
+#include <iostream>
+
+#if CPU_PROFILER
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cpuprof {
+
+std::atomic<bool> gCapturing{false};
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t start, end;
+};
+
+// Jeden producent (właściciel wątku), czytelnik tylko przy zrzucie. Po
+// przepełnieniu nadpisujemy najstarsze zdarzenia; czytelnik odrzuca te,
+// które mogły zostać nadpisane w trakcie kopiowania.
+struct ThreadBuffer {
+    static const size_t kCapacity = 1 << 16;   // ~1.5 MB na wątek
+
+    std::vector<Event> events = std::vector<Event>(kCapacity);
+    std::atomic<uint64_t> written{0};
+    uint32_t tid = 0;
+    std::string name;
+    bool finished = false;   // wątek się skończył, bufor czeka na zapis śladu
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;  // wątki, które zapisały strefę
+    uint32_t nextTid = 0;
+    bool pending = false;    // (pod mutex) ślad ustawiony, jeszcze nie zapisany
+    CpuTraceOptions options;
+    int frame = 0;
+    bool active = false;     // okno ustawione, plik jeszcze nie zapisany
+    uint64_t windowStart = 0;
+};
+
+Registry& Reg() {
+    static Registry r;
+    return r;
+}
+
+// Bufor wątku powstaje dopiero przy pierwszej strefie (a strefy zapisujemy
+// tylko w trakcie przechwytywania), więc wątki krótkotrwałe - np. producent
+// CompressedInput na każdy plik - nic nie kosztują poza śladem. Przy końcu
+// wątku bufor wraca od razu albo, gdy ślad czeka na zapis, po zapisie.
+struct LocalSlot {
+    ThreadBuffer* buffer = nullptr;
+    const char* name = nullptr;   // PROFILE_THREAD przed pierwszą strefą
+
+    ~LocalSlot() {
+        if (!buffer) return;
+        Registry& r = Reg();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.pending) buffer->finished = true;
+        else std::erase_if(r.buffers, [&](const auto& b) { return b.get() == buffer; });
+    }
+};
+
+thread_local LocalSlot tLocal;
+
+ThreadBuffer& LocalBuffer() {
+    if (!tLocal.buffer) {
+        Registry& r = Reg();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>());
+        tLocal.buffer = r.buffers.back().get();
+        tLocal.buffer->tid = ++r.nextTid;
+        if (tLocal.name) tLocal.buffer->name = tLocal.name;
+    }
+    return *tLocal.buffer;
+}
+
+const auto kEpoch = std::chrono::steady_clock::now();
+
+void WriteTrace(Registry& r, uint64_t fromNs, uint64_t toNs) {
+    std::ofstream out(r.options.path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Nie mozna zapisac " << r.options.path << "\n";
+        return;
+    }
+
+    size_t count = 0, lost = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& b : r.buffers) {
+        if (!b->name.empty()) {
+            out << (first ? "" : ",\n")
+                << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << JsonEscape(b->name) << "\"}}";
+            first = false;
+        }
+
+        const uint64_t end = b->written.load(std::memory_order_acquire);
+        const uint64_t begin = end > ThreadBuffer::kCapacity ? end - ThreadBuffer::kCapacity : 0;
+        lost += (size_t)begin;
+        for (uint64_t i = begin; i < end; i++) {
+            Event e = b->events[i % ThreadBuffer::kCapacity];
+            // producent mógł w międzyczasie zawinąć bufor i nadpisać ten slot
+            if (b->written.load(std::memory_order_acquire) - i > ThreadBuffer::kCapacity) { lost++; continue; }
+            if (e.end < fromNs || e.start > toNs) continue;
+
+            char buf[96];
+            std::snprintf(buf, sizeof(buf), "\"ts\":%.3f,\"dur\":%.3f",
+                          e.start * 1e-3, (e.end - e.start) * 1e-3);
+            out << (first ? "" : ",\n")
+                << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << "," << buf
+                << ",\"name\":\"" << JsonEscape(e.name) << "\"}";
+            first = false;
+            count++;
+        }
+    }
+    out << "\n]}\n";
+    std::cout << "CPU trace: " << count << " stref -> " << r.options.path;
+    if (lost) std::cout << " (nadpisanych: " << lost << ")";
+    std::cout << "\n";
+}
+
+// Po zapisie (albo porzuceniu) śladu: bufory zakończonych wątków już zbędne
+void ReleaseFinished(Registry& r) {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.pending = false;
+    std::erase_if(r.buffers, [](const auto& b) { return b->finished; });
+}
+
+} // namespace
+
+uint64_t NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+void Record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer& b = LocalBuffer();
+    const uint64_t w = b.written.load(std::memory_order_relaxed);
+    b.events[w % ThreadBuffer::kCapacity] = Event{name, startNs, endNs};
+    b.written.store(w + 1, std::memory_order_release);
+}
+
+} // namespace cpuprof
+
+using namespace cpuprof;
+
+void StartCpuTrace(const CpuTraceOptions& o) {
+    Registry& r = Reg();
+    r.options = o;
+    r.frame = 0;
+    r.active = true;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.pending = true;
+    }
+    r.windowStart = 0;
+    if (o.firstFrame <= 0) {
+        r.windowStart = NowNs();
+        gCapturing.store(true, std::memory_order_relaxed);
+    }
+}
+
+void CpuFrameMark() {
+    Registry& r = Reg();
+    if (!r.active) return;
+
+    const int finished = r.frame++;
+    const int last = r.options.firstFrame < 0 ? 0 : r.options.lastFrame;
+    if (finished >= last && gCapturing.load(std::memory_order_relaxed)) {
+        gCapturing.store(false, std::memory_order_relaxed);
+        r.active = false;
+        WriteTrace(r, r.windowStart, NowNs());
+        ReleaseFinished(r);
+    } else if (r.frame == r.options.firstFrame) {
+        r.windowStart = NowNs();
+        gCapturing.store(true, std::memory_order_relaxed);
+    }
+}
+
+void FinishCpuTrace() {
+    Registry& r = Reg();
+    if (!r.active) return;
+    gCapturing.store(false, std::memory_order_relaxed);
+    r.active = false;
+    if (r.windowStart) WriteTrace(r, r.windowStart, NowNs());
+    ReleaseFinished(r);
+}
+
+void SetCpuThreadName(const char* name) {
+    tLocal.name = name;
+    if (!tLocal.buffer) return;   // nazwa trafi do bufora przy pierwszej strefie
+    std::lock_guard<std::mutex> lock(Reg().mutex);
+    tLocal.buffer->name = name;
+}
+
+#else
+
+void StartCpuTrace(const CpuTraceOptions&) {
+    std::cerr << "Profiler CPU wylaczony (zbuduj z -DCPU_PROFILER=ON)\n";
+}
+void CpuFrameMark() {}
+void FinishCpuTrace() {}
+void SetCpuThreadName(const char*) {}
+
+#endif
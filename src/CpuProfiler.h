@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <string>
+#include <cstdint>
+
+// Profiler CPU na strefach RAII:
+//
+//   void LoadStuff() {
+//       PROFILE_ZONE("LoadStuff");
+//       ...
+//   }
+//
+// Każdy wątek pisze do własnego bufora pierścieniowego (jeden producent,
+// bez blokad; mutex tylko przy pierwszej strefie wątku), a zrzut to JSON
+// chrome://tracing / Perfetto (format trace_event, zdarzenia "X").
+// Bez CPU_PROFILER (opcja CMake) makra znikają całkowicie, a funkcje
+// sterujące tylko ostrzegają.
+
+struct CpuTraceOptions {
+    std::string path;          // plik JSON
+    int firstFrame = -1;       // -1 = start programu aż do końca pierwszej klatki (0 = też od startu)
+    int lastFrame = -1;        // włącznie
+};
+
+// Ustawia okno nagrania; przy firstFrame <= 0 nagrywanie rusza od razu
+void StartCpuTrace(const CpuTraceOptions& o);
+// Koniec klatki (PROFILE_FRAME); zamyka okno i zapisuje plik, gdy trzeba
+void CpuFrameMark();
+// Zapisuje, jeśli okno jeszcze się nie domknęło (np. wcześniejsze wyjście)
+void FinishCpuTrace();
+void SetCpuThreadName(const char* name);
+
+#if CPU_PROFILER
+
+#include <atomic>
+
+namespace cpuprof {
+
+extern std::atomic<bool> gCapturing;
+
+uint64_t NowNs();
+// name musi żyć do zrzutu - w praktyce literał
+void Record(const char* name, uint64_t startNs, uint64_t endNs);
+
+class Zone {
+public:
+    explicit Zone(const char* name)
+        : name_(gCapturing.load(std::memory_order_relaxed) ? name : nullptr),
+          start_(name_ ? NowNs() : 0) {}
+    ~Zone() { if (name_) Record(name_, start_, NowNs()); }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+
+} // namespace cpuprof
+
+#define CPU_PROFILE_CONCAT2(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT2(a, b)
+#define PROFILE_ZONE(name) ::cpuprof::Zone CPU_PROFILE_CONCAT(cpuZone_, __LINE__)(name)
+#define PROFILE_FRAME() CpuFrameMark()
+#define PROFILE_THREAD(name) SetCpuThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
@@ -0,0 +1,86 @@
+﻿#include "FileWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(const std::string& dir) : dir_(dir) {
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        std::cerr << "inotify_init1 fail, hot reload wylaczony\n";
+        return;
+    }
+    // edytory zapisują albo w miejscu (CLOSE_WRITE), albo przez plik tymczasowy + rename (MOVED_TO)
+    wd_ = inotify_add_watch(fd_, dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd_ < 0) std::cerr << "Nie moge obserwowac katalogu: " << dir_ << "\n";
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd_ >= 0) close(fd_);
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+    if (fd_ < 0 || wd_ < 0) return changed;
+
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = read(fd_, buf, sizeof(buf));
+        if (n <= 0) break; // EAGAIN = nic więcej w kolejce
+
+        for (char* p = buf; p < buf + n; ) {
+            const inotify_event* ev = (const inotify_event*)p;
+            if (ev->len > 0) {
+                std::string name = ev->name;
+                if (std::find(changed.begin(), changed.end(), name) == changed.end())
+                    changed.push_back(name);
+            }
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
+
+#else
+
+static const std::chrono::milliseconds kPollInterval(500);
+
+FileWatcher::FileWatcher(const std::string& dir) : dir_(dir) {
+    scan(nullptr);
+    lastScan_ = std::chrono::steady_clock::now();
+}
+
+FileWatcher::~FileWatcher() = default;
+
+void FileWatcher::scan(std::vector<std::string>* changed) {
+    std::error_code ec;
+    for (const auto& e : std::filesystem::directory_iterator(dir_, ec)) {
+        if (!e.is_regular_file(ec)) continue;
+        std::string name = e.path().filename().string();
+        auto t = e.last_write_time(ec);
+        if (ec) continue;
+        auto it = stamps_.find(name);
+        if (it == stamps_.end() || it->second != t) {
+            if (changed && it != stamps_.end()) changed->push_back(name);
+            stamps_[name] = t;
+        }
+    }
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastScan_ < kPollInterval) return changed;
+    lastScan_ = now;
+    scan(&changed);
+    return changed;
+}
+
+#endif
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
+
+// Obserwuje jeden katalog i zwraca nazwy plików, które zostały zapisane.
+// Linux: inotify (nieblokujący deskryptor, poll() nic nie kosztuje gdy brak zmian).
+// Gdzie indziej: porównanie last_write_time co pollInterval.
+class FileWatcher {
+public:
+    explicit FileWatcher(const std::string& dir);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Nazwy plików (bez katalogu) zmienionych od ostatniego wywołania
+    std::vector<std::string> poll();
+
+private:
+    std::string dir_;
+#ifdef __linux__
+    int fd_ = -1;
+    int wd_ = -1;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> stamps_;
+    std::chrono::steady_clock::time_point lastScan_;
+    void scan(std::vector<std::string>* changed);
+#endif
+};
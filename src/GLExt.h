@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <cstring>
+
+#include <glad/glad.h>
+
+// glad jest wygenerowany dla czystego GL 3.3 bez rozszerzeń, więc to, czego
+// potrzebujemy ponad 3.3, dociągamy sami (tak jak anizotropię w main.cpp).
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_EXT)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_EXT)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_EXT)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)(GLuint count);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC_EXT)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+struct GLExtensions {
+    bool anisotropic = false;  // GL_EXT_texture_filter_anisotropic
+
+    // GL 4.1 / GL_ARB_get_program_binary
+    bool programBinary = false;
+    PFNGLGETPROGRAMBINARYPROC_EXT GetProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYPROC_EXT ProgramBinary = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC_EXT ProgramParameteri = nullptr;
+
+    // GL_KHR_parallel_shader_compile (albo wersja ARB)
+    bool parallelShaderCompile = false;
+    PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT MaxShaderCompilerThreads = nullptr;
+
+    // GL 4.4 / GL_ARB_buffer_storage (trwale zmapowane bufory)
+    bool bufferStorage = false;
+    PFNGLBUFFERSTORAGEPROC_EXT BufferStorage = nullptr;
+};
+
+inline GLExtensions gExt;
+
+static inline bool HasGLVersion(int major, int minor) {
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+static inline bool HasGLExtension(const char* name) {
+    GLint n = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+    for (GLint i = 0; i < n; i++) {
+        const char* e = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (e && std::strcmp(e, name) == 0) return true;
+    }
+    return false;
+}
+
+// Wołać po gladLoadGLLoader, z tym samym loaderem
+static inline void LoadGLExtensions(GLADloadproc load) {
+    gExt = GLExtensions{};
+    gExt.anisotropic = HasGLExtension("GL_EXT_texture_filter_anisotropic") ||
+                       HasGLExtension("GL_ARB_texture_filter_anisotropic");
+
+    if (HasGLVersion(4, 1) || HasGLExtension("GL_ARB_get_program_binary")) {
+        gExt.GetProgramBinary  = (PFNGLGETPROGRAMBINARYPROC_EXT)load("glGetProgramBinary");
+        gExt.ProgramBinary     = (PFNGLPROGRAMBINARYPROC_EXT)load("glProgramBinary");
+        gExt.ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC_EXT)load("glProgramParameteri");
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        gExt.programBinary = gExt.GetProgramBinary && gExt.ProgramBinary &&
+                             gExt.ProgramParameteri && formats > 0;
+    }
+
+    if (HasGLExtension("GL_KHR_parallel_shader_compile")) {
+        gExt.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)load("glMaxShaderCompilerThreadsKHR");
+    } else if (HasGLExtension("GL_ARB_parallel_shader_compile")) {
+        gExt.MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)load("glMaxShaderCompilerThreadsARB");
+    }
+    if (gExt.MaxShaderCompilerThreads) {
+        // 0xFFFFFFFF = "ile sterownik uzna za sensowne"
+        gExt.MaxShaderCompilerThreads(0xFFFFFFFFu);
+        gExt.parallelShaderCompile = true;
+    }
+
+    if (HasGLVersion(4, 4) || HasGLExtension("GL_ARB_buffer_storage")) {
+        gExt.BufferStorage = (PFNGLBUFFERSTORAGEPROC_EXT)load("glBufferStorage");
+        gExt.bufferStorage = gExt.BufferStorage != nullptr;
+    }
+}
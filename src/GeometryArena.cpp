@@ -0,0 +1,223 @@
+﻿#include "GeometryArena.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+
+// Podwaja pojemność (co najmniej 1024), aż zmieści required elementów
+static uint32_t GrowCapacity(uint32_t capacity, uint64_t required) {
+    uint64_t cap = std::max<uint64_t>(capacity, 1024);
+    while (cap < required) cap *= 2;
+    if (cap > 0xFFFFFFFFull) throw std::length_error("GeometryArena: bufor ponad 2^32 elementow");
+    return (uint32_t)cap;
+}
+
+// Kopia zakresów GPU->GPU między dwoma buforami (albo rozłącznymi
+// fragmentami jednego) bez przechodzenia przez CPU
+static void CopyElements(GLuint src, GLuint dst, size_t elemSize, uint32_t from, uint32_t to, uint32_t count) {
+    if (!count) return;
+    glBindBuffer(GL_COPY_READ_BUFFER, src);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        (GLintptr)(from * elemSize), (GLintptr)(to * elemSize), (GLsizeiptr)(count * elemSize));
+}
+
+GeometryArena::GeometryArena(uint32_t vertexCapacity, uint32_t indexCapacity)
+    : vertexAlloc_(vertexCapacity), indexAlloc_(indexCapacity) {
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    setupVao();
+    glBindVertexArray(0);
+}
+
+GeometryArena::~GeometryArena() {
+    glDeleteVertexArrays(1, &vao_);
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &ebo_);
+}
+
+void GeometryArena::setupVao() {
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, nrm));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);   // stan VAO
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GeometryArena::Handle GeometryArena::allocate(uint32_t vertices, uint32_t indices) {
+    auto va = vertexAlloc_.allocate(vertices);
+    auto ia = indexAlloc_.allocate(indices);
+    if (!va || !ia) {
+        if (va) vertexAlloc_.free(va.node);
+        if (ia) indexAlloc_.free(ia.node);
+        reserve(vertices, indices);
+        va = vertexAlloc_.allocate(vertices);
+        ia = indexAlloc_.allocate(indices);
+        if (!va || !ia) throw std::runtime_error("GeometryArena: brak miejsca po powiekszeniu buforow");
+    }
+
+    Handle h;
+    if (!spareHandles_.empty()) {
+        h = spareHandles_.back();
+        spareHandles_.pop_back();
+    } else {
+        h = (Handle)ranges_.size();
+        ranges_.emplace_back();
+    }
+    Slot& s = ranges_[h];
+    s.range = Range{va.offset, vertices, ia.offset, indices};
+    s.vertexNode = va.node;
+    s.indexNode = ia.node;
+    s.live = true;
+    return h;
+}
+
+void GeometryArena::free(Handle h) {
+    if (h >= ranges_.size() || !ranges_[h].live) throw std::logic_error("GeometryArena::free: nieznany zakres");
+    Slot& s = ranges_[h];
+    vertexAlloc_.free(s.vertexNode);
+    indexAlloc_.free(s.indexNode);
+    s = Slot{};
+    spareHandles_.push_back(h);
+}
+
+void GeometryArena::resize(Handle h, uint32_t vertices, uint32_t indices) {
+    PROFILE_ZONE("GeometryArena::resize");
+    Slot& s = ranges_[h];
+    const Range old = s.range;
+    // nowe miejsce obok starego (stare jeszcze zajęte), kopia, zwolnienie starego
+    const auto va = vertexAlloc_.allocate(vertices);
+    const auto ia = indexAlloc_.allocate(indices);
+    if (!va || !ia) {
+        // Obok się nie mieści: przebudowa od razu z nowym rozmiarem zakresu -
+        // jedna kopia i bez starego zakresu w nowych buforach
+        if (va) vertexAlloc_.free(va.node);
+        if (ia) indexAlloc_.free(ia.node);
+        const uint32_t vcap = GrowCapacity(vertexAlloc_.capacity(), vertexAlloc_.used() - old.vertexCount + vertices);
+        const uint32_t icap = GrowCapacity(indexAlloc_.capacity(), indexAlloc_.used() - old.indexCount + indices);
+        if (vcap == vertexAlloc_.capacity() && icap == indexAlloc_.capacity()) compactions_++;
+        else grows_++;
+        rebuild(vcap, icap, h, vertices, indices);
+        return;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    CopyElements(vbo_, vbo_, sizeof(Vertex), old.firstVertex, va.offset, std::min(old.vertexCount, vertices));
+    CopyElements(ebo_, ebo_, sizeof(uint32_t), old.firstIndex, ia.offset, std::min(old.indexCount, indices));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    copyMs_ += MsSince(t0);
+
+    vertexAlloc_.free(s.vertexNode);
+    indexAlloc_.free(s.indexNode);
+    s.range = Range{va.offset, vertices, ia.offset, indices};
+    s.vertexNode = va.node;
+    s.indexNode = ia.node;
+    layoutVersion_++;
+}
+
+void GeometryArena::reserve(uint32_t vertices, uint32_t indices) {
+    const uint32_t vcap = GrowCapacity(vertexAlloc_.capacity(), vertexAlloc_.used() + std::max(vertices, 1u));
+    const uint32_t icap = GrowCapacity(indexAlloc_.capacity(), indexAlloc_.used() + std::max(indices, 1u));
+    // Wolnego starcza, tylko jest poszatkowane: wystarczy dosunąć zakresy
+    if (vcap == vertexAlloc_.capacity() && icap == indexAlloc_.capacity()) compactions_++;
+    else grows_++;
+    rebuild(vcap, icap);
+}
+
+void GeometryArena::compact() {
+    const auto v = vertexAlloc_.stats(), i = indexAlloc_.stats();
+    if (v.freeRegions <= 1 && i.freeRegions <= 1 && v.largestFree + v.used == v.capacity &&
+        i.largestFree + i.used == i.capacity) {
+        // jeden wolny blok na końcu = już dosunięte (albo pusto)
+        return;
+    }
+    compactions_++;
+    rebuild(vertexAlloc_.capacity(), indexAlloc_.capacity());
+}
+
+void GeometryArena::rebuild(uint32_t vertexCapacity, uint32_t indexCapacity,
+                            Handle resized, uint32_t vertices, uint32_t indices) {
+    // Nowe bufory z zakresami dosuniętymi do początku. Kopia do osobnego
+    // bufora, bo glCopyBufferSubData nie pozwala na nakładające się zakresy.
+    PROFILE_ZONE("GeometryArena rebuild");
+    auto t0 = std::chrono::steady_clock::now();
+    const GLuint oldVbo = vbo_, oldEbo = ebo_;
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+
+    // świeży alokator oddaje kolejne przydziały jeden za drugim
+    vertexAlloc_ = OffsetAllocator(vertexCapacity);
+    indexAlloc_ = OffsetAllocator(indexCapacity);
+    for (Handle h = 0; h < (Handle)ranges_.size(); h++) {
+        Slot& s = ranges_[h];
+        if (!s.live) continue;
+        const uint32_t vcount = h == resized ? vertices : s.range.vertexCount;
+        const uint32_t icount = h == resized ? indices : s.range.indexCount;
+        const auto va = vertexAlloc_.allocate(vcount);
+        const auto ia = indexAlloc_.allocate(icount);
+        CopyElements(oldVbo, vbo_, sizeof(Vertex), s.range.firstVertex, va.offset, std::min(vcount, s.range.vertexCount));
+        CopyElements(oldEbo, ebo_, sizeof(uint32_t), s.range.firstIndex, ia.offset, std::min(icount, s.range.indexCount));
+        s.range = Range{va.offset, vcount, ia.offset, icount};
+        s.vertexNode = va.node;
+        s.indexNode = ia.node;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &oldVbo);
+    glDeleteBuffers(1, &oldEbo);
+    setupVao();
+    glBindVertexArray(0);
+    copyMs_ += MsSince(t0);
+    layoutVersion_++;
+}
+
+void GeometryArena::uploadVertices(Handle h, uint32_t first, const Vertex* data, uint32_t count) {
+    const Range& r = range(h);
+    if (first + count > r.vertexCount) throw std::out_of_range("GeometryArena: wierzcholki poza zakresem");
+    if (!count) return;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(r.firstVertex + first) * sizeof(Vertex),
+                    (GLsizeiptr)count * sizeof(Vertex), data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::uploadIndices(Handle h, uint32_t first, const uint32_t* data, uint32_t count) {
+    const Range& r = range(h);
+    if (first + count > r.indexCount) throw std::out_of_range("GeometryArena: indeksy poza zakresem");
+    if (!count) return;
+    // EBO przez GL_COPY_WRITE_BUFFER: GL_ELEMENT_ARRAY_BUFFER to stan aktualnego VAO
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(r.firstIndex + first) * sizeof(uint32_t),
+                    (GLsizeiptr)count * sizeof(uint32_t), data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+GeometryArena::Stats GeometryArena::stats() const {
+    Stats s;
+    s.vertices = vertexAlloc_.stats();
+    s.indices = indexAlloc_.stats();
+    s.ranges = (uint32_t)(ranges_.size() - spareHandles_.size());
+    s.grows = grows_;
+    s.compactions = compactions_;
+    s.copyMs = copyMs_;
+    return s;
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "ObjLoader.h"
+#include "OffsetAllocator.h"
+
+// Wspólne bufory geometrii: jeden VBO (Vertex) i jeden EBO (uint32) na
+// wszystkie modele, jeden VAO. Model dostaje zakres wierzchołków i indeksów
+// z OffsetAllocator; jego indeksy zostają lokalne (od 0), a rysuje się
+// glDrawElementsBaseVertex(firstIndex + ..., baseVertex = firstVertex).
+//
+// Zakresy mogą się przesuwać (resize, compact, wzrost buforów), dlatego
+// właściciel trzyma Handle i czyta offsety przez range() przy rysowaniu.
+// layoutVersion() rośnie przy każdym przesunięciu albo nowym buforze.
+// Tylko wątek GL.
+class GeometryArena {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle kNoHandle = ~0u;
+
+    struct Range {
+        uint32_t firstVertex = 0, vertexCount = 0;
+        uint32_t firstIndex = 0, indexCount = 0;
+    };
+
+    struct Stats {
+        OffsetAllocator::Stats vertices, indices;   // w elementach
+        uint32_t ranges = 0;
+        uint32_t grows = 0;          // realokacje buforów
+        uint32_t compactions = 0;
+        double copyMs = 0.0;         // kopiowanie GPU->GPU (wzrost, resize, compact)
+    };
+
+    // Pojemność początkowa w elementach; rośnie x2 w miarę potrzeb
+    GeometryArena(uint32_t vertexCapacity = 256 * 1024, uint32_t indexCapacity = 1024 * 1024);
+    ~GeometryArena();
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    Handle allocate(uint32_t vertices, uint32_t indices);
+    // Nowy rozmiar z zachowaniem zawartości (do min(stary, nowy))
+    void resize(Handle h, uint32_t vertices, uint32_t indices);
+    void free(Handle h);
+    // Dosuwa wszystkie zakresy do początku buforów (jedna kopia na zakres)
+    void compact();
+
+    // Zapis części zakresu: od wierzchołka/indeksu first (względem zakresu)
+    void uploadVertices(Handle h, uint32_t first, const Vertex* data, uint32_t count);
+    void uploadIndices(Handle h, uint32_t first, const uint32_t* data, uint32_t count);
+
+    const Range& range(Handle h) const { return ranges_[h].range; }
+    GLuint vao() const { return vao_; }
+    GLuint vertexBuffer() const { return vbo_; }
+    GLuint indexBuffer() const { return ebo_; }
+    uint32_t layoutVersion() const { return layoutVersion_; }
+    Stats stats() const;
+
+private:
+    struct Slot {
+        Range range;
+        OffsetAllocator::Node vertexNode = OffsetAllocator::kNoNode;
+        OffsetAllocator::Node indexNode = OffsetAllocator::kNoNode;
+        bool live = false;
+    };
+
+    // Miejsce na vertices/indices: najpierw compact, jeśli wolnego starczy
+    // tylko w kawałkach, potem wzrost buforów
+    void reserve(uint32_t vertices, uint32_t indices);
+    // resized (opcjonalnie) dostaje od razu nowy rozmiar vertices/indices
+    void rebuild(uint32_t vertexCapacity, uint32_t indexCapacity,
+                 Handle resized = kNoHandle, uint32_t vertices = 0, uint32_t indices = 0);
+    void setupVao();
+
+    GLuint vao_ = 0, vbo_ = 0, ebo_ = 0;
+    OffsetAllocator vertexAlloc_, indexAlloc_;
+    std::vector<Slot> ranges_;
+    std::vector<Handle> spareHandles_;
+    uint32_t layoutVersion_ = 0;
+    uint32_t grows_ = 0, compactions_ = 0;
+    double copyMs_ = 0.0;
+};
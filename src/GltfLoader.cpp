@@ -0,0 +1,1074 @@
+﻿#include "GltfLoader.h"
+#include "MappedFile.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+
+// ---------------------------------------------------------------- JSON ---
+
+// Minimalne drzewo JSON - tyle, ile trzeba do nagłówka glTF
+struct Json {
+    enum class Type : uint8_t { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json& operator[](std::string_view key) const {
+        for (const auto& [k, v] : members)
+            if (k == key) return v;
+        return Null();
+    }
+    const Json& operator[](size_t i) const { return i < items.size() ? items[i] : Null(); }
+    size_t size() const { return items.size(); }
+    bool has(std::string_view key) const { return (*this)[key].type != Type::Null; }
+    double num(double def = 0.0) const { return type == Type::Number ? number : def; }
+    int integer(int def = -1) const { return type == Type::Number ? (int)number : def; }
+    const std::string& str() const { return string; }
+
+    static const Json& Null() {
+        static const Json null;
+        return null;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    Json parse() {
+        Json v = value();
+        skipSpace();
+        if (p_ != end_) fail("smieci po JSON");
+        return v;
+    }
+
+private:
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string("Blad JSON glTF: ") + what);
+    }
+    void skipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) p_++;
+    }
+    bool consume(char c) {
+        skipSpace();
+        if (p_ < end_ && *p_ == c) {
+            p_++;
+            return true;
+        }
+        return false;
+    }
+    void expect(char c) {
+        if (!consume(c)) fail("nieoczekiwany znak");
+    }
+    bool literal(const char* word) {
+        const size_t n = std::strlen(word);
+        if ((size_t)(end_ - p_) < n || std::memcmp(p_, word, n) != 0) return false;
+        p_ += n;
+        return true;
+    }
+
+    Json value() {
+        skipSpace();
+        if (p_ >= end_) fail("koniec danych");
+        Json v;
+        switch (*p_) {
+        case '{':
+            p_++;
+            v.type = Json::Type::Object;
+            if (consume('}')) return v;
+            do {
+                skipSpace();
+                std::string key = string();
+                expect(':');
+                v.members.emplace_back(std::move(key), value());
+            } while (consume(','));
+            expect('}');
+            return v;
+        case '[':
+            p_++;
+            v.type = Json::Type::Array;
+            if (consume(']')) return v;
+            do v.items.push_back(value()); while (consume(','));
+            expect(']');
+            return v;
+        case '"':
+            v.type = Json::Type::String;
+            v.string = string();
+            return v;
+        default:
+            if (literal("true")) { v.type = Json::Type::Bool; v.boolean = true; return v; }
+            if (literal("false")) { v.type = Json::Type::Bool; return v; }
+            if (literal("null")) return v;
+            return numberValue();
+        }
+    }
+
+    Json numberValue() {
+        const char* start = p_;
+        while (p_ < end_ && (std::strchr("+-.eE", *p_) || (*p_ >= '0' && *p_ <= '9'))) p_++;
+        if (p_ == start) fail("nieoczekiwany znak");
+        Json v;
+        v.type = Json::Type::Number;
+        // strtod czyta do końca liczby, a bufor nie musi kończyć się zerem
+        v.number = std::strtod(std::string(start, p_).c_str(), nullptr);
+        return v;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out.push_back((char)cp);
+        } else if (cp < 0x800) {
+            out.push_back((char)(0xC0 | (cp >> 6)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            out.push_back((char)(0xE0 | (cp >> 12)));
+            out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back((char)(0xF0 | (cp >> 18)));
+            out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    uint32_t hex4() {
+        if (end_ - p_ < 4) fail("urwane \\u");
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) {
+            const char c = *p_++;
+            v <<= 4;
+            if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+            else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+            else fail("zly \\u");
+        }
+        return v;
+    }
+
+    std::string string() {
+        if (p_ >= end_ || *p_ != '"') fail("oczekiwany napis");
+        p_++;
+        std::string out;
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ != '\\') {
+                out.push_back(*p_++);
+                continue;
+            }
+            if (++p_ >= end_) break;
+            const char e = *p_++;
+            switch (e) {
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp = hex4();
+                if (cp >= 0xD800 && cp < 0xDC00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+                    p_ += 2;
+                    const uint32_t lo = hex4();
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default: out.push_back(e); break;   // \" \\ \/
+            }
+        }
+        if (p_ >= end_) fail("urwany napis");
+        p_++;
+        return out;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+// ------------------------------------------------------------- pomocnicze ---
+
+std::string LowerExtension(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+    return ext;
+}
+
+std::string DirectoryOf(const std::string& path) {
+    std::string dir = std::filesystem::path(path).parent_path().generic_string();
+    return dir.empty() ? "." : dir;
+}
+
+// "%20" -> " " (URI w glTF są zakodowane)
+std::string UriDecode(const std::string& uri) {
+    std::string out;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            out.push_back((char)std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out.push_back(uri[i]);
+        }
+    }
+    return out;
+}
+
+std::string UriEncode(const std::string& path) {
+    static const char* hex = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : path) {
+        if (std::isalnum(c) || std::strchr("-._~/", c)) {
+            out.push_back((char)c);
+        } else {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 15]);
+        }
+    }
+    return out;
+}
+
+std::vector<unsigned char> Base64Decode(std::string_view s) {
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+' || c == '-') return 62;
+        if (c == '/' || c == '_') return 63;
+        return -1;
+    };
+    std::vector<unsigned char> out;
+    out.reserve(s.size() / 4 * 3);
+    uint32_t acc = 0;
+    int bits = 0;
+    for (char c : s) {
+        const int v = value(c);
+        if (v < 0) continue;   // '=' i białe znaki
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back((unsigned char)(acc >> bits));
+        }
+    }
+    return out;
+}
+
+constexpr int kByte = 5120, kUnsignedByte = 5121, kShort = 5122, kUnsignedShort = 5123,
+              kUnsignedInt = 5125, kFloat = 5126;
+
+int ComponentSize(int type) {
+    switch (type) {
+    case kByte: case kUnsignedByte: return 1;
+    case kShort: case kUnsignedShort: return 2;
+    case kUnsignedInt: case kFloat: return 4;
+    default: throw std::runtime_error("glTF: nieznany componentType " + std::to_string(type));
+    }
+}
+
+int ComponentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT4") return 16;
+    throw std::runtime_error("glTF: nieobslugiwany typ akcesora " + type);
+}
+
+// Rozmiar / przesunięcie / indeks z JSON jako size_t. Ujemne, ułamkowe i
+// większe niż 2^53 (double nie trzyma ich dokładnie) odrzucamy przed
+// rzutowaniem, żeby spreparowany plik nie przekręcił sum przy sprawdzaniu
+// zakresów. Brak pola = def.
+size_t SizeField(const Json& j, const char* field, size_t def = 0) {
+    if (j.type == Json::Type::Null) return def;
+    const double d = j.num(-1.0);
+    if (!(d >= 0.0) || d != std::floor(d) || d >= 9007199254740992.0)
+        throw std::runtime_error(std::string("glTF: niepoprawne ") + field);
+    return (size_t)d;
+}
+
+// ---------------------------------------------------------------- dokument ---
+
+struct BufferView {
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    size_t stride = 0;   // 0 = ciasno
+};
+
+struct Accessor {
+    const unsigned char* data = nullptr;   // pierwszy element
+    size_t count = 0;
+    size_t stride = 0;                     // odstęp elementów (z widoku albo rozmiar elementu)
+    size_t elemSize = 0;
+    int componentType = 0, components = 0;
+    bool normalized = false;
+    int view = -1;
+    bool hasBounds = false;
+    glm::vec3 min{0.f}, max{0.f};
+
+    float component(size_t i, int c) const {
+        const unsigned char* e = data + i * stride;
+        switch (componentType) {
+        case kFloat: { float f; std::memcpy(&f, e + 4 * c, 4); return f; }
+        case kUnsignedByte: { const float v = e[c]; return normalized ? v / 255.f : v; }
+        case kByte: { const float v = (int8_t)e[c]; return normalized ? std::max(v / 127.f, -1.f) : v; }
+        case kUnsignedShort: { uint16_t u; std::memcpy(&u, e + 2 * c, 2); return normalized ? u / 65535.f : (float)u; }
+        case kShort: { int16_t s; std::memcpy(&s, e + 2 * c, 2); return normalized ? std::max(s / 32767.f, -1.f) : (float)s; }
+        case kUnsignedInt: { uint32_t u; std::memcpy(&u, e + 4 * c, 4); return (float)u; }
+        }
+        return 0.f;
+    }
+    uint32_t index(size_t i) const {
+        const unsigned char* e = data + i * stride;
+        switch (componentType) {
+        case kUnsignedByte: return e[0];
+        case kUnsignedShort: { uint16_t u; std::memcpy(&u, e, 2); return u; }
+        default: { uint32_t u; std::memcpy(&u, e, 4); return u; }
+        }
+    }
+};
+
+// Zestaw wierzchołków: akcesory atrybutów + transformacja węzła. Prymitywy
+// z tym samym zestawem dzielą wierzchołki (indeksy przesunięte o first).
+struct VertexSet {
+    int position = -1, uv = -1, normal = -1;
+    glm::mat4 world{1.f};
+    bool identity = true;
+    bool packed = false;       // układ = Vertex: jeden memcpy
+    uint32_t users = 0;        // prymitywy korzystające z zestawu
+    size_t count = 0;
+    uint32_t first = 0;        // ustalane przy wysyłaniu
+    bool emitted = false;
+};
+
+struct Draw {
+    uint32_t set = 0;
+    int indices = -1;          // -1 = kolejne wierzchołki
+    int material = -1;
+    size_t indexCount = 0;
+    bool hasBounds = false;    // extras.boundsMin/Max (SaveGLB)
+    glm::vec3 boundsMin{0.f}, boundsMax{0.f};
+};
+
+class GltfDocument {
+public:
+    explicit GltfDocument(const std::string& path, bool geometry = true) : baseDir_(DirectoryOf(path)) {
+        PROFILE_ZONE("glTF parse");
+        file_ = MappedFile(path);
+        const unsigned char* d = file_.data();
+        std::span<const unsigned char> bin;
+        if (file_.size() >= 12 && std::memcmp(d, "glTF", 4) == 0) {
+            // GLB: nagłówek 12 B, potem kawałki [długość, typ, dane]
+            uint32_t version = 0;
+            std::memcpy(&version, d + 4, 4);
+            if (version != 2) throw std::runtime_error("GLB: wersja " + std::to_string(version) + " nieobslugiwana");
+            size_t at = 12;
+            while (at + 8 <= file_.size()) {
+                uint32_t len = 0, type = 0;
+                std::memcpy(&len, d + at, 4);
+                std::memcpy(&type, d + at + 4, 4);
+                if (at + 8 + len > file_.size()) throw std::runtime_error("GLB: uciety kawalek");
+                if (type == 0x4E4F534A) json_ = JsonParser((const char*)d + at + 8, (const char*)d + at + 8 + len).parse();
+                else if (type == 0x004E4942) bin = {d + at + 8, len};
+                at += 8 + ((len + 3) & ~3u);
+            }
+            if (json_.type != Json::Type::Object) throw std::runtime_error("GLB bez JSON: " + path);
+        } else {
+            json_ = JsonParser((const char*)d, (const char*)d + file_.size()).parse();
+        }
+        const std::string version = json_["asset"]["version"].str();
+        if (!version.empty() && version[0] != '2') throw std::runtime_error("glTF: wersja " + version + " nieobslugiwana");
+        if (!geometry) return;
+
+        for (const Json& b : json_["buffers"].items) {
+            const std::string& uri = b["uri"].str();
+            const size_t length = SizeField(b["byteLength"], "byteLength");
+            std::span<const unsigned char> data;
+            if (uri.empty()) {
+                data = bin;   // bufor 0 GLB
+            } else if (uri.rfind("data:", 0) == 0) {
+                const size_t comma = uri.find(',');
+                if (comma == std::string::npos || uri.find(";base64") > comma)
+                    throw std::runtime_error("glTF: data URI bez base64");
+                decoded_.push_back(Base64Decode(std::string_view(uri).substr(comma + 1)));
+                data = {decoded_.back().data(), decoded_.back().size()};
+            } else {
+                external_.push_back(std::make_unique<MappedFile>(baseDir_ + "/" + UriDecode(uri)));
+                data = {external_.back()->data(), external_.back()->size()};
+            }
+            if (data.size() < length) throw std::runtime_error("glTF: bufor krotszy niz byteLength");
+            buffers_.push_back(data.first(length));
+        }
+        for (const Json& v : json_["bufferViews"].items) {
+            const size_t b = SizeField(v["buffer"], "buffer", SIZE_MAX);
+            const size_t offset = SizeField(v["byteOffset"], "byteOffset"), length = SizeField(v["byteLength"], "byteLength");
+            // bez dodawania: offset + length mógłby się przekręcić
+            if (b >= buffers_.size() || offset > buffers_[b].size() || length > buffers_[b].size() - offset)
+                throw std::runtime_error("glTF: bufferView poza buforem");
+            views_.push_back({buffers_[b].data() + offset, length, SizeField(v["byteStride"], "byteStride")});
+        }
+        for (const Json& a : json_["accessors"].items) accessors_.push_back(readAccessor(a));
+    }
+
+    const Json& json() const { return json_; }
+    const std::string& baseDir() const { return baseDir_; }
+    const std::vector<Accessor>& accessors() const { return accessors_; }
+    const std::vector<BufferView>& views() const { return views_; }
+    size_t bytes() const {
+        size_t n = file_.size();
+        for (const auto& f : external_) n += f->size();
+        return n;
+    }
+
+private:
+    Accessor readAccessor(const Json& a) const {
+        if (a.has("sparse")) throw std::runtime_error("glTF: akcesory sparse nieobslugiwane");
+        Accessor r;
+        r.componentType = a["componentType"].integer(0);
+        r.components = ComponentCount(a["type"].str());
+        r.elemSize = (size_t)ComponentSize(r.componentType) * r.components;
+        r.normalized = a["normalized"].boolean;
+        r.count = SizeField(a["count"], "count");
+        r.view = a["bufferView"].integer(-1);
+        if (r.view < 0 || (size_t)r.view >= views_.size()) throw std::runtime_error("glTF: akcesor bez bufferView");
+        const BufferView& v = views_[(size_t)r.view];
+        r.stride = v.stride ? v.stride : r.elemSize;
+        const size_t offset = SizeField(a["byteOffset"], "byteOffset");
+        // ostatni element musi się zmieścić: count - 1 pełnych kroków za
+        // pierwszym, liczone dzieleniem zamiast mnożenia
+        if (r.count && (offset > v.length || r.elemSize > v.length - offset ||
+                        r.count - 1 > (v.length - offset - r.elemSize) / r.stride))
+            throw std::runtime_error("glTF: akcesor poza bufferView");
+        r.data = v.data + offset;
+        const Json& mn = a["min"];
+        const Json& mx = a["max"];
+        if (r.components == 3 && mn.size() == 3 && mx.size() == 3) {
+            r.hasBounds = true;
+            r.min = glm::vec3(mn[0].num(), mn[1].num(), mn[2].num());
+            r.max = glm::vec3(mx[0].num(), mx[1].num(), mx[2].num());
+        }
+        return r;
+    }
+
+    std::string baseDir_;
+    MappedFile file_;
+    Json json_;
+    std::vector<std::unique_ptr<MappedFile>> external_;
+    std::vector<std::vector<unsigned char>> decoded_;
+    std::vector<std::span<const unsigned char>> buffers_;
+    std::vector<BufferView> views_;
+    std::vector<Accessor> accessors_;
+};
+
+// Nazwy materiałów (klucze MaterialMap): name, a gdy brak albo powtórzony -
+// z numerem materiału
+std::vector<std::string> MaterialKeys(const Json& json) {
+    std::vector<std::string> keys;
+    const Json& mats = json["materials"];
+    for (size_t i = 0; i < mats.size(); i++) {
+        std::string key = mats[i]["name"].str();
+        if (key.empty() || std::find(keys.begin(), keys.end(), key) != keys.end())
+            key = (key.empty() ? "material" : key) + "#" + std::to_string(i);
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+MaterialMap ReadMaterials(const Json& json, const std::string& baseDir) {
+    MaterialMap out;
+    const std::vector<std::string> keys = MaterialKeys(json);
+    auto imagePath = [&](const Json& textureInfo) -> std::string {
+        const int t = textureInfo["index"].integer(-1);
+        if (t < 0) return "";
+        const int source = json["textures"][(size_t)t]["source"].integer(-1);
+        if (source < 0) return "";
+        const std::string& uri = json["images"][(size_t)source]["uri"].str();
+        if (uri.empty() || uri.rfind("data:", 0) == 0) return "";   // osadzone - nieobsługiwane
+        return baseDir + "/" + UriDecode(uri);
+    };
+
+    const Json& mats = json["materials"];
+    for (size_t i = 0; i < mats.size(); i++) {
+        const Json& m = mats[i];
+        const Json& pbr = m["pbrMetallicRoughness"];
+        Material mat;
+        mat.name = keys[i];
+        mat.uvOriginTop = true;
+        const Json& base = pbr["baseColorFactor"];
+        if (base.size() >= 3) mat.Kd = glm::vec3(base[0].num(1), base[1].num(1), base[2].num(1));
+        // PBR -> Blinn-Phong: odbicie 4% (dielektryk) do Kd (metal), połysk z szorstkości
+        const float metallic = (float)pbr["metallicFactor"].num(1.0);
+        const float roughness = std::clamp((float)pbr["roughnessFactor"].num(1.0), 0.05f, 1.f);
+        mat.Ks = glm::mix(glm::vec3(0.04f), mat.Kd, metallic);
+        mat.Ns = std::clamp(2.f / std::pow(roughness, 4.f) - 2.f, 1.f, 256.f);
+        // SaveGLB zapisuje oryginalne Ks/Ns obok
+        const Json& extras = m["extras"];
+        if (extras["Ks"].size() == 3) mat.Ks = glm::vec3(extras["Ks"][0].num(), extras["Ks"][1].num(), extras["Ks"][2].num());
+        if (extras.has("Ns")) mat.Ns = (float)extras["Ns"].num(mat.Ns);
+        mat.mapKd = imagePath(pbr["baseColorTexture"]);
+        mat.mapBump = imagePath(m["normalTexture"]);
+        mat.bumpScale = (float)m["normalTexture"]["scale"].num(1.0);
+        out[mat.name] = std::move(mat);
+    }
+    return out;
+}
+
+glm::mat4 NodeMatrix(const Json& node) {
+    const Json& m = node["matrix"];
+    if (m.size() == 16) {
+        float v[16];
+        for (size_t i = 0; i < 16; i++) v[i] = (float)m[i].num();
+        return glm::make_mat4(v);   // glTF też kolumnami
+    }
+    glm::mat4 r(1.f);
+    const Json& t = node["translation"];
+    const Json& q = node["rotation"];
+    const Json& s = node["scale"];
+    if (t.size() == 3) r = glm::translate(r, glm::vec3(t[0].num(), t[1].num(), t[2].num()));
+    if (q.size() == 4) r *= glm::mat4_cast(glm::quat((float)q[3].num(), (float)q[0].num(), (float)q[1].num(), (float)q[2].num()));
+    if (s.size() == 3) r = glm::scale(r, glm::vec3(s[0].num(1), s[1].num(1), s[2].num(1)));
+    return r;
+}
+
+// Co i w jakiej kolejności wysłać: zestawy wierzchołków i prymitywy
+struct Plan {
+    std::vector<VertexSet> sets;
+    std::vector<Draw> draws;
+    size_t vertices = 0, indices = 0;
+    size_t skipped = 0;        // prymitywy inne niż TRIANGLES
+};
+
+Plan MakePlan(const GltfDocument& doc) {
+    const Json& json = doc.json();
+    const std::vector<Accessor>& acc = doc.accessors();
+    Plan plan;
+    std::map<std::tuple<int, int, int, int>, uint32_t> setIds;   // (pos, uv, nrm, węzeł) -> zestaw
+
+    auto attribute = [&](const Json& prim, const char* name, int components) {
+        const int a = prim["attributes"][name].integer(-1);
+        if (a < 0) return -1;
+        if ((size_t)a >= acc.size() || acc[(size_t)a].components < components)
+            throw std::runtime_error(std::string("glTF: zly akcesor ") + name);
+        return a;
+    };
+    auto addMesh = [&](int mesh, int node, const glm::mat4& world) {
+        for (const Json& prim : json["meshes"][(size_t)mesh]["primitives"].items) {
+            if (prim["mode"].integer(4) != 4) {
+                plan.skipped++;
+                continue;
+            }
+            const int pos = attribute(prim, "POSITION", 3);
+            if (pos < 0) continue;
+            const int uv = attribute(prim, "TEXCOORD_0", 2);
+            const int nrm = attribute(prim, "NORMAL", 3);
+            const bool identity = world == glm::mat4(1.f);
+
+            auto [it, inserted] = setIds.try_emplace({pos, uv, nrm, identity ? -1 : node}, (uint32_t)plan.sets.size());
+            if (inserted) {
+                VertexSet s;
+                s.position = pos;
+                s.uv = uv;
+                s.normal = nrm;
+                s.world = world;
+                s.identity = identity;
+                s.count = acc[(size_t)pos].count;
+                const Accessor& p = acc[(size_t)pos];
+                s.packed = identity && p.componentType == kFloat && p.stride == sizeof(Vertex) && uv >= 0 && nrm >= 0 &&
+                           acc[(size_t)uv].componentType == kFloat && acc[(size_t)nrm].componentType == kFloat &&
+                           acc[(size_t)uv].data == p.data + offsetof(Vertex, uv) &&
+                           acc[(size_t)nrm].data == p.data + offsetof(Vertex, nrm) &&
+                           acc[(size_t)uv].count == p.count && acc[(size_t)nrm].count == p.count;
+                plan.sets.push_back(s);
+                plan.vertices += s.count;
+            }
+            VertexSet& set = plan.sets[it->second];
+            set.users++;
+
+            Draw d;
+            d.set = it->second;
+            d.indices = prim["indices"].integer(-1);
+            if (d.indices >= (int)acc.size()) throw std::runtime_error("glTF: zly akcesor indeksow");
+            d.indexCount = d.indices >= 0 ? acc[(size_t)d.indices].count : set.count;
+            d.material = prim["material"].integer(-1);
+            const Json& extras = prim["extras"];
+            if (identity && extras["boundsMin"].size() == 3 && extras["boundsMax"].size() == 3) {
+                d.hasBounds = true;
+                d.boundsMin = glm::vec3(extras["boundsMin"][0].num(), extras["boundsMin"][1].num(), extras["boundsMin"][2].num());
+                d.boundsMax = glm::vec3(extras["boundsMax"][0].num(), extras["boundsMax"][1].num(), extras["boundsMax"][2].num());
+            }
+            plan.draws.push_back(d);
+            plan.indices += d.indexCount;
+        }
+    };
+
+    const Json& nodes = json["nodes"];
+    std::vector<int> roots;
+    const Json& scenes = json["scenes"];
+    if (scenes.size()) {
+        for (const Json& n : scenes[(size_t)std::max(0, json["scene"].integer(0))]["nodes"].items) roots.push_back(n.integer());
+    } else if (nodes.size()) {
+        // bez scen: korzenie to węzły, które nie są niczyimi dziećmi
+        std::vector<bool> child(nodes.size(), false);
+        for (const Json& n : nodes.items)
+            for (const Json& c : n["children"].items)
+                if ((size_t)c.integer() < child.size()) child[(size_t)c.integer()] = true;
+        for (size_t i = 0; i < nodes.size(); i++)
+            if (!child[i]) roots.push_back((int)i);
+    }
+
+    if (roots.empty()) {
+        // sam plik siatek, bez węzłów
+        for (size_t m = 0; m < json["meshes"].size(); m++) addMesh((int)m, -1, glm::mat4(1.f));
+    } else {
+        std::vector<std::pair<int, glm::mat4>> stack;
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it) stack.emplace_back(*it, glm::mat4(1.f));
+        size_t visited = 0;
+        while (!stack.empty()) {
+            auto [n, parent] = stack.back();
+            stack.pop_back();
+            if (n < 0 || (size_t)n >= nodes.size() || ++visited > nodes.size() * 4)
+                throw std::runtime_error("glTF: zla hierarchia wezlow");
+            const Json& node = nodes[(size_t)n];
+            const glm::mat4 world = parent * NodeMatrix(node);
+            const int mesh = node["mesh"].integer(-1);
+            if (mesh >= 0) addMesh(mesh, n, world);
+            const Json& children = node["children"];
+            for (size_t c = children.size(); c-- > 0;) stack.emplace_back(children[c].integer(), world);
+        }
+    }
+    return plan;
+}
+
+// Wierzchołki [first, first + count) zestawu do out
+void ReadVertices(const GltfDocument& doc, const VertexSet& set, size_t first, size_t count, Vertex* out,
+                  ObjLoadStats& stats) {
+    const std::vector<Accessor>& acc = doc.accessors();
+    const Accessor& pos = acc[(size_t)set.position];
+    if (set.packed) {
+        std::memcpy(out, pos.data + first * sizeof(Vertex), count * sizeof(Vertex));
+        stats.zeroCopyBytes += count * sizeof(Vertex);
+        return;
+    }
+    const Accessor* uv = set.uv >= 0 ? &acc[(size_t)set.uv] : nullptr;
+    const Accessor* nrm = set.normal >= 0 ? &acc[(size_t)set.normal] : nullptr;
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(set.world)));
+    for (size_t i = 0; i < count; i++) {
+        const size_t v = first + i;
+        Vertex& o = out[i];
+        o.pos = glm::vec3(pos.component(v, 0), pos.component(v, 1), pos.component(v, 2));
+        o.uv = uv && v < uv->count ? glm::vec2(uv->component(v, 0), uv->component(v, 1)) : glm::vec2(0.f);
+        o.nrm = nrm && v < nrm->count ? glm::vec3(nrm->component(v, 0), nrm->component(v, 1), nrm->component(v, 2))
+                                      : glm::vec3(0, 1, 0);
+        if (!set.identity) {
+            o.pos = glm::vec3(set.world * glm::vec4(o.pos, 1.f));
+            const glm::vec3 n = normalMatrix * o.nrm;
+            if (glm::dot(n, n) > 0.f) o.nrm = glm::normalize(n);
+        }
+    }
+}
+
+// Indeksy [first, first + count) prymitywu, przesunięte o set.first. Każdy
+// musi trafić w wierzchołki zestawu - inaczej draw czytałby poza model.
+void ReadIndices(const GltfDocument& doc, const Draw& d, const VertexSet& set, size_t first, size_t count,
+                 uint32_t* out, ObjLoadStats& stats) {
+    const uint32_t base = set.first;
+    if (d.indices < 0) {
+        if (first + count > set.count) throw std::runtime_error("glTF: prymityw bez indeksow dluzszy niz akcesor pozycji");
+        for (size_t i = 0; i < count; i++) out[i] = base + (uint32_t)(first + i);
+        return;
+    }
+    const Accessor& a = doc.accessors()[(size_t)d.indices];
+    if (a.componentType == kUnsignedInt && a.stride == 4 && base == 0) {
+        std::memcpy(out, a.data + first * 4, count * 4);
+        for (size_t i = 0; i < count; i++)
+            if (out[i] >= set.count) throw std::runtime_error("glTF: indeks poza akcesorem pozycji");
+        stats.zeroCopyBytes += count * 4;
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const size_t v = a.index(first + i);
+        if (v >= set.count) throw std::runtime_error("glTF: indeks poza akcesorem pozycji");
+        out[i] = base + (uint32_t)v;
+    }
+}
+
+// AABB prymitywu: z extras, z min/max akcesora (gdy zestaw ma jednego
+// użytkownika), a w ostateczności po indeksach
+void DrawBounds(const GltfDocument& doc, const VertexSet& set, const Draw& d, glm::vec3& mn, glm::vec3& mx) {
+    if (d.hasBounds) {
+        mn = d.boundsMin;
+        mx = d.boundsMax;
+        return;
+    }
+    const Accessor& pos = doc.accessors()[(size_t)set.position];
+    mn = glm::vec3(1e30f);
+    mx = glm::vec3(-1e30f);
+    if (set.users == 1 && pos.hasBounds) {
+        for (int c = 0; c < 8; c++) {
+            const glm::vec3 corner((c & 1) ? pos.max.x : pos.min.x, (c & 2) ? pos.max.y : pos.min.y,
+                                   (c & 4) ? pos.max.z : pos.min.z);
+            const glm::vec3 p = glm::vec3(set.world * glm::vec4(corner, 1.f));
+            mn = glm::min(mn, p);
+            mx = glm::max(mx, p);
+        }
+        return;
+    }
+    const Accessor* idx = d.indices >= 0 ? &doc.accessors()[(size_t)d.indices] : nullptr;
+    for (size_t i = 0; i < d.indexCount; i++) {
+        const size_t v = idx ? idx->index(i) : i;
+        if (v >= pos.count) throw std::runtime_error("glTF: indeks poza akcesorem pozycji");
+        const glm::vec3 p = glm::vec3(set.world * glm::vec4(pos.component(v, 0), pos.component(v, 1), pos.component(v, 2), 1.f));
+        mn = glm::min(mn, p);
+        mx = glm::max(mx, p);
+    }
+    if (!d.indexCount) mn = mx = glm::vec3(0.f);
+}
+
+ObjLoadStats EmitToSink(const GltfDocument& doc, GeometrySink& sink, const std::atomic<bool>* cancel) {
+    Plan plan = MakePlan(doc);
+    const std::vector<std::string> keys = MaterialKeys(doc.json());
+    ObjLoadStats stats;
+    sink.expect(plan.vertices, plan.indices);
+
+    uint32_t vertices = 0, indices = 0;
+    for (const Draw& d : plan.draws) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) throw LoadCancelled();
+        VertexSet& set = plan.sets[d.set];
+        if (!set.emitted) {
+            PROFILE_ZONE("glTF vertices");
+            set.first = vertices;
+            set.emitted = true;
+            for (size_t done = 0; done < set.count;) {
+                std::span<Vertex> space = sink.vertexSpace();
+                const size_t n = std::min(space.size(), set.count - done);
+                ReadVertices(doc, set, done, n, space.data(), stats);
+                sink.commitVertices(n);
+                done += n;
+            }
+            vertices += (uint32_t)set.count;
+            stats.positions += set.count;
+            if (set.uv >= 0) stats.uvs += set.count;
+            if (set.normal >= 0) stats.normals += set.count;
+        }
+
+        SubMesh sm;
+        sm.materialName = d.material >= 0 && (size_t)d.material < keys.size() ? keys[(size_t)d.material] : "";
+        sm.indexOffset = indices;
+        sm.indexCount = (uint32_t)d.indexCount;
+        DrawBounds(doc, set, d, sm.boundsMin, sm.boundsMax);
+        {
+            PROFILE_ZONE("glTF indices");
+            for (size_t done = 0; done < d.indexCount;) {
+                std::span<uint32_t> space = sink.indexSpace();
+                const size_t n = std::min(space.size(), d.indexCount - done);
+                ReadIndices(doc, d, set, done, n, space.data(), stats);
+                sink.commitIndices(n);
+                done += n;
+            }
+        }
+        indices += (uint32_t)d.indexCount;
+        stats.faces += d.indexCount / 3;
+        if (!sink.submesh(sm, {})) break;
+    }
+    stats.vertices = vertices;
+    stats.indices = indices;
+    return stats;
+}
+
+// Sink do wektorów LoadedModel (LoadGLTF)
+class VectorSink final : public GeometrySink {
+public:
+    explicit VectorSink(LoadedModel& m) : m_(m) {}
+    std::span<Vertex> vertexSpace() override {
+        if (m_.vertices.size() == usedVertices_) m_.vertices.resize(std::max<size_t>(usedVertices_ * 2, 1024));
+        return std::span<Vertex>(m_.vertices).subspan(usedVertices_);
+    }
+    void commitVertices(size_t count) override { usedVertices_ += count; }
+    std::span<uint32_t> indexSpace() override {
+        if (m_.indices.size() == usedIndices_) m_.indices.resize(std::max<size_t>(usedIndices_ * 2, 1024));
+        return std::span<uint32_t>(m_.indices).subspan(usedIndices_);
+    }
+    void commitIndices(size_t count) override { usedIndices_ += count; }
+    bool submesh(const SubMesh& sm, MaterialMap&&) override {
+        m_.submeshes.push_back(sm);
+        return true;
+    }
+    void expect(size_t vertices, size_t indices) override {
+        m_.vertices.resize(vertices);
+        m_.indices.resize(indices);
+    }
+    void finish() {
+        m_.vertices.resize(usedVertices_);
+        m_.indices.resize(usedIndices_);
+    }
+
+private:
+    LoadedModel& m_;
+    size_t usedVertices_ = 0, usedIndices_ = 0;
+};
+
+// Sink na kawałki LoadGLTFStreaming: wierzchołki od poprzedniego kawałka
+class ChunkSink final : public GeometrySink {
+public:
+    explicit ChunkSink(const ObjChunkFn& fn) : fn_(fn) {}
+    std::span<Vertex> vertexSpace() override {
+        if (chunk_.vertices.size() == usedVertices_) chunk_.vertices.resize(std::max<size_t>(usedVertices_ * 2, 1024));
+        return std::span<Vertex>(chunk_.vertices).subspan(usedVertices_);
+    }
+    void commitVertices(size_t count) override { usedVertices_ += count; }
+    std::span<uint32_t> indexSpace() override {
+        if (chunk_.indices.size() == usedIndices_) chunk_.indices.resize(std::max<size_t>(usedIndices_ * 2, 1024));
+        return std::span<uint32_t>(chunk_.indices).subspan(usedIndices_);
+    }
+    void commitIndices(size_t count) override { usedIndices_ += count; }
+    bool submesh(const SubMesh& sm, MaterialMap&&) override {
+        chunk_.vertices.resize(usedVertices_);
+        chunk_.indices.resize(usedIndices_);
+        chunk_.submesh = sm;
+        const uint32_t next = chunk_.firstVertex + (uint32_t)usedVertices_;
+        const bool more = fn_(std::move(chunk_));
+        chunk_ = ObjChunk{};
+        chunk_.firstVertex = next;
+        usedVertices_ = usedIndices_ = 0;
+        return more;
+    }
+
+private:
+    const ObjChunkFn& fn_;
+    ObjChunk chunk_;
+    size_t usedVertices_ = 0, usedIndices_ = 0;
+};
+
+} // namespace
+
+bool IsGLTFPath(const std::string& path) {
+    const std::string ext = LowerExtension(path);
+    return ext == ".gltf" || ext == ".glb";
+}
+
+LoadedModel LoadGLTF(const std::string& path, const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("LoadGLTF");
+    const auto t0 = std::chrono::steady_clock::now();
+    GltfDocument doc(path);
+    LoadedModel model;
+    VectorSink sink(model);
+    model.stats = EmitToSink(doc, sink, cancel);
+    sink.finish();
+    const auto m0 = std::chrono::steady_clock::now();
+    model.materials = ReadMaterials(doc.json(), doc.baseDir());
+    model.stats.mtlMs = MsSince(m0);
+    model.stats.totalMs = MsSince(t0);
+    return model;
+}
+
+MaterialMap LoadGLTFMaterials(const std::string& path) {
+    PROFILE_ZONE("LoadGLTFMaterials");
+    GltfDocument doc(path, false);
+    return ReadMaterials(doc.json(), doc.baseDir());
+}
+
+ObjLoadStats LoadGLTFToSink(const std::string& path, GeometrySink& sink, const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("LoadGLTFToSink");
+    const auto t0 = std::chrono::steady_clock::now();
+    GltfDocument doc(path);
+    ObjLoadStats stats = EmitToSink(doc, sink, cancel);
+    stats.totalMs = MsSince(t0);
+    return stats;
+}
+
+ObjLoadStats LoadGLTFStreaming(const std::string& path, const ObjChunkFn& onChunk, const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("LoadGLTFStreaming");
+    const auto t0 = std::chrono::steady_clock::now();
+    GltfDocument doc(path);
+    ChunkSink sink(onChunk);
+    ObjLoadStats stats = EmitToSink(doc, sink, cancel);
+    stats.totalMs = MsSince(t0);
+    return stats;
+}
+
+void SaveGLB(const LoadedModel& model, const std::string& path, bool interleaved) {
+    PROFILE_ZONE("SaveGLB");
+    namespace fs = std::filesystem;
+    const size_t nv = model.vertices.size();
+    const std::string dir = DirectoryOf(path);
+
+    // BIN: wierzchołki (przeplecione albo trzy tablice), potem indeksy.
+    // v w UV odwracamy do konwencji glTF.
+    std::vector<unsigned char> bin;
+    auto append = [&](const void* p, size_t n) {
+        const size_t at = bin.size();
+        bin.resize(at + n);
+        std::memcpy(bin.data() + at, p, n);
+        return at;
+    };
+    std::vector<Vertex> flipped(model.vertices);
+    for (Vertex& v : flipped) v.uv.y = 1.f - v.uv.y;
+    size_t posAt = 0, uvAt = 0, nrmAt = 0;
+    if (interleaved) {
+        posAt = append(flipped.data(), nv * sizeof(Vertex));
+    } else {
+        std::vector<glm::vec3> p(nv), n(nv);
+        std::vector<glm::vec2> t(nv);
+        for (size_t i = 0; i < nv; i++) {
+            p[i] = flipped[i].pos;
+            t[i] = flipped[i].uv;
+            n[i] = flipped[i].nrm;
+        }
+        posAt = append(p.data(), nv * sizeof(glm::vec3));
+        uvAt = append(t.data(), nv * sizeof(glm::vec2));
+        nrmAt = append(n.data(), nv * sizeof(glm::vec3));
+    }
+    const size_t vertexBytes = bin.size();
+    append(model.indices.data(), model.indices.size() * sizeof(uint32_t));
+
+    glm::vec3 mn(1e30f), mx(-1e30f);
+    for (const Vertex& v : model.vertices) {
+        mn = glm::min(mn, v.pos);
+        mx = glm::max(mx, v.pos);
+    }
+    if (!nv) mn = mx = glm::vec3(0.f);
+
+    std::ostringstream js;
+    js.precision(9);
+    auto vec = [&](const glm::vec3& v) { js << "[" << v.x << "," << v.y << "," << v.z << "]"; };
+    auto quoted = [&](const std::string& s) {
+        js << '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') js << '\\' << c;
+            else if ((unsigned char)c < 0x20) js << ' ';
+            else js << c;
+        }
+        js << '"';
+    };
+
+    js << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"zadanieNatalia SaveGLB\"},"
+       << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],";
+    js << "\"buffers\":[{\"byteLength\":" << bin.size() << "}],\"bufferViews\":[";
+    if (interleaved) {
+        js << "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << vertexBytes << ",\"byteStride\":" << sizeof(Vertex)
+           << ",\"target\":34962},";
+    } else {
+        js << "{\"buffer\":0,\"byteOffset\":" << posAt << ",\"byteLength\":" << nv * 12 << ",\"target\":34962},"
+           << "{\"buffer\":0,\"byteOffset\":" << uvAt << ",\"byteLength\":" << nv * 8 << ",\"target\":34962},"
+           << "{\"buffer\":0,\"byteOffset\":" << nrmAt << ",\"byteLength\":" << nv * 12 << ",\"target\":34962},";
+    }
+    const int indexView = interleaved ? 1 : 3;
+    js << "{\"buffer\":0,\"byteOffset\":" << vertexBytes << ",\"byteLength\":" << model.indices.size() * 4
+       << ",\"target\":34963}],";
+
+    // akcesory: 0 pozycje, 1 UV, 2 normalne, 3.. indeksy submeshy
+    js << "\"accessors\":[";
+    js << "{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":" << nv << ",\"type\":\"VEC3\",\"min\":";
+    vec(mn);
+    js << ",\"max\":";
+    vec(mx);
+    js << "},{\"bufferView\":" << (interleaved ? 0 : 1) << ",\"byteOffset\":" << (interleaved ? offsetof(Vertex, uv) : 0)
+       << ",\"componentType\":5126,\"count\":" << nv << ",\"type\":\"VEC2\"}"
+       << ",{\"bufferView\":" << (interleaved ? 0 : 2) << ",\"byteOffset\":" << (interleaved ? offsetof(Vertex, nrm) : 0)
+       << ",\"componentType\":5126,\"count\":" << nv << ",\"type\":\"VEC3\"}";
+    for (const SubMesh& sm : model.submeshes)
+        js << ",{\"bufferView\":" << indexView << ",\"byteOffset\":" << sm.indexOffset * 4
+           << ",\"componentType\":5125,\"count\":" << sm.indexCount << ",\"type\":\"SCALAR\"}";
+    js << "],";
+
+    // materiały w kolejności nazw, tekstury po jednej na plik
+    std::vector<std::string> names;
+    for (const auto& [name, mat] : model.materials) names.push_back(name);
+    std::sort(names.begin(), names.end());
+    std::vector<std::string> images;
+    auto image = [&](const std::string& file) {
+        auto it = std::find(images.begin(), images.end(), file);
+        if (it != images.end()) return (int)(it - images.begin());
+        images.push_back(file);
+        return (int)images.size() - 1;
+    };
+    js << "\"materials\":[";
+    for (size_t i = 0; i < names.size(); i++) {
+        const Material& m = model.materials.at(names[i]);
+        js << (i ? "," : "") << "{\"name\":";
+        quoted(names[i]);
+        js << ",\"pbrMetallicRoughness\":{\"baseColorFactor\":[" << m.Kd.r << "," << m.Kd.g << "," << m.Kd.b
+           << ",1],\"metallicFactor\":0,\"roughnessFactor\":"
+           << std::pow(2.f / (std::max(m.Ns, 0.f) + 2.f), 0.25f);
+        if (!m.mapKd.empty()) js << ",\"baseColorTexture\":{\"index\":" << image(m.mapKd) << "}";
+        js << "}";
+        if (!m.mapBump.empty()) js << ",\"normalTexture\":{\"index\":" << image(m.mapBump) << ",\"scale\":" << m.bumpScale << "}";
+        js << ",\"extras\":{\"Ks\":";
+        vec(m.Ks);
+        js << ",\"Ns\":" << m.Ns << "}}";
+    }
+    js << "],\"textures\":[";
+    for (size_t i = 0; i < images.size(); i++) js << (i ? "," : "") << "{\"source\":" << i << "}";
+    js << "],\"images\":[";
+    for (size_t i = 0; i < images.size(); i++) {
+        std::error_code ec;
+        fs::path rel = fs::relative(fs::path(images[i]), fs::path(dir), ec);
+        js << (i ? "," : "") << "{\"uri\":";
+        quoted(UriEncode(ec || rel.empty() ? images[i] : rel.generic_string()));
+        js << "}";
+    }
+
+    js << "],\"meshes\":[{\"primitives\":[";
+    for (size_t i = 0; i < model.submeshes.size(); i++) {
+        const SubMesh& sm = model.submeshes[i];
+        js << (i ? "," : "") << "{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1,\"NORMAL\":2},\"indices\":" << 3 + i
+           << ",\"mode\":4";
+        auto it = std::find(names.begin(), names.end(), sm.materialName);
+        if (it != names.end()) js << ",\"material\":" << (it - names.begin());
+        js << ",\"extras\":{\"boundsMin\":";
+        vec(sm.boundsMin);
+        js << ",\"boundsMax\":";
+        vec(sm.boundsMax);
+        js << "}}";
+    }
+    js << "]}]}";
+
+    std::string json = js.str();
+    while (json.size() % 4) json.push_back(' ');
+    while (bin.size() % 4) bin.push_back(0);
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) throw std::runtime_error("Nie moge zapisac GLB: " + path);
+        auto u32 = [&](uint32_t v) { f.write((const char*)&v, 4); };
+        f.write("glTF", 4);
+        u32(2);
+        u32((uint32_t)(12 + 8 + json.size() + 8 + bin.size()));
+        u32((uint32_t)json.size());
+        u32(0x4E4F534A);
+        f.write(json.data(), (std::streamsize)json.size());
+        u32((uint32_t)bin.size());
+        u32(0x004E4942);
+        f.write((const char*)bin.data(), (std::streamsize)bin.size());
+        if (!f) throw std::runtime_error("Nie moge zapisac GLB: " + path);
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        throw std::runtime_error("Nie moge zapisac GLB: " + path);
+    }
+}
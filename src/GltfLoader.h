@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <atomic>
+#include <string>
+
+#include "ObjLoader.h"
+
+// glTF 2.0: .gltf (JSON + pliki .bin / data: URI) albo .glb (JSON i bufor w
+// jednym pliku). Wynik w tych samych strukturach co OBJ: prymityw trybu
+// TRIANGLES = SubMesh, materiał PBR przybliżony Kd/Ks/Ns.
+//
+// Bufory są zmapowane (MappedFile). Gdy atrybuty leżą już jak Vertex
+// (float pos/uv/nrm z przeplotem co 32 bajty, węzeł bez transformacji),
+// wierzchołki idą do celu jednym memcpy z mapowania, a indeksy uint32 bez
+// przesunięcia też - bez przepakowywania po wierzchołku. Inne układy
+// (osobne widoki, typy znormalizowane, uint16) są zbierane po elemencie.
+// Prymitywy z tym samym zestawem akcesorów dzielą wierzchołki.
+//
+// UV zostają w konwencji glTF (v = 0 u góry obrazu), a materiały mają
+// uvOriginTop, więc tekstury dekodujemy bez odwracania. Obrazy osadzone w
+// buforze (bufferView) i rozszerzenia (Draco, sparse) nie są obsługiwane.
+
+// Po rozszerzeniu: .gltf / .glb (bez względu na wielkość liter)
+bool IsGLTFPath(const std::string& path);
+
+// Cały model w wektorach (jak LoadOBJ_WithMTL), z materiałami
+LoadedModel LoadGLTF(const std::string& path, const std::atomic<bool>* cancel = nullptr);
+
+// Same materiały - JSON, bez dotykania buforów
+MaterialMap LoadGLTFMaterials(const std::string& path);
+
+// Geometria do sink, kolejne prymitywy jako submeshe; materiały nie idą
+// przez sink (LoadGLTFMaterials). Zapowiedź rozmiaru (expect) jest dokładna.
+ObjLoadStats LoadGLTFToSink(const std::string& path, GeometrySink& sink,
+                            const std::atomic<bool>* cancel = nullptr);
+
+// Jak LoadOBJStreaming: kawałek na prymityw, bez materiałów
+ObjLoadStats LoadGLTFStreaming(const std::string& path, const ObjChunkFn& onChunk,
+                               const std::atomic<bool>* cancel = nullptr);
+
+// Zapis modelu jako GLB (benchmark OBJ vs GLB, --export-glb). interleaved:
+// jeden widok z Vertex po kolei (szybka ścieżka LoadGLTF); false: osobny
+// widok na pozycje, UV i normalne, jak zwykle eksportują edytory.
+// Tekstury jako URI względem katalogu pliku; Ks/Ns w extras materiału,
+// AABB submesha w extras prymitywu.
+void SaveGLB(const LoadedModel& model, const std::string& path, bool interleaved = true);
@@ -0,0 +1,233 @@
+﻿#include "GpuProfiler.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+GpuProfiler::GpuProfiler(bool perDraw) : perDraw_(perDraw) {}
+
+GpuProfiler::~GpuProfiler() {
+    for (FrameSet& fs : sets_) {
+        if (!fs.queries.empty()) glDeleteQueries((GLsizei)fs.queries.size(), fs.queries.data());
+    }
+    if (overlayVao_) glDeleteVertexArrays(1, &overlayVao_);
+}
+
+bool GpuProfiler::openCsv(const std::string& path) {
+    csv_.open(path, std::ios::trunc);
+    if (!csv_) {
+        std::cerr << "Nie mozna zapisac " << path << "\n";
+        return false;
+    }
+    csv_ << "frame,pass,depth,gpu_ms,cpu_ms,draws,triangles,state_changes\n";
+    return true;
+}
+
+uint32_t GpuProfiler::timestamp(FrameSet& fs) {
+    if (fs.used == fs.queries.size()) {
+        // pula rośnie do największej klatki i potem już tylko jest używana ponownie
+        size_t grow = std::max<size_t>(16, fs.queries.size());
+        fs.queries.resize(fs.queries.size() + grow);
+        glGenQueries((GLsizei)grow, fs.queries.data() + fs.used);
+    }
+    glQueryCounter(fs.queries[fs.used], GL_TIMESTAMP);
+    return fs.used++;
+}
+
+bool GpuProfiler::available(const FrameSet& fs) const {
+    if (fs.used == 0) return true;
+    // zapytania kończą się w kolejności wysłania - wystarczy sprawdzić ostatnie
+    GLuint ready = GL_FALSE;
+    glGetQueryObjectuiv(fs.queries[fs.used - 1], GL_QUERY_RESULT_AVAILABLE, &ready);
+    return ready == GL_TRUE;
+}
+
+void GpuProfiler::collect(FrameSet& fs) {
+    if (!available(fs)) stalls_++;   // glGetQueryObjectui64v niżej poczeka
+
+    std::vector<GLuint64> ts(fs.used);
+    for (uint32_t i = 0; i < fs.used; i++) glGetQueryObjectui64v(fs.queries[i], GL_QUERY_RESULT, &ts[i]);
+
+    last_.clear();
+    lastGpuMs_ = 0.0;
+    GLuint64 first = 0, lastTs = 0;
+    for (const Scope& s : fs.scopes) {
+        PassStats p;
+        p.name = s.name;
+        p.depth = s.depth;
+        p.gpuMs = (ts[s.q1] > ts[s.q0]) ? (double)(ts[s.q1] - ts[s.q0]) * 1e-6 : 0.0;
+        p.cpuMs = std::chrono::duration<double, std::milli>(s.cpu1 - s.cpu0).count();
+        p.draws = s.draws;
+        p.triangles = s.triangles;
+        p.stateChanges = s.stateChanges;
+        last_.push_back(p);
+
+        if (s.depth == 0) {
+            if (first == 0 || ts[s.q0] < first) first = ts[s.q0];
+            lastTs = std::max(lastTs, ts[s.q1]);
+        }
+    }
+    if (lastTs > first) lastGpuMs_ = (double)(lastTs - first) * 1e-6;
+
+    if (csv_) {
+        char buf[64];
+        for (const PassStats& p : last_) {
+            std::snprintf(buf, sizeof(buf), "%.4f,%.4f", p.gpuMs, p.cpuMs);
+            csv_ << fs.frame << ',' << p.name << ',' << p.depth << ',' << buf << ','
+                 << p.draws << ',' << p.triangles << ',' << p.stateChanges << '\n';
+        }
+    }
+    fs.pending = false;
+}
+
+void GpuProfiler::beginFrame() {
+    // Najpierw odbieramy wszystko, co już gotowe (od najstarszej klatki),
+    // dopiero potem ewentualnie czekamy na zestaw, który zaraz nadpiszemy.
+    for (int k = 1; k <= kFramesInFlight; k++) {
+        FrameSet& fs = sets_[(frame_ + k) % kFramesInFlight];
+        if (fs.pending && available(fs)) collect(fs);
+    }
+
+    current_ = (int)(frame_ % kFramesInFlight);
+    FrameSet& fs = sets_[current_];
+    if (fs.pending) collect(fs);
+
+    fs.used = 0;
+    fs.scopes.clear();
+    fs.frame = frame_;
+    open_.clear();
+}
+
+void GpuProfiler::endFrame() {
+    if (current_ < 0) return;
+    while (!open_.empty()) end(open_.back());
+    sets_[current_].pending = !sets_[current_].scopes.empty();
+    current_ = -1;
+    frame_++;
+}
+
+int GpuProfiler::begin(const std::string& name) {
+    if (current_ < 0) return -1;
+    FrameSet& fs = sets_[current_];
+    Scope s;
+    s.name = name;
+    s.depth = (int)open_.size();
+    s.q0 = timestamp(fs);
+    s.cpu0 = Clock::now();
+    fs.scopes.push_back(std::move(s));
+    int id = (int)fs.scopes.size() - 1;
+    open_.push_back(id);
+    return id;
+}
+
+void GpuProfiler::end(int scope) {
+    if (current_ < 0 || scope < 0) return;
+    FrameSet& fs = sets_[current_];
+    // zamykamy też zapomniane zakresy wewnętrzne
+    while (!open_.empty()) {
+        int id = open_.back();
+        open_.pop_back();
+        fs.scopes[id].cpu1 = Clock::now();
+        fs.scopes[id].q1 = timestamp(fs);
+        if (id == scope) break;
+    }
+}
+
+void GpuProfiler::count(uint32_t draws, uint64_t triangles, uint32_t stateChanges) {
+    if (current_ < 0) return;
+    FrameSet& fs = sets_[current_];
+    for (int id : open_) {
+        fs.scopes[id].draws += draws;
+        fs.scopes[id].triangles += triangles;
+        fs.scopes[id].stateChanges += stateChanges;
+    }
+}
+
+std::string GpuProfiler::summary() const {
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "GPU %.2f ms", lastGpuMs_);
+    std::string s = buf;
+
+    uint32_t draws = 0, states = 0;
+    uint64_t tris = 0;
+    for (const PassStats& p : last_) {
+        if (p.depth != 0) continue;
+        std::snprintf(buf, sizeof(buf), " | %s %.2f", p.name.c_str(), p.gpuMs);
+        s += buf;
+        draws += p.draws;
+        tris += p.triangles;
+        states += p.stateChanges;
+    }
+    std::snprintf(buf, sizeof(buf), " | %u draws %lluk tris %u state",
+                  draws, (unsigned long long)((tris + 500) / 1000), states);
+    s += buf;
+    if (stalls_) s += " | stalls " + std::to_string(stalls_);
+    return s;
+}
+
+void GpuProfiler::drawOverlay(int width, int height, double budgetMs) {
+    if (last_.empty() || width <= 0 || height <= 0) return;
+
+    if (!overlayShader_) {
+        try {
+            overlayShader_ = std::make_unique<Shader>("shaders/overlay.vert", "shaders/overlay.frag");
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return;
+        }
+        // prostokąty z gl_VertexID, ale core profile i tak wymaga VAO
+        glGenVertexArrays(1, &overlayVao_);
+    }
+
+    GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cull = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    overlayShader_->use();
+    glBindVertexArray(overlayVao_);
+
+    // piksele -> NDC, (0,0) w lewym górnym rogu
+    const float px = 2.f / (float)width, py = 2.f / (float)height;
+    auto rect = [&](float x, float y, float w, float h, float r, float g, float b, float a) {
+        overlayShader_->setVec4("uColor", glm::vec4(r, g, b, a));
+        overlayShader_->setVec4("uRect", glm::vec4(-1.f + x * px, 1.f - (y + h) * py, w * px, h * py));
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    };
+
+    static const float palette[][3] = {
+        {0.95f, 0.55f, 0.20f}, {0.30f, 0.75f, 0.95f}, {0.45f, 0.90f, 0.35f},
+        {0.90f, 0.35f, 0.60f}, {0.95f, 0.85f, 0.30f}, {0.65f, 0.50f, 0.95f},
+    };
+
+    const float x0 = 10.f, barMax = std::min(400.f, width * 0.4f);
+    const float barH = 10.f, rowH = 14.f;
+    float y = 10.f;
+
+    // cała klatka na tle budżetu (tło = budżet, dłuższy pasek = przekroczony)
+    rect(x0, y, barMax, barH, 0.f, 0.f, 0.f, 0.5f);
+    float frameW = (float)std::min(lastGpuMs_ / budgetMs, 1.5) * barMax;
+    bool over = lastGpuMs_ > budgetMs;
+    rect(x0, y, frameW, barH, over ? 0.95f : 0.85f, over ? 0.25f : 0.85f, over ? 0.25f : 0.85f, 0.9f);
+    y += rowH;
+
+    int color = 0;
+    for (const PassStats& p : last_) {
+        if (p.depth > 1) continue;
+        const float* c = palette[color++ % 6];
+        float indent = p.depth * 12.f;
+        float w = (float)std::min(p.gpuMs / budgetMs, 1.5) * (barMax - indent);
+        float h = p.depth == 0 ? barH : barH * 0.5f;
+        rect(x0 + indent, y, std::max(w, 1.f), h, c[0], c[1], c[2], 0.9f);
+        y += p.depth == 0 ? rowH : h + 2.f;
+        if (y > height - rowH) break;
+    }
+
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+    if (depth) glEnable(GL_DEPTH_TEST);
+    if (cull) glEnable(GL_CULL_FACE);
+}
@@ -0,0 +1,434 @@
+﻿#include "JobSystem.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+struct Job {
+    std::function<void()> fn;
+    JobCounter* counter = nullptr;
+    bool main = false;
+    bool background = false;
+};
+
+namespace {
+
+// Kolejka Chase-Lev (Lê, Pop, Cohen, Zappa Nardelli, "Correct and Efficient
+// Work-Stealing for Weak Memory Models", 2013). push/pop tylko właściciel,
+// steal dowolny wątek. Tablica rośnie x2; stare zostają do końca, bo złodziej
+// mógł jeszcze wziąć do nich wskaźnik.
+class WorkStealingDeque {
+public:
+    WorkStealingDeque() {
+        arrays_.push_back(std::make_unique<Array>(256));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(Job* job) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) a = grow(a, t, b);
+        a->put(b, job);
+        bottom_.store(b + 1, std::memory_order_release);   // złodziej widzi zadanie razem z jego treścią
+    }
+
+    Job* pop() {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        Job* job = nullptr;
+        if (t <= b) {
+            job = a->get(b);
+            if (t == b) {
+                // ostatni element: ścigamy się ze złodziejami o top
+                if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed))
+                    job = nullptr;
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.store(b + 1, std::memory_order_relaxed);   // pusta
+        }
+        return job;
+    }
+
+    Job* steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+
+        Array* a = array_.load(std::memory_order_acquire);
+        Job* job = a->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+            return nullptr;   // przegrany wyścig - złodziej szuka gdzie indziej
+        return job;
+    }
+
+    bool empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        explicit Array(int64_t cap) : capacity(cap), slots(new std::atomic<Job*>[(size_t)cap]) {}
+        Job* get(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, Job* j) { slots[i & (capacity - 1)].store(j, std::memory_order_relaxed); }
+
+        const int64_t capacity;   // potęga dwójki
+        std::unique_ptr<std::atomic<Job*>[]> slots;
+    };
+
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        arrays_.push_back(std::make_unique<Array>(old->capacity * 2));
+        Array* a = arrays_.back().get();
+        for (int64_t i = t; i < b; i++) a->put(i, old->get(i));
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Array*> array_{nullptr};
+    std::vector<std::unique_ptr<Array>> arrays_;   // tylko właściciel
+};
+
+thread_local JobSystem* tSystem = nullptr;
+thread_local int tWorker = -1;          // indeks w workers_, -1 = wątek spoza puli
+thread_local uint32_t tRandom = 0x9e3779b9u;
+
+uint32_t NextRandom() {
+    // xorshift32: tylko do wyboru ofiary kradzieży
+    tRandom ^= tRandom << 13;
+    tRandom ^= tRandom >> 17;
+    tRandom ^= tRandom << 5;
+    return tRandom;
+}
+
+const int kSpinsBeforeSleep = 64;
+
+} // namespace
+
+struct JobSystem::Worker {
+    WorkStealingDeque deque;
+    std::thread thread;
+    std::atomic<size_t> executed{0}, stolen{0};
+};
+
+JobSystem::JobSystem(unsigned threads) : mainThread_(std::this_thread::get_id()) {
+    if (threads == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        threads = std::max(2u, hw > 1 ? hw - 1 : 1u);
+    }
+    for (unsigned i = 0; i < threads; i++) workers_.push_back(std::make_unique<Worker>());
+    // wątki startują dopiero gdy wszystkie kolejki istnieją (kradną z każdej)
+    for (unsigned i = 0; i < threads; i++)
+        workers_[i]->thread = std::thread(&JobSystem::workerLoop, this, (int)i);
+}
+
+JobSystem::~JobSystem() {
+    stop_.store(true);
+    wake(true);
+    for (auto& w : workers_) w->thread.join();
+
+    // niewykonane zadania (np. main, których nikt nie wypompował)
+    for (auto& w : workers_)
+        while (Job* j = w->deque.pop()) delete j;
+    for (Job* j : inject_) delete j;
+    for (Job* j : background_) delete j;
+    for (Job* j : mainQueue_) delete j;
+}
+
+void JobSystem::run(std::function<void()> fn, JobCounter* counter) {
+    if (counter) counter->add();
+    submit(new Job{std::move(fn), counter, false});
+}
+
+void JobSystem::runAfter(JobCounter& dep, std::function<void()> fn, JobCounter* counter) {
+    if (counter) counter->add();
+    release(dep, new Job{std::move(fn), counter, false});
+}
+
+void JobSystem::runBackground(std::function<void()> fn, JobCounter* counter) {
+    if (counter) counter->add();
+    submit(new Job{std::move(fn), counter, false, true});
+}
+
+void JobSystem::runOnMain(std::function<void()> fn, JobCounter* counter) {
+    if (counter) counter->add();
+    submitMain(new Job{std::move(fn), counter, true});
+}
+
+void JobSystem::runOnMainAfter(JobCounter& dep, std::function<void()> fn, JobCounter* counter) {
+    if (counter) counter->add();
+    release(dep, new Job{std::move(fn), counter, true});
+}
+
+void JobSystem::submit(Job* job) {
+    if (job->background) {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        background_.push_back(job);
+        backgroundSize_.fetch_add(1);
+    } else if (tSystem == this && tWorker >= 0) {
+        workers_[tWorker]->deque.push(job);
+    } else {
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        inject_.push_back(job);
+        injectSize_.fetch_add(1);
+        injected_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake(false);
+}
+
+void JobSystem::submitMain(Job* job) {
+    {
+        std::lock_guard<std::mutex> lock(mainMutex_);
+        mainQueue_.push_back(job);
+        mainSize_.fetch_add(1);
+    }
+    wake(true);   // notify_one mógłby obudzić robotnika zamiast wątku głównego
+}
+
+void JobSystem::release(JobCounter& dep, Job* job) {
+    {
+        std::lock_guard<std::mutex> lock(dep.mutex_);
+        // signal() opróżnia listę pod tym samym mutexem po zejściu do zera,
+        // więc albo widzimy zero, albo on zobaczy nasze zadanie
+        if (dep.value_.load() != 0) {
+            dep.continuations_.push_back(job);
+            return;
+        }
+    }
+    if (job->main) submitMain(job);
+    else submit(job);
+}
+
+void JobSystem::signal(JobCounter* counter) {
+    if (!counter) return;
+    std::atomic<int>& inFlight = counter->inFlight_;
+    inFlight.fetch_add(1);
+    if (counter->value_.fetch_sub(1) == 1) {
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex_);
+            ready.swap(counter->continuations_);
+        }
+        inFlight.fetch_sub(1);   // od tu licznika już nie dotykamy
+        for (Job* j : ready) {
+            if (j->main) submitMain(j);
+            else submit(j);
+        }
+        wake(true);              // czekający w wait() mogą spać
+        return;
+    }
+    inFlight.fetch_sub(1);
+}
+
+void JobSystem::execute(Job* job) {
+    try {
+        job->fn();
+    } catch (...) {
+        if (!job->counter) throw;   // bez licznika nie ma komu oddać: jak w std::thread
+        std::lock_guard<std::mutex> lock(job->counter->mutex_);
+        if (!job->counter->error_) job->counter->error_ = std::current_exception();
+    }
+    JobCounter* counter = job->counter;
+    delete job;
+
+    if (tWorker >= 0 && tSystem == this) workers_[tWorker]->executed.fetch_add(1, std::memory_order_relaxed);
+    signal(counter);
+}
+
+Job* JobSystem::findJob(int self) {
+    if (self >= 0) {
+        if (Job* j = workers_[self]->deque.pop()) return j;
+    }
+
+    if (injectSize_.load() > 0) {
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        if (!inject_.empty()) {
+            Job* j = inject_.front();
+            inject_.pop_front();
+            injectSize_.fetch_sub(1);
+            return j;
+        }
+    }
+
+    const size_t n = workers_.size();
+    const size_t first = NextRandom() % n;
+    for (size_t k = 0; k < n; k++) {
+        const size_t victim = (first + k) % n;
+        if ((int)victim == self) continue;
+        if (Job* j = workers_[victim]->deque.steal()) {
+            if (self >= 0) workers_[self]->stolen.fetch_add(1, std::memory_order_relaxed);
+            return j;
+        }
+    }
+    return nullptr;
+}
+
+Job* JobSystem::findBackgroundJob() {
+    if (backgroundSize_.load() == 0) return nullptr;
+    std::lock_guard<std::mutex> lock(backgroundMutex_);
+    if (background_.empty()) return nullptr;
+    Job* j = background_.front();
+    background_.pop_front();
+    backgroundSize_.fetch_sub(1);
+    return j;
+}
+
+bool JobSystem::runMainOne() {
+    if (mainSize_.load() == 0) return false;
+    Job* j = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mainMutex_);
+        if (mainQueue_.empty()) return false;
+        j = mainQueue_.front();
+        mainQueue_.pop_front();
+        mainSize_.fetch_sub(1);
+    }
+    execute(j);
+    return true;
+}
+
+size_t JobSystem::pumpMain() {
+    if (!isMainThread()) return 0;
+    // tylko to, co już czeka: zadanie dokładające kolejne nie zablokuje klatki
+    size_t n = mainSize_.load();
+    size_t done = 0;
+    while (done < n && runMainOne()) done++;
+    return done;
+}
+
+void JobSystem::wake(bool all) {
+    epoch_.fetch_add(1);
+    if (sleepers_.load() == 0) return;
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    if (all) sleepCv_.notify_all();
+    else sleepCv_.notify_one();
+}
+
+unsigned JobSystem::threadIndex() const {
+    if (tSystem == this && tWorker >= 0) return (unsigned)tWorker + 1;
+    return isMainThread() ? 0 : workerCount() + 1;
+}
+
+void JobSystem::wait(JobCounter& counter, bool runMain) {
+    const bool main = runMain && isMainThread();
+    const int self = (tSystem == this) ? tWorker : -1;
+    int spins = 0;
+
+    for (;;) {
+        if (counter.value_.load() == 0) {
+            if (counter.inFlight_.load() == 0) break;
+            std::this_thread::yield();   // signal() właśnie kończy, to chwila
+            continue;
+        }
+
+        const uint64_t e = epoch_.load();
+        if (main && runMainOne()) { spins = 0; continue; }
+        if (Job* j = findJob(self)) {
+            execute(j);
+            spins = 0;
+            continue;
+        }
+        if (++spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_.fetch_add(1);
+        sleeps_.fetch_add(1, std::memory_order_relaxed);
+        sleepCv_.wait(lock, [&] { return epoch_.load() != e || counter.value_.load() == 0; });
+        sleepers_.fetch_sub(1);
+        spins = 0;
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex_);
+        std::swap(error, counter.error_);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void JobSystem::splitFor(size_t begin, size_t end, size_t grain,
+                         const std::function<void(size_t, size_t)>& fn, JobCounter& counter) {
+    // prawą połowę oddajemy do kolejki (do kradzieży), lewą dzielimy dalej sami
+    while (end - begin > grain) {
+        const size_t mid = begin + (end - begin) / 2;
+        run([this, mid, end, grain, &fn, &counter] { splitFor(mid, end, grain, fn, counter); }, &counter);
+        end = mid;
+    }
+    fn(begin, end);
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)>& fn, bool runMain) {
+    if (end <= begin) return;
+    const size_t n = end - begin;
+    if (grain == 0) grain = std::max<size_t>(1, n / ((workers_.size() + 1) * 4));
+    if (n <= grain) {
+        fn(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    try {
+        splitFor(begin, end, grain, fn, counter);
+    } catch (...) {
+        // kawałki już wysłane mają referencję do fn i licznika - trzeba na nie poczekać
+        std::lock_guard<std::mutex> lock(counter.mutex_);
+        if (!counter.error_) counter.error_ = std::current_exception();
+    }
+    wait(counter, runMain);
+}
+
+void JobSystem::workerLoop(int index) {
+    static const char* const kNames[] = {"worker 0", "worker 1", "worker 2", "worker 3",
+                                         "worker 4", "worker 5", "worker 6", "worker 7"};
+    PROFILE_THREAD(index < 8 ? kNames[index] : "worker");
+    tSystem = this;
+    tWorker = index;
+    tRandom = 0x9e3779b9u * (uint32_t)(index + 1);
+
+    int spins = 0;
+    for (;;) {
+        const uint64_t e = epoch_.load();
+        Job* j = findJob(index);
+        if (!j) j = findBackgroundJob();
+        if (j) {
+            execute(j);
+            spins = 0;
+            continue;
+        }
+        if (stop_.load()) return;
+        if (++spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_.fetch_add(1);
+        sleeps_.fetch_add(1, std::memory_order_relaxed);
+        sleepCv_.wait(lock, [&] { return stop_.load() || epoch_.load() != e; });
+        sleepers_.fetch_sub(1);
+        spins = 0;
+    }
+}
+
+JobSystem::Stats JobSystem::stats() const {
+    Stats s;
+    for (const auto& w : workers_) {
+        s.executed += w->executed.load(std::memory_order_relaxed);
+        s.stolen += w->stolen.load(std::memory_order_relaxed);
+    }
+    s.injected = injected_.load(std::memory_order_relaxed);
+    s.sleeps = sleeps_.load(std::memory_order_relaxed);
+    return s;
+}
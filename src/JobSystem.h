@@ -0,0 +1,142 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct Job;
+
+// Licznik zadań: add() przed wysłaniem, każde zadanie zdejmuje 1 po skończeniu.
+// Na zerze startują zadania czekające na licznik (JobSystem::runAfter), a
+// JobSystem::wait() wraca. Pierwszy wyjątek z zadań trzyma i wait() go rzuca.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    void add(int n = 1) { value_.fetch_add(n); }
+    bool done() const { return value_.load() == 0; }
+    int value() const { return value_.load(); }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> value_{0};
+    // Licznik bywa zmienną na stosie czekającego, który wraca, gdy zobaczy
+    // zero; inFlight_ > 0 znaczy, że ktoś jest jeszcze w signal() i go dotyka
+    std::atomic<int> inFlight_{0};
+    std::mutex mutex_;              // continuations_ i error_
+    std::vector<Job*> continuations_;
+    std::exception_ptr error_;
+};
+
+// Planista z kradzieżą pracy. Każdy wątek roboczy ma własną kolejkę Chase-Lev:
+// swoje zadania bierze od dołu (LIFO, ciepły cache), bezczynne wątki kradną
+// od góry (FIFO, największe kawałki). Zadania wysłane spoza puli trafiają do
+// wspólnej kolejki pod mutexem. Zadania runOnMain wykonuje tylko wątek główny:
+// ten, który stworzył JobSystem, albo przejął tę rolę w setMainThread() (ten
+// z kontekstem GL) - w pumpMain() albo czekając w wait().
+class JobSystem {
+public:
+    // 0 = liczba rdzeni - 1 (wątek główny też pracuje), ale co najmniej 2
+    explicit JobSystem(unsigned threads = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // counter (opcjonalny) dostaje +1 od razu i -1 po wykonaniu fn
+    void run(std::function<void()> fn, JobCounter* counter = nullptr);
+    // fn startuje dopiero gdy dep spadnie do zera (od razu, jeśli już jest zerem)
+    void runAfter(JobCounter& dep, std::function<void()> fn, JobCounter* counter = nullptr);
+    // Długie zadanie (plik, dekodowanie): tylko wątki puli, po ich zwykłej
+    // pracy. wait() go nie podbiera, więc wątek główny nie utknie w ładowaniu.
+    void runBackground(std::function<void()> fn, JobCounter* counter = nullptr);
+    // fn na wątku głównym
+    void runOnMain(std::function<void()> fn, JobCounter* counter = nullptr);
+    void runOnMainAfter(JobCounter& dep, std::function<void()> fn, JobCounter* counter = nullptr);
+
+    // Czeka na zero, w międzyczasie wykonując cudze zadania (na wątku głównym
+    // także kolejkę main, chyba że runMain == false - np. w środku klatki,
+    // gdzie zadanie main mogłoby podmienić model). Rzuca pierwszy wyjątek
+    // zadań tego licznika.
+    void wait(JobCounter& counter, bool runMain = true);
+
+    // fn(b, e) na kawałkach [begin, end) nie większych niż grain; 0 = ok. 4
+    // kawałki na wątek. Dzieli rekurencyjnie na pół, więc złodzieje dostają
+    // duże połowy, a nie pojedyncze kawałki. Wraca po wykonaniu całości.
+    // runMain jak w wait().
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn, bool runMain = true);
+
+    // Wykonuje zadania runOnMain, które już czekają (np. raz na klatkę).
+    // Zwraca ich liczbę; poza wątkiem głównym nic nie robi.
+    size_t pumpMain();
+
+    // Wołający zostaje wątkiem głównym (np. osobny wątek renderu przejmuje
+    // kontekst GL). Tylko gdy poprzedni już nie pompuje kolejki main.
+    void setMainThread() { mainThread_.store(std::this_thread::get_id()); }
+
+    unsigned workerCount() const { return (unsigned)workers_.size(); }
+    // 0 = wątek główny, 1..workerCount() = wątek puli, workerCount() + 1 =
+    // każdy inny wątek (może podebrać zadanie w wait() albo parallelFor).
+    // Do danych "na wątek" (np. bufory komend) - indeks stały przez całe
+    // życie wątku; ostatni jest wspólny, więc dane pod nim wymagają blokady.
+    unsigned threadIndex() const;
+    unsigned threadSlots() const { return workerCount() + 2; }
+    bool isMainThread() const { return std::this_thread::get_id() == mainThread_.load(); }
+
+    struct Stats {
+        size_t executed = 0, stolen = 0;   // przez wątki puli
+        size_t injected = 0, sleeps = 0;
+    };
+    Stats stats() const;
+
+private:
+    struct Worker;
+
+    void submit(Job* job);                  // do kolejki wątku albo wspólnej
+    void submitMain(Job* job);
+    void execute(Job* job);
+    void signal(JobCounter* counter);       // -1, na zerze continuations
+    void release(JobCounter& dep, Job* job);
+    Job* findJob(int self);                 // własna kolejka, wspólna, kradzież
+    Job* findBackgroundJob();
+    bool runMainOne();
+    void workerLoop(int index);
+    void wake(bool all);
+    void splitFor(size_t begin, size_t end, size_t grain,
+                  const std::function<void(size_t, size_t)>& fn, JobCounter& counter);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::thread::id> mainThread_;
+
+    std::mutex injectMutex_;
+    std::deque<Job*> inject_;
+    std::atomic<size_t> injectSize_{0};
+
+    std::mutex backgroundMutex_;
+    std::deque<Job*> background_;
+    std::atomic<size_t> backgroundSize_{0};
+
+    std::mutex mainMutex_;
+    std::deque<Job*> mainQueue_;
+    std::atomic<size_t> mainSize_{0};
+
+    // usypianie: wątek zapamiętuje epoch przed szukaniem pracy i śpi tylko,
+    // jeśli nikt w tym czasie nic nie wysłał (bez zgubionych pobudek)
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<int> sleepers_{0};
+    std::atomic<bool> stop_{false};
+
+    std::atomic<size_t> injected_{0}, sleeps_{0};
+};
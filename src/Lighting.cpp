@@ -0,0 +1,250 @@
+﻿#include "Lighting.h"
+#include "Shader.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+int SliceOf(float depth, float zNear, float zFar) {
+    float s = std::log(depth / zNear) / std::log(zFar / zNear) * ClusteredLighting::kGridZ;
+    return std::clamp((int)std::floor(s), 0, ClusteredLighting::kGridZ - 1);
+}
+
+float SliceDepth(int s, float zNear, float zFar) {
+    return zNear * std::pow(zFar / zNear, (float)s / ClusteredLighting::kGridZ);
+}
+
+GLuint MakeBufferTexture(GLuint& buf, GLenum internalFormat) {
+    glGenBuffers(1, &buf);
+    glBindBuffer(GL_TEXTURE_BUFFER, buf);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_DYNAMIC_DRAW);
+
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_BUFFER, tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buf);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return tex;
+}
+
+} // namespace
+
+ClusteredLighting::ClusteredLighting(int firstUnit) : firstUnit_(firstUnit) {
+    gridTex_ = MakeBufferTexture(gridBuf_, GL_RG32UI);
+    indexTex_ = MakeBufferTexture(indexBuf_, GL_R32UI);
+    lightTex_ = MakeBufferTexture(lightBuf_, GL_RGBA32F);
+    gridCap_ = indexCap_ = lightCap_ = 16;
+    grid_.resize(kClusters * 2);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    GLuint tex[3] = {gridTex_, indexTex_, lightTex_};
+    GLuint bufs[3] = {gridBuf_, indexBuf_, lightBuf_};
+    glDeleteTextures(3, tex);
+    glDeleteBuffers(3, bufs);
+}
+
+void ClusteredLighting::upload(GLuint buf, const void* data, size_t bytes, size_t& capacity) {
+    if (bytes == 0) return;
+    glBindBuffer(GL_TEXTURE_BUFFER, buf);
+    if (bytes > capacity) {
+        // rośniemy z zapasem, żeby nie realokować co klatkę przy zmiennej liczbie świateł
+        capacity = std::max(bytes, capacity * 2);
+        glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& proj,
+                               float zNear, float zFar, JobSystem* jobs) {
+    auto t0 = std::chrono::steady_clock::now();
+    zNear_ = zNear;
+    zFar_ = zFar;
+    lightCount_ = lights.size();
+
+    // 1) zakresy klastrów każdego światła (sfera w przestrzeni widoku, zachowawczo)
+    spans_.clear();
+    const float p00 = proj[0][0], p11 = proj[1][1];
+    const float p20 = proj[2][0], p21 = proj[2][1];
+
+    for (uint32_t li = 0; li < (uint32_t)lights.size(); li++) {
+        const Light& L = lights[li];
+        glm::vec3 c = glm::vec3(view * glm::vec4(L.pos, 1.f));
+        float r = L.radius;
+
+        float dNear = std::max(zNear, -c.z - r);
+        float dFar = std::min(zFar, -c.z + r);
+        if (dNear > dFar) continue;   // całe za kamerą albo za far
+
+        int s0 = SliceOf(dNear, zNear, zFar);
+        int s1 = SliceOf(dFar, zNear, zFar);
+        for (int s = s0; s <= s1; s++) {
+            float d0 = std::max(dNear, SliceDepth(s, zNear, zFar));
+            float d1 = std::min(dFar, SliceDepth(s + 1, zNear, zFar));
+
+            // x/d i y/d są monotoniczne w x i w 1/d, więc ekstrema są w narożnikach
+            float xs[2] = {c.x - r, c.x + r};
+            float ys[2] = {c.y - r, c.y + r};
+            float ds[2] = {d0, d1};
+            float nx0 = 1e30f, nx1 = -1e30f, ny0 = 1e30f, ny1 = -1e30f;
+            for (float d : ds) {
+                for (float x : xs) {
+                    float n = p00 * x / d - p20;
+                    nx0 = std::min(nx0, n); nx1 = std::max(nx1, n);
+                }
+                for (float y : ys) {
+                    float n = p11 * y / d - p21;
+                    ny0 = std::min(ny0, n); ny1 = std::max(ny1, n);
+                }
+            }
+            if (nx1 < -1.f || nx0 > 1.f || ny1 < -1.f || ny0 > 1.f) continue;
+
+            auto tile = [](float ndc, int grid) {
+                return std::clamp((int)std::floor((ndc * 0.5f + 0.5f) * grid), 0, grid - 1);
+            };
+            Span sp;
+            sp.light = li;
+            sp.z = (uint8_t)s;
+            sp.x0 = (uint8_t)tile(nx0, kGridX); sp.x1 = (uint8_t)tile(nx1, kGridX);
+            sp.y0 = (uint8_t)tile(ny0, kGridY); sp.y1 = (uint8_t)tile(ny1, kGridY);
+            spans_.push_back(sp);
+        }
+    }
+
+    // 2) zakresy ułożone plastrami (sortowanie przez zliczanie, stabilne):
+    // plaster to ciągły kawałek grid_, więc plastry liczą się niezależnie
+    std::fill(std::begin(sliceBegin_), std::end(sliceBegin_), 0u);
+    for (const Span& sp : spans_) sliceBegin_[sp.z + 1]++;
+    for (int z = 0; z < kGridZ; z++) sliceBegin_[z + 1] += sliceBegin_[z];
+    sliceSpans_.resize(spans_.size());
+    {
+        uint32_t cursor[kGridZ];
+        std::copy(sliceBegin_, sliceBegin_ + kGridZ, cursor);
+        for (const Span& sp : spans_) sliceSpans_[cursor[sp.z]++] = sp;
+    }
+
+    // 3) liczniki -> prefix sum -> wypełnienie (bez list na klaster)
+    constexpr int kSliceClusters = kGridX * kGridY;
+    auto cluster = [](int x, int y, int z) { return (z * kGridY + y) * kGridX + x; };
+    auto forSlices = [&](const std::function<void(int)>& fn) {
+        if (jobs) {
+            // w środku klatki: bez zadań main, jak nagrywanie komend
+            jobs->parallelFor(0, kGridZ, 1, [&](size_t b, size_t e) {
+                for (size_t z = b; z < e; z++) fn((int)z);
+            }, false);
+        } else {
+            for (int z = 0; z < kGridZ; z++) fn(z);
+        }
+    };
+
+    // liczniki i prefix sum w obrębie plastra
+    forSlices([&](int z) {
+        uint32_t* g = grid_.data() + (size_t)z * kSliceClusters * 2;
+        std::fill(g, g + kSliceClusters * 2, 0u);
+        for (uint32_t i = sliceBegin_[z]; i < sliceBegin_[z + 1]; i++) {
+            const Span& sp = sliceSpans_[i];
+            for (int y = sp.y0; y <= sp.y1; y++)
+                for (int x = sp.x0; x <= sp.x1; x++)
+                    g[(y * kGridX + x) * 2 + 1]++;
+        }
+        uint32_t total = 0;
+        for (int c = 0; c < kSliceClusters; c++) {
+            g[c * 2] = total;
+            total += g[c * 2 + 1];
+            g[c * 2 + 1] = 0;   // wypełniamy od nowa jako kursor
+        }
+        sliceTotal_[z] = total;
+    });
+
+    // początki plastrów w indices_ (24 liczby - szybciej niż zadanie)
+    uint32_t sliceOffset[kGridZ];
+    uint32_t total = 0;
+    for (int z = 0; z < kGridZ; z++) {
+        sliceOffset[z] = total;
+        total += sliceTotal_[z];
+    }
+
+    indices_.resize(total);
+    forSlices([&](int z) {
+        uint32_t* g = grid_.data() + (size_t)z * kSliceClusters * 2;
+        for (int c = 0; c < kSliceClusters; c++) g[c * 2] += sliceOffset[z];
+        for (uint32_t i = sliceBegin_[z]; i < sliceBegin_[z + 1]; i++) {
+            const Span& sp = sliceSpans_[i];
+            for (int y = sp.y0; y <= sp.y1; y++)
+                for (int x = sp.x0; x <= sp.x1; x++) {
+                    const int c = cluster(x, y, sp.z);
+                    indices_[grid_[c * 2] + grid_[c * 2 + 1]++] = sp.light;
+                }
+        }
+    });
+
+    lightData_.resize(lights.size() * 3);
+    for (size_t i = 0; i < lights.size(); i++) {
+        const Light& L = lights[i];
+        lightData_[i * 3 + 0] = glm::vec4(L.pos, L.radius);
+        lightData_[i * 3 + 1] = glm::vec4(L.color * L.intensity, L.cosInner);
+        lightData_[i * 3 + 2] = glm::vec4(glm::normalize(L.dir), L.cosOuter);
+    }
+
+    assignMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    upload(gridBuf_, grid_.data(), grid_.size() * sizeof(uint32_t), gridCap_);
+    upload(indexBuf_, indices_.data(), indices_.size() * sizeof(uint32_t), indexCap_);
+    upload(lightBuf_, lightData_.data(), lightData_.size() * sizeof(glm::vec4), lightCap_);
+}
+
+void ClusteredLighting::bindTextures() const {
+    glActiveTexture(GL_TEXTURE0 + firstUnit_);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTex_);
+    glActiveTexture(GL_TEXTURE0 + firstUnit_ + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTex_);
+    glActiveTexture(GL_TEXTURE0 + firstUnit_ + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, lightTex_);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ClusteredLighting::setUniforms(const Shader& sh, int screenW, int screenH) const {
+    float logRatio = std::log(zFar_ / zNear_);
+    sh.setInt("uClusterGrid", firstUnit_);
+    sh.setInt("uLightIndices", firstUnit_ + 1);
+    sh.setInt("uLightData", firstUnit_ + 2);
+    sh.setVec3("uClusterDims", glm::vec3(kGridX, kGridY, kGridZ));
+    // plaster = log(d) * scale + bias
+    sh.setVec3("uClusterZ", glm::vec3(kGridZ / logRatio, -kGridZ * std::log(zNear_) / logRatio, 0.f));
+    sh.setVec3("uScreenSize", glm::vec3((float)screenW, (float)screenH, 0.f));
+}
+
+void MakeDemoLights(std::vector<Light>& out, size_t count, const glm::vec3& center, float radius, float time) {
+    out.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        // deterministyczne "losowe" parametry, żeby pomiary były powtarzalne
+        uint32_t h = (uint32_t)i * 2654435761u;
+        auto rnd = [&h]() { h ^= h >> 13; h *= 0x5bd1e995u; h ^= h >> 15; return (h & 0xFFFF) / 65535.f; };
+
+        float ang = rnd() * 6.2831853f + time * (0.2f + 0.6f * rnd());
+        float ring = radius * (0.3f + 1.2f * rnd());
+        float height = (rnd() * 2.f - 1.f) * radius;
+
+        Light& L = out[i];
+        L.pos = center + glm::vec3(std::cos(ang) * ring, height, std::sin(ang) * ring);
+        L.radius = radius * (0.25f + 0.5f * rnd());
+        L.color = glm::vec3(0.3f + 0.7f * rnd(), 0.3f + 0.7f * rnd(), 0.3f + 0.7f * rnd());
+        L.intensity = 1.5f;
+        if (i % 4 == 3) {
+            // co czwarte światło to reflektor celujący w środek modelu
+            L.dir = glm::normalize(center - L.pos);
+            L.cosInner = std::cos(0.35f);
+            L.cosOuter = std::cos(0.55f);
+        } else {
+            L.dir = glm::vec3(0.f, -1.f, 0.f);
+            L.cosInner = -1.f;
+            L.cosOuter = -2.f;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Shader;
+class JobSystem;
+
+// Światło punktowe albo reflektor (spot). Dla punktowego cosOuter <= -1.
+struct Light {
+    glm::vec3 pos{0.f};
+    float radius = 1.f;        // zasięg, poza nim światło = 0
+    glm::vec3 color{1.f};
+    float intensity = 1.f;
+    glm::vec3 dir{0.f, -1.f, 0.f};
+    float cosInner = -1.f;
+    float cosOuter = -2.f;
+};
+
+// Clustered forward: widok dzielony na siatkę gridX x gridY kafli ekranu
+// i gridZ plastrów głębokości (wykładniczo). Co klatkę CPU przypisuje światła
+// do klastrów, a fragment shader (CLUSTERED_LIGHTS) iteruje tylko po liście
+// swojego klastra. Liczenie i wypełnianie list idzie plastrami Z (niezależne
+// od siebie) przez JobSystem::parallelFor, gdy renderer ma pulę wątków.
+// Dane idą do buffer texture (GL 3.3 nie ma SSBO):
+//   uClusterGrid  RG32UI  (offset, count) na klaster
+//   uLightIndices R32UI   indeksy świateł
+//   uLightData    RGBA32F 3 texele na światło
+class ClusteredLighting {
+public:
+    static const int kGridX = 16;
+    static const int kGridY = 9;
+    static const int kGridZ = 24;
+    static const int kClusters = kGridX * kGridY * kGridZ;
+
+    // pierwsza jednostka tekstur; zajmujemy firstUnit..firstUnit+2
+    explicit ClusteredLighting(int firstUnit = 2);
+    ~ClusteredLighting();
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // Przypisanie świateł do klastrów i upload; zNear/zFar jak w macierzy projekcji.
+    // Wątek GL; jobs (opcjonalnie) dzieli pracę między plastry Z.
+    void update(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& proj,
+                float zNear, float zFar, JobSystem* jobs = nullptr);
+
+    void bindTextures() const;
+    void setUniforms(const Shader& sh, int screenW, int screenH) const;
+
+    size_t lightCount() const { return lightCount_; }
+    size_t indexCount() const { return indices_.size(); }
+    double assignMs() const { return assignMs_; }
+
+private:
+    struct Span {           // zakres kafli jednego światła w jednym plastrze
+        uint32_t light;
+        uint8_t z, x0, x1, y0, y1;
+    };
+
+    void upload(GLuint buf, const void* data, size_t bytes, size_t& capacity);
+
+    int firstUnit_;
+    GLuint gridBuf_ = 0, indexBuf_ = 0, lightBuf_ = 0;
+    GLuint gridTex_ = 0, indexTex_ = 0, lightTex_ = 0;
+    size_t gridCap_ = 0, indexCap_ = 0, lightCap_ = 0;
+
+    float zNear_ = 0.05f, zFar_ = 500.f;
+    size_t lightCount_ = 0;
+    double assignMs_ = 0.0;
+
+    // bufory robocze trzymane między klatkami, żeby nie alokować co klatkę
+    std::vector<Span> spans_;
+    std::vector<Span> sliceSpans_;    // spans_ ułożone plastrami (kolejność świateł zachowana)
+    uint32_t sliceBegin_[kGridZ + 1] = {};
+    uint32_t sliceTotal_[kGridZ] = {};
+    std::vector<uint32_t> grid_;      // 2 x uint na klaster
+    std::vector<uint32_t> indices_;
+    std::vector<glm::vec4> lightData_;
+};
+
+// Animowane światła do sceny demo / benchmarku, rozłożone wokół modelu
+void MakeDemoLights(std::vector<Light>& out, size_t count, const glm::vec3& center, float radius, float time);
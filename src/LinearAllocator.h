@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Alokator "na klatkę": przesuwa wskaźnik w blokach stałego rozmiaru, nic nie
+// zwalnia pojedynczo, reset() cofa wszystko naraz i zostawia bloki na
+// następną klatkę. Po rozgrzaniu (tyle bloków, ile potrzebuje najcięższa
+// klatka) nie dotyka sterty. Jeden wątek na alokator.
+class LinearAllocator {
+public:
+    explicit LinearAllocator(size_t blockSize = 64 * 1024) : blockSize_(blockSize) {}
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        if (size > blockSize_) throw std::length_error("LinearAllocator: za duzy przydzial");
+        size_t at = (offset_ + align - 1) & ~(align - 1);
+        if (blocks_.empty() || at + size > blockSize_) {
+            nextBlock();
+            at = 0;
+        }
+        offset_ = at + size;
+        used_ += size;
+        return blocks_[block_].get() + at;
+    }
+
+    // Tylko typy bez destruktora - reset() nikogo nie sprząta
+    template <class T>
+    T* allocateArray(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "LinearAllocator nie wola destruktorow");
+        return static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+    }
+
+    // Oddaje koniec ostatniego przydziału (zarezerwowane z zapasem, użyte mniej)
+    void shrinkLast(size_t bytes) {
+        offset_ -= bytes;
+        used_ -= bytes;
+    }
+
+    void reset() {
+        block_ = 0;
+        offset_ = 0;
+        used_ = 0;
+    }
+
+    size_t bytesUsed() const { return used_; }
+    size_t capacity() const { return blocks_.size() * blockSize_; }
+    size_t blockSize() const { return blockSize_; }
+
+private:
+    void nextBlock() {
+        if (!blocks_.empty()) block_++;
+        if (block_ == blocks_.size()) blocks_.emplace_back(new std::byte[blockSize_]);
+        offset_ = 0;
+    }
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    size_t blockSize_;
+    size_t block_ = 0, offset_ = 0, used_ = 0;
+};
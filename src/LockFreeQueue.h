@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Ograniczona kolejka wielu producentów / wielu konsumentów bez blokad
+// (D. Vyukov, "Bounded MPMC queue"). Każda komórka ma numer sekwencji, który
+// mówi, czyja jest teraz kolej: producent rezerwuje miejsce jednym CAS-em na
+// enqueue_, zapisuje wartość i publikuje ją numerem. Kolejność globalna FIFO.
+// Pełna kolejka nie czeka - tryPush zwraca false, decyduje wołający.
+template <class T>
+class LockFreeQueue {
+public:
+    // capacity zaokrąglamy w górę do potęgi dwójki
+    explicit LockFreeQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap *= 2;
+        mask_ = cap - 1;
+        cells_.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // Przenosi v tylko przy sukcesie; przy pełnej kolejce v zostaje nietknięte
+    bool tryPush(T& v) {
+        Cell* cell;
+        size_t pos = enqueue_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;   // pełna
+            } else {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(v);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        Cell* cell;
+        size_t pos = dequeue_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;   // pusta
+            } else {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->value);
+        cell->value = T();   // nie trzymamy zasobów w pustej komórce
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueue_{0};
+    alignas(64) std::atomic<size_t> dequeue_{0};
+};
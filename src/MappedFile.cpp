@@ -0,0 +1,105 @@
+﻿#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (view) {
+                file_ = file;
+                mapping_ = mapping;
+                data_ = (const unsigned char*)view;
+                size_ = (size_t)size.QuadPart;
+                mapped_ = true;
+                return;
+            }
+            if (mapping) CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::close(fd);   // mapowanie trzyma plik samo
+                data_ = (const unsigned char*)p;
+                size_ = (size_t)st.st_size;
+                mapped_ = true;
+                return;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+    // pusty plik, brak mmap albo błąd mapowania: zwykły odczyt
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) throw std::runtime_error("Nie moge otworzyc pliku: " + path);
+    copy_.resize((size_t)f.tellg());
+    f.seekg(0);
+    f.read((char*)copy_.data(), (std::streamsize)copy_.size());
+    if (!f) throw std::runtime_error("Blad odczytu pliku: " + path);
+    data_ = copy_.data();
+    size_ = copy_.size();
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept {
+    *this = std::move(o);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this == &o) return *this;
+    release();
+    data_ = std::exchange(o.data_, nullptr);
+    size_ = std::exchange(o.size_, 0);
+    mapped_ = std::exchange(o.mapped_, false);
+    copy_ = std::move(o.copy_);
+#ifdef _WIN32
+    file_ = std::exchange(o.file_, nullptr);
+    mapping_ = std::exchange(o.mapping_, nullptr);
+#endif
+    return *this;
+}
+
+void MappedFile::release() {
+    if (mapped_) {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle((HANDLE)mapping_);
+        CloseHandle((HANDLE)file_);
+        file_ = mapping_ = nullptr;
+#elif defined(__unix__) || defined(__APPLE__)
+        munmap((void*)data_, size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    copy_.clear();
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Plik tylko do odczytu widziany jako pamięć: mmap (POSIX) albo
+// MapViewOfFile (Windows), a gdy mapowanie się nie uda - zwykły odczyt do
+// bufora. data() jest ważne, dopóki obiekt żyje.
+class MappedFile {
+public:
+    MappedFile() = default;
+    // Rzuca, gdy pliku nie da się otworzyć
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool mapped() const { return mapped_; }   // false = kopia w buforze
+
+private:
+    void release();
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<unsigned char> copy_;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
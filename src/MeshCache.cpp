@@ -0,0 +1,266 @@
+﻿#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MappedFile.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <type_traits>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t kMagic = 0x434D4E5A; // "ZNMC"
+const uint32_t kVersion = 1;
+
+int64_t FileTime(const std::string& path) {
+    std::error_code ec;
+    const auto t = fs::last_write_time(path, ec);
+    return ec ? 0 : (int64_t)t.time_since_epoch().count();
+}
+
+// Plik, od którego zależy wpis: OBJ i mtllib z nagłówka
+struct Dependency {
+    std::string path;
+    uint64_t size = 0;
+    int64_t time = 0;
+};
+
+std::vector<Dependency> Dependencies(const std::string& objPath, const std::string& baseDir) {
+    std::vector<Dependency> deps;
+    std::vector<std::string> paths = {objPath};
+    for (std::string& p : FindMtlLibs(objPath, baseDir)) paths.push_back(std::move(p));
+    for (const std::string& p : paths) {
+        std::error_code ec;
+        const uint64_t size = fs::file_size(p, ec);
+        deps.push_back({p, ec ? 0 : size, FileTime(p)});
+    }
+    return deps;
+}
+
+template <class T>
+void Put(std::ostream& os, const T& v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    os.write((const char*)&v, sizeof(T));
+}
+void PutString(std::ostream& os, const std::string& s) {
+    Put(os, (uint32_t)s.size());
+    os.write(s.data(), (std::streamsize)s.size());
+}
+void PutBytes(std::ostream& os, const std::vector<uint8_t>& v) {
+    Put(os, (uint64_t)v.size());
+    os.write((const char*)v.data(), (std::streamsize)v.size());
+}
+
+// Odczyt z zmapowanego pliku; każdy get sprawdza, czy dane jeszcze są
+class Reader {
+public:
+    Reader(const unsigned char* p, size_t n) : p_(p), end_(p + n) {}
+
+    template <class T>
+    bool get(T& v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if ((size_t)(end_ - p_) < sizeof(T)) return false;
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return true;
+    }
+    bool getString(std::string& s) {
+        uint32_t n = 0;
+        if (!get(n) || n > (1u << 16) || (size_t)(end_ - p_) < n) return false;
+        s.assign((const char*)p_, n);
+        p_ += n;
+        return true;
+    }
+    bool getBytes(std::span<const uint8_t>& out) {
+        uint64_t n = 0;
+        if (!get(n) || (uint64_t)(end_ - p_) < n) return false;
+        out = {p_, (size_t)n};
+        p_ += n;
+        return true;
+    }
+    bool atEnd() const { return p_ == end_; }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+};
+
+} // namespace
+
+std::string OBJMeshCachePath(const std::string& objPath) {
+    return objPath + ".zmesh";
+}
+
+bool SaveMeshCache(const LoadedModel& model, const std::string& objPath, const std::string& baseDir,
+                   MeshCacheInfo* info) {
+    PROFILE_ZONE("SaveMeshCache");
+    const std::string path = OBJMeshCachePath(objPath);
+    const std::vector<Dependency> deps = Dependencies(objPath, baseDir);
+    const std::vector<uint8_t> vertices = MeshCodec::EncodeVertices(model.vertices.data(), model.vertices.size(), sizeof(Vertex));
+    const std::vector<uint8_t> indices = MeshCodec::EncodeIndices(model.indices);
+
+    // zapis do pliku tymczasowego + rename, jak w ProgramBinaryCache
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        Put(f, kMagic);
+        Put(f, kVersion);
+        PutString(f, baseDir);
+        Put(f, (uint32_t)deps.size());
+        for (const Dependency& d : deps) {
+            PutString(f, d.path);
+            Put(f, d.size);
+            Put(f, d.time);
+        }
+        const ObjLoadStats& s = model.stats;
+        for (size_t n : {s.lines, s.positions, s.uvs, s.normals, s.faces}) Put(f, (uint64_t)n);
+        Put(f, (uint32_t)model.submeshes.size());
+        for (const SubMesh& sm : model.submeshes) {
+            PutString(f, sm.materialName);
+            Put(f, sm.indexOffset);
+            Put(f, sm.indexCount);
+            Put(f, sm.boundsMin);
+            Put(f, sm.boundsMax);
+        }
+        Put(f, (uint32_t)model.materials.size());
+        for (const auto& [name, m] : model.materials) {
+            PutString(f, name);
+            Put(f, m.Kd);
+            Put(f, m.Ks);
+            Put(f, m.Ns);
+            PutString(f, m.mapKd);
+            PutString(f, m.mapBump);
+            Put(f, m.bumpScale);
+            Put(f, (uint8_t)m.uvOriginTop);
+        }
+        Put(f, (uint64_t)model.vertices.size());
+        Put(f, (uint64_t)model.indices.size());
+        PutBytes(f, vertices);
+        PutBytes(f, indices);
+        if (!f) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    if (info) {
+        info->rawBytes = model.vertices.size() * sizeof(Vertex) + model.indices.size() * sizeof(uint32_t);
+        info->storedBytes = fs::file_size(path, ec);
+    }
+    return true;
+}
+
+bool LoadMeshCache(const std::string& objPath, const std::string& baseDir, LoadedModel& out, MeshCacheInfo* info) {
+    PROFILE_ZONE("LoadMeshCache");
+    const auto t0 = std::chrono::steady_clock::now();
+    const std::string path = OBJMeshCachePath(objPath);
+    std::error_code ec;
+    if (!fs::exists(path, ec)) return false;
+    MappedFile file;
+    try {
+        file = MappedFile(path);
+    } catch (const std::exception&) {
+        return false;
+    }
+    Reader r(file.data(), file.size());
+
+    uint32_t magic = 0, version = 0, n = 0;
+    std::string dir;
+    if (!r.get(magic) || !r.get(version) || magic != kMagic || version != kVersion) return false;
+    if (!r.getString(dir) || dir != baseDir || !r.get(n) || n == 0 || n > 1024) return false;
+
+    // wpis starszy niż OBJ albo MTL - geometria mogła się zmienić
+    std::vector<Dependency> stored(n);
+    for (Dependency& d : stored)
+        if (!r.getString(d.path) || !r.get(d.size) || !r.get(d.time)) return false;
+    const std::vector<Dependency> current = Dependencies(objPath, baseDir);
+    if (current.size() != stored.size()) return false;
+    for (size_t i = 0; i < current.size(); i++)
+        if (current[i].path != stored[i].path || current[i].size != stored[i].size || current[i].time != stored[i].time)
+            return false;
+
+    LoadedModel model;
+    uint64_t counts[5];
+    for (uint64_t& c : counts)
+        if (!r.get(c)) return false;
+    model.stats.lines = (size_t)counts[0];
+    model.stats.positions = (size_t)counts[1];
+    model.stats.uvs = (size_t)counts[2];
+    model.stats.normals = (size_t)counts[3];
+    model.stats.faces = (size_t)counts[4];
+
+    if (!r.get(n) || n > file.size()) return false;
+    model.submeshes.resize(n);
+    for (SubMesh& sm : model.submeshes)
+        if (!r.getString(sm.materialName) || !r.get(sm.indexOffset) || !r.get(sm.indexCount) ||
+            !r.get(sm.boundsMin) || !r.get(sm.boundsMax))
+            return false;
+    if (!r.get(n) || n > file.size()) return false;
+    for (uint32_t i = 0; i < n; i++) {
+        Material m;
+        uint8_t uvOriginTop = 0;
+        if (!r.getString(m.name) || !r.get(m.Kd) || !r.get(m.Ks) || !r.get(m.Ns) || !r.getString(m.mapKd) ||
+            !r.getString(m.mapBump) || !r.get(m.bumpScale) || !r.get(uvOriginTop))
+            return false;
+        m.uvOriginTop = uvOriginTop != 0;
+        std::string name = m.name;
+        model.materials[name] = std::move(m);
+    }
+
+    uint64_t vertexCount = 0, indexCount = 0;
+    std::span<const uint8_t> vertices, indices;
+    if (!r.get(vertexCount) || !r.get(indexCount) || !r.getBytes(vertices) || !r.getBytes(indices) || !r.atEnd())
+        return false;
+    // 2 bity nagłówka na 16 elementów to najmniej, ile zajmuje zakodowany element
+    if (vertexCount > vertices.size() * 64 || indexCount > indices.size() * 64) return false;
+    for (const SubMesh& sm : model.submeshes)
+        if ((uint64_t)sm.indexOffset + sm.indexCount > indexCount) return false;
+    const double readMs = MsSince(t0);
+
+    const auto d0 = std::chrono::steady_clock::now();
+    model.vertices.resize((size_t)vertexCount);
+    model.indices.resize((size_t)indexCount);
+    try {
+        MeshCodec::DecodeVertices(vertices, model.vertices.data(), model.vertices.size(), sizeof(Vertex));
+        MeshCodec::DecodeIndices(indices, model.indices);
+    } catch (const std::exception&) {
+        return false;
+    }
+    for (uint32_t i : model.indices)
+        if (i >= vertexCount) return false;
+
+    model.stats.vertices = model.vertices.size();
+    model.stats.indices = model.indices.size();
+    model.stats.totalMs = MsSince(t0);
+    if (info) {
+        info->rawBytes = vertexCount * sizeof(Vertex) + indexCount * sizeof(uint32_t);
+        info->storedBytes = file.size();
+        info->readMs = readMs;
+        info->decodeMs = MsSince(d0);
+    }
+    out = std::move(model);
+    return true;
+}
+
+LoadedModel LoadOBJCached(const std::string& objPath, const std::string& baseDir, const std::atomic<bool>* cancel,
+                          bool* fromCache) {
+    PROFILE_ZONE("LoadOBJCached");
+    LoadedModel model;
+    if (LoadMeshCache(objPath, baseDir, model)) {
+        if (fromCache) *fromCache = true;
+        return model;
+    }
+    model = LoadOBJ_WithMTL(objPath, baseDir, cancel);
+    SaveMeshCache(model, objPath, baseDir);   // np. katalog tylko do odczytu - następnym razem znów OBJ
+    if (fromCache) *fromCache = false;
+    return model;
+}
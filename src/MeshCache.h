@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "ObjLoader.h"
+
+// Sidecar z gotową geometrią obok OBJ ("<obj>.zmesh"), jak indeks odcinków
+// (.sidx). Wierzchołki i indeksy zapisane MeshCodec, do tego submeshe,
+// materiały i liczniki z wczytania. Wpis jest ważny, dopóki OBJ i pliki
+// mtllib z jego nagłówka (FindMtlLibs) mają ten sam rozmiar i czas
+// modyfikacji, a baseDir się nie zmienił; mtllib spoza nagłówka nie są
+// sprawdzane.
+struct MeshCacheInfo {
+    uint64_t rawBytes = 0;     // wierzchołki + indeksy w pamięci
+    uint64_t storedBytes = 0;  // cały plik cache
+    double readMs = 0.0;       // mapowanie pliku i nagłówek
+    double decodeMs = 0.0;     // MeshCodec
+};
+
+std::string OBJMeshCachePath(const std::string& objPath);
+// false, gdy zapis się nie udał (np. katalog tylko do odczytu)
+bool SaveMeshCache(const LoadedModel& model, const std::string& objPath, const std::string& baseDir,
+                   MeshCacheInfo* info = nullptr);
+// false, gdy pliku nie ma, jest uszkodzony albo nieaktualny
+bool LoadMeshCache(const std::string& objPath, const std::string& baseDir, LoadedModel& out,
+                   MeshCacheInfo* info = nullptr);
+
+// Jak LoadOBJ_WithMTL, ale najpierw sidecar; przy pudle wczytuje OBJ i
+// zapisuje sidecar (błąd zapisu nie jest błędem wczytania)
+LoadedModel LoadOBJCached(const std::string& objPath, const std::string& baseDir,
+                          const std::atomic<bool>* cancel = nullptr, bool* fromCache = nullptr);
@@ -0,0 +1,384 @@
+﻿#include "MeshCodec.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace MeshCodec {
+namespace {
+
+constexpr size_t kGroup = 16;
+constexpr size_t kGroups = kBlock / kGroup;
+constexpr size_t kHeaderBytes = kGroups / 4;   // 2 bity na grupę
+
+[[noreturn]] void Corrupt() {
+    throw std::runtime_error("Uszkodzone dane siatki (MeshCodec)");
+}
+
+uint32_t ZigZag(uint32_t d) {
+    return (d << 1) ^ (uint32_t)((int32_t)d >> 31);
+}
+
+uint32_t UnZigZag(uint32_t z) {
+    return (z >> 1) ^ (0u - (z & 1));
+}
+
+// Ile bajtów zajmują dane grupy przy danym kodzie nagłówka (0, 2, 4, 8 bitów)
+constexpr size_t kGroupBytes[4] = {0, 4, 8, 16};
+
+// Płaszczyzna bloku: nagłówki grup, potem dane grup po kolei
+void EncodePlane(const uint8_t* plane, size_t groups, std::vector<uint8_t>& out) {
+    const size_t header = out.size();
+    out.resize(header + kHeaderBytes, 0);
+    for (size_t g = 0; g < groups; g++) {
+        const uint8_t* v = plane + g * kGroup;
+        uint8_t any = 0;
+        for (size_t i = 0; i < kGroup; i++) any |= v[i];
+        const int code = any == 0 ? 0 : any < 4 ? 1 : any < 16 ? 2 : 3;
+        out[header + g / 4] |= (uint8_t)(code << ((g % 4) * 2));
+        switch (code) {
+        case 1:
+            for (size_t k = 0; k < 4; k++)
+                out.push_back((uint8_t)(v[4 * k] << 6 | v[4 * k + 1] << 4 | v[4 * k + 2] << 2 | v[4 * k + 3]));
+            break;
+        case 2:
+            for (size_t k = 0; k < 8; k++) out.push_back((uint8_t)(v[2 * k] << 4 | v[2 * k + 1]));
+            break;
+        case 3:
+            out.insert(out.end(), v, v + kGroup);
+            break;
+        }
+    }
+}
+
+// Odwrotność EncodePlane; zwraca wskaźnik za danymi płaszczyzny. simd:
+// ścieżka SSE2 (gdy jest w kompilacji), inaczej skalarna - ta sama treść.
+const uint8_t* DecodePlane(const uint8_t* p, const uint8_t* end, size_t groups, uint8_t* plane, bool simd) {
+    if ((size_t)(end - p) < kHeaderBytes) Corrupt();
+    const uint8_t* header = p;
+    p += kHeaderBytes;
+    for (size_t g = 0; g < groups; g++) {
+        const int code = (header[g / 4] >> ((g % 4) * 2)) & 3;
+        if ((size_t)(end - p) < kGroupBytes[code]) Corrupt();
+        uint8_t* v = plane + g * kGroup;
+#ifdef MESH_CODEC_SSE2
+        if (simd) {
+            __m128i r;
+            switch (code) {
+            case 0:
+                r = _mm_setzero_si128();
+                break;
+            case 1: {
+                int32_t word;
+                std::memcpy(&word, p, 4);
+                const __m128i x = _mm_cvtsi32_si128(word);
+                const __m128i m = _mm_set1_epi8(3);
+                // bajt k -> wartości 4k..4k+3 z bitów 7-6, 5-4, 3-2, 1-0
+                const __m128i a = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 6), m),
+                                                    _mm_and_si128(_mm_srli_epi16(x, 4), m));
+                const __m128i b = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 2), m), _mm_and_si128(x, m));
+                r = _mm_unpacklo_epi16(a, b);
+                break;
+            }
+            case 2: {
+                const __m128i x = _mm_loadl_epi64((const __m128i*)p);
+                const __m128i m = _mm_set1_epi8(15);
+                r = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x, 4), m), _mm_and_si128(x, m));
+                break;
+            }
+            default:
+                r = _mm_loadu_si128((const __m128i*)p);
+                break;
+            }
+            _mm_storeu_si128((__m128i*)v, r);
+            p += kGroupBytes[code];
+            continue;
+        }
+#else
+        (void)simd;
+#endif
+        switch (code) {
+        case 0:
+            std::memset(v, 0, kGroup);
+            break;
+        case 1:
+            for (size_t k = 0; k < 4; k++) {
+                v[4 * k] = p[k] >> 6;
+                v[4 * k + 1] = (p[k] >> 4) & 3;
+                v[4 * k + 2] = (p[k] >> 2) & 3;
+                v[4 * k + 3] = p[k] & 3;
+            }
+            break;
+        case 2:
+            for (size_t k = 0; k < 8; k++) {
+                v[2 * k] = p[k] >> 4;
+                v[2 * k + 1] = p[k] & 15;
+            }
+            break;
+        default:
+            std::memcpy(v, p, kGroup);
+            break;
+        }
+        p += kGroupBytes[code];
+    }
+    return p;
+}
+
+// Cztery płaszczyzny -> słowa, odwrócony zigzag i suma prefiksowa od last
+void CombinePlanes(const uint8_t (*planes)[kBlock], size_t n, uint32_t& last, uint32_t* words, bool simd) {
+    size_t i = 0;
+#ifdef MESH_CODEC_SSE2
+    if (simd) {
+        __m128i carry = _mm_set1_epi32((int)last);
+        const __m128i one = _mm_set1_epi32(1);
+        auto finish = [&](__m128i z, uint32_t* dst) {
+            __m128i d = _mm_xor_si128(_mm_srli_epi32(z, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(z, one)));
+            d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+            d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+            d = _mm_add_epi32(d, carry);
+            carry = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 3, 3, 3));
+            _mm_store_si128((__m128i*)dst, d);
+        };
+        // płaszczyzny mają zapas do pełnej grupy, więc n zaokrąglamy w górę
+        for (; i + kGroup <= (n + kGroup - 1) / kGroup * kGroup; i += kGroup) {
+            const __m128i b0 = _mm_load_si128((const __m128i*)(planes[0] + i));
+            const __m128i b1 = _mm_load_si128((const __m128i*)(planes[1] + i));
+            const __m128i b2 = _mm_load_si128((const __m128i*)(planes[2] + i));
+            const __m128i b3 = _mm_load_si128((const __m128i*)(planes[3] + i));
+            const __m128i lo01 = _mm_unpacklo_epi8(b0, b1), hi01 = _mm_unpackhi_epi8(b0, b1);
+            const __m128i lo23 = _mm_unpacklo_epi8(b2, b3), hi23 = _mm_unpackhi_epi8(b2, b3);
+            finish(_mm_unpacklo_epi16(lo01, lo23), words + i);
+            finish(_mm_unpackhi_epi16(lo01, lo23), words + i + 4);
+            finish(_mm_unpacklo_epi16(hi01, hi23), words + i + 8);
+            finish(_mm_unpackhi_epi16(hi01, hi23), words + i + 12);
+        }
+        // ostatnia prawdziwa wartość (dalej są słowa z dopełnienia)
+        last = n ? words[n - 1] : last;
+        return;
+    }
+#else
+    (void)simd;
+#endif
+    for (; i < n; i++) {
+        const uint32_t z = planes[0][i] | (uint32_t)planes[1][i] << 8 | (uint32_t)planes[2][i] << 16 |
+                           (uint32_t)planes[3][i] << 24;
+        last += UnZigZag(z);
+        words[i] = last;
+    }
+}
+
+// Kolumny bloku (słowa po kBlock) -> elementy o danym stride
+void StoreColumns(const uint32_t* columns, size_t cols, size_t n, size_t stride, uint8_t* out, bool simd) {
+    size_t c = 0;
+#ifdef MESH_CODEC_SSE2
+    // po cztery kolumny i cztery elementy: transpozycja 4x4
+    for (; simd && c + 4 <= cols; c += 4) {
+        const uint32_t* k0 = columns + c * kBlock;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m128i r0 = _mm_load_si128((const __m128i*)(k0 + i));
+            const __m128i r1 = _mm_load_si128((const __m128i*)(k0 + kBlock + i));
+            const __m128i r2 = _mm_load_si128((const __m128i*)(k0 + 2 * kBlock + i));
+            const __m128i r3 = _mm_load_si128((const __m128i*)(k0 + 3 * kBlock + i));
+            const __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+            const __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+            uint8_t* dst = out + i * stride + c * 4;
+            _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i*)(dst + stride), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i*)(dst + 2 * stride), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i*)(dst + 3 * stride), _mm_unpackhi_epi64(t2, t3));
+        }
+        for (; i < n; i++)
+            for (size_t k = 0; k < 4; k++) std::memcpy(out + i * stride + (c + k) * 4, k0 + k * kBlock + i, 4);
+    }
+#else
+    (void)simd;
+#endif
+    for (; c < cols; c++)
+        for (size_t i = 0; i < n; i++) std::memcpy(out + i * stride + c * 4, columns + c * kBlock + i, 4);
+}
+
+std::vector<uint8_t> EncodeWords(const uint8_t* data, size_t count, size_t stride) {
+    if (stride == 0 || stride % 4) throw std::invalid_argument("MeshCodec: stride musi byc wielokrotnoscia 4");
+    const size_t cols = stride / 4;
+    std::vector<uint8_t> out;
+    out.reserve(count * stride / 2);
+    std::vector<uint32_t> last(cols, 0);
+    uint8_t planes[4][kBlock];
+    for (size_t base = 0; base < count; base += kBlock) {
+        const size_t n = std::min(kBlock, count - base);
+        const size_t groups = (n + kGroup - 1) / kGroup;
+        for (size_t c = 0; c < cols; c++) {
+            std::memset(planes, 0, sizeof(planes));
+            for (size_t i = 0; i < n; i++) {
+                uint32_t w;
+                std::memcpy(&w, data + (base + i) * stride + c * 4, 4);
+                const uint32_t z = ZigZag(w - last[c]);
+                last[c] = w;
+                for (int p = 0; p < 4; p++) planes[p][i] = (uint8_t)(z >> (8 * p));
+            }
+            for (int p = 0; p < 4; p++) EncodePlane(planes[p], groups, out);
+        }
+    }
+    return out;
+}
+
+void DecodeWords(std::span<const uint8_t> encoded, uint8_t* out, size_t count, size_t stride, bool simd) {
+    if (stride == 0 || stride % 4) throw std::invalid_argument("MeshCodec: stride musi byc wielokrotnoscia 4");
+    const size_t cols = stride / 4;
+    const uint8_t* p = encoded.data();
+    const uint8_t* end = p + encoded.size();
+    std::vector<uint32_t> last(cols, 0);
+    alignas(16) uint8_t planes[4][kBlock];
+    // kolumny jednego bloku; wyrównane do 16 pod SSE
+    struct alignas(16) Column { uint32_t w[kBlock]; };
+    std::vector<Column> columns(cols);
+    for (size_t base = 0; base < count; base += kBlock) {
+        const size_t n = std::min(kBlock, count - base);
+        const size_t groups = (n + kGroup - 1) / kGroup;
+        for (size_t c = 0; c < cols; c++) {
+            for (int k = 0; k < 4; k++) p = DecodePlane(p, end, groups, planes[k], simd);
+            CombinePlanes(planes, n, last[c], columns[c].w, simd);
+        }
+        StoreColumns(columns[0].w, cols, n, stride, out + base * stride, simd);
+    }
+    if (p != end) Corrupt();
+}
+
+// Ile grup każdej szerokości (kod 0..3) ma strumień; dane już sprawdzone
+void CountGroupWidths(std::span<const uint8_t> encoded, size_t count, size_t stride, size_t (&used)[4]) {
+    const uint8_t* p = encoded.data();
+    for (size_t base = 0; base < count; base += kBlock) {
+        const size_t groups = (std::min(kBlock, count - base) + kGroup - 1) / kGroup;
+        for (size_t plane = 0; plane < stride; plane++) {   // stride / 4 kolumn po 4 płaszczyzny
+            const uint8_t* header = p;
+            p += kHeaderBytes;
+            for (size_t g = 0; g < groups; g++) {
+                const int code = (header[g / 4] >> ((g % 4) * 2)) & 3;
+                used[code]++;
+                p += kGroupBytes[code];
+            }
+        }
+    }
+}
+
+// Jeden przypadek SelfCheck: wszystkie ścieżki dekodera, potem ucięcie
+bool RoundTrip(const char* name, const std::vector<uint32_t>& words, size_t stride, size_t (&used)[4],
+               std::string* failure) {
+    const size_t count = words.size() * 4 / stride;
+    const std::vector<uint8_t> encoded = EncodeWords((const uint8_t*)words.data(), count, stride);
+    auto fail = [&](const char* what, bool simd) {
+        if (failure) *failure = std::string("MeshCodec ") + name + (simd ? " (SSE2): " : " (skalarnie): ") + what;
+        return false;
+    };
+    for (bool simd : {false, true}) {
+        if (simd && !SimdDecoder()) continue;
+        std::vector<uint32_t> decoded(words.size(), 0xCDCDCDCDu);
+        try {
+            DecodeWords(encoded, (uint8_t*)decoded.data(), count, stride, simd);
+        } catch (const std::exception&) {
+            return fail("wyjatek przy poprawnych danych", simd);
+        }
+        if (decoded != words) return fail("inne dane po dekodowaniu", simd);
+        if (!encoded.empty()) {
+            bool threw = false;
+            try {
+                std::vector<uint8_t> cut(encoded.begin(), encoded.end() - 1);
+                DecodeWords(cut, (uint8_t*)decoded.data(), count, stride, simd);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            if (!threw) return fail("uciete dane bez bledu", simd);
+        }
+    }
+    CountGroupWidths(encoded, count, stride, used);
+    return true;
+}
+
+} // namespace
+
+std::vector<uint8_t> EncodeVertices(const void* vertices, size_t count, size_t stride) {
+    PROFILE_ZONE("MeshCodec encode vertices");
+    return EncodeWords((const uint8_t*)vertices, count, stride);
+}
+
+void DecodeVertices(std::span<const uint8_t> encoded, void* out, size_t count, size_t stride) {
+    PROFILE_ZONE("MeshCodec decode vertices");
+    DecodeWords(encoded, (uint8_t*)out, count, stride, SimdDecoder());
+}
+
+std::vector<uint8_t> EncodeIndices(std::span<const uint32_t> indices) {
+    PROFILE_ZONE("MeshCodec encode indices");
+    return EncodeWords((const uint8_t*)indices.data(), indices.size(), sizeof(uint32_t));
+}
+
+void DecodeIndices(std::span<const uint8_t> encoded, std::span<uint32_t> out) {
+    PROFILE_ZONE("MeshCodec decode indices");
+    DecodeWords(encoded, (uint8_t*)out.data(), out.size(), sizeof(uint32_t), SimdDecoder());
+}
+
+bool SimdDecoder() {
+#ifdef MESH_CODEC_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SelfCheck(std::string* failure) {
+    PROFILE_ZONE("MeshCodec self check");
+    size_t used[4] = {};
+    uint32_t seed = 12345;
+    auto random = [&] { return seed = seed * 1664525u + 1013904223u; };
+
+    // wierzchołki 32 B (8 kolumn): stała, +1, +5/-3, losowe, floaty; dwa
+    // pełne bloki i niepełny trzeci z niepełną grupą
+    const size_t vertexWords = 8;
+    std::vector<uint32_t> vertices;
+    for (size_t i = 0; i < 2 * kBlock + 37; i++) {
+        const float f[4] = {std::sin(i * 0.01f), std::cos(i * 0.02f), i * 0.5f, -1.f / (1.f + i)};
+        uint32_t w[vertexWords] = {0x12345678u, (uint32_t)i, (uint32_t)(i / 2 * 2 + (i % 2) * 5), random()};
+        std::memcpy(w + 4, f, sizeof(f));
+        vertices.insert(vertices.end(), w, w + vertexWords);
+    }
+    // indeksy: pasy trójkątów z rzadkimi dużymi skokami
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < 1000; i++) indices.push_back(i % 97 == 0 ? random() : i / 3 + (i % 3));
+
+    if (!RoundTrip("wierzcholki", vertices, vertexWords * 4, used, failure)) return false;
+    if (!RoundTrip("indeksy", indices, 4, used, failure)) return false;
+    for (size_t n : {size_t(0), size_t(1), kGroup - 1, kGroup, kGroup + 1, kBlock, kBlock + 1}) {
+        std::vector<uint32_t> small(indices.begin(), indices.begin() + n);
+        if (!RoundTrip("krotki strumien", small, 4, used, failure)) return false;
+    }
+    // pusty strumień nie ma żadnych bajtów, a nadmiarowe dane to błąd
+    {
+        bool threw = false;
+        try {
+            const uint8_t extra[1] = {0};
+            DecodeWords(extra, nullptr, 0, 4, SimdDecoder());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        if (!threw) {
+            if (failure) *failure = "MeshCodec: dane za pustym strumieniem bez bledu";
+            return false;
+        }
+    }
+    for (int code = 0; code < 4; code++) {
+        if (!used[code]) {
+            if (failure) *failure = "MeshCodec: zadna grupa o szerokosci " + std::to_string(kGroupBytes[code] / 2) + " bitow";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace MeshCodec
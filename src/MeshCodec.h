@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Bezstratny kodek geometrii do pliku cache (MeshCache). Strumień to słowa
+// 32-bitowe w kolumnach (wierzchołek: stride / 4 kolumn, indeksy: jedna):
+//
+//   1. delta względem poprzedniego elementu w tej samej kolumnie (mod 2^32),
+//      zigzag - małe różnice w obie strony dają małe liczby,
+//   2. bloki po kBlock elementów, w bloku każda kolumna rozbita na cztery
+//      płaszczyzny bajtów (najmłodszy ... najstarszy),
+//   3. płaszczyzna w grupach po 16 bajtów, każda grupa z 2-bitowym
+//      nagłówkiem: 0, 2, 4 albo 8 bitów na bajt (najmniej, ile się mieści).
+//
+// Starsze bajty delt zwykle są zerami (grupy bez danych), młodsze mieszczą
+// się w 2-4 bitach - indeksy kurczą się ok. 3x, floaty mniej (mantysa).
+// Dekoder rozpakowuje grupy, składa płaszczyzny, odwraca zigzag, sumuje
+// prefiksowo i transponuje kolumny do wierzchołków na SSE2 (x86-64);
+// ścieżka skalarna (ten sam algorytm) jest zawsze w kompilacji.
+namespace MeshCodec {
+
+constexpr size_t kBlock = 256;
+
+// stride: wielokrotność 4 (bajty jednego elementu)
+std::vector<uint8_t> EncodeVertices(const void* vertices, size_t count, size_t stride);
+// Rzuca std::runtime_error, gdy dane są ucięte albo nie pasują do count/stride
+void DecodeVertices(std::span<const uint8_t> encoded, void* out, size_t count, size_t stride);
+
+// Indeksy: delta względem poprzedniego indeksu, dalej jak wyżej
+std::vector<uint8_t> EncodeIndices(std::span<const uint32_t> indices);
+void DecodeIndices(std::span<const uint8_t> encoded, std::span<uint32_t> out);
+
+// Czy dekoder ma ścieżkę SIMD w tej kompilacji
+bool SimdDecoder();
+
+// Koder -> dekoder na danych syntetycznych, osobno ścieżką SIMD i skalarną:
+// pusty strumień, pojedyncze elementy, niepełny ostatni blok i grupa, grupy
+// 0/2/4/8 bitów (sprawdzane w nagłówkach strumienia), ucięte dane muszą
+// rzucić. false i opis w failure przy pierwszej niezgodności.
+bool SelfCheck(std::string* failure = nullptr);
+
+} // namespace MeshCodec
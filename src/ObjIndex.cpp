@@ -0,0 +1,578 @@
+﻿#include "ObjIndex.h"
+#include "ObjParse.h"
+#include "CompressedInput.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t kMagic = 0x494F4E5A; // "ZNOI"
+const uint32_t kVersion = 2;
+
+int64_t FileTime(const std::string& path) {
+    std::error_code ec;
+    const auto t = fs::last_write_time(path, ec);
+    return ec ? 0 : (int64_t)t.time_since_epoch().count();
+}
+
+// Najmniejszy i największy indeks atrybutu użyty przez ściany odcinka
+struct Refs {
+    int64_t lo = std::numeric_limits<int64_t>::max(), hi = -1;
+    void add(int i) {
+        if (i < 0) return;
+        lo = std::min<int64_t>(lo, i);
+        hi = std::max<int64_t>(hi, i);
+    }
+    ObjAttributeRange range() const {
+        if (hi < 0) return {};
+        return ObjAttributeRange{(uint32_t)lo, (uint32_t)(hi - lo + 1)};
+    }
+};
+
+bool IsFaceLine(const std::string& line) {
+    return line.size() >= 2 && line[0] == 'f' && (line[1] == ' ' || line[1] == '\t');
+}
+
+// --- sidecar: proste typy jak w pamięci, napisy jako długość + bajty ---
+
+template <class T>
+void Put(std::ostream& os, const T& v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    os.write((const char*)&v, sizeof(T));
+}
+void PutString(std::ostream& os, const std::string& s) {
+    Put(os, (uint32_t)s.size());
+    os.write(s.data(), (std::streamsize)s.size());
+}
+template <class T>
+void PutVector(std::ostream& os, const std::vector<T>& v) {
+    Put(os, (uint64_t)v.size());
+    os.write((const char*)v.data(), (std::streamsize)(v.size() * sizeof(T)));
+}
+
+template <class T>
+bool Get(std::istream& is, T& v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return (bool)is.read((char*)&v, sizeof(T));
+}
+bool GetString(std::istream& is, std::string& s) {
+    uint32_t n = 0;
+    if (!Get(is, n) || n > (1u << 16)) return false;
+    s.resize(n);
+    return (bool)is.read(s.data(), n);
+}
+template <class T>
+bool GetVector(std::istream& is, std::vector<T>& v, uint64_t limit) {
+    uint64_t n = 0;
+    if (!Get(is, n) || n > limit) return false;
+    v.resize((size_t)n);
+    return (bool)is.read((char*)v.data(), (std::streamsize)(n * sizeof(T)));
+}
+
+} // namespace
+
+ObjSectionIndex IndexOBJSections(const std::string& objPath, ObjAttributeVisitor* visitor,
+                                 const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("IndexOBJSections");
+    std::ifstream f(objPath, std::ios::binary);
+    if (!f) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+    // offsety odcinków i znaczniki to skoki w pliku - w strumieniu gzip/zstd ich nie ma
+    if (DetectCompression(objPath) != InputCompression::None)
+        throw std::runtime_error("Skompresowany OBJ nie ma indeksu odcinkow (rozpakuj go): " + objPath);
+    constexpr uint32_t kStride = ObjSectionIndex::kMarkStride;
+
+    ObjSectionIndex idx;
+    idx.fileTime = FileTime(objPath);
+    idx.sections.emplace_back();
+    std::string object, material;
+    bool namedObjects = false;   // było "o" - wtedy "g" nie zmienia nazwy obiektu
+    Refs refV, refT, refN;
+    glm::vec3 blockMin(1e30f), blockMax(-1e30f);
+    uint64_t offset = 0;
+
+    auto closeSection = [&]() {
+        ObjSection& s = idx.sections.back();
+        s.positions = refV.range();
+        s.uvs = refT.range();
+        s.normals = refN.range();
+        refV = refT = refN = Refs{};
+        // pusty odcinek bez usemtl nic nie wnosi
+        if (s.faces == 0 && !s.newMaterial) idx.sections.pop_back();
+    };
+    auto newSection = [&](bool newMaterial) {
+        closeSection();
+        ObjSection s;
+        s.object = object;
+        s.material = material;
+        s.newMaterial = newMaterial;
+        idx.sections.push_back(std::move(s));
+    };
+
+    std::string raw, tok;
+    while (std::getline(f, raw)) {
+        const uint64_t lineBegin = offset;
+        // + '\n' ('\r' jest w raw); ostatnia linia może go nie mieć - wtedy getline ustawia eof
+        offset += raw.size() + (f.eof() ? 0 : 1);
+        const std::string line = Trim(raw);
+        if (line.empty() || line[0] == '#') continue;
+        idx.lines++;
+        if (cancel && (idx.lines & 4095) == 0 && cancel->load(std::memory_order_relaxed))
+            throw LoadCancelled();
+
+        if (IsFaceLine(line)) {
+            ObjSection& s = idx.sections.back();
+            std::istringstream iss(line.substr(2));
+            size_t corners = 0;
+            while (iss >> tok) {
+                const Key k = ParseFaceVertex(tok);
+                refV.add(k.v);
+                refT.add(k.t);
+                refN.add(k.n);
+                corners++;
+            }
+            if (!s.faces) s.begin = lineBegin;
+            s.end = offset;
+            s.faces++;
+            idx.faces++;
+            if (corners >= 3) s.indices += (uint32_t)((corners - 2) * 3);
+            continue;
+        }
+
+        std::istringstream iss(line);
+        std::string tag;
+        iss >> tag;
+        if (tag == "v") {
+            glm::vec3 p; iss >> p.x >> p.y >> p.z;
+            if (idx.positions % kStride == 0) {
+                idx.positionMarks.push_back(lineBegin);
+                if (idx.positions) {
+                    idx.blockMin.push_back(blockMin);
+                    idx.blockMax.push_back(blockMax);
+                }
+                blockMin = glm::vec3(1e30f);
+                blockMax = glm::vec3(-1e30f);
+            }
+            blockMin = glm::min(blockMin, p);
+            blockMax = glm::max(blockMax, p);
+            if (visitor) visitor->position(p);
+            idx.positions++;
+        } else if (tag == "vt") {
+            glm::vec2 t; iss >> t.x >> t.y;
+            if (idx.uvs % kStride == 0) idx.uvMarks.push_back(lineBegin);
+            if (visitor) visitor->uv(t);
+            idx.uvs++;
+        } else if (tag == "vn") {
+            glm::vec3 n; iss >> n.x >> n.y >> n.z;
+            if (idx.normals % kStride == 0) idx.normalMarks.push_back(lineBegin);
+            if (visitor) visitor->normal(n);
+            idx.normals++;
+        } else if (tag == "mtllib") {
+            idx.mtlLibs.push_back(MtlLibName(iss));
+        } else if (tag == "usemtl") {
+            std::string name; std::getline(iss, name);
+            material = Trim(name);
+            newSection(true);
+        } else if (tag == "o") {
+            std::string name; std::getline(iss, name);
+            object = Trim(name);
+            namedObjects = true;
+            newSection(false);
+        } else if (tag == "g") {
+            // jak w ObjScan: w pliku bez "o" obiektami są grupy
+            std::string name; std::getline(iss, name);
+            if (!namedObjects) object = Trim(name);
+            newSection(false);
+        }
+    }
+    closeSection();
+    if (idx.positions) {
+        idx.blockMin.push_back(blockMin);
+        idx.blockMax.push_back(blockMax);
+    }
+
+    for (ObjSection& s : idx.sections) {
+        idx.indices += s.indices;
+        if (!s.positions.count) continue;
+        const size_t b0 = s.positions.first / kStride;
+        const size_t b1 = std::min<size_t>((s.positions.first + s.positions.count - 1) / kStride, idx.blockMin.size() - 1);
+        s.boundsMin = glm::vec3(1e30f);
+        s.boundsMax = glm::vec3(-1e30f);
+        for (size_t b = b0; b <= b1; b++) {
+            s.boundsMin = glm::min(s.boundsMin, idx.blockMin[b]);
+            s.boundsMax = glm::max(s.boundsMax, idx.blockMax[b]);
+        }
+    }
+    idx.fileSize = offset;
+    return idx;
+}
+
+std::string OBJIndexPath(const std::string& objPath) {
+    return objPath + ".sidx";
+}
+
+bool SaveOBJIndex(const ObjSectionIndex& idx, const std::string& path) {
+    // zapis do pliku tymczasowego + rename, jak w ProgramBinaryCache
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        Put(f, kMagic);
+        Put(f, kVersion);
+        Put(f, idx.fileSize);
+        Put(f, idx.fileTime);
+        for (size_t n : {idx.lines, idx.positions, idx.uvs, idx.normals, idx.faces, idx.indices}) Put(f, (uint64_t)n);
+        Put(f, (uint32_t)idx.mtlLibs.size());
+        for (const std::string& s : idx.mtlLibs) PutString(f, s);
+        Put(f, (uint32_t)idx.sections.size());
+        for (const ObjSection& s : idx.sections) {
+            PutString(f, s.object);
+            PutString(f, s.material);
+            Put(f, (uint8_t)s.newMaterial);
+            Put(f, s.begin);
+            Put(f, s.end);
+            Put(f, s.faces);
+            Put(f, s.indices);
+            Put(f, s.positions);
+            Put(f, s.uvs);
+            Put(f, s.normals);
+            Put(f, s.boundsMin);
+            Put(f, s.boundsMax);
+        }
+        PutVector(f, idx.positionMarks);
+        PutVector(f, idx.uvMarks);
+        PutVector(f, idx.normalMarks);
+        PutVector(f, idx.blockMin);
+        PutVector(f, idx.blockMax);
+        if (!f) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+    return !ec;
+}
+
+bool LoadOBJIndex(const std::string& path, const std::string& objPath, ObjSectionIndex& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    uint32_t magic = 0, version = 0;
+    ObjSectionIndex idx;
+    if (!Get(f, magic) || !Get(f, version) || magic != kMagic || version != kVersion) return false;
+    if (!Get(f, idx.fileSize) || !Get(f, idx.fileTime)) return false;
+
+    // indeks starszy niż OBJ (albo od innego pliku) - nie ufamy offsetom
+    std::error_code ec;
+    const uint64_t size = fs::file_size(objPath, ec);
+    if (ec || size != idx.fileSize || FileTime(objPath) != idx.fileTime) return false;
+
+    uint64_t counts[6];
+    for (uint64_t& n : counts)
+        if (!Get(f, n)) return false;
+    idx.lines = (size_t)counts[0];
+    idx.positions = (size_t)counts[1];
+    idx.uvs = (size_t)counts[2];
+    idx.normals = (size_t)counts[3];
+    idx.faces = (size_t)counts[4];
+    idx.indices = (size_t)counts[5];
+
+    uint32_t n = 0;
+    if (!Get(f, n) || n > idx.lines) return false;
+    idx.mtlLibs.resize(n);
+    for (std::string& s : idx.mtlLibs)
+        if (!GetString(f, s)) return false;
+    if (!Get(f, n) || n > idx.lines + 1) return false;
+    idx.sections.resize(n);
+    for (ObjSection& s : idx.sections) {
+        uint8_t newMaterial = 0;
+        if (!GetString(f, s.object) || !GetString(f, s.material) || !Get(f, newMaterial) ||
+            !Get(f, s.begin) || !Get(f, s.end) || !Get(f, s.faces) || !Get(f, s.indices) ||
+            !Get(f, s.positions) || !Get(f, s.uvs) || !Get(f, s.normals) ||
+            !Get(f, s.boundsMin) || !Get(f, s.boundsMax))
+            return false;
+        s.newMaterial = newMaterial != 0;
+        if (s.end > idx.fileSize || s.begin > s.end) return false;
+    }
+    const uint64_t marks = idx.lines / ObjSectionIndex::kMarkStride + 1;
+    if (!GetVector(f, idx.positionMarks, marks) || !GetVector(f, idx.uvMarks, marks) ||
+        !GetVector(f, idx.normalMarks, marks) || !GetVector(f, idx.blockMin, marks) ||
+        !GetVector(f, idx.blockMax, marks))
+        return false;
+    out = std::move(idx);
+    return true;
+}
+
+ObjSectionIndex LoadOrBuildOBJIndex(const std::string& objPath, bool* rebuilt) {
+    const std::string path = OBJIndexPath(objPath);
+    ObjSectionIndex idx;
+    {
+        PROFILE_ZONE("LoadOBJIndex");
+        if (LoadOBJIndex(path, objPath, idx)) {
+            if (rebuilt) *rebuilt = false;
+            return idx;
+        }
+    }
+    idx = IndexOBJSections(objPath);
+    SaveOBJIndex(idx, path);   // np. katalog tylko do odczytu - następnym razem znów zbudujemy
+    if (rebuilt) *rebuilt = true;
+    return idx;
+}
+
+namespace {
+
+void ReadValue(std::istringstream& iss, glm::vec3& v) { iss >> v.x >> v.y >> v.z; }
+void ReadValue(std::istringstream& iss, glm::vec2& v) { iss >> v.x >> v.y; }
+
+// Wybrane zakresy atrybutów jednego rodzaju, doczytane skokiem do
+// najbliższego znacznika (ObjSectionIndex::*Marks)
+template <class T>
+class AttributeSlices {
+public:
+    void load(std::ifstream& f, const std::vector<uint64_t>& marks, const char* tag,
+              std::vector<ObjAttributeRange> ranges) {
+        constexpr uint32_t kStride = ObjSectionIndex::kMarkStride;
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const ObjAttributeRange& a, const ObjAttributeRange& b) { return a.first < b.first; });
+        // sąsiednie i nakładające się zakresy łączymy
+        std::vector<ObjAttributeRange> merged;
+        for (const ObjAttributeRange& r : ranges) {
+            if (!r.count) continue;
+            if (!merged.empty() && r.first <= merged.back().first + merged.back().count) {
+                const uint32_t end = std::max(merged.back().first + merged.back().count, r.first + r.count);
+                merged.back().count = end - merged.back().first;
+            } else {
+                merged.push_back(r);
+            }
+        }
+
+        std::string raw, kind;
+        for (const ObjAttributeRange& r : merged) {
+            const size_t mark = r.first / kStride;
+            if (mark >= marks.size()) throw std::runtime_error("Indeks OBJ nie pasuje do pliku");
+            Slice s;
+            s.first = r.first;
+            s.data.reserve(r.count);
+            uint64_t n = (uint64_t)mark * kStride;
+            const uint64_t end = (uint64_t)r.first + r.count;
+            f.clear();
+            f.seekg((std::streamoff)marks[mark]);
+            while (n < end && std::getline(f, raw)) {
+                if (raw.empty() || raw[0] != 'v') continue;
+                std::istringstream iss(raw);
+                iss >> kind;
+                if (kind != tag) continue;
+                if (n >= r.first) {
+                    T v{};
+                    ReadValue(iss, v);
+                    s.data.push_back(v);
+                }
+                n++;
+            }
+            if (n < end) throw std::runtime_error("Indeks OBJ nie pasuje do pliku");
+            slices_.push_back(std::move(s));
+        }
+    }
+
+    const T* find(int i) {
+        if (i < 0) return nullptr;
+        const uint32_t u = (uint32_t)i;
+        if (!last_ || u < last_->first || u - last_->first >= last_->data.size()) {
+            auto it = std::upper_bound(slices_.begin(), slices_.end(), u,
+                                       [](uint32_t v, const Slice& s) { return v < s.first; });
+            if (it == slices_.begin()) return nullptr;
+            --it;
+            if (u - it->first >= it->data.size()) return nullptr;
+            last_ = &*it;
+        }
+        return &last_->data[u - last_->first];
+    }
+
+private:
+    struct Slice {
+        uint32_t first = 0;
+        std::vector<T> data;
+    };
+    std::vector<Slice> slices_;
+    const Slice* last_ = nullptr;
+};
+
+// Odcinki kolejnych submeshy, tak jak ParseOBJ dzieli model: nowy submesh
+// na każdym usemtl albo przy pierwszej ścianie bez usemtl. Z subset
+// zostają tylko pasujące odcinki i submeshe, w których coś zostało.
+std::vector<std::vector<uint32_t>> GroupSections(const ObjSectionIndex& idx, const ObjSubset& subset) {
+    std::vector<std::vector<uint32_t>> groups;
+    std::vector<bool> keep;
+    bool open = false;
+    for (uint32_t i = 0; i < (uint32_t)idx.sections.size(); i++) {
+        const ObjSection& s = idx.sections[i];
+        if (s.newMaterial || (!open && s.faces)) {
+            groups.emplace_back();
+            keep.push_back(subset.empty());
+            open = true;
+        }
+        if (!open || !subset.matches(s.object, s.material)) continue;
+        groups.back().push_back(i);
+        if (s.faces) keep.back() = true;
+    }
+    std::vector<std::vector<uint32_t>> out;
+    for (size_t g = 0; g < groups.size(); g++)
+        if (keep[g]) out.push_back(std::move(groups[g]));
+    return out;
+}
+
+// Ściany odcinków z groups do model, submesh na grupę; atrybuty tylko z
+// zakresów, do których odwołują się te odcinki
+void LoadSectionGroups(const std::string& objPath, const ObjSectionIndex& idx,
+                       const std::vector<std::vector<uint32_t>>& groups, LoadedModel& model,
+                       const std::atomic<bool>* cancel) {
+    std::ifstream f(objPath, std::ios::binary);
+    if (!f) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+
+    std::vector<ObjAttributeRange> pr, tr, nr;
+    for (const auto& group : groups) {
+        for (uint32_t si : group) {
+            pr.push_back(idx.sections[si].positions);
+            tr.push_back(idx.sections[si].uvs);
+            nr.push_back(idx.sections[si].normals);
+        }
+    }
+    AttributeSlices<glm::vec3> positions, normals;
+    AttributeSlices<glm::vec2> uvs;
+    positions.load(f, idx.positionMarks, "v", std::move(pr));
+    uvs.load(f, idx.uvMarks, "vt", std::move(tr));
+    normals.load(f, idx.normalMarks, "vn", std::move(nr));
+
+    std::unordered_map<Key, uint32_t, KeyHash> remap;
+    std::string raw, tok;
+    std::vector<Key> face;
+    size_t lines = 0;
+    for (const auto& group : groups) {
+        SubMesh sm;
+        sm.materialName = group.empty() ? std::string() : idx.sections[group.front()].material;
+        sm.indexOffset = (uint32_t)model.indices.size();
+        glm::vec3 smMin(1e30f), smMax(-1e30f);
+
+        for (uint32_t si : group) {
+            const ObjSection& section = idx.sections[si];
+            if (!section.faces) continue;
+            f.clear();
+            f.seekg((std::streamoff)section.begin);
+            uint64_t offset = section.begin;
+            while (offset < section.end && std::getline(f, raw)) {
+                offset += raw.size() + 1;
+                if (cancel && (++lines & 4095) == 0 && cancel->load(std::memory_order_relaxed))
+                    throw LoadCancelled();
+                const std::string line = Trim(raw);
+                if (!IsFaceLine(line)) continue;
+                model.stats.lines++;
+                model.stats.faces++;
+
+                std::istringstream iss(line.substr(2));
+                face.clear();
+                while (iss >> tok) face.push_back(ParseFaceVertex(tok));
+                if (face.size() < 3) continue;
+
+                for (size_t i = 1; i + 1 < face.size(); i++) {
+                    const Key tri[3] = { face[0], face[i], face[i+1] };
+                    for (const Key& key : tri) {
+                        const glm::vec3* pos = positions.find(key.v);
+                        if (!pos) throw std::runtime_error("Blad indeksu v w OBJ.");
+                        smMin = glm::min(smMin, *pos);
+                        smMax = glm::max(smMax, *pos);
+
+                        auto it = remap.find(key);
+                        if (it != remap.end()) {
+                            model.indices.push_back(it->second);
+                            continue;
+                        }
+                        Vertex vtx{};
+                        vtx.pos = *pos;
+                        const glm::vec2* uv = uvs.find(key.t);
+                        vtx.uv = uv ? *uv : glm::vec2(0,0);
+                        const glm::vec3* nrm = normals.find(key.n);
+                        vtx.nrm = nrm ? *nrm : glm::vec3(0,1,0);
+
+                        const uint32_t newIndex = (uint32_t)model.vertices.size();
+                        model.vertices.push_back(vtx);
+                        remap[key] = newIndex;
+                        model.indices.push_back(newIndex);
+                    }
+                }
+            }
+        }
+        sm.indexCount = (uint32_t)model.indices.size() - sm.indexOffset;
+        sm.boundsMin = sm.indexCount ? smMin : glm::vec3(0.f);
+        sm.boundsMax = sm.indexCount ? smMax : glm::vec3(0.f);
+        model.submeshes.push_back(sm);
+    }
+    model.stats.vertices = model.vertices.size();
+    model.stats.indices = model.indices.size();
+}
+
+} // namespace
+
+LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseDir, const ObjSubset& subset,
+                            const std::atomic<bool>* cancel) {
+    if (subset.empty()) return LoadOBJ_WithMTL(objPath, baseDir, cancel);
+    PROFILE_ZONE("LoadOBJ_WithMTL subset");
+    auto t0 = std::chrono::steady_clock::now();
+    const ObjSectionIndex idx = LoadOrBuildOBJIndex(objPath);
+
+    LoadedModel model;
+    LoadSectionGroups(objPath, idx, GroupSections(idx, subset), model, cancel);
+    for (const std::string& lib : idx.mtlLibs) {
+        auto m0 = std::chrono::steady_clock::now();
+        for (auto& [name, mat] : LoadMTL(baseDir + "/" + lib, baseDir)) model.materials[name] = std::move(mat);
+        model.stats.mtlMs += MsSince(m0);
+    }
+    model.stats.positions = idx.positions;
+    model.stats.uvs = idx.uvs;
+    model.stats.normals = idx.normals;
+    model.stats.totalMs = MsSince(t0);
+    return model;
+}
+
+ObjLazyModel::ObjLazyModel(const std::string& objPath, const ObjSubset& subset) : objPath_(objPath) {
+    PROFILE_ZONE("ObjLazyModel");
+    bool rebuilt = false;
+    index_ = LoadOrBuildOBJIndex(objPath, &rebuilt);
+    fromSidecar_ = !rebuilt;
+    sections_ = GroupSections(index_, subset);
+    for (const auto& group : sections_) {
+        SubMesh sm;
+        glm::vec3 mn(1e30f), mx(-1e30f);
+        for (uint32_t si : group) {
+            const ObjSection& s = index_.sections[si];
+            sm.materialName = s.material;
+            expectedVertices_ += s.positions.count;
+            expectedIndices_ += s.indices;
+            if (!s.faces || !s.positions.count) continue;
+            mn = glm::min(mn, s.boundsMin);
+            mx = glm::max(mx, s.boundsMax);
+        }
+        if (mn.x <= mx.x) {
+            sm.boundsMin = mn;
+            sm.boundsMax = mx;
+        }
+        submeshes_.push_back(sm);
+    }
+}
+
+ObjChunk ObjLazyModel::page(size_t submesh) const {
+    PROFILE_ZONE("ObjLazyModel::page");
+    LoadedModel m;
+    LoadSectionGroups(objPath_, index_, {sections_.at(submesh)}, m, nullptr);
+    ObjChunk chunk;
+    chunk.vertices = std::move(m.vertices);
+    chunk.indices = std::move(m.indices);
+    chunk.submesh = m.submeshes.front();
+    return chunk;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+
+// Zakres atrybutów [first, first + count), do których odwołują się ściany
+struct ObjAttributeRange {
+    uint32_t first = 0, count = 0;
+};
+
+// Odcinek pliku OBJ: zaczyna go linia o, g albo usemtl (albo początek pliku).
+// begin/end obejmują tylko jego linie f, więc można skoczyć wprost do nich.
+struct ObjSection {
+    std::string object;        // ostatnie o przed odcinkiem (w pliku bez o: ostatnie g)
+    std::string material;      // aktywny usemtl
+    bool newMaterial = false;  // odcinek otwiera usemtl (= nowy submesh)
+    uint64_t begin = 0, end = 0;
+    uint32_t faces = 0;
+    uint32_t indices = 0;      // po triangulacji
+    ObjAttributeRange positions, uvs, normals;
+    // zachowawczy AABB: suma bloków pozycji (kMarkStride) z zakresu positions
+    glm::vec3 boundsMin{0.f}, boundsMax{0.f};
+};
+
+// Indeks odcinków z jednego przejścia po pliku. Co kMarkStride-ty atrybut
+// danego rodzaju ma zapisany offset swojej linii, więc zakres atrybutów
+// też da się doczytać skokiem, bez czytania pliku od początku.
+struct ObjSectionIndex {
+    static constexpr uint32_t kMarkStride = 4096;
+
+    uint64_t fileSize = 0;
+    int64_t fileTime = 0;                // last_write_time przy budowie (sidecar)
+    std::vector<std::string> mtlLibs;    // nazwy z mtllib (względem baseDir), po kolei
+    std::vector<ObjSection> sections;
+    std::vector<uint64_t> positionMarks, uvMarks, normalMarks;
+    std::vector<glm::vec3> blockMin, blockMax;   // AABB każdego bloku kMarkStride pozycji
+    size_t lines = 0;
+    size_t positions = 0, uvs = 0, normals = 0;
+    size_t faces = 0, indices = 0;
+};
+
+// Podgląd atrybutów w trakcie budowy indeksu (LoadOBJOutOfCore zrzuca je na dysk)
+class ObjAttributeVisitor {
+public:
+    virtual ~ObjAttributeVisitor() = default;
+    virtual void position(const glm::vec3& p) = 0;
+    virtual void uv(const glm::vec2& t) = 0;
+    virtual void normal(const glm::vec3& n) = 0;
+};
+
+ObjSectionIndex IndexOBJSections(const std::string& objPath, ObjAttributeVisitor* visitor = nullptr,
+                                 const std::atomic<bool>* cancel = nullptr);
+
+// Sidecar obok OBJ ("<obj>.sidx"). Load zwraca false, gdy pliku nie ma,
+// jest uszkodzony albo OBJ zmienił rozmiar lub czas modyfikacji.
+std::string OBJIndexPath(const std::string& objPath);
+bool SaveOBJIndex(const ObjSectionIndex& idx, const std::string& path);
+bool LoadOBJIndex(const std::string& path, const std::string& objPath, ObjSectionIndex& out);
+// Sidecar, a gdy nieaktualny: nowy indeks i zapis (błąd zapisu nie jest błędem wczytania)
+ObjSectionIndex LoadOrBuildOBJIndex(const std::string& objPath, bool* rebuilt = nullptr);
+
+// Model stronicowany: od razu tylko indeks (zwykle z sidecara), geometria
+// submeshy na żądanie. Submeshe jak z LoadOBJ_WithMTL (granice na usemtl),
+// ale subset może część odcinków pominąć.
+class ObjLazyModel {
+public:
+    ObjLazyModel(const std::string& objPath, const ObjSubset& subset = {});
+
+    // indexCount = 0, bounds zachowawcze z indeksu
+    const std::vector<SubMesh>& submeshes() const { return submeshes_; }
+    const ObjSectionIndex& index() const { return index_; }
+    bool indexFromSidecar() const { return fromSidecar_; }
+    // Rozmiar wszystkich submeshy razem (wierzchołki: szacunek z zakresów pozycji)
+    uint32_t expectedVertices() const { return expectedVertices_; }
+    uint32_t expectedIndices() const { return expectedIndices_; }
+
+    // Geometria submesha: wierzchołki i indeksy liczone od 0 (wołający
+    // przesuwa je na swoje miejsce), submesh z dokładnym AABB.
+    // Wątkobezpieczne - każde wywołanie czyta plik własnym strumieniem.
+    ObjChunk page(size_t submesh) const;
+
+private:
+    std::string objPath_;
+    ObjSectionIndex index_;
+    bool fromSidecar_ = false;
+    uint32_t expectedVertices_ = 0, expectedIndices_ = 0;
+    std::vector<SubMesh> submeshes_;
+    std::vector<std::vector<uint32_t>> sections_;   // odcinki każdego submesha
+};
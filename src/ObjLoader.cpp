@@ -1,38 +1,16 @@
 ﻿#include "ObjLoader.h"
+#include "ObjParse.h"
+#include "CompressedInput.h"
+#include "CpuProfiler.h"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
-#include <iostream>
 #include <unordered_map>
 
-static inline std::string Trim(const std::string& s) {
-    size_t a = s.find_first_not_of(" \t\r\n");
-    size_t b = s.find_last_not_of(" \t\r\n");
-    if (a == std::string::npos) return "";
-    return s.substr(a, b - a + 1);
-}
-
-static inline std::string NormalizePath(std::string p) {
-    // zamień backslash na slash
-    for (char &c : p) if (c == '\\') c = '/';
-
-    // usuń podwójne (i więcej) slashe: "a//b///c" -> "a/b/c"
-    std::string out;
-    out.reserve(p.size());
-    bool prevSlash = false;
-    for (char c : p) {
-        if (c == '/') {
-            if (!prevSlash) out.push_back(c);
-            prevSlash = true;
-        } else {
-            out.push_back(c);
-            prevSlash = false;
-        }
-    }
-    return out;
-}
-
 static std::string JoinPath(const std::string& a, const std::string& b) {
     if (a.empty()) return b;
     if (b.empty()) return a;
@@ -52,45 +30,6 @@ static std::string JoinPath(const std::string& a, const std::string& b) {
     return A + "/" + B;
 }
 
-struct Key {
-    int v=-1, t=-1, n=-1;
-    bool operator==(const Key& o) const { return v==o.v && t==o.t && n==o.n; }
-};
-
-struct KeyHash {
-    size_t operator()(const Key& k) const noexcept {
-        size_t h1 = std::hash<int>{}(k.v);
-        size_t h2 = std::hash<int>{}(k.t);
-        size_t h3 = std::hash<int>{}(k.n);
-        return h1 ^ (h2 * 1315423911u) ^ (h3 * 2654435761u);
-    }
-};
-
-// token "v/t/n" lub "v//n" lub "v/t"
-static Key ParseFaceVertex(const std::string& tok) {
-    Key k;
-    int parts[3] = {0,0,0};
-    int pi = 0;
-    std::string tmp;
-
-    for (size_t i=0; i<=tok.size(); i++) {
-        char c = (i<tok.size()) ? tok[i] : '/';
-        if (c=='/') {
-            parts[pi] = tmp.empty() ? 0 : std::stoi(tmp);
-            tmp.clear();
-            pi++;
-            if (pi > 2) break;
-        } else {
-            tmp.push_back(c);
-        }
-    }
-
-    k.v = (parts[0] != 0) ? (parts[0] - 1) : -1;
-    k.t = (parts[1] != 0) ? (parts[1] - 1) : -1;
-    k.n = (parts[2] != 0) ? (parts[2] - 1) : -1;
-    return k;
-}
-
 // MTL: weź z map_Kd ostatni "sensowny" fragment (obsługa -s, -bm itd.)
 static std::string ExtractTexturePathFromMapLine(std::istringstream& iss) {
     std::string rest;
@@ -116,11 +55,13 @@ static std::string ExtractTexturePathFromMapLine(std::istringstream& iss) {
     return Trim(rest.substr(sp + 1));
 }
 
-static std::unordered_map<std::string, Material> LoadMTL(const std::string& mtlPath, const std::string& baseDir) {
-    std::ifstream f(mtlPath);
-    if (!f) throw std::runtime_error("Nie moge otworzyc MTL: " + mtlPath);
+MaterialMap LoadMTL(const std::string& mtlPath, const std::string& baseDir) {
+    PROFILE_ZONE("LoadMTL");
+    auto in = OpenInputFile(mtlPath);
+    if (!in) throw std::runtime_error("Nie moge otworzyc MTL: " + mtlPath);
+    std::istream& f = *in;
 
-    std::unordered_map<std::string, Material> mats;
+    MaterialMap mats;
     Material* cur = nullptr;
 
     std::string line;
@@ -149,16 +90,58 @@ static std::unordered_map<std::string, Material> LoadMTL(const std::string& mtlP
             std::string rel = ExtractTexturePathFromMapLine(iss);
             rel = NormalizePath(rel);
             cur->mapKd = JoinPath(baseDir, rel);
+        } else if (tag == "map_Bump" || tag == "bump" || tag == "norm") {
+            std::string rest; std::getline(iss, rest);
+            size_t bm = rest.find("-bm ");
+            if (bm != std::string::npos) {
+                std::istringstream opt(rest.substr(bm + 4));
+                opt >> cur->bumpScale;
+            }
+            std::istringstream pathIss(rest);
+            std::string rel = ExtractTexturePathFromMapLine(pathIss);
+            rel = NormalizePath(rel);
+            cur->mapBump = JoinPath(baseDir, rel);
         }
-        // map_Bump ignorujemy (nie wymagane)
     }
 
     return mats;
 }
 
-LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseDir) {
-    std::ifstream f(objPath);
-    if (!f) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+std::vector<std::string> FindMtlLibs(const std::string& objPath, const std::string& baseDir) {
+    PROFILE_ZONE("FindMtlLibs");
+    auto in = OpenInputFile(objPath);
+    if (!in) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+    std::istream& f = *in;
+
+    std::vector<std::string> libs;
+    std::string line;
+    while (std::getline(f, line)) {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream iss(line);
+        std::string tag;
+        iss >> tag;
+        if (tag == "mtllib") libs.push_back(MtlLibPath(iss, baseDir));
+        else if (tag != "o" && tag != "g" && tag != "s") break;   // zaczyna się geometria
+    }
+    return libs;
+}
+
+// preloadedMtl == nullptr: każdy mtllib parsowany od razu (LoadOBJ_WithMTL).
+// Inaczej pliki z listy pomijamy - materiały dołoży wołający.
+// onChunk != nullptr: zamknięte submeshe oddajemy od razu i zdejmujemy z
+// modelu; indeksy dalej liczymy globalnie (emitted*).
+// sink != nullptr: wierzchołki i indeksy od razu do sink, model ich nie trzyma.
+static LoadedModel ParseOBJ(const std::string& objPath, const std::string& baseDir,
+                            const std::vector<std::string>* preloadedMtl,
+                            const ObjChunkFn* onChunk = nullptr,
+                            const std::atomic<bool>* cancel = nullptr,
+                            GeometrySink* sink = nullptr) {
+    auto t0 = std::chrono::steady_clock::now();
+    auto in = OpenInputFile(objPath);
+    if (!in) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+    std::istream& f = *in;
 
     std::vector<glm::vec3> positions;
     std::vector<glm::vec2> uvs;
@@ -169,32 +152,90 @@ LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseD
 
     std::string activeMtl = "";
     bool submeshOpen = false;
+    bool cancelled = false;
+    uint32_t emittedVertices = 0, emittedIndices = 0;
+    glm::vec3 smMin(1e30f), smMax(-1e30f);   // AABB otwartego submesha
+
+    std::optional<SinkWriter<Vertex>> vertexOut;
+    std::optional<SinkWriter<uint32_t>> indexOut;
+    if (sink) {
+        vertexOut.emplace(*sink, &GeometrySink::vertexSpace, &GeometrySink::commitVertices);
+        indexOut.emplace(*sink, &GeometrySink::indexSpace, &GeometrySink::commitIndices);
+    }
+    auto emitVertex = [&](const Vertex& v) {
+        const uint32_t index = emittedVertices + (uint32_t)model.vertices.size();
+        if (vertexOut) {
+            vertexOut->push(v);
+            emittedVertices++;
+        } else {
+            model.vertices.push_back(v);
+        }
+        return index;
+    };
+    auto emitIndex = [&](uint32_t i) {
+        if (indexOut) {
+            indexOut->push(i);
+            emittedIndices++;
+        } else {
+            model.indices.push_back(i);
+        }
+    };
 
     auto startSubmeshIfNeeded = [&]() {
         if (submeshOpen) return;
         SubMesh sm;
         sm.materialName = activeMtl;
-        sm.indexOffset = (uint32_t)model.indices.size();
+        sm.indexOffset = emittedIndices + (uint32_t)model.indices.size();
         sm.indexCount = 0;
         model.submeshes.push_back(sm);
         submeshOpen = true;
+        smMin = glm::vec3(1e30f);
+        smMax = glm::vec3(-1e30f);
     };
 
     auto closeSubmeshIfOpen = [&]() {
         if (!submeshOpen) return;
-        model.submeshes.back().indexCount =
-                (uint32_t)model.indices.size() - model.submeshes.back().indexOffset;
+        SubMesh& sm = model.submeshes.back();
+        sm.indexCount = emittedIndices + (uint32_t)model.indices.size() - sm.indexOffset;
+        sm.boundsMin = sm.indexCount ? smMin : glm::vec3(0.f);
+        sm.boundsMax = sm.indexCount ? smMax : glm::vec3(0.f);
         submeshOpen = false;
+        if (sink) {
+            vertexOut->flush();
+            indexOut->flush();
+            if (!sink->submesh(sm, std::move(model.materials))) cancelled = true;
+            model.submeshes.clear();
+            model.materials.clear();
+            return;
+        }
+        if (!onChunk) return;
+
+        ObjChunk chunk;
+        chunk.firstVertex = emittedVertices;
+        chunk.vertices = std::move(model.vertices);
+        chunk.indices = std::move(model.indices);
+        chunk.submesh = sm;
+        chunk.materials = std::move(model.materials);
+        emittedVertices += (uint32_t)chunk.vertices.size();
+        emittedIndices += (uint32_t)chunk.indices.size();
+        model.vertices.clear();
+        model.indices.clear();
+        model.submeshes.clear();
+        model.materials.clear();
+        if (!(*onChunk)(std::move(chunk))) cancelled = true;
     };
 
     std::string line;
-    while (std::getline(f, line)) {
+    while (!cancelled && std::getline(f, line)) {
         line = Trim(line);
         if (line.empty() || line[0] == '#') continue;
 
         std::istringstream iss(line);
         std::string tag;
         iss >> tag;
+        model.stats.lines++;
+        if (cancel && (model.stats.lines & 4095) == 0 && cancel->load(std::memory_order_relaxed))
+            throw LoadCancelled();
 
         if (tag == "v") {
             glm::vec3 p; iss >> p.x >> p.y >> p.z;
@@ -206,11 +247,12 @@ LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseD
             glm::vec3 n; iss >> n.x >> n.y >> n.z;
             normals.push_back(n);
         } else if (tag == "mtllib") {
-            // nazwa pliku może mieć spacje, więc bierzemy resztę linii
-            std::string rest; std::getline(iss, rest);
-            rest = Trim(rest);
-            std::string mtlPath = baseDir + "/" + NormalizePath(rest);
-            model.materials = LoadMTL(mtlPath, baseDir);
+            std::string mtlPath = MtlLibPath(iss, baseDir);
+            if (preloadedMtl && std::find(preloadedMtl->begin(), preloadedMtl->end(), mtlPath) != preloadedMtl->end())
+                continue;
+            auto m0 = std::chrono::steady_clock::now();
+            for (auto& [name, mat] : LoadMTL(mtlPath, baseDir)) model.materials[name] = std::move(mat);
+            model.stats.mtlMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m0).count();
         } else if (tag == "usemtl") {
             std::string name; std::getline(iss, name);
             name = Trim(name);
@@ -219,6 +261,7 @@ LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseD
             startSubmeshIfNeeded();
         } else if (tag == "f") {
             startSubmeshIfNeeded();
+            model.stats.faces++;
 
             std::vector<Key> face;
             std::string tok;
@@ -234,12 +277,16 @@ LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseD
 
                     auto it = remap.find(key);
                     if (it != remap.end()) {
-                        model.indices.push_back(it->second);
+                        emitIndex(it->second);
+                        smMin = glm::min(smMin, positions[key.v]);
+                        smMax = glm::max(smMax, positions[key.v]);
                         continue;
                     }
 
                     if (key.v < 0 || key.v >= (int)positions.size())
                         throw std::runtime_error("Blad indeksu v w OBJ.");
+                    smMin = glm::min(smMin, positions[key.v]);
+                    smMax = glm::max(smMax, positions[key.v]);
 
                     Vertex vtx{};
                     vtx.pos = positions[key.v];
@@ -250,16 +297,15 @@ LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseD
                     vtx.nrm = glm::vec3(0,1,0);
                     if (key.n >= 0 && key.n < (int)normals.size()) vtx.nrm = normals[key.n];
 
-                    uint32_t newIndex = (uint32_t)model.vertices.size();
-                    model.vertices.push_back(vtx);
+                    const uint32_t newIndex = emitVertex(vtx);
                     remap[key] = newIndex;
-                    model.indices.push_back(newIndex);
+                    emitIndex(newIndex);
                 }
             }
         }
     }
 
-    closeSubmeshIfOpen();
+    if (!cancelled) closeSubmeshIfOpen();
 
     // Jeśli nie było usemtl ani mtllib – nadal jest OK, będzie 1 submesh z materialName=""
     if (model.submeshes.empty() && !model.indices.empty()) {
@@ -267,13 +313,53 @@ LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseD
         sm.materialName = "";
         sm.indexOffset = 0;
         sm.indexCount = (uint32_t)model.indices.size();
+        sm.boundsMin = glm::vec3(1e30f);
+        sm.boundsMax = glm::vec3(-1e30f);
+        for (const Vertex& v : model.vertices) {
+            sm.boundsMin = glm::min(sm.boundsMin, v.pos);
+            sm.boundsMax = glm::max(sm.boundsMax, v.pos);
+        }
         model.submeshes.push_back(sm);
     }
 
-    std::cout << "OBJ loaded: vertices=" << model.vertices.size()
-              << " indices=" << model.indices.size()
-              << " submeshes=" << model.submeshes.size()
-              << " materials=" << model.materials.size() << "\n";
-
+    model.stats.positions = positions.size();
+    model.stats.uvs = uvs.size();
+    model.stats.normals = normals.size();
+    model.stats.vertices = emittedVertices + model.vertices.size();
+    model.stats.indices = emittedIndices + model.indices.size();
+    model.stats.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
     return model;
 }
+
+LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseDir,
+                            const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("LoadOBJ_WithMTL");
+    return ParseOBJ(objPath, baseDir, nullptr, nullptr, cancel);
+}
+
+LoadedModel LoadOBJGeometry(const std::string& objPath, const std::string& baseDir,
+                            const std::vector<std::string>& preloadedMtl) {
+    PROFILE_ZONE("LoadOBJGeometry");
+    return ParseOBJ(objPath, baseDir, &preloadedMtl);
+}
+
+ObjLoadStats LoadOBJStreaming(const std::string& objPath, const std::string& baseDir,
+                              const std::vector<std::string>& preloadedMtl, const ObjChunkFn& onChunk) {
+    PROFILE_ZONE("LoadOBJStreaming");
+    return ParseOBJ(objPath, baseDir, &preloadedMtl, &onChunk).stats;
+}
+
+ObjLoadStats LoadOBJToSink(const std::string& objPath, const std::string& baseDir,
+                           const std::vector<std::string>& preloadedMtl, GeometrySink& sink) {
+    PROFILE_ZONE("LoadOBJToSink");
+    return ParseOBJ(objPath, baseDir, &preloadedMtl, nullptr, nullptr, &sink).stats;
+}
+
+void PrintLoadSummary(std::ostream& os, const LoadedModel& m) {
+    // Renderer nie trzyma geometrii na CPU po wysłaniu - liczby ze statystyk
+    os << "OBJ loaded: vertices=" << std::max(m.stats.vertices, m.vertices.size())
+       << " indices=" << std::max(m.stats.indices, m.indices.size())
+       << " submeshes=" << m.submeshes.size()
+       << " materials=" << m.materials.size()
+       << " (" << m.stats.totalMs << " ms)\n";
+}
@@ -1,8 +1,14 @@
 ﻿#pragma once
+#include <algorithm>
 #include <string>
+#include <ostream>
 #include <vector>
 #include <unordered_map>
+#include <functional>
+#include <span>
 #include <cstdint>
+#include <atomic>
+#include <stdexcept>
 
 #include <glm/glm.hpp>
 
@@ -19,12 +25,34 @@ struct Material {
     float Ns{32.f};
     std::string mapKd;     // pełna ścieżka do tekstury
     unsigned int glTex = 0; // uchwyt GL po załadowaniu
+    std::string mapBump;   // normal mapa (map_Bump / bump / norm)
+    float bumpScale{1.f};  // -bm
+    unsigned int glBumpTex = 0;
+    bool uvOriginTop = false;  // glTF: v = 0 u góry obrazu - tekstury dekodowane bez odwracania
 };
 
 struct SubMesh {
     std::string materialName;
     uint32_t indexOffset = 0;
     uint32_t indexCount = 0;
+    glm::vec3 boundsMin{0.f};  // AABB w przestrzeni modelu (culling, cienie)
+    glm::vec3 boundsMax{0.f};
+};
+
+// Co i jak długo wczytywał loader (raport startu, podsumowanie w konsoli)
+struct ObjLoadStats {
+    double totalMs = 0.0;      // cały LoadOBJ_WithMTL, razem z MTL
+    double mtlMs = 0.0;
+    size_t lines = 0;          // bez pustych i komentarzy
+    size_t positions = 0, uvs = 0, normals = 0;
+    size_t faces = 0;          // przed triangulacją
+    size_t vertices = 0, indices = 0;   // po deduplikacji (też gdy nie trafiły do LoadedModel)
+    // LoadOBJOutOfCore: atrybuty zrzucone na dysk, wczytane strony, obroty okna dedup
+    uint64_t spillBytes = 0;
+    uint64_t attributePageLoads = 0;
+    size_t dedupRotations = 0;
+    // glTF: bajty wierzchołków i indeksów skopiowane wprost z zmapowanych widoków
+    uint64_t zeroCopyBytes = 0;
 };
 
 struct LoadedModel {
@@ -32,6 +60,93 @@ struct LoadedModel {
     std::vector<uint32_t> indices;
     std::vector<SubMesh> submeshes;
     std::unordered_map<std::string, Material> materials;
+    ObjLoadStats stats;
+};
+
+using MaterialMap = std::unordered_map<std::string, Material>;
+
+// Rzucane, gdy wczytywanie przerwano flagą cancel
+struct LoadCancelled : std::runtime_error {
+    LoadCancelled() : std::runtime_error("Wczytywanie przerwane") {}
 };
 
-LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseDir);
+// cancel (opcjonalny) sprawdzany co kilka tysięcy linii - ustawiony przerywa
+// parsowanie wyjątkiem LoadCancelled
+LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseDir,
+                            const std::atomic<bool>* cancel = nullptr);
+
+// Wybrane obiekty (o; w pliku bez o grupy g) i/lub materiały (usemtl); pusta lista = bez filtra
+struct ObjSubset {
+    std::vector<std::string> objects;
+    std::vector<std::string> materials;
+
+    bool empty() const { return objects.empty() && materials.empty(); }
+    bool matches(const std::string& object, const std::string& material) const {
+        return (objects.empty() || std::find(objects.begin(), objects.end(), object) != objects.end()) &&
+               (materials.empty() || std::find(materials.begin(), materials.end(), material) != materials.end());
+    }
+};
+
+// Tylko część modelu: z indeksu odcinków (sidecar "<obj>.sidx", budowany
+// przy pierwszym użyciu - ObjIndex.h) skok wprost do ścian wybranych
+// odcinków i do atrybutów, których używają. Materiały wszystkie.
+LoadedModel LoadOBJ_WithMTL(const std::string& objPath, const std::string& baseDir, const ObjSubset& subset,
+                            const std::atomic<bool>* cancel = nullptr);
+
+// Do równoległego startu: ścieżki mtllib z nagłówka OBJ (do pierwszej linii
+// z geometrią), osobny parser MTL i geometria bez tych plików MTL. mtllib
+// spoza nagłówka LoadOBJGeometry i tak wczyta sam.
+std::vector<std::string> FindMtlLibs(const std::string& objPath, const std::string& baseDir);
+MaterialMap LoadMTL(const std::string& mtlPath, const std::string& baseDir);
+LoadedModel LoadOBJGeometry(const std::string& objPath, const std::string& baseDir,
+                            const std::vector<std::string>& preloadedMtl);
+
+// Kawałek modelu z LoadOBJStreaming: jeden zamknięty submesh i wierzchołki
+// dodane od poprzedniego kawałka. Indeksy i offsety są globalne jak w
+// LoadedModel, więc kawałki doklejane po kolei dają ten sam model.
+struct ObjChunk {
+    uint32_t firstVertex = 0;        // = liczba wierzchołków z poprzednich kawałków
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;   // indeksy tego submesha (od submesh.indexOffset)
+    SubMesh submesh;
+    MaterialMap materials;           // z mtllib spotkanych od poprzedniego kawałka
+    // staged: wierzchołki i indeksy poszły już do GPU inną drogą (GeometrySink),
+    // wektory są puste; stagedVertices to ich liczba (indeksów: submesh.indexCount)
+    bool staged = false;
+    uint32_t stagedVertices = 0;
+};
+
+// false = przerwij wczytywanie (anulowanie)
+using ObjChunkFn = std::function<bool(ObjChunk&& chunk)>;
+
+// Jak LoadOBJGeometry, ale oddaje każdy submesh zaraz po jego zamknięciu
+// (usemtl albo koniec pliku) i nie trzyma całego modelu w pamięci.
+ObjLoadStats LoadOBJStreaming(const std::string& objPath, const std::string& baseDir,
+                              const std::vector<std::string>& preloadedMtl, const ObjChunkFn& onChunk);
+
+// Cel geometrii z LoadOBJToSink, np. zmapowany bufor GL. Parser pisze
+// wierzchołki i indeksy wprost w oddane miejsce, bez wektorów całego modelu.
+class GeometrySink {
+public:
+    virtual ~GeometrySink() = default;
+    // Niepuste miejsce na kolejne elementy; wołający pisze od początku
+    // i potwierdza zapisane przez commit*, zanim poprosi o kolejne
+    virtual std::span<Vertex> vertexSpace() = 0;
+    virtual void commitVertices(size_t count) = 0;
+    virtual std::span<uint32_t> indexSpace() = 0;
+    virtual void commitIndices(size_t count) = 0;
+    // Zamknięty submesh (jego wierzchołki i indeksy już potwierdzone) i
+    // materiały z mtllib spotkanych od poprzedniego; false = przerwij
+    virtual bool submesh(const SubMesh& sm, MaterialMap&& materials) = 0;
+    // Opcjonalna zapowiedź rozmiaru całego modelu (szacunek), zanim
+    // przyjdzie pierwszy submesh - np. żeby od razu zarezerwować bufory
+    virtual void expect(size_t vertices, size_t indices) { (void)vertices; (void)indices; }
+};
+
+// Jak LoadOBJStreaming, ale geometria idzie do sink. W pamięci zostają tylko
+// atrybuty z pliku i mapa deduplikacji.
+ObjLoadStats LoadOBJToSink(const std::string& objPath, const std::string& baseDir,
+                           const std::vector<std::string>& preloadedMtl, GeometrySink& sink);
+
+// "OBJ loaded: vertices=... indices=... submeshes=... materials=... (X ms)"
+void PrintLoadSummary(std::ostream& os, const LoadedModel& m);
@@ -0,0 +1,301 @@
+﻿#include "ObjOutOfCore.h"
+#include "ObjParse.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+// Przybliżony koszt jednego wpisu std::unordered_map<Key, uint32_t>
+// (węzeł z alokacji + kubełek)
+static constexpr size_t kDedupEntryBytes = 48;
+
+// Tablica T w pliku tymczasowym. Pierwszy przebieg dopisuje przez bufor
+// jednej strony, drugi czyta przez pamięć podręczną stron mapowaną
+// bezpośrednio (strona i trafia do slotu i % slotów) - rozmiar stały,
+// a ściany OBJ zwykle odwołują się do niedawnych atrybutów.
+template <class T>
+class SpillArray {
+public:
+    static constexpr size_t kPageElems = 4096;
+
+    SpillArray(const fs::path& dir, const char* tag) {
+        static std::atomic<unsigned> counter{0};
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        path_ = dir / ("obj-" + std::string(tag) + "-" + std::to_string(stamp) + "-" +
+                       std::to_string(counter++) + ".tmp");
+        file_.open(path_, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file_) throw std::runtime_error("Nie moge utworzyc pliku tymczasowego: " + path_.string());
+        write_.reserve(kPageElems);
+    }
+    ~SpillArray() {
+        file_.close();
+        std::error_code ec;
+        fs::remove(path_, ec);
+    }
+    SpillArray(const SpillArray&) = delete;
+    SpillArray& operator=(const SpillArray&) = delete;
+
+    void push(const T& v) {
+        write_.push_back(v);
+        size_++;
+        if (write_.size() == kPageElems) flushWrite();
+    }
+
+    // Koniec zapisu; potem tylko operator[]. cacheBytes dzielimy na strony.
+    void finish(size_t cacheBytes) {
+        flushWrite();
+        write_ = {};
+        file_.flush();
+        const size_t pages = (size_ + kPageElems - 1) / kPageElems;
+        const size_t slots = std::clamp<size_t>(cacheBytes / (kPageElems * sizeof(T)), 1, std::max<size_t>(pages, 1));
+        slots_.resize(slots);
+    }
+
+    const T& operator[](size_t i) {
+        const size_t page = i / kPageElems;
+        Slot& s = slots_[page % slots_.size()];
+        if (s.page != page) load(s, page);
+        return s.data[i % kPageElems];
+    }
+
+    size_t size() const { return size_; }
+    uint64_t bytes() const { return (uint64_t)size_ * sizeof(T); }
+    uint64_t pageLoads() const { return loads_; }
+
+private:
+    struct Slot {
+        size_t page = ~size_t(0);
+        std::vector<T> data;
+    };
+
+    void flushWrite() {
+        if (write_.empty()) return;
+        file_.write((const char*)write_.data(), (std::streamsize)(write_.size() * sizeof(T)));
+        if (!file_) throw std::runtime_error("Blad zapisu pliku tymczasowego: " + path_.string());
+        write_.clear();
+    }
+
+    void load(Slot& s, size_t page) {
+        const size_t first = page * kPageElems;
+        const size_t count = std::min(kPageElems, size_ - first);
+        s.data.resize(kPageElems);
+        file_.seekg((std::streamoff)(first * sizeof(T)));
+        file_.read((char*)s.data.data(), (std::streamsize)(count * sizeof(T)));
+        if (!file_) throw std::runtime_error("Blad odczytu pliku tymczasowego: " + path_.string());
+        s.page = page;
+        loads_++;
+    }
+
+    fs::path path_;
+    std::fstream file_;
+    std::vector<T> write_;
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    uint64_t loads_ = 0;
+};
+
+struct AttributeSpill : ObjAttributeVisitor {
+    SpillArray<glm::vec3> positions;
+    SpillArray<glm::vec2> uvs;
+    SpillArray<glm::vec3> normals;
+
+    explicit AttributeSpill(const fs::path& dir)
+        : positions(dir, "v"), uvs(dir, "vt"), normals(dir, "vn") {}
+
+    // Budżet pamięci podręcznej proporcjonalnie do rozmiaru tablic
+    void finish(size_t cacheBytes) {
+        const double total = (double)std::max<uint64_t>(bytes(), 1);
+        positions.finish((size_t)(cacheBytes * (positions.bytes() / total)));
+        uvs.finish((size_t)(cacheBytes * (uvs.bytes() / total)));
+        normals.finish((size_t)(cacheBytes * (normals.bytes() / total)));
+    }
+    uint64_t bytes() const { return positions.bytes() + uvs.bytes() + normals.bytes(); }
+
+    void position(const glm::vec3& p) override { positions.push(p); }
+    void uv(const glm::vec2& t) override { uvs.push(t); }
+    void normal(const glm::vec3& n) override { normals.push(n); }
+};
+
+// Dwa pokolenia mapy deduplikacji po maxEntries/2 wpisów. Trafienie w
+// starszym przenosi wpis do bieżącego, więc zostają klucze używane ostatnio.
+class DedupWindow {
+public:
+    explicit DedupWindow(size_t maxEntries) : generation_(std::max<size_t>(maxEntries / 2, 1024)) {
+        current_.reserve(generation_);
+    }
+
+    const uint32_t* find(const Key& k) {
+        auto it = current_.find(k);
+        if (it != current_.end()) return &it->second;
+        auto old = previous_.find(k);
+        if (old == previous_.end()) return nullptr;
+        return &insert(k, old->second);
+    }
+
+    uint32_t& insert(const Key& k, uint32_t index) {
+        if (current_.size() >= generation_) {
+            previous_.swap(current_);
+            current_.clear();
+            rotations_++;
+        }
+        return current_[k] = index;
+    }
+
+    size_t rotations() const { return rotations_; }
+    // Tyle różnych kluczy mieści się bez żadnej rotacji
+    size_t generation() const { return generation_; }
+
+private:
+    size_t generation_;
+    std::unordered_map<Key, uint32_t, KeyHash> current_, previous_;
+    size_t rotations_ = 0;
+};
+
+ObjLoadStats LoadOBJOutOfCore(const std::string& objPath, const std::string& baseDir,
+                              const std::vector<std::string>& preloadedMtl, GeometrySink& sink,
+                              const OutOfCoreSettings& settings, const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("LoadOBJOutOfCore");
+    auto t0 = std::chrono::steady_clock::now();
+    const fs::path tempDir = settings.tempDir.empty() ? fs::temp_directory_path() : fs::path(settings.tempDir);
+
+    AttributeSpill spill(tempDir);
+    ObjSectionIndex idx;
+    {
+        PROFILE_ZONE("OBJ pass 1");
+        idx = IndexOBJSections(objPath, &spill, cancel);
+    }
+    spill.finish(settings.memoryLimit / 2);
+
+    ObjLoadStats stats;
+    stats.lines = idx.lines;
+    stats.positions = idx.positions;
+    stats.uvs = idx.uvs;
+    stats.normals = idx.normals;
+    stats.faces = idx.faces;
+    stats.spillBytes = spill.bytes();
+
+    MaterialMap materials;
+    for (const std::string& lib : idx.mtlLibs) {
+        const std::string path = baseDir + "/" + lib;
+        if (std::find(preloadedMtl.begin(), preloadedMtl.end(), path) != preloadedMtl.end()) continue;
+        auto m0 = std::chrono::steady_clock::now();
+        for (auto& [name, mat] : LoadMTL(path, baseDir)) materials[name] = std::move(mat);
+        stats.mtlMs += MsSince(m0);
+    }
+
+    PROFILE_ZONE("OBJ pass 2");
+    DedupWindow window(settings.memoryLimit / 4 / kDedupEntryBytes);
+
+    // Górna granica wierzchołków: każdy indeks dodaje najwyżej jeden. Różnych
+    // trójek (v,t,n) jest najwyżej v * (vt+1) * (vn+1) (+1 na brak atrybutu),
+    // ale to ogranicza wynik tylko, gdy wszystkie mieszczą się w oknie - po
+    // rotacji ta sama trójka wraca jako nowy wierzchołek.
+    size_t triples = idx.positions;
+    for (size_t n : {idx.uvs + 1, idx.normals + 1})
+        triples = triples > SIZE_MAX / n ? SIZE_MAX : triples * n;
+    sink.expect(triples <= window.generation() ? std::min(triples, idx.indices) : idx.indices, idx.indices);
+    SinkWriter<Vertex> vertexOut(sink, &GeometrySink::vertexSpace, &GeometrySink::commitVertices);
+    SinkWriter<uint32_t> indexOut(sink, &GeometrySink::indexSpace, &GeometrySink::commitIndices);
+    uint32_t vertices = 0, indices = 0;
+
+    SubMesh sm;
+    bool submeshOpen = false;
+    bool cancelled = false;
+    glm::vec3 smMin(1e30f), smMax(-1e30f);
+
+    auto openSubmesh = [&](const std::string& material) {
+        sm = SubMesh{};
+        sm.materialName = material;
+        sm.indexOffset = indices;
+        submeshOpen = true;
+        smMin = glm::vec3(1e30f);
+        smMax = glm::vec3(-1e30f);
+    };
+    auto closeSubmesh = [&]() {
+        if (!submeshOpen) return;
+        sm.indexCount = indices - sm.indexOffset;
+        sm.boundsMin = sm.indexCount ? smMin : glm::vec3(0.f);
+        sm.boundsMax = sm.indexCount ? smMax : glm::vec3(0.f);
+        submeshOpen = false;
+        vertexOut.flush();
+        indexOut.flush();
+        if (!sink.submesh(sm, std::move(materials))) cancelled = true;
+        materials.clear();
+    };
+
+    std::ifstream f(objPath, std::ios::binary);
+    if (!f) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+    std::string raw;
+    std::vector<Key> face;
+    size_t lines = 0;
+    for (const ObjSection& section : idx.sections) {
+        if (cancelled) break;
+        if (section.newMaterial) {
+            closeSubmesh();
+            if (cancelled) break;
+            openSubmesh(section.material);
+        }
+        if (!section.faces) continue;
+        if (!submeshOpen) openSubmesh(section.material);
+
+        f.clear();
+        f.seekg((std::streamoff)section.begin);
+        uint64_t offset = section.begin;
+        while (offset < section.end && std::getline(f, raw)) {
+            offset += raw.size() + 1;
+            if (cancel && (++lines & 4095) == 0 && cancel->load(std::memory_order_relaxed))
+                throw LoadCancelled();
+            const std::string line = Trim(raw);
+            if (line.size() < 2 || line[0] != 'f' || (line[1] != ' ' && line[1] != '\t')) continue;
+
+            std::istringstream iss(line.substr(2));
+            face.clear();
+            std::string tok;
+            while (iss >> tok) face.push_back(ParseFaceVertex(tok));
+            if (face.size() < 3) continue;
+
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                const Key tri[3] = { face[0], face[i], face[i+1] };
+                for (const Key& key : tri) {
+                    if (key.v < 0 || key.v >= (int)spill.positions.size())
+                        throw std::runtime_error("Blad indeksu v w OBJ.");
+                    const glm::vec3 pos = spill.positions[key.v];
+                    smMin = glm::min(smMin, pos);
+                    smMax = glm::max(smMax, pos);
+
+                    uint32_t index;
+                    if (const uint32_t* hit = window.find(key)) {
+                        index = *hit;
+                    } else {
+                        Vertex vtx{};
+                        vtx.pos = pos;
+                        vtx.uv = glm::vec2(0,0);
+                        if (key.t >= 0 && key.t < (int)spill.uvs.size()) vtx.uv = spill.uvs[key.t];
+                        vtx.nrm = glm::vec3(0,1,0);
+                        if (key.n >= 0 && key.n < (int)spill.normals.size()) vtx.nrm = spill.normals[key.n];
+                        index = vertices++;
+                        vertexOut.push(vtx);
+                        window.insert(key, index);
+                    }
+                    indexOut.push(index);
+                    indices++;
+                }
+            }
+        }
+    }
+    if (!cancelled) closeSubmesh();
+
+    stats.vertices = vertices;
+    stats.indices = indices;
+    stats.dedupRotations = window.rotations();
+    stats.attributePageLoads = spill.positions.pageLoads() + spill.uvs.pageLoads() + spill.normals.pageLoads();
+    stats.totalMs = MsSince(t0);
+    return stats;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ObjLoader.h"
+#include "ObjIndex.h"
+
+// Wczytywanie OBJ większych niż RAM. memoryLimit dzielimy tak:
+//  - 1/2: pamięć podręczna stron atrybutów (v/vt/vn), które pierwszy
+//    przebieg (IndexOBJSections) zrzuca do plików tymczasowych w tempDir;
+//  - 1/4: okno deduplikacji - dwa pokolenia mapy (v,t,n) -> indeks; gdy
+//    bieżące się zapełni, starsze wypada. Wierzchołek sprzed okna dostaje
+//    nowy indeks (model większy, ale ten sam obraz);
+//  - reszta: bufory linii, lista odcinków, materiały.
+// Wierzchołki i indeksy idą do GeometrySink, jak w LoadOBJToSink.
+struct OutOfCoreSettings {
+    size_t memoryLimit = 256u << 20;
+    std::string tempDir;   // puste = std::filesystem::temp_directory_path()
+};
+
+// Drugi przebieg idzie po odcinkach w kolejności pliku; submeshe i indeksy
+// wychodzą takie jak z LoadOBJToSink, dopóki okno mieści cały model.
+// Przed pierwszym submeshem sink.expect() dostaje rozmiary z pierwszego przebiegu.
+ObjLoadStats LoadOBJOutOfCore(const std::string& objPath, const std::string& baseDir,
+                              const std::vector<std::string>& preloadedMtl, GeometrySink& sink,
+                              const OutOfCoreSettings& settings = {},
+                              const std::atomic<bool>* cancel = nullptr);
@@ -0,0 +1,110 @@
+﻿#pragma once
+// Wspólne kawałki parsera OBJ (ObjLoader, ObjOutOfCore) - tylko dla .cpp
+#include <span>
+#include <sstream>
+#include <string>
+
+#include "ObjLoader.h"
+
+inline std::string Trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    size_t b = s.find_last_not_of(" \t\r\n");
+    if (a == std::string::npos) return "";
+    return s.substr(a, b - a + 1);
+}
+
+inline std::string NormalizePath(std::string p) {
+    // zamień backslash na slash
+    for (char &c : p) if (c == '\\') c = '/';
+
+    // usuń podwójne (i więcej) slashe: "a//b///c" -> "a/b/c"
+    std::string out;
+    out.reserve(p.size());
+    bool prevSlash = false;
+    for (char c : p) {
+        if (c == '/') {
+            if (!prevSlash) out.push_back(c);
+            prevSlash = true;
+        } else {
+            out.push_back(c);
+            prevSlash = false;
+        }
+    }
+    return out;
+}
+
+struct Key {
+    int v=-1, t=-1, n=-1;
+    bool operator==(const Key& o) const { return v==o.v && t==o.t && n==o.n; }
+};
+
+struct KeyHash {
+    size_t operator()(const Key& k) const noexcept {
+        size_t h1 = std::hash<int>{}(k.v);
+        size_t h2 = std::hash<int>{}(k.t);
+        size_t h3 = std::hash<int>{}(k.n);
+        return h1 ^ (h2 * 1315423911u) ^ (h3 * 2654435761u);
+    }
+};
+
+// token "v/t/n" lub "v//n" lub "v/t"
+inline Key ParseFaceVertex(const std::string& tok) {
+    Key k;
+    int parts[3] = {0,0,0};
+    int pi = 0;
+    std::string tmp;
+
+    for (size_t i=0; i<=tok.size(); i++) {
+        char c = (i<tok.size()) ? tok[i] : '/';
+        if (c=='/') {
+            parts[pi] = tmp.empty() ? 0 : std::stoi(tmp);
+            tmp.clear();
+            pi++;
+            if (pi > 2) break;
+        } else {
+            tmp.push_back(c);
+        }
+    }
+
+    k.v = (parts[0] != 0) ? (parts[0] - 1) : -1;
+    k.t = (parts[1] != 0) ? (parts[1] - 1) : -1;
+    k.n = (parts[2] != 0) ? (parts[2] - 1) : -1;
+    return k;
+}
+
+inline std::string MtlLibName(std::istringstream& iss) {
+    // nazwa pliku może mieć spacje, więc bierzemy resztę linii
+    std::string rest; std::getline(iss, rest);
+    return NormalizePath(Trim(rest));
+}
+
+inline std::string MtlLibPath(std::istringstream& iss, const std::string& baseDir) {
+    return baseDir + "/" + MtlLibName(iss);
+}
+
+// Zapis po elemencie w miejsce od GeometrySink, potwierdzany porcjami
+template <class T>
+struct SinkWriter {
+    SinkWriter(GeometrySink& s, std::span<T> (GeometrySink::*sp)(), void (GeometrySink::*c)(size_t))
+        : sink(s), space(sp), commit(c) {}
+
+    GeometrySink& sink;
+    std::span<T> (GeometrySink::*space)();
+    void (GeometrySink::*commit)(size_t);
+    std::span<T> span;
+    size_t used = 0;
+
+    void push(const T& v) {
+        if (used == span.size()) {
+            flush();
+            span = (sink.*space)();
+        }
+        span[used++] = v;
+    }
+    void flush() {
+        if (used) (sink.*commit)(used);
+        span = {};
+        used = 0;
+    }
+};
+
@@ -0,0 +1,198 @@
+﻿#include "ObjScan.h"
+#include "ObjParse.h"
+#include "CompressedInput.h"
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+namespace {
+
+constexpr size_t kBlockSize = 1 << 20;
+
+bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+std::string_view TrimView(std::string_view s) {
+    while (!s.empty() && IsSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && IsSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// Kolejny float z s (from_chars nie zna '+' ani wiodących spacji)
+bool NextFloat(std::string_view& s, float& out) {
+    s = TrimView(s);
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    const auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+    if (r.ec != std::errc()) return false;
+    s.remove_prefix((size_t)(r.ptr - s.data()));
+    return true;
+}
+
+size_t CountTokens(std::string_view s) {
+    size_t n = 0;
+    bool in = false;
+    for (char c : s) {
+        const bool space = IsSpace(c);
+        if (!space && !in) n++;
+        in = !space;
+    }
+    return n;
+}
+
+// Lista bez powtórzeń, w kolejności pierwszego wystąpienia
+class UniqueNames {
+public:
+    explicit UniqueNames(std::vector<std::string>& out) : out_(out) {}
+    void add(std::string_view name) {
+        if (name.empty()) return;
+        auto [it, inserted] = seen_.emplace(name);
+        if (inserted) out_.push_back(*it);
+    }
+
+private:
+    std::vector<std::string>& out_;
+    std::unordered_set<std::string> seen_;
+};
+
+// Linie pliku po kolei, czytane blokami kBlockSize (linia dłuższa niż blok
+// powiększa bufor). fn dostaje linię bez '\n'.
+template <class Fn>
+uint64_t ForEachLine(std::istream& f, Fn&& fn) {
+    std::vector<char> buf(kBlockSize);
+    size_t carry = 0;
+    uint64_t total = 0;
+    for (;;) {
+        f.read(buf.data() + carry, (std::streamsize)(buf.size() - carry));
+        const size_t got = (size_t)f.gcount();
+        total += got;
+        const size_t n = carry + got;
+        const char* p = buf.data();
+        const char* end = p + n;
+        while (const char* nl = (const char*)std::memchr(p, '\n', (size_t)(end - p))) {
+            fn(std::string_view(p, (size_t)(nl - p)));
+            p = nl + 1;
+        }
+        carry = (size_t)(end - p);
+        if (!f) {
+            if (carry) fn(std::string_view(p, carry));
+            return total;
+        }
+        std::memmove(buf.data(), p, carry);
+        if (carry == buf.size()) buf.resize(buf.size() * 2);
+    }
+}
+
+} // namespace
+
+ObjMetadata ScanOBJMetadata(const std::string& objPath, const std::string& baseDir,
+                            const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("ScanOBJMetadata");
+    const auto t0 = std::chrono::steady_clock::now();
+    auto in = OpenInputFile(objPath);
+    if (!in) throw std::runtime_error("Nie moge otworzyc OBJ: " + objPath);
+
+    ObjMetadata m;
+    m.path = objPath;
+    std::vector<std::string> groups;
+    UniqueNames objects(m.objects), groupNames(groups), materials(m.materials), textures(m.textures);
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    size_t lines = 0;
+
+    m.fileSize = ForEachLine(*in, [&](std::string_view line) {
+        line = TrimView(line);
+        if (line.empty() || line[0] == '#') return;
+        if (cancel && (++lines & 16383) == 0 && cancel->load(std::memory_order_relaxed))
+            throw LoadCancelled();
+
+        size_t tagEnd = 0;
+        while (tagEnd < line.size() && !IsSpace(line[tagEnd])) tagEnd++;
+        const std::string_view tag = line.substr(0, tagEnd);
+        std::string_view rest = line.substr(tagEnd);
+
+        if (tag == "v") {
+            glm::vec3 p;
+            if (!NextFloat(rest, p.x) || !NextFloat(rest, p.y) || !NextFloat(rest, p.z))
+                throw std::runtime_error("Blad linii v w OBJ: " + objPath);
+            bmin = glm::min(bmin, p);
+            bmax = glm::max(bmax, p);
+            m.positions++;
+        } else if (tag == "vt") {
+            m.uvs++;
+        } else if (tag == "vn") {
+            m.normals++;
+        } else if (tag == "f") {
+            const size_t corners = CountTokens(rest);
+            m.faces++;
+            if (corners >= 3) m.triangles += corners - 2;
+        } else if (tag == "o") {
+            objects.add(TrimView(rest));
+        } else if (tag == "g") {
+            groupNames.add(TrimView(rest));
+        } else if (tag == "usemtl") {
+            materials.add(TrimView(rest));
+        } else if (tag == "mtllib") {
+            std::istringstream iss{std::string(rest)};
+            m.mtlLibs.push_back(MtlLibPath(iss, baseDir));
+        }
+    });
+
+    if (m.objects.empty()) m.objects = std::move(groups);
+    if (m.positions) {
+        m.boundsMin = bmin;
+        m.boundsMax = bmax;
+    }
+    for (const std::string& lib : m.mtlLibs) {
+        // MTL są małe - zwykły LoadMTL (bez tekstur GL) wystarczy
+        try {
+            for (const auto& [name, mat] : LoadMTL(lib, baseDir)) {
+                if (!mat.mapKd.empty()) textures.add(mat.mapKd);
+                if (!mat.mapBump.empty()) textures.add(mat.mapBump);
+            }
+        } catch (const std::exception&) {
+            m.missing.push_back(lib);
+        }
+    }
+    m.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return m;
+}
+
+std::vector<ObjMetadata> ScanOBJFiles(JobSystem& jobs, const std::vector<std::string>& objPaths,
+                                      ObjScanStats* stats, const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("ScanOBJFiles");
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<ObjMetadata> out(objPaths.size());
+    // pliki bywają bardzo nierówne, więc grain 1 - kradzież wyrówna resztę
+    jobs.parallelFor(0, objPaths.size(), 1, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            const std::string& path = objPaths[i];
+            try {
+                std::string dir = std::filesystem::path(path).parent_path().generic_string();
+                if (dir.empty()) dir = ".";
+                out[i] = ScanOBJMetadata(path, dir, cancel);
+            } catch (const LoadCancelled&) {
+                throw;
+            } catch (const std::exception& ex) {
+                out[i].path = path;
+                out[i].error = ex.what();
+            }
+        }
+    });
+
+    if (stats) {
+        *stats = ObjScanStats{};
+        for (const ObjMetadata& m : out) {
+            stats->files++;
+            stats->bytes += m.fileSize;
+            if (!m.error.empty()) stats->failed++;
+        }
+        stats->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    return out;
+}
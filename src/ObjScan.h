@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+// Metadane OBJ dla przeglądarki assetów. Jedno przejście po pliku blokami,
+// bez deduplikacji, bez tablic atrybutów i bez std::string na linię -
+// tylko liczniki, AABB i nazwy.
+struct ObjMetadata {
+    std::string path;
+    uint64_t fileSize = 0;                // bajty tekstu (skompresowany: po rozpakowaniu)
+    size_t positions = 0, uvs = 0, normals = 0;
+    size_t faces = 0;                     // przed triangulacją
+    size_t triangles = 0;                 // po triangulacji fan
+    std::vector<std::string> objects;     // nazwy o (bez powtórzeń); plik bez o: nazwy g
+    std::vector<std::string> materials;   // nazwy z usemtl, bez powtórzeń
+    std::vector<std::string> mtlLibs;     // pełne ścieżki z mtllib
+    std::vector<std::string> textures;    // map_Kd i bump z tych MTL, bez powtórzeń
+    std::vector<std::string> missing;     // mtllib, których nie da się otworzyć
+    glm::vec3 boundsMin{0.f}, boundsMax{0.f};   // AABB wszystkich v (także nieużytych)
+    double ms = 0.0;
+    std::string error;                    // ScanOBJFiles: niepusty = pliku nie przeczytano
+};
+
+// Rzuca, gdy OBJ nie da się otworzyć (brak MTL tylko trafia do missing).
+// cancel jak w LoadOBJ_WithMTL.
+ObjMetadata ScanOBJMetadata(const std::string& objPath, const std::string& baseDir,
+                            const std::atomic<bool>* cancel = nullptr);
+
+struct ObjScanStats {
+    size_t files = 0, failed = 0;
+    uint64_t bytes = 0;
+    double ms = 0.0;                      // ściana, cały ScanOBJFiles
+
+    double filesPerSecond() const { return ms > 0.0 ? files * 1000.0 / ms : 0.0; }
+    double mbPerSecond() const { return ms > 0.0 ? bytes / (1024.0 * 1024.0) * 1000.0 / ms : 0.0; }
+};
+
+// Wiele plików równolegle (JobSystem::parallelFor, po jednym pliku na
+// zadanie); baseDir każdego to jego katalog. Wynik w kolejności objPaths,
+// błąd pliku nie przerywa reszty - trafia do ObjMetadata::error.
+std::vector<ObjMetadata> ScanOBJFiles(JobSystem& jobs, const std::vector<std::string>& objPaths,
+                                      ObjScanStats* stats = nullptr, const std::atomic<bool>* cancel = nullptr);
@@ -0,0 +1,194 @@
+﻿#include "OffsetAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+// Rozmiar -> koszyk: do 7 dokładnie, dalej wykładnik i 3 bity mantysy
+uint32_t BinRoundDown(uint32_t size) {
+    if (size < 8) return size;
+    const uint32_t high = 31 - (uint32_t)std::countl_zero(size);
+    const uint32_t shift = high - 3;
+    return ((shift + 1) << 3) | ((size >> shift) & 7);
+}
+
+// Najmniejszy koszyk, którego każdy blok pomieści size
+uint32_t BinRoundUp(uint32_t size) {
+    const uint32_t bin = BinRoundDown(size);
+    if (size < 8) return bin;
+    const uint32_t shift = 31 - (uint32_t)std::countl_zero(size) - 3;
+    // przeniesienie z mantysy do wykładnika wychodzi samo
+    return (size & ((1u << shift) - 1)) ? bin + 1 : bin;
+}
+
+// Najniższy ustawiony bit >= from albo 32
+uint32_t LowestBitFrom(uint32_t mask, uint32_t from) {
+    if (from >= 32) return 32;
+    const uint32_t m = mask & (~0u << from);
+    return m ? (uint32_t)std::countr_zero(m) : 32;
+}
+
+}
+
+OffsetAllocator::OffsetAllocator(uint32_t capacity) {
+    std::fill(std::begin(bins_), std::end(bins_), kNoNode);
+    grow(capacity);
+}
+
+OffsetAllocator::Node OffsetAllocator::newNode() {
+    if (!spareNodes_.empty()) {
+        Node n = spareNodes_.back();
+        spareNodes_.pop_back();
+        nodes_[n] = Block{};
+        return n;
+    }
+    nodes_.emplace_back();
+    return (Node)(nodes_.size() - 1);
+}
+
+void OffsetAllocator::insertFree(Node n) {
+    Block& b = nodes_[n];
+    const uint32_t bin = BinRoundDown(b.size);
+    b.used = false;
+    b.binPrev = kNoNode;
+    b.binNext = bins_[bin];
+    if (b.binNext != kNoNode) nodes_[b.binNext].binPrev = n;
+    bins_[bin] = n;
+    topMask_ |= 1u << (bin >> 3);
+    leafMask_[bin >> 3] |= (uint8_t)(1u << (bin & 7));
+}
+
+void OffsetAllocator::removeFree(Node n) {
+    Block& b = nodes_[n];
+    if (b.binPrev != kNoNode) {
+        nodes_[b.binPrev].binNext = b.binNext;
+    } else {
+        const uint32_t bin = BinRoundDown(b.size);
+        bins_[bin] = b.binNext;
+        if (b.binNext == kNoNode) {
+            leafMask_[bin >> 3] &= (uint8_t)~(1u << (bin & 7));
+            if (!leafMask_[bin >> 3]) topMask_ &= ~(1u << (bin >> 3));
+        }
+    }
+    if (b.binNext != kNoNode) nodes_[b.binNext].binPrev = b.binPrev;
+    b.binPrev = b.binNext = kNoNode;
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size) {
+    if (size == 0) size = 1;   // pusty zakres też musi mieć własny węzeł
+    if (size > capacity_ - used_) return {};
+
+    // pierwszy niepusty koszyk >= BinRoundUp(size): najpierw w tym samym
+    // wierszu, potem najniższy niepusty wiersz wyżej
+    const uint32_t want = BinRoundUp(size);
+    uint32_t top = want >> 3;
+    uint32_t leaf = LowestBitFrom(leafMask_[top], want & 7);
+    if (leaf == 32) top = LowestBitFrom(topMask_, top + 1);
+    if (top < kTopBins && leaf == 32) leaf = (uint32_t)std::countr_zero((uint32_t)leafMask_[top]);
+    Node n = top < kTopBins ? bins_[(top << 3) | leaf] : kNoNode;
+    if (n == kNoNode) {
+        // Wyżej pusto: jeszcze koszyk samego size, gdzie bloki bywają mniejsze
+        // (np. jedyny wolny blok po compact ma dokładnie tyle, ile trzeba)
+        for (n = bins_[BinRoundDown(size)]; n != kNoNode && nodes_[n].size < size; n = nodes_[n].binNext) {}
+        if (n == kNoNode) return {};
+    }
+    removeFree(n);
+
+    // reszta bloku wraca jako wolny sąsiad
+    if (nodes_[n].size > size) {
+        const Node rest = newNode();
+        Block& b = nodes_[n];   // newNode mógł przenieść wektor
+        Block& r = nodes_[rest];
+        r.offset = b.offset + size;
+        r.size = b.size - size;
+        r.prev = n;
+        r.next = b.next;
+        if (b.next != kNoNode) nodes_[b.next].prev = rest;
+        else last_ = rest;
+        b.next = rest;
+        b.size = size;
+        insertFree(rest);
+    }
+    nodes_[n].used = true;
+    used_ += size;
+    return Allocation{nodes_[n].offset, n};
+}
+
+void OffsetAllocator::free(Node n) {
+    if (n >= nodes_.size() || !nodes_[n].used) throw std::logic_error("OffsetAllocator::free: blok nie jest zajety");
+    used_ -= nodes_[n].size;
+    nodes_[n].used = false;
+
+    // sklejanie: poprzedni wolny wchłania n, n wchłania następny wolny
+    auto absorbNext = [this](Node into) {
+        Block& b = nodes_[into];
+        const Node nx = b.next;
+        b.size += nodes_[nx].size;
+        b.next = nodes_[nx].next;
+        if (b.next != kNoNode) nodes_[b.next].prev = into;
+        else last_ = into;
+        nodes_[nx] = Block{};
+        spareNodes_.push_back(nx);
+    };
+    const Node nx = nodes_[n].next;
+    if (nx != kNoNode && !nodes_[nx].used) {
+        removeFree(nx);
+        absorbNext(n);
+    }
+    Node keep = n;
+    const Node pv = nodes_[n].prev;
+    if (pv != kNoNode && !nodes_[pv].used) {
+        removeFree(pv);
+        absorbNext(pv);
+        keep = pv;
+    }
+    insertFree(keep);
+}
+
+void OffsetAllocator::grow(uint32_t capacity) {
+    if (capacity <= capacity_) return;
+    const uint32_t extra = capacity - capacity_;
+    if (last_ != kNoNode && !nodes_[last_].used) {
+        removeFree(last_);
+        nodes_[last_].size += extra;
+        insertFree(last_);
+    } else {
+        const Node n = newNode();
+        nodes_[n].offset = capacity_;
+        nodes_[n].size = extra;
+        nodes_[n].prev = last_;
+        if (last_ != kNoNode) nodes_[last_].next = n;
+        last_ = n;
+        insertFree(n);
+    }
+    capacity_ = capacity;
+}
+
+void OffsetAllocator::reset() {
+    const uint32_t capacity = capacity_;
+    nodes_.clear();
+    spareNodes_.clear();
+    std::fill(std::begin(bins_), std::end(bins_), kNoNode);
+    topMask_ = 0;
+    std::fill(std::begin(leafMask_), std::end(leafMask_), (uint8_t)0);
+    last_ = kNoNode;
+    capacity_ = 0;
+    used_ = 0;
+    grow(capacity);
+}
+
+OffsetAllocator::Stats OffsetAllocator::stats() const {
+    Stats s;
+    s.capacity = capacity_;
+    s.used = used_;
+    for (Node n = 0; n < (Node)nodes_.size(); n++) {
+        const Block& b = nodes_[n];
+        // węzły w spareNodes_ są wyzerowane (size 0) - nie liczą się
+        if (b.used || b.size == 0) continue;
+        s.freeRegions++;
+        s.largestFree = std::max(s.largestFree, b.size);
+    }
+    return s;
+}
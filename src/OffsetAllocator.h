@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+// Przydział zakresów [offset, offset+size) w przestrzeni, której sam nie
+// trzyma (np. elementy bufora GL). W stylu TLSF: wolne bloki w 256 koszykach
+// "małych floatów" (wykładnik + 3 bity mantysy), dwupoziomowa maska
+// niepustych koszyków, więc allocate() i free() są O(1) niezależnie od
+// liczby bloków. free() od razu skleja z wolnymi sąsiadami.
+//
+// Koszyk z allocate() zaokrągla rozmiar w górę - każdy blok w nim jest dość
+// duży. Dopiero gdy wyżej nic nie ma, przegląda koszyk samego rozmiaru,
+// gdzie bloki bywają za małe (tylko wtedy czas nie jest stały).
+class OffsetAllocator {
+public:
+    using Node = uint32_t;
+    static constexpr Node kNoNode = ~0u;
+
+    struct Allocation {
+        uint32_t offset = 0;
+        Node node = kNoNode;   // do free(); kNoNode = brak miejsca
+        explicit operator bool() const { return node != kNoNode; }
+    };
+
+    struct Stats {
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+        uint32_t freeRegions = 0;   // > 1 = fragmentacja
+        uint32_t largestFree = 0;
+    };
+
+    explicit OffsetAllocator(uint32_t capacity = 0);
+
+    Allocation allocate(uint32_t size);
+    void free(Node node);
+    // Dokłada wolne miejsce na końcu (bufor urósł); nigdy nie zmniejsza
+    void grow(uint32_t capacity);
+    // Wszystko wolne, pojemność bez zmian
+    void reset();
+
+    uint32_t capacity() const { return capacity_; }
+    uint32_t used() const { return used_; }
+    uint32_t sizeOf(Node node) const { return nodes_[node].size; }
+    Stats stats() const;
+
+private:
+    static constexpr uint32_t kTopBins = 32;
+    static constexpr uint32_t kLeafBins = 8;   // 3 bity mantysy
+    static constexpr uint32_t kBins = kTopBins * kLeafBins;
+
+    struct Block {
+        uint32_t offset = 0, size = 0;
+        Node binPrev = kNoNode, binNext = kNoNode;   // lista wolnych w koszyku
+        Node prev = kNoNode, next = kNoNode;         // sąsiedzi w przestrzeni
+        bool used = false;
+    };
+
+    Node newNode();
+    void insertFree(Node n);
+    void removeFree(Node n);
+
+    std::vector<Block> nodes_;
+    std::vector<Node> spareNodes_;
+    Node bins_[kBins];
+    uint32_t topMask_ = 0;
+    uint8_t leafMask_[kTopBins] = {};
+    Node last_ = kNoNode;   // blok na końcu przestrzeni (grow)
+    uint32_t capacity_ = 0;
+    uint32_t used_ = 0;
+};
@@ -0,0 +1,157 @@
+﻿#include "ProgramBinaryCache.h"
+#include "GLExt.h"
+#include "Timing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+const uint32_t kMagic = 0x42504E5A; // "ZNPB"
+const uint32_t kVersion = 1;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;     // GLenum binaryFormat
+    uint32_t length;
+    double compileMs;    // ile kosztowała kompilacja ze źródeł
+};
+
+uint64_t Fnv1a(uint64_t h, const void* data, size_t n) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t Fnv1a(uint64_t h, const std::string& s) {
+    h = Fnv1a(h, s.data(), s.size());
+    return Fnv1a(h, "\0", 1); // separator, żeby "ab"+"c" != "a"+"bc"
+}
+
+std::string GLString(GLenum name) {
+    const char* s = (const char*)glGetString(name);
+    return s ? s : "";
+}
+
+} // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(std::string dir) : dir_(std::move(dir)) {
+    enabled_ = gExt.programBinary;
+    driverId_ = GLString(GL_VENDOR) + "|" + GLString(GL_RENDERER) + "|" + GLString(GL_VERSION);
+    if (!enabled_) return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) enabled_ = false;
+}
+
+uint64_t ProgramBinaryCache::key(const std::string& vsSrc, const std::string& fsSrc) const {
+    uint64_t h = 14695981039346656037ull;
+    h = Fnv1a(h, vsSrc);
+    h = Fnv1a(h, fsSrc);
+    h = Fnv1a(h, driverId_);
+    return h;
+}
+
+std::string ProgramBinaryCache::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return dir_ + "/" + name;
+}
+
+GLuint ProgramBinaryCache::load(uint64_t key) {
+    if (!enabled_) return 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::string path = pathFor(key);
+    std::ifstream f(path, std::ios::binary);
+    if (!f) { stats_.misses++; return 0; }
+
+    Header h{};
+    f.read((char*)&h, sizeof(h));
+    std::vector<char> blob;
+    if (f && h.magic == kMagic && h.version == kVersion && h.length > 0) {
+        blob.resize(h.length);
+        f.read(blob.data(), h.length);
+        if ((size_t)f.gcount() != blob.size()) blob.clear();
+    }
+    f.close();
+
+    if (blob.empty()) {
+        stats_.misses++;
+        stats_.rejected++;
+        std::filesystem::remove(path);
+        return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    gExt.ProgramBinary(prog, (GLenum)h.format, blob.data(), (GLsizei)blob.size());
+    GLint ok = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        // inny sterownik / aktualizacja -> kompilujemy ze źródeł i nadpisujemy wpis
+        glDeleteProgram(prog);
+        stats_.misses++;
+        stats_.rejected++;
+        std::filesystem::remove(path);
+        return 0;
+    }
+
+    double ms = MsSince(t0);
+    stats_.hits++;
+    stats_.loadMs += ms;
+    stats_.savedMs += h.compileMs - ms;
+    return prog;
+}
+
+void ProgramBinaryCache::prepareForLink(GLuint program) const {
+    if (enabled_) gExt.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramBinaryCache::store(uint64_t key, GLuint program, double compileMs) {
+    stats_.compileMs += compileMs;
+    if (!enabled_) return;
+
+    GLint len = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &len);
+    if (len <= 0) return;
+
+    std::vector<char> blob((size_t)len);
+    GLenum format = 0;
+    GLsizei written = 0;
+    gExt.GetProgramBinary(program, len, &written, &format, blob.data());
+    if (written <= 0) return;
+
+    Header h{kMagic, kVersion, (uint32_t)format, (uint32_t)written, compileMs};
+
+    // zapis do pliku tymczasowego + rename, żeby równoległe uruchomienie nie czytało połowy
+    std::string path = pathFor(key);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return;
+        f.write((const char*)&h, sizeof(h));
+        f.write(blob.data(), written);
+        if (!f) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+}
+
+void ProgramBinaryCache::printStats(std::ostream& os) const {
+    os << "Program binary cache: " << (enabled_ ? "on" : "off (brak GL_ARB_get_program_binary)")
+       << " hits=" << stats_.hits
+       << " misses=" << stats_.misses
+       << " rejected=" << stats_.rejected
+       << " load=" << stats_.loadMs << "ms"
+       << " compile=" << stats_.compileMs << "ms"
+       << " saved=" << stats_.savedMs << "ms\n";
+}
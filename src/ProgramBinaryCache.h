@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+#include <glad/glad.h>
+
+// Cache zlinkowanych programów na dysku (glGetProgramBinary/glProgramBinary).
+// Klucz = hash źródeł (już z define'ami) + GL_VENDOR/GL_RENDERER/GL_VERSION,
+// więc zmiana sterownika po prostu daje miss, a nie zepsuty program.
+struct ProgramBinaryStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t rejected = 0;   // binarka była, ale sterownik jej nie przyjął
+    double loadMs = 0.0;     // czas ładowania binarek (trafienia)
+    double compileMs = 0.0;  // czas kompilacji ze źródeł (pudła)
+    double savedMs = 0.0;    // zapisany czas kompilacji trafień minus czas ich ładowania
+};
+
+class ProgramBinaryCache {
+public:
+    explicit ProgramBinaryCache(std::string dir = "shader_cache");
+
+    bool enabled() const { return enabled_; }
+
+    uint64_t key(const std::string& vsSrc, const std::string& fsSrc) const;
+
+    // 0 gdy brak wpisu albo sterownik odrzucił binarkę (wtedy kompilujemy ze źródeł)
+    GLuint load(uint64_t key);
+
+    // Wołać przed glLinkProgram, żeby sterownik zachował binarkę
+    void prepareForLink(GLuint program) const;
+    void store(uint64_t key, GLuint program, double compileMs);
+
+    const ProgramBinaryStats& stats() const { return stats_; }
+    void printStats(std::ostream& os) const;
+
+private:
+    std::string pathFor(uint64_t key) const;
+
+    std::string dir_;
+    std::string driverId_;
+    bool enabled_ = false;
+    ProgramBinaryStats stats_;
+};
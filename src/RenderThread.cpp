@@ -0,0 +1,93 @@
+﻿#include "RenderThread.h"
+#include "CpuProfiler.h"
+#include "GpuProfiler.h"
+#include "JobSystem.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+RenderThread::RenderThread(GLFWwindow* win, Renderer& renderer, JobSystem& jobs,
+                           GpuProfiler* profiler, FrameHook onFrame)
+    : win_(win), renderer_(renderer), jobs_(jobs), profiler_(profiler), onFrame_(std::move(onFrame)) {}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+void RenderThread::start(const FrameSnapshot& first) {
+    snapshots_.write() = first;
+    snapshots_.publish();
+
+    feedback_.geometryVersion = renderer_.geometryVersion();
+    feedback_.center = renderer_.worldCenter();
+    feedback_.radius = renderer_.worldRadius();
+
+    stop_.store(false);
+    glfwMakeContextCurrent(nullptr);   // kontekst może być aktualny tylko w jednym wątku
+    thread_ = std::thread([this] { loop(); });
+}
+
+void RenderThread::stop() {
+    if (!thread_.joinable()) return;
+    stop_.store(true);
+    thread_.join();
+    glfwMakeContextCurrent(win_);
+    jobs_.setMainThread();
+}
+
+void RenderThread::submit(const FrameSnapshot& snapshot) {
+    snapshots_.write() = snapshot;
+    snapshots_.publish();
+}
+
+RenderFeedback RenderThread::feedback() const {
+    std::lock_guard<std::mutex> lock(feedbackMutex_);
+    return feedback_;
+}
+
+void RenderThread::loop() {
+    PROFILE_THREAD("render");
+    glfwMakeContextCurrent(win_);
+    jobs_.setMainThread();   // runOnMain (np. wznowienia AsyncAssets) potrzebuje GL
+
+    auto titleTime = std::chrono::steady_clock::now();
+    while (!stop_.load()) {
+        if (snapshots_.update()) snapshotsUsed_++;
+        const FrameSnapshot& s = snapshots_.read();
+
+        {
+            PROFILE_ZONE("update");
+            renderer_.update();
+        }
+        if (onFrame_ && !onFrame_(renderer_)) {
+            failed_.store(true);
+            break;
+        }
+
+        renderer_.render(s.params);
+        if (profiler_ && s.showProfiler) profiler_->drawOverlay(s.params.width, s.params.height);
+
+        {
+            std::lock_guard<std::mutex> lock(feedbackMutex_);
+            feedback_.geometryVersion = renderer_.geometryVersion();
+            feedback_.center = renderer_.worldCenter();
+            feedback_.radius = renderer_.worldRadius();
+            feedback_.frames = frames_ + 1;
+            auto now = std::chrono::steady_clock::now();
+            if (profiler_ && now - titleTime > std::chrono::milliseconds(250)) {
+                feedback_.title = profiler_->summary();
+                titleTime = now;
+            }
+        }
+
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(win_);
+        }
+        latencyMsSum_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s.created).count();
+        frames_++;
+        PROFILE_FRAME();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
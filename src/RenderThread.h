@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <glm/glm.hpp>
+
+#include "Renderer.h"
+#include "TripleBuffer.h"
+
+struct GLFWwindow;
+class GpuProfiler;
+class JobSystem;
+
+// Stan klatki z wątku głównego: po publish() nikt go już nie zmienia
+struct FrameSnapshot {
+    FrameParams params;
+    bool showProfiler = true;
+    uint64_t sequence = 0;                          // numer kroku symulacji
+    std::chrono::steady_clock::time_point created;  // do opóźnienia wejście -> swap
+};
+
+// Co wątek renderu odsyła głównemu: model do kadrowania kamery i tytuł okna
+// (glfwSetWindowTitle wolno wołać tylko z wątku głównego)
+struct RenderFeedback {
+    uint32_t geometryVersion = 0;
+    glm::vec3 center{0.f};
+    float radius = 1.f;
+    std::string title;
+    uint64_t frames = 0;
+};
+
+// Wołane na wątku GL raz na klatkę przed renderem (np. doładowanie modelu);
+// false = błąd, render się zatrzymuje
+using FrameHook = std::function<bool(Renderer&)>;
+
+// Osobny wątek z kontekstem GL. Wątek główny tylko pompuje zdarzenia GLFW,
+// rusza kamerą i co krok wysyła niezmienny FrameSnapshot przez potrójny
+// bufor; render bierze zawsze najnowszy (albo powtarza poprzedni), więc
+// skok CPU po jednej stronie nie zatrzymuje drugiej.
+class RenderThread {
+public:
+    RenderThread(GLFWwindow* win, Renderer& renderer, JobSystem& jobs,
+                 GpuProfiler* profiler = nullptr, FrameHook onFrame = {});
+    // stop(), jeśli nie zatrzymano wcześniej
+    ~RenderThread();
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Wątek główny oddaje kontekst GL i rolę wątku głównego JobSystem
+    void start(const FrameSnapshot& first);
+    // Czeka na koniec wątku renderu i odbiera kontekst z powrotem
+    void stop();
+
+    void submit(const FrameSnapshot& snapshot);
+    RenderFeedback feedback() const;
+    bool failed() const { return failed_.load(); }
+    bool running() const { return thread_.joinable(); }
+
+    // Po stop(): klatki, nowe snapshoty i średni czas od snapshotu do swapu
+    uint64_t framesRendered() const { return frames_; }
+    uint64_t snapshotsUsed() const { return snapshotsUsed_; }
+    double avgLatencyMs() const { return frames_ ? latencyMsSum_ / (double)frames_ : 0.0; }
+
+private:
+    void loop();
+
+    GLFWwindow* win_;
+    Renderer& renderer_;
+    JobSystem& jobs_;
+    GpuProfiler* profiler_;
+    FrameHook onFrame_;
+
+    TripleBuffer<FrameSnapshot> snapshots_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> failed_{false};
+
+    mutable std::mutex feedbackMutex_;
+    RenderFeedback feedback_;
+
+    // tylko wątek renderu (czytane po join)
+    uint64_t frames_ = 0, snapshotsUsed_ = 0;
+    double latencyMsSum_ = 0.0;
+};
@@ -0,0 +1,583 @@
+﻿#include "Renderer.h"
+#include "Texture.h"
+#include "CpuProfiler.h"
+#include "JobSystem.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Submeshe na jeden kawałek nagrywania komend; mniejsza scena nagrywa się
+// w całości na wątku renderu (pula kosztuje więcej, niż oszczędza)
+static const size_t kRecordGrain = 512;
+
+// Blok FrameData z phong.vert/phong.frag (std140: vec3 + float = 16 bajtów)
+struct FrameUniforms {
+    glm::mat4 model, view, proj;
+    glm::vec4 viewPos, lightDir, lightColor;
+};
+static const GLuint kFrameDataBinding = 0;
+static const size_t kFrameRingRegion = 16 * 1024;   // miejsce na przyszłe dane klatki
+
+// Najtańszy wariant shadera, który jeszcze poprawnie narysuje materiał
+static uint32_t PickShaderFeatures(const Material& mat) {
+    uint32_t f = SF_NONE;
+    if (mat.glTex) f |= SF_TEXTURE;
+    if (mat.glBumpTex) f |= SF_NORMAL_MAP;
+    if (glm::max(mat.Ks.r, glm::max(mat.Ks.g, mat.Ks.b)) > 1e-4f) f |= SF_SPECULAR;
+    return f;
+}
+
+Renderer::Renderer(const RenderSettings& s) : settings_(s) {
+    // Shader: warianty phong.vert/phong.frag kompilowane na żądanie
+    // (zlinkowane programy trzymamy w shader_cache/, żeby kolejny start ich nie kompilował)
+    programCache_ = std::make_unique<ProgramBinaryCache>(settings_.shaderCacheDir);
+    shaders_ = std::make_unique<ShaderCache>("shaders/phong.vert", "shaders/phong.frag", programCache_.get());
+
+    // Hot reload: zapis pliku w shaders/ przebudowuje warianty w tle
+    if (settings_.hotReload) shaderWatcher_ = std::make_unique<FileWatcher>("shaders");
+
+    clustered_ = std::make_unique<ClusteredLighting>();
+    sunDir_ = glm::normalize(glm::vec3(-1.f, -1.f, -0.5f));
+    frameRing_ = std::make_unique<UploadRing>(GL_UNIFORM_BUFFER, kFrameRingRegion, 3);
+    geometry_ = std::make_unique<GeometryArena>();
+}
+
+Renderer::~Renderer() {
+    for (auto& [path, tex] : textures_) glDeleteTextures(1, &tex);
+}
+
+void Renderer::clearModel() {
+    for (auto& [path, tex] : textures_) glDeleteTextures(1, &tex);
+    textures_.clear();
+    model_ = LoadedModel{};
+    uploadStats_ = ModelUploadStats{};
+    if (modelGeometry_ != GeometryArena::kNoHandle) geometry_->free(modelGeometry_);
+    modelGeometry_ = GeometryArena::kNoHandle;
+    vertexCount_ = indexCount_ = 0;
+    submeshPages_.clear();
+    pageRequests_.clear();
+    missingPages_ = 0;
+
+    submeshMats_.clear();
+    submeshFeatures_.clear();
+    submeshShaders_.clear();
+    casters_.clear();
+    shadows_.reset();
+    shadowGeometryDirty_ = false;
+
+    boundsMin_ = glm::vec3(1e30f);
+    boundsMax_ = glm::vec3(-1e30f);
+    center_ = glm::vec3(0.f);
+    radius_ = 1.f;
+    geometryVersion_++;
+}
+
+void Renderer::setModel(LoadedModel m, const DecodedTextures* decoded) {
+    PROFILE_ZONE("Renderer::setModel");
+    clearModel();
+    model_ = std::move(m);
+
+    // --- bounding box modelu (kamera, zasięg cieni, światła demo) ---
+    glm::vec3 mn( 1e30f), mx(-1e30f);
+    for (const auto& v : model_.vertices) {
+        mn = glm::min(mn, v.pos);
+        mx = glm::max(mx, v.pos);
+    }
+    includeBounds(mn, mx);
+
+    // Tekstury materiałów (dekodowanie i upload mierzone osobno)
+    auto loadTexture = [&](const std::string& path, bool flip) -> GLuint {
+        // ten sam plik może być w kilku materiałach: wysyłamy raz, obrazu nie przenosimy
+        auto cached = textures_.find(path);
+        if (cached != textures_.end()) return cached->second;
+
+        const DecodedImage* img = nullptr;
+        DecodedImage local;
+        auto t0 = std::chrono::steady_clock::now();
+        if (decoded) {
+            auto it = decoded->find(path);
+            if (it != decoded->end()) img = &it->second;
+        }
+        if (!img) {
+            local = DecodeImage(path, flip);
+            img = &local;
+        }
+        uploadStats_.textureDecodeMs += MsSince(t0);
+        return uploadTexture(path, *img);
+    };
+    for (auto& [name, mat] : model_.materials) {
+        if (!mat.mapKd.empty()) {
+            mat.glTex = loadTexture(mat.mapKd, !mat.uvOriginTop);
+        }
+        if (!mat.mapBump.empty()) {
+            mat.glBumpTex = loadTexture(mat.mapBump, !mat.uvOriginTop);
+        }
+    }
+
+    // Cienie: osobny strumień samych pozycji + ten sam EBO; każdy submesh to caster
+    // (model jest statyczny, więc version się nie zmienia i kaskady odświeża tylko ruch kamery)
+    auto shadowsStart = std::chrono::steady_clock::now();
+    addShadowCasters(0);
+    uploadStats_.shadowsMs = MsSince(shadowsStart);
+
+    // Materiał brany do rysowania submesha + wariant shadera (liczone raz, nie co klatkę).
+    // Warianty kompilują się w tle; do tego czasu rysujemy wariantem zapasowym.
+    resolveSubmeshes(0);
+    std::cout << "Shader variants: " << shaders_->size() << "\n";
+
+    uploadGeometry(model_.vertices, model_.indices);
+    // geometria żyje już tylko w arenie; liczby zostają w statystykach
+    model_.stats.vertices = model_.vertices.size();
+    model_.stats.indices = model_.indices.size();
+    std::vector<Vertex>().swap(model_.vertices);
+    std::vector<uint32_t>().swap(model_.indices);
+
+    shadowsStart = std::chrono::steady_clock::now();
+    if (shadows_) {
+        const GeometryArena::Range& r = geometry_->range(modelGeometry_);
+        shadows_->setGeometry(geometry_->vao(), r.firstIndex, (int32_t)r.firstVertex);
+        shadowLayout_ = geometry_->layoutVersion();
+    }
+    uploadStats_.shadowsMs += MsSince(shadowsStart);
+}
+
+void Renderer::addMaterials(MaterialMap mats) {
+    for (auto& [name, mat] : mats) {
+        // tekstura mogła przyjść przed materiałem
+        auto kd = textures_.find(mat.mapKd);
+        if (kd != textures_.end()) mat.glTex = kd->second;
+        auto bump = textures_.find(mat.mapBump);
+        if (bump != textures_.end()) mat.glBumpTex = bump->second;
+        model_.materials[name] = std::move(mat);   // węzły mapy są stabilne: submeshMats_ zostają ważne
+    }
+    resolveSubmeshes(0);
+}
+
+void Renderer::addGeometry(ObjChunk chunk) {
+    PROFILE_ZONE("Renderer::addGeometry");
+    const size_t firstSubmesh = model_.submeshes.size();
+    if (chunk.firstVertex != vertexCount_ || chunk.submesh.indexOffset != indexCount_)
+        throw std::runtime_error("Renderer::addGeometry: kawalki modelu nie po kolei");
+
+    if (!chunk.materials.empty()) addMaterials(std::move(chunk.materials));
+    model_.submeshes.push_back(chunk.submesh);
+    if (chunk.submesh.indexCount) includeBounds(chunk.submesh.boundsMin, chunk.submesh.boundsMax);
+
+    const bool newShadows = addShadowCasters(firstSubmesh);
+    resolveSubmeshes(newShadows ? 0 : firstSubmesh);   // SF_SHADOWS zmienia wariant wszystkich
+    if (chunk.staged) {
+        // dane już w arenie (copyStaged), tylko je zaliczamy
+        vertexCount_ += chunk.stagedVertices;
+        indexCount_ += chunk.submesh.indexCount;
+    } else {
+        uploadGeometry(chunk.vertices, chunk.indices);
+    }
+    shadowGeometryDirty_ = true;   // kaskady przerysowujemy raz, w render()
+    geometryVersion_++;
+}
+
+void Renderer::addTexture(const std::string& path, const DecodedImage& img) {
+    if (textures_.count(path)) return;
+    GLuint tex = uploadTexture(path, img);
+    for (auto& [name, mat] : model_.materials) {
+        if (mat.mapKd == path) mat.glTex = tex;
+        if (mat.mapBump == path) mat.glBumpTex = tex;
+    }
+    resolveSubmeshes(0);   // z teksturą materiał przechodzi na pełny wariant
+}
+
+void Renderer::finishModel(const ObjLoadStats& stats) {
+    model_.stats = stats;
+    std::cout << "Shader variants: " << shaders_->size() << "\n";
+}
+
+GLuint Renderer::uploadTexture(const std::string& path, const DecodedImage& img) {
+    auto t0 = std::chrono::steady_clock::now();
+    GLuint tex = UploadTexture2D(img);
+    uploadStats_.textureUploadMs += MsSince(t0);
+    if (tex) uploadStats_.textures++;
+    textures_[path] = tex;
+    return tex;
+}
+
+void Renderer::includeBounds(const glm::vec3& mn, const glm::vec3& mx) {
+    boundsMin_ = glm::min(boundsMin_, mn);
+    boundsMax_ = glm::max(boundsMax_, mx);
+    center_ = (boundsMin_ + boundsMax_) * 0.5f;
+    radius_ = glm::length(boundsMax_ - boundsMin_) * 0.5f;
+    if (radius_ < 0.0001f) radius_ = 1.0f;
+}
+
+void Renderer::resolveSubmeshes(size_t first) {
+    const size_t n = model_.submeshes.size();
+    submeshMats_.resize(n);
+    submeshFeatures_.resize(n);
+    submeshShaders_.resize(n, nullptr);
+    submeshPages_.resize(n, Page::Resident);
+    for (size_t i = first; i < n; i++) {
+        auto it = model_.materials.find(model_.submeshes[i].materialName);
+        const Material* mat = (it != model_.materials.end()) ? &it->second : &fallbackMat_;
+        submeshMats_[i] = mat;
+        submeshFeatures_[i] = PickShaderFeatures(*mat);
+        shaders_->request(featuresFor(i));
+    }
+}
+
+void Renderer::reserveGeometry(uint32_t vertices, uint32_t indices) {
+    // Zakres modelu w GeometryArena. Cały model: zakres dokładnie na miarę.
+    // Doklejanie: przy braku miejsca zakres x2 (kopia na GPU).
+    if (modelGeometry_ == GeometryArena::kNoHandle) {
+        modelGeometry_ = geometry_->allocate(vertices, indices);
+    } else {
+        const GeometryArena::Range& r = geometry_->range(modelGeometry_);
+        if (vertices > r.vertexCount || indices > r.indexCount) {
+            geometry_->resize(modelGeometry_,
+                              vertices > r.vertexCount ? std::max(vertices, r.vertexCount * 2) : r.vertexCount,
+                              indices > r.indexCount ? std::max(indices, r.indexCount * 2) : r.indexCount);
+        }
+    }
+}
+
+void Renderer::expectGeometry(uint32_t vertices, uint32_t indices) {
+    vertices = std::max({vertices, vertexCount_, 1u});
+    indices = std::max({indices, indexCount_, 1u});
+    if (modelGeometry_ == GeometryArena::kNoHandle) {
+        modelGeometry_ = geometry_->allocate(vertices, indices);
+        return;
+    }
+    const GeometryArena::Range& r = geometry_->range(modelGeometry_);
+    if (vertices > r.vertexCount || indices > r.indexCount)
+        geometry_->resize(modelGeometry_, std::max(vertices, r.vertexCount), std::max(indices, r.indexCount));
+}
+
+void Renderer::addPlaceholders(const std::vector<SubMesh>& submeshes) {
+    PROFILE_ZONE("Renderer::addPlaceholders");
+    const size_t first = model_.submeshes.size();
+    for (SubMesh sm : submeshes) {
+        if (sm.boundsMin.x <= sm.boundsMax.x) includeBounds(sm.boundsMin, sm.boundsMax);
+        sm.indexOffset = indexCount_;
+        sm.indexCount = 0;   // nic do rysowania, dopóki nie przyjdzie pageGeometry
+        model_.submeshes.push_back(sm);
+    }
+    const bool newShadows = addShadowCasters(first);
+    resolveSubmeshes(newShadows ? 0 : first);
+    for (size_t i = first; i < model_.submeshes.size(); i++) submeshPages_[i] = Page::Missing;
+    missingPages_ += submeshes.size();
+    geometryVersion_++;
+}
+
+std::vector<uint32_t> Renderer::takePageRequests() {
+    std::vector<uint32_t> out;
+    out.swap(pageRequests_);
+    return out;
+}
+
+void Renderer::pageGeometry(uint32_t submesh, ObjChunk chunk) {
+    PROFILE_ZONE("Renderer::pageGeometry");
+    if (submesh >= model_.submeshes.size() || submeshPages_[submesh] == Page::Resident)
+        throw std::logic_error("Renderer::pageGeometry: submesh nie czeka na geometrie");
+    // indeksy kawałka liczą od 0, model od początku swojego zakresu
+    for (uint32_t& i : chunk.indices) i += vertexCount_;
+    SubMesh& sm = model_.submeshes[submesh];
+    sm.indexOffset = indexCount_;
+    sm.indexCount = (uint32_t)chunk.indices.size();
+    sm.boundsMin = chunk.submesh.boundsMin;
+    sm.boundsMax = chunk.submesh.boundsMax;
+    uploadGeometry(chunk.vertices, chunk.indices);
+    if (submesh < casters_.size()) {
+        ShadowCaster& c = casters_[submesh];
+        c.boundsMin = sm.boundsMin;
+        c.boundsMax = sm.boundsMax;
+        c.indexOffset = sm.indexOffset;
+        c.indexCount = sm.indexCount;
+    }
+    submeshPages_[submesh] = Page::Resident;
+    missingPages_--;
+    shadowGeometryDirty_ = true;
+    geometryVersion_++;
+}
+
+// AABB (przestrzeń modelu) przynajmniej częściowo w bryle widzenia mvp:
+// odrzucamy tylko, gdy wszystkie rogi leżą za jedną płaszczyzną
+static bool BoxInFrustum(const glm::mat4& mvp, const glm::vec3& mn, const glm::vec3& mx) {
+    glm::vec4 c[8];
+    for (int i = 0; i < 8; i++)
+        c[i] = mvp * glm::vec4(i & 1 ? mx.x : mn.x, i & 2 ? mx.y : mn.y, i & 4 ? mx.z : mn.z, 1.f);
+    for (int axis = 0; axis < 3; axis++) {
+        bool allBelow = true, allAbove = true;
+        for (const glm::vec4& p : c) {
+            allBelow = allBelow && p[axis] < -p.w;
+            allAbove = allAbove && p[axis] > p.w;
+        }
+        if (allBelow || allAbove) return false;
+    }
+    return true;
+}
+
+void Renderer::uploadGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    auto buffersStart = std::chrono::steady_clock::now();
+    PROFILE_ZONE("GeometryArena upload");
+    reserveGeometry(vertexCount_ + (uint32_t)vertices.size(), indexCount_ + (uint32_t)indices.size());
+    geometry_->uploadVertices(modelGeometry_, vertexCount_, vertices.data(), (uint32_t)vertices.size());
+    geometry_->uploadIndices(modelGeometry_, indexCount_, indices.data(), (uint32_t)indices.size());
+    vertexCount_ += (uint32_t)vertices.size();
+    indexCount_ += (uint32_t)indices.size();
+    uploadStats_.buffersMs += MsSince(buffersStart);
+}
+
+void Renderer::copyStaged(StagingBuffer& staging, const StagedRange& r) {
+    auto buffersStart = std::chrono::steady_clock::now();
+    PROFILE_ZONE("GeometryArena copy staged");
+    const uint32_t end = r.first + r.count;
+    if (r.indices) reserveGeometry(std::max(vertexCount_, 1u), end);
+    else reserveGeometry(end, std::max(indexCount_, 1u));
+    const GeometryArena::Range& g = geometry_->range(modelGeometry_);
+    if (r.indices) {
+        staging.copyTo(r.block, r.offset, geometry_->indexBuffer(),
+                       (GLintptr)(g.firstIndex + r.first) * sizeof(uint32_t), r.count * sizeof(uint32_t));
+    } else {
+        staging.copyTo(r.block, r.offset, geometry_->vertexBuffer(),
+                       (GLintptr)(g.firstVertex + r.first) * sizeof(Vertex), r.count * sizeof(Vertex));
+    }
+    if (r.lastInBlock) staging.retire(r.block);
+    uploadStats_.buffersMs += MsSince(buffersStart);
+}
+
+bool Renderer::addShadowCasters(size_t first) {
+    if (!settings_.shadows) return false;
+    const float distance = std::max(10.f, worldRadius() * 12.f);
+    bool created = false;
+    if (!shadows_) {
+        CascadedShadowMaps::Settings ss;
+        ss.maxDistance = distance;
+        shadows_ = std::make_unique<CascadedShadowMaps>(ss);
+        created = true;
+    } else if (distance > shadows_->maxDistance()) {
+        shadows_->setMaxDistance(distance);   // model urósł
+    }
+
+    const glm::mat4 world = glm::scale(glm::mat4(1.0f), glm::vec3(settings_.modelScale));
+    for (size_t i = first; i < model_.submeshes.size(); i++) {
+        const SubMesh& sm = model_.submeshes[i];
+        ShadowCaster c;
+        c.world = world;
+        c.boundsMin = sm.boundsMin;
+        c.boundsMax = sm.boundsMax;
+        c.indexOffset = sm.indexOffset;
+        c.indexCount = sm.indexCount;
+        casters_.push_back(c);
+    }
+    return created;
+}
+
+uint32_t Renderer::featuresFor(size_t submesh) const {
+    // SF_CLUSTERED / SF_SHADOWS dokładamy wszystkim wariantom
+    uint32_t f = submeshFeatures_[submesh];
+    if (settings_.lights > 0) f |= SF_CLUSTERED;
+    if (shadows_) f |= SF_SHADOWS;
+    return f;
+}
+
+void Renderer::update() {
+    PROFILE_ZONE("Renderer::update");
+    if (shaderWatcher_) {
+        for (const std::string& file : shaderWatcher_->poll()) {
+            if (shaders_->uses(file)) {
+                std::cout << "Shader reload: " << file << "\n";
+                shaders_->reload();
+                break;
+            }
+        }
+    }
+    shaders_->update();
+    if (!reportedShaderStats_ && !shaders_->compiling()) {
+        programCache_->printStats(std::cout);
+        reportedShaderStats_ = true;
+    }
+}
+
+void Renderer::waitForShaders() {
+    for (size_t i = 0; i < submeshFeatures_.size(); i++) shaders_->get(featuresFor(i));
+    update();
+}
+
+void Renderer::recordDraws(size_t begin, size_t end) {
+    if (begin == end || modelGeometry_ == GeometryArena::kNoHandle) return;   // same placeholdery
+    const unsigned slot = jobs_ ? jobs_->threadIndex() : 0;
+    // kawałek mógł podebrać obcy wątek czekający w wait() - ich bufor jest wspólny
+    std::unique_lock<std::mutex> lock(outsideRecord_, std::defer_lock);
+    if (jobs_ && slot == jobs_->workerCount() + 1) lock.lock();
+    CommandBuffer& cb = commands_.buffer(slot);
+    // indeksy modelu są lokalne: baseVertex przesuwa je na zakres w arenie
+    const GeometryArena::Range& geo = geometry_->range(modelGeometry_);
+    for (size_t i = begin; i < end; i++) {
+        const SubMesh& sm = model_.submeshes[i];
+        if (sm.indexCount == 0) continue;
+        const Material& mat = *submeshMats_[i];
+        const uint8_t variant = submeshSlots_[i];
+        const Shader* sh = usedShaders_[variant];
+        const MaterialUniforms& mu = materialUniforms_[variant];
+        const GLuint tex = (sh->features & SF_TEXTURE) ? mat.glTex : 0;
+        const GLuint bump = (sh->features & SF_NORMAL_MAP) ? mat.glBumpTex : 0;
+
+        // wariant, potem tekstury: sąsiednie elementy dzielą stan; na końcu
+        // indeks submesha, żeby kolejność nie zależała od podziału na wątki
+        const uint64_t key = ((uint64_t)variant << 56) | ((uint64_t)(tex & 0xFFFF) << 40) |
+                             ((uint64_t)(bump & 0xFFFF) << 24) | (uint64_t)(i & 0xFFFFFF);
+        cb.begin(key);
+        cb.useProgram(sh->id);
+        cb.uniform3f(mu.kd, mat.Kd);
+        if (sh->features & SF_SPECULAR) {
+            cb.uniform3f(mu.ks, mat.Ks);
+            cb.uniform1f(mu.ns, mat.Ns);
+        }
+        if (sh->features & SF_TEXTURE) cb.bindTexture(0, tex);
+        if (sh->features & SF_NORMAL_MAP) {
+            // bitangent z pochodnych v: przy v rosnącym w dół obrazu zielony kanał odwrotnie
+            cb.uniform2f(mu.bumpScale, glm::vec2(mat.bumpScale, mat.uvOriginTop ? -mat.bumpScale : mat.bumpScale));
+            cb.bindTexture(1, bump);
+        }
+        cb.drawElements(sm.indexCount, geo.firstIndex + sm.indexOffset, (int32_t)geo.firstVertex, (uint32_t)i);
+        cb.end();
+    }
+}
+
+void Renderer::render(const FrameParams& f) {
+    PROFILE_ZONE("Renderer::render");
+    if (profiler_) profiler_->beginFrame();
+
+    if (shadows_ && modelGeometry_ != GeometryArena::kNoHandle &&
+        (shadowGeometryDirty_ || shadowLayout_ != geometry_->layoutVersion())) {
+        const GeometryArena::Range& r = geometry_->range(modelGeometry_);
+        shadows_->setGeometry(geometry_->vao(), r.firstIndex, (int32_t)r.firstVertex);
+        shadowGeometryDirty_ = false;
+        shadowLayout_ = geometry_->layoutVersion();
+    }
+
+    usedShaders_.clear();
+    submeshSlots_.resize(submeshFeatures_.size());
+    for (size_t i = 0; i < submeshFeatures_.size(); i++) {
+        Shader* sh = &shaders_->resolve(featuresFor(i));
+        submeshShaders_[i] = sh;
+        auto it = std::find(usedShaders_.begin(), usedShaders_.end(), sh);
+        submeshSlots_[i] = (uint8_t)(it - usedShaders_.begin());
+        if (it == usedShaders_.end()) usedShaders_.push_back(sh);
+    }
+
+    {
+        GpuScope scope(profiler_, "clear");
+        glViewport(0, 0, f.width, f.height);
+        glClearColor(0.08f, 0.09f, 0.10f, 1.f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    glm::mat4 modelM(1.0f);
+    // jeśli model jest gigantyczny/mały, możesz przeskalować:
+    modelM = glm::scale(modelM, glm::vec3(settings_.modelScale));
+
+    float aspect = (float)f.width / (float)f.height;
+    glm::mat4 proj = glm::perspective(glm::radians(f.fovDeg), aspect, kNear, kFar);
+
+    if (missingPages_) {
+        // submeshe na dysku, które kamera właśnie widzi - do doczytania
+        const glm::mat4 mvp = proj * f.view * modelM;
+        for (size_t i = 0; i < submeshPages_.size(); i++) {
+            if (submeshPages_[i] != Page::Missing) continue;
+            const SubMesh& sm = model_.submeshes[i];
+            if (sm.boundsMin.x <= sm.boundsMax.x && !BoxInFrustum(mvp, sm.boundsMin, sm.boundsMax)) continue;
+            submeshPages_[i] = Page::Requested;
+            pageRequests_.push_back((uint32_t)i);
+        }
+    }
+
+    if (shadows_) {
+        PROFILE_ZONE("shadows");
+        GpuScope scope(profiler_, "shadows");
+        shadows_->update(f.view, glm::radians(f.fovDeg), aspect, kNear, sunDir_, casters_);
+        shadows_->bindTexture();
+        if (profiler_) profiler_->count(shadows_->castersDrawn(), shadows_->trianglesDrawn(), shadows_->stateChanges() + 1);
+    }
+
+    if (settings_.lights > 0) {
+        PROFILE_ZONE("light assignment");
+        GpuScope scope(profiler_, "lights");
+        MakeDemoLights(lights_, settings_.lights, worldCenter(), worldRadius(), f.time);
+        clustered_->update(lights_, f.view, proj, kNear, kFar, jobs_);
+        clustered_->bindTextures();
+        if (profiler_) profiler_->count(0, 0, 3);   // trzy buffer texture
+    }
+
+    GpuScope mainScope(profiler_, "main");
+
+    // wspólne dane klatki: jeden blok w pierścieniu zamiast glUniform na wariant;
+    // reszta (samplery, cienie, światła) raz na każdy użyty wariant
+    {
+        PROFILE_ZONE("uniform setup");
+        frameRing_->beginFrame();
+        FrameUniforms fu;
+        fu.model = modelM;
+        fu.view = f.view;
+        fu.proj = proj;
+        fu.viewPos = glm::vec4(f.camPos, 0.f);
+        fu.lightDir = glm::vec4(sunDir_, 0.f);
+        fu.lightColor = glm::vec4(1.f);
+        frameRing_->bind(kFrameDataBinding, frameRing_->push(fu));
+
+        materialUniforms_.resize(usedShaders_.size());
+        for (size_t variant = 0; variant < usedShaders_.size(); variant++) {
+            Shader* sh = usedShaders_[variant];
+            sh->use();
+            const GLuint block = glGetUniformBlockIndex(sh->id, "FrameData");
+            if (block != GL_INVALID_INDEX) glUniformBlockBinding(sh->id, block, kFrameDataBinding);
+            sh->setInt("uDiffuse", 0);
+            sh->setInt("uNormalMap", 1);
+            if (sh->features & SF_CLUSTERED) clustered_->setUniforms(*sh, f.width, f.height);
+            if (sh->features & SF_SHADOWS) shadows_->setUniforms(*sh);
+
+            MaterialUniforms& mu = materialUniforms_[variant];
+            mu.kd = glGetUniformLocation(sh->id, "uMat.Kd");
+            mu.ks = glGetUniformLocation(sh->id, "uMat.Ks");
+            mu.ns = glGetUniformLocation(sh->id, "uMat.Ns");
+            mu.bumpScale = glGetUniformLocation(sh->id, "uBumpScale");
+        }
+    }
+
+    // Nagranie komend: kawałki submeshy na wątkach puli, każdy do bufora
+    // swojego wątku. Bez kolejki main - zadanie main (np. nowy model) w
+    // środku klatki podmieniłoby dane, które właśnie czytamy.
+    {
+        PROFILE_ZONE("record draws");
+        const size_t n = model_.submeshes.size();
+        commands_.reset(jobs_ ? jobs_->threadSlots() : 1);
+        if (jobs_) jobs_->parallelFor(0, n, kRecordGrain, [this](size_t b, size_t e) { recordDraws(b, e); }, false);
+        else recordDraws(0, n);
+        commands_.sort();
+    }
+
+    PROFILE_ZONE("draw submission");
+    glBindVertexArray(geometry_->vao());
+    if (profiler_) profiler_->count(0, 0, (uint32_t)usedShaders_.size() + 1);
+
+    replayStats_ = commands_.replay([this](const Command& c, uint32_t stateChanges) {
+        const SubMesh& sm = model_.submeshes[c.draw.tag];
+        GpuScope drawScope(profiler_ && profiler_->perDraw() ? profiler_ : nullptr, sm.materialName);
+        glDrawElementsBaseVertex(GL_TRIANGLES,
+                                 (GLsizei)c.draw.count,
+                                 GL_UNSIGNED_INT,
+                                 (void*)(uintptr_t)(c.draw.firstIndex * sizeof(uint32_t)),
+                                 (GLint)c.draw.baseVertex);
+        // liczniki idą do wszystkich otwartych zakresów: "main" i ewentualnie submesha
+        if (profiler_) profiler_->count(1, c.draw.count / 3, stateChanges);
+    });
+
+    glBindVertexArray(0);
+    frameRing_->endFrame();
+
+    mainScope.close();
+    if (profiler_) profiler_->endFrame();
+}
@@ -0,0 +1,184 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+#include "Shader.h"
+#include "ProgramBinaryCache.h"
+#include "FileWatcher.h"
+#include "Lighting.h"
+#include "ShadowMaps.h"
+#include "GpuProfiler.h"
+#include "Texture.h"
+#include "CommandBuffer.h"
+#include "UploadRing.h"
+#include "GeometryArena.h"
+#include "StagingBuffer.h"
+
+class JobSystem;
+
+struct RenderSettings {
+    size_t lights = 0;         // animowane światła punktowe/spot (clustered)
+    bool shadows = true;
+    bool hotReload = true;     // obserwuj shaders/
+    float modelScale = 0.02f;  // model z Blendera jest ogromny
+    std::string shaderCacheDir = "shader_cache";
+};
+
+// Czasy kroków setModel (raport startu)
+struct ModelUploadStats {
+    size_t textures = 0;
+    double textureDecodeMs = 0.0;
+    double textureUploadMs = 0.0;
+    double buffersMs = 0.0;    // upload do GeometryArena
+    double shadowsMs = 0.0;    // strumień pozycji i castery
+};
+
+struct FrameParams {
+    glm::mat4 view{1.f};
+    glm::vec3 camPos{0.f};
+    float fovDeg = 60.f;
+    int width = 1280, height = 720;
+    float time = 0.f;
+};
+
+// Wszystko, co rysuje scenę: warianty shaderów, bufory modelu, tekstury,
+// światła i cienie. Nie wie nic o oknie - rysuje do aktualnie zbindowanego
+// framebuffera, więc tak samo działa z oknem i offscreen (benchmark).
+class Renderer {
+public:
+    static constexpr float kNear = 0.05f;
+    static constexpr float kFar = 500.f;
+
+    // Wymaga aktywnego kontekstu GL (po gladLoadGLLoader i LoadGLExtensions)
+    explicit Renderer(const RenderSettings& s);
+    ~Renderer();
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // Tekstury, zakres w GeometryArena, castery cieni i zlecenie kompilacji wariantów.
+    // Wierzchołki i indeksy po wysłaniu znikają z model() (zostają stats.vertices/indices).
+    // Obrazy z decoded (jeśli są) tylko wysyłamy, resztę dekodujemy tutaj.
+    void setModel(LoadedModel m, const DecodedTextures* decoded = nullptr);
+
+    // Ładowanie przyrostowe (AssetStreamer): submeshe, materiały i tekstury
+    // dochodzą w dowolnej kolejności, brakujące rysujemy zapasowo. Geometria
+    // tylko po kolei (ObjChunk::firstVertex == dotychczasowa liczba wierzchołków).
+    void clearModel();
+    void addMaterials(MaterialMap mats);
+    void addGeometry(ObjChunk chunk);
+    // Wierzchołki/indeksy z bloku staging prosto do areny (kopia na GPU);
+    // potem addGeometry z ObjChunk::stagedVertices zalicza je do modelu
+    void copyStaged(StagingBuffer& staging, const StagedRange& r);
+    // Zapowiedziany rozmiar modelu: zakres w arenie od razu na tę miarę
+    // (bez kolejnych powiększeń x2 w trakcie wczytywania)
+    void expectGeometry(uint32_t vertices, uint32_t indices);
+
+    // Stronicowanie (ObjLazyModel): submeshe bez geometrii, tylko materiał i
+    // zachowawczy AABB. render() zbiera te, które wpadają w frustum kamery;
+    // wołający odbiera je takePageRequests() i oddaje geometrię pageGeometry()
+    // (indeksy od 0, doklejane na koniec zakresu modelu).
+    void addPlaceholders(const std::vector<SubMesh>& submeshes);
+    std::vector<uint32_t> takePageRequests();
+    void pageGeometry(uint32_t submesh, ObjChunk chunk);
+    size_t missingPages() const { return missingPages_; }
+    void addTexture(const std::string& path, const DecodedImage& img);
+    void finishModel(const ObjLoadStats& stats);
+    // Rośnie przy każdej zmianie geometrii (np. żeby dopasować kamerę)
+    uint32_t geometryVersion() const { return geometryVersion_; }
+
+    void setLightCount(size_t n) { settings_.lights = n; }
+    size_t lightCount() const { return settings_.lights; }
+    bool shadowsEnabled() const { return shadows_ != nullptr; }
+
+    // Opcjonalny profiler (nullptr = wyłączony); render() otwiera i zamyka w nim klatkę
+    void setProfiler(GpuProfiler* p) { profiler_ = p; }
+    // Opcjonalna pula (nullptr = jeden wątek): komendy rysowania nagrywane
+    // równolegle, po kawałkach submeshy. Musi żyć dłużej niż render().
+    void setJobSystem(JobSystem* jobs) { jobs_ = jobs; }
+
+    // Raz na klatkę: hot reload i odbiór skończonych kompilacji
+    void update();
+    // Czeka aż wszystkie potrzebne warianty będą gotowe (benchmarki)
+    void waitForShaders();
+
+    void render(const FrameParams& f);
+
+    const LoadedModel& model() const { return model_; }
+    const ModelUploadStats& uploadStats() const { return uploadStats_; }
+    const ReplayStats& replayStats() const { return replayStats_; }   // ostatnia klatka
+    const UploadRing& frameRing() const { return *frameRing_; }
+    const GeometryArena& geometry() const { return *geometry_; }
+    glm::vec3 worldCenter() const { return center_ * settings_.modelScale; }
+    float worldRadius() const { return radius_ * settings_.modelScale; }
+    const ClusteredLighting& lighting() const { return *clustered_; }
+    ProgramBinaryCache& programCache() { return *programCache_; }
+    ShaderCache& shaders() { return *shaders_; }
+
+private:
+    uint32_t featuresFor(size_t submesh) const;
+    GLuint uploadTexture(const std::string& path, const DecodedImage& img);
+    void includeBounds(const glm::vec3& mn, const glm::vec3& mx);
+    void resolveSubmeshes(size_t first);   // materiał + wariant od submesha first
+    void reserveGeometry(uint32_t vertices, uint32_t indices);   // pojemność zakresu modelu
+    void uploadGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);   // doklejenie
+    bool addShadowCasters(size_t first);   // true = cienie dopiero powstały
+    void recordDraws(size_t begin, size_t end);   // dowolny wątek, bez GL
+
+    RenderSettings settings_;
+    std::unique_ptr<ProgramBinaryCache> programCache_;
+    std::unique_ptr<ShaderCache> shaders_;
+    std::unique_ptr<FileWatcher> shaderWatcher_;
+    bool reportedShaderStats_ = false;
+    GpuProfiler* profiler_ = nullptr;
+    JobSystem* jobs_ = nullptr;
+
+    LoadedModel model_;
+    std::unordered_map<std::string, GLuint> textures_;   // ścieżka -> tekstura (współdzielona przez materiały)
+    glm::vec3 boundsMin_{1e30f}, boundsMax_{-1e30f};
+    glm::vec3 center_{0.f};
+    float radius_ = 1.f;
+    uint32_t geometryVersion_ = 0;
+    // wspólne VBO/EBO/VAO; model to jeden zakres, przy doklejaniu rośnie x2
+    std::unique_ptr<GeometryArena> geometry_;
+    GeometryArena::Handle modelGeometry_ = GeometryArena::kNoHandle;
+    uint32_t vertexCount_ = 0, indexCount_ = 0;         // wysłane do areny (model_ ich nie trzyma)
+    enum class Page : uint8_t { Resident, Missing, Requested };
+    std::vector<Page> submeshPages_;                     // równolegle do model_.submeshes
+    std::vector<uint32_t> pageRequests_;
+    size_t missingPages_ = 0;                            // Missing + Requested
+    bool shadowGeometryDirty_ = false;
+    uint32_t shadowLayout_ = 0;                         // layoutVersion() areny widziany przez cienie
+    ModelUploadStats uploadStats_;
+
+    Material fallbackMat_{};
+    std::vector<const Material*> submeshMats_;
+    std::vector<uint32_t> submeshFeatures_;   // tylko cechy materiału
+    std::vector<Shader*> submeshShaders_;     // rozwiązane w tej klatce
+    std::vector<Shader*> usedShaders_;
+    std::vector<uint8_t> submeshSlots_;       // indeks wariantu w usedShaders_
+
+    // lokacje uniformów materiału w usedShaders_[i] (nagrywanie nie woła GL)
+    struct MaterialUniforms {
+        GLint kd = -1, ks = -1, ns = -1, bumpScale = -1;
+    };
+    std::vector<MaterialUniforms> materialUniforms_;
+    CommandList commands_;
+    std::mutex outsideRecord_;   // wspólny bufor komend wątków spoza puli (JobSystem::threadIndex)
+    ReplayStats replayStats_;
+
+    std::unique_ptr<UploadRing> frameRing_;   // blok FrameData co klatkę
+
+    std::unique_ptr<ClusteredLighting> clustered_;
+    std::vector<Light> lights_;
+
+    std::unique_ptr<CascadedShadowMaps> shadows_;
+    std::vector<ShadowCaster> casters_;
+    glm::vec3 sunDir_{0.f, -1.f, 0.f};
+};
@@ -3,11 +3,21 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <filesystem>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "GLExt.h"
+#include "ProgramBinaryCache.h"
+
 static inline std::string ReadTextFile(const std::string& path) {
     std::ifstream f(path);
     if (!f) throw std::runtime_error("Nie moge otworzyc pliku: " + path);
@@ -16,32 +26,120 @@ static inline std::string ReadTextFile(const std::string& path) {
     return ss.str();
 }
 
+// Cechy wariantu shadera -> każda bitem zamienia się w #define w źródle
+enum ShaderFeature : uint32_t {
+    SF_NONE       = 0,
+    SF_TEXTURE    = 1u << 0, // HAS_TEXTURE    - próbkuje uDiffuse zamiast uMat.Kd
+    SF_SPECULAR   = 1u << 1, // HAS_SPECULAR   - liczy Phonga (Ks != 0)
+    SF_NORMAL_MAP = 1u << 2, // HAS_NORMAL_MAP - uNormalMap (map_Bump)
+    SF_INSTANCED  = 1u << 3, // INSTANCED      - macierz modelu z atrybutu 3..6
+    SF_QUANTIZED  = 1u << 4, // QUANTIZED      - pozycje znormalizowane + uQuantScale/uQuantOffset
+    SF_CLUSTERED  = 1u << 5, // CLUSTERED_LIGHTS - światła punktowe/spot z ClusteredLighting
+    SF_SHADOWS    = 1u << 6, // HAS_SHADOWS    - cascaded shadow maps światła kierunkowego
+};
+
+static inline std::string ShaderDefines(uint32_t features) {
+    std::string d;
+    if (features & SF_TEXTURE)    d += "#define HAS_TEXTURE\n";
+    if (features & SF_SPECULAR)   d += "#define HAS_SPECULAR\n";
+    if (features & SF_NORMAL_MAP) d += "#define HAS_NORMAL_MAP\n";
+    if (features & SF_INSTANCED)  d += "#define INSTANCED\n";
+    if (features & SF_QUANTIZED)  d += "#define QUANTIZED\n";
+    if (features & SF_CLUSTERED)  d += "#define CLUSTERED_LIGHTS\n";
+    if (features & SF_SHADOWS)    d += "#define HAS_SHADOWS\n";
+    return d;
+}
+
+// #version musi zostać pierwszą linią, więc define'y wstawiamy zaraz za nią
+static inline std::string InjectDefines(const std::string& src, const std::string& defines) {
+    if (defines.empty()) return src;
+    size_t v = src.find("#version");
+    if (v == std::string::npos) return defines + src;
+    size_t eol = src.find('\n', v);
+    if (eol == std::string::npos) return src + "\n" + defines;
+    return src.substr(0, eol + 1) + defines + src.substr(eol + 1);
+}
+
+struct ShaderSource {
+    std::string vs;
+    std::string fs;
+};
+
+enum class ShaderStatus { Compiling, Ready, Failed };
+
+// Tag dla konstruktora, który tylko wysyła kompilację i nie czeka na wynik
+struct ShaderAsync {};
+
 class Shader {
 public:
     GLuint id = 0;
+    uint32_t features = SF_NONE;
+    ShaderStatus status = ShaderStatus::Compiling;
+    std::string log;   // błąd kompilacji/linkowania gdy status == Failed
 
-    Shader(const std::string& vsPath, const std::string& fsPath) {
-        std::string vsSrc = ReadTextFile(vsPath);
-        std::string fsSrc = ReadTextFile(fsPath);
+    Shader(const std::string& vsPath, const std::string& fsPath, uint32_t features = SF_NONE,
+           ProgramBinaryCache* binCache = nullptr)
+        : Shader(ShaderSource{ReadTextFile(vsPath), ReadTextFile(fsPath)}, features, binCache) {}
 
-        GLuint vs = compile(GL_VERTEX_SHADER, vsSrc.c_str());
-        GLuint fs = compile(GL_FRAGMENT_SHADER, fsSrc.c_str());
+    // Synchronicznie, jak dawniej: czeka na sterownik i rzuca przy błędzie
+    explicit Shader(const ShaderSource& src, uint32_t features = SF_NONE,
+                    ProgramBinaryCache* binCache = nullptr)
+        : Shader(src, features, binCache, ShaderAsync{}) {
+        finish();
+        if (status == ShaderStatus::Failed) throw std::runtime_error(log);
+    }
+
+    // Asynchronicznie: glCompileShader/glLinkProgram bez pytania o status.
+    // Z GL_KHR_parallel_shader_compile sterownik kompiluje w swoich wątkach,
+    // a poll() tylko sprawdza GL_COMPLETION_STATUS_KHR.
+    Shader(const ShaderSource& src, uint32_t features, ProgramBinaryCache* binCache, ShaderAsync)
+        : features(features), binCache(binCache) {
+        std::string defines = ShaderDefines(features);
+        std::string vsSrc = InjectDefines(src.vs, defines);
+        std::string fsSrc = InjectDefines(src.fs, defines);
+
+        if (binCache) {
+            binKey = binCache->key(vsSrc, fsSrc);
+            id = binCache->load(binKey);
+            if (id) { status = ShaderStatus::Ready; return; }
+        }
+        t0 = std::chrono::steady_clock::now();
+
+        vs = compile(GL_VERTEX_SHADER, vsSrc.c_str());
+        fs = compile(GL_FRAGMENT_SHADER, fsSrc.c_str());
 
         id = glCreateProgram();
         glAttachShader(id, vs);
         glAttachShader(id, fs);
+        if (binCache) binCache->prepareForLink(id);
         glLinkProgram(id);
+    }
 
-        GLint ok = 0;
-        glGetProgramiv(id, GL_LINK_STATUS, &ok);
-        if (!ok) {
-            char log[2048];
-            glGetProgramInfoLog(id, 2048, nullptr, log);
-            throw std::runtime_error(std::string("Shader link error: ") + log);
+    ~Shader() {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        if (id) glDeleteProgram(id);
+    }
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    bool ready() const { return status == ShaderStatus::Ready; }
+
+    // true gdy kompilacja się skończyła (Ready albo Failed). Bez rozszerzenia
+    // pytanie o GL_LINK_STATUS blokuje, więc ShaderCache woła to z budżetem.
+    bool poll() {
+        if (status != ShaderStatus::Compiling) return true;
+        if (gExt.parallelShaderCompile) {
+            GLint done = 0;
+            glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done) return false;
         }
+        complete();
+        return true;
+    }
 
-        glDeleteShader(vs);
-        glDeleteShader(fs);
+    void finish() {
+        if (status == ShaderStatus::Compiling) complete();
     }
 
     void use() const { glUseProgram(id); }
@@ -52,6 +150,9 @@ public:
     void setVec3(const char* name, const glm::vec3& v) const {
         glUniform3fv(glGetUniformLocation(id, name), 1, glm::value_ptr(v));
     }
+    void setVec4(const char* name, const glm::vec4& v) const {
+        glUniform4fv(glGetUniformLocation(id, name), 1, glm::value_ptr(v));
+    }
     void setFloat(const char* name, float v) const {
         glUniform1f(glGetUniformLocation(id, name), v);
     }
@@ -60,18 +161,160 @@ public:
     }
 
 private:
+    ProgramBinaryCache* binCache = nullptr;
+    uint64_t binKey = 0;
+    GLuint vs = 0, fs = 0;
+    std::chrono::steady_clock::time_point t0;
+
     static GLuint compile(GLenum type, const char* src) {
         GLuint s = glCreateShader(type);
         glShaderSource(s, 1, &src, nullptr);
         glCompileShader(s);
+        return s;
+    }
 
+    static std::string shaderLog(GLuint s, const char* what) {
         GLint ok = 0;
         glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+        if (ok) return "";
+        char buf[2048];
+        glGetShaderInfoLog(s, 2048, nullptr, buf);
+        return std::string("Shader compile error (") + what + "): " + buf;
+    }
+
+    void complete() {
+        GLint ok = 0;
+        glGetProgramiv(id, GL_LINK_STATUS, &ok);
         if (!ok) {
-            char log[2048];
-            glGetShaderInfoLog(s, 2048, nullptr, log);
-            throw std::runtime_error(std::string("Shader compile error: ") + log);
+            log = shaderLog(vs, "vert") + shaderLog(fs, "frag");
+            if (log.empty()) {
+                char buf[2048];
+                glGetProgramInfoLog(id, 2048, nullptr, buf);
+                log = std::string("Shader link error: ") + buf;
+            }
+            status = ShaderStatus::Failed;
+        } else {
+            status = ShaderStatus::Ready;
         }
-        return s;
+
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+        vs = fs = 0;
+
+        // czas od wysłania do gotowości (przy kompilacji równoległej to górne oszacowanie)
+        if (binCache && ok) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            binCache->store(binKey, id, ms);
+        }
+    }
+};
+
+// Warianty jednej pary vert/frag. Każdy wariant kompiluje się w tle; dopóki nie
+// jest gotowy, resolve() zwraca prosty wariant zapasowy (SF_NONE, kompilowany od razu).
+// reload() przebudowuje wszystkie warianty, a stare programy działają aż nowe będą gotowe.
+class ShaderCache {
+public:
+    ShaderCache(const std::string& vsPath, const std::string& fsPath, ProgramBinaryCache* binCache = nullptr)
+        : vsPath(vsPath), fsPath(fsPath), src{ReadTextFile(vsPath), ReadTextFile(fsPath)}, binCache(binCache) {
+        fallbackShader = std::make_unique<Shader>(src, SF_NONE, binCache);
     }
+
+    // Zleca kompilację wariantu (jeśli jeszcze nie ma) bez czekania
+    void request(uint32_t features) {
+        if (variants.count(features)) return;
+        Variant v;
+        v.pending = std::make_unique<Shader>(src, features, binCache, ShaderAsync{});
+        variants.emplace(features, std::move(v));
+    }
+
+    // Gotowy wariant albo zapasowy, nigdy nie blokuje
+    Shader& resolve(uint32_t features) {
+        auto it = variants.find(features);
+        if (it == variants.end()) { request(features); return *fallbackShader; }
+        return it->second.live ? *it->second.live : *fallbackShader;
+    }
+
+    // Synchronicznie (np. benchmark albo narzędzia)
+    Shader& get(uint32_t features) {
+        request(features);
+        Variant& v = variants[features];
+        if (v.pending) {
+            v.pending->finish();
+            promote(features, v);
+        }
+        if (!v.live) throw std::runtime_error("Wariant shadera nie skompilowal sie: " + std::to_string(features));
+        return *v.live;
+    }
+
+    // Raz na klatkę: odbiera skończone kompilacje. Bez GL_KHR_parallel_shader_compile
+    // sprawdzenie statusu blokuje, więc kończymy najwyżej maxBlockingPerFrame programów.
+    void update(int maxBlockingPerFrame = 1) {
+        int blocking = 0;
+        auto mayPoll = [&]() {
+            if (gExt.parallelShaderCompile) return true;
+            if (blocking >= maxBlockingPerFrame) return false;
+            blocking++;
+            return true;
+        };
+
+        if (fallbackPending && mayPoll() && fallbackPending->poll()) {
+            if (fallbackPending->ready()) fallbackShader = std::move(fallbackPending);
+            else std::cerr << "Fallback shader failed:\n" << fallbackPending->log << "\n";
+            fallbackPending.reset();
+        }
+        for (auto& [features, v] : variants) {
+            if (v.pending && mayPoll() && v.pending->poll()) promote(features, v);
+        }
+    }
+
+    // Ponowne wczytanie źródeł i przebudowa wszystkich wariantów w tle
+    void reload() {
+        ShaderSource fresh;
+        try {
+            fresh = ShaderSource{ReadTextFile(vsPath), ReadTextFile(fsPath)};
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return;
+        }
+        src = std::move(fresh);
+        for (auto& [features, v] : variants)
+            v.pending = std::make_unique<Shader>(src, features, binCache, ShaderAsync{});
+        fallbackPending = std::make_unique<Shader>(src, SF_NONE, binCache, ShaderAsync{});
+    }
+
+    bool uses(const std::string& fileName) const {
+        return std::filesystem::path(vsPath).filename() == fileName ||
+               std::filesystem::path(fsPath).filename() == fileName;
+    }
+
+    bool compiling() const {
+        for (const auto& [features, v] : variants) if (v.pending) return true;
+        return false;
+    }
+
+    Shader& fallback() { return *fallbackShader; }
+    size_t size() const { return variants.size(); }
+
+private:
+    struct Variant {
+        std::unique_ptr<Shader> live;
+        std::unique_ptr<Shader> pending;
+    };
+
+    void promote(uint32_t features, Variant& v) {
+        if (v.pending->ready()) {
+            v.live = std::move(v.pending);
+        } else {
+            // zły shader po edycji nie może wywrócić programu: zostaje stara wersja
+            std::cerr << "Shader variant " << features << " failed:\n" << v.pending->log << "\n";
+            v.pending.reset();
+        }
+    }
+
+    std::string vsPath, fsPath;
+    ShaderSource src;
+    ProgramBinaryCache* binCache = nullptr;
+    std::unique_ptr<Shader> fallbackShader;
+    std::unique_ptr<Shader> fallbackPending;
+    std::unordered_map<uint32_t, Variant> variants;
 };
@@ -0,0 +1,227 @@
+﻿#include "ShadowMaps.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+uint64_t HashMix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+uint64_t FloatBits(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+struct LightBox {   // AABB castera w przestrzeni światła
+    glm::vec3 mn, mx;
+};
+
+} // namespace
+
+CascadedShadowMaps::CascadedShadowMaps(const Settings& s, int textureUnit) : settings_(s), unit_(textureUnit) {
+    settings_.cascades = std::clamp(settings_.cascades, 1, kMaxCascades);
+
+    glGenTextures(1, &depthTex_);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthTex_);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, settings_.size, settings_.size,
+                 settings_.cascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    depthShader_ = std::make_unique<Shader>("shaders/shadow.vert", "shaders/shadow.frag");
+}
+
+CascadedShadowMaps::~CascadedShadowMaps() {
+    glDeleteTextures(1, &depthTex_);
+    glDeleteFramebuffers(1, &fbo_);
+}
+
+void CascadedShadowMaps::setGeometry(GLuint vao, uint32_t firstIndex, int32_t baseVertex) {
+    vao_ = vao;
+    firstIndex_ = firstIndex;
+    baseVertex_ = baseVertex;
+
+    // nowa geometria = wszystkie kaskady do przerysowania
+    for (Cascade& c : cascades_) c.key = 0;
+}
+
+void CascadedShadowMaps::setMaxDistance(float d) {
+    settings_.maxDistance = d;
+    for (Cascade& c : cascades_) c.key = 0;
+}
+
+void CascadedShadowMaps::update(const glm::mat4& view, float fovY, float aspect, float zNear,
+                                const glm::vec3& lightDir, const std::vector<ShadowCaster>& casters) {
+    rendered_ = 0;
+    drawn_ = 0;
+    triangles_ = 0;
+    stateChanges_ = 0;
+    if (!vao_) return;
+
+    glm::mat4 invView = glm::inverse(view);
+    glm::vec3 camPos = glm::vec3(invView[3]);
+    glm::vec3 camFwd = -glm::normalize(glm::vec3(invView[2]));
+
+    glm::vec3 L = glm::normalize(lightDir);
+    glm::vec3 up = std::abs(L.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    glm::mat4 lightRot = glm::lookAt(glm::vec3(0.f), L, up);
+
+    // AABB casterów w przestrzeni światła liczymy raz, a nie na kaskadę
+    std::vector<LightBox> boxes(casters.size());
+    for (size_t i = 0; i < casters.size(); i++) {
+        const ShadowCaster& c = casters[i];
+        glm::mat4 m = lightRot * c.world;
+        glm::vec3 mn(1e30f), mx(-1e30f);
+        for (int k = 0; k < 8; k++) {
+            glm::vec3 p((k & 1) ? c.boundsMax.x : c.boundsMin.x,
+                        (k & 2) ? c.boundsMax.y : c.boundsMin.y,
+                        (k & 4) ? c.boundsMax.z : c.boundsMin.z);
+            glm::vec3 q = glm::vec3(m * glm::vec4(p, 1.f));
+            mn = glm::min(mn, q);
+            mx = glm::max(mx, q);
+        }
+        boxes[i] = {mn, mx};
+    }
+
+    const float tanHalf = std::tan(fovY * 0.5f);
+    const float k = tanHalf * tanHalf * (1.f + aspect * aspect);
+    const float zFar = settings_.maxDistance;
+    const int n = settings_.cascades;
+    float splitNear = zNear;
+    GLint prevFbo = 0;
+    GLint prevViewport[4] = {0, 0, 0, 0};
+
+    for (int ci = 0; ci < n; ci++) {
+        Cascade& cas = cascades_[ci];
+
+        // podział "practical split scheme": mieszanka logarytmicznego i liniowego
+        float t = (float)(ci + 1) / n;
+        float logSplit = zNear * std::pow(zFar / zNear, t);
+        float linSplit = zNear + (zFar - zNear) * t;
+        float splitFar = settings_.splitLambda * logSplit + (1.f - settings_.splitLambda) * linSplit;
+        cas.splitFar = splitFar;
+
+        // sfera otaczająca wycinek frustum; promień zależy tylko od podziału,
+        // więc obrót kamery nie zmienia rozmiaru texela (brak migotania)
+        float dc = std::min(splitFar, (splitFar + splitNear) * (1.f + k) * 0.5f);
+        float radius = std::sqrt((splitFar - dc) * (splitFar - dc) + splitFar * splitFar * k);
+        radius = std::ceil(radius * 16.f) / 16.f;
+        glm::vec3 center = camPos + camFwd * dc;
+        splitNear = splitFar;
+
+        // środek przyciągnięty do siatki texeli mapy
+        float texel = 2.f * radius / settings_.size;
+        glm::vec3 cLS = glm::vec3(lightRot * glm::vec4(center, 1.f));
+        int64_t sx = (int64_t)std::floor(cLS.x / texel);
+        int64_t sy = (int64_t)std::floor(cLS.y / texel);
+        int64_t sz = (int64_t)std::floor(cLS.z / texel);
+        float x = sx * texel, y = sy * texel, z = sz * texel;
+
+        // castery: przecięcie w XY i nie całkiem za pudełkiem (bliżej światła = większe z)
+        visible_.clear();
+        float nearZ = z + radius;
+        uint64_t key = 1469598103934665603ull;
+        for (size_t i = 0; i < casters.size(); i++) {
+            const LightBox& b = boxes[i];
+            if (b.mx.x < x - radius || b.mn.x > x + radius) continue;
+            if (b.mx.y < y - radius || b.mn.y > y + radius) continue;
+            if (b.mx.z < z - radius) continue;
+            visible_.push_back((uint32_t)i);
+            nearZ = std::max(nearZ, b.mx.z);
+            key = HashMix(key, i);
+            key = HashMix(key, casters[i].version);
+        }
+        key = HashMix(key, FloatBits(L.x));
+        key = HashMix(key, FloatBits(L.y));
+        key = HashMix(key, FloatBits(L.z));
+        key = HashMix(key, FloatBits(radius));
+        key = HashMix(key, (uint64_t)sx);
+        key = HashMix(key, (uint64_t)sy);
+        key = HashMix(key, (uint64_t)sz);
+        key = HashMix(key, FloatBits(nearZ));
+        if (key == 0) key = 1;
+
+        if (key == cas.key) continue;   // nic się nie zmieniło -> stara mapa jest dobra
+        cas.key = key;
+
+        glm::mat4 lightProj = glm::ortho(x - radius, x + radius, y - radius, y + radius,
+                                         -nearZ, -(z - radius));
+        cas.lightViewProj = lightProj * lightRot;
+
+        if (rendered_ == 0) {
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+            glGetIntegerv(GL_VIEWPORT, prevViewport);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+            glViewport(0, 0, settings_.size, settings_.size);
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(2.f, 4.f);
+            depthShader_->use();
+            glBindVertexArray(vao_);
+            stateChanges_ += 3;   // FBO, program, VAO
+        }
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTex_, 0, ci);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        stateChanges_++;          // warstwa tablicy
+
+        for (uint32_t i : visible_) {
+            const ShadowCaster& c = casters[i];
+            depthShader_->setMat4("uLightMVP", cas.lightViewProj * c.world);
+            glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)c.indexCount, GL_UNSIGNED_INT,
+                                     (void*)(uintptr_t)((firstIndex_ + c.indexOffset) * sizeof(uint32_t)), baseVertex_);
+            drawn_++;
+            triangles_ += c.indexCount / 3;
+        }
+        rendered_++;
+    }
+
+    if (rendered_ > 0) {
+        stateChanges_ += 2;
+        glBindVertexArray(0);
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+        glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    }
+}
+
+void CascadedShadowMaps::bindTexture() const {
+    glActiveTexture(GL_TEXTURE0 + unit_);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthTex_);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void CascadedShadowMaps::setUniforms(const Shader& sh) const {
+    // [-1,1] -> [0,1] dla współrzędnych tekstury i głębokości
+    const glm::mat4 bias(0.5f, 0.f, 0.f, 0.f,
+                         0.f, 0.5f, 0.f, 0.f,
+                         0.f, 0.f, 0.5f, 0.f,
+                         0.5f, 0.5f, 0.5f, 1.f);
+    float splits[kMaxCascades] = {0.f, 0.f, 0.f, 0.f};
+    for (int i = 0; i < settings_.cascades; i++) {
+        std::string name = "uShadowMat[" + std::to_string(i) + "]";
+        sh.setMat4(name.c_str(), bias * cascades_[i].lightViewProj);
+        splits[i] = cascades_[i].splitFar;
+    }
+    glUniform4f(glGetUniformLocation(sh.id, "uCascadeSplits"), splits[0], splits[1], splits[2], splits[3]);
+    sh.setInt("uCascadeCount", settings_.cascades);
+    sh.setInt("uShadowMap", unit_);
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+
+class Shader;
+
+// Jeden submesh rzucający cień. version trzeba podbić, gdy zmienia się
+// jego transformacja albo geometria - wtedy kaskady, które go widzą, się odświeżą.
+struct ShadowCaster {
+    glm::mat4 world{1.f};
+    glm::vec3 boundsMin{0.f};
+    glm::vec3 boundsMax{0.f};
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    uint32_t version = 0;
+};
+
+// Cascaded shadow maps dla światła kierunkowego.
+// Kaskada jest przerysowywana tylko gdy zmieni się jej klucz: kierunek światła,
+// przyciągnięte do texela granice (kamera musi przesunąć się o texel) albo
+// zbiór/wersje casterów wewnątrz. Przebieg cieni czyta strumień samych pozycji
+// i rysuje tylko castery, które wpadają w daną kaskadę.
+class CascadedShadowMaps {
+public:
+    static const int kMaxCascades = 4;
+
+    struct Settings {
+        int cascades = 3;
+        int size = 2048;
+        float maxDistance = 20.f;  // dalej od kamery nie ma cieni
+        float splitLambda = 0.75f; // 0 = liniowo, 1 = logarytmicznie
+    };
+
+    explicit CascadedShadowMaps(const Settings& s, int textureUnit = 5);
+    ~CascadedShadowMaps();
+    CascadedShadowMaps(const CascadedShadowMaps&) = delete;
+    CascadedShadowMaps& operator=(const CascadedShadowMaps&) = delete;
+
+    // VAO z pozycjami w atrybucie 0 (GeometryArena) i zakres modelu w nim:
+    // indeksy casterów liczone od firstIndex, wierzchołki od baseVertex.
+    // Przerysowuje kaskady.
+    void setGeometry(GLuint vao, uint32_t firstIndex, int32_t baseVertex);
+    // Zasięg cieni (np. gdy model dochodzi kawałkami i rośnie); przerysowuje kaskady
+    void setMaxDistance(float d);
+    float maxDistance() const { return settings_.maxDistance; }
+
+    // Aktualizuje kaskady i przerysowuje tylko te nieaktualne. Po drodze zmienia
+    // FBO i viewport, na koniec przywraca te, które były ustawione wcześniej.
+    void update(const glm::mat4& view, float fovY, float aspect, float zNear,
+                const glm::vec3& lightDir, const std::vector<ShadowCaster>& casters);
+
+    void bindTexture() const;
+    void setUniforms(const Shader& sh) const;
+
+    int cascadesRendered() const { return rendered_; }  // w ostatnim update()
+    int castersDrawn() const { return drawn_; }
+    uint64_t trianglesDrawn() const { return triangles_; }
+    int stateChanges() const { return stateChanges_; }   // bindy FBO/programu/VAO/warstwy
+
+private:
+    struct Cascade {
+        glm::mat4 lightViewProj{1.f};
+        float splitFar = 0.f;
+        uint64_t key = 0;      // 0 = jeszcze nie rysowana
+    };
+
+    Settings settings_;
+    int unit_;
+    GLuint depthTex_ = 0, fbo_ = 0;
+    GLuint vao_ = 0;           // nie nasz (arena)
+    uint32_t firstIndex_ = 0;
+    int32_t baseVertex_ = 0;
+    std::unique_ptr<Shader> depthShader_;
+    Cascade cascades_[kMaxCascades];
+    std::vector<uint32_t> visible_;   // roboczy: castery aktualnej kaskady
+    int rendered_ = 0, drawn_ = 0;
+    uint64_t triangles_ = 0;
+    int stateChanges_ = 0;
+};
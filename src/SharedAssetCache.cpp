@@ -0,0 +1,632 @@
+﻿#include "SharedAssetCache.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "CpuProfiler.h"
+#include "Timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t kMagic = 0x43534E5A; // "ZNSC"
+const uint32_t kVersion = 1;
+const size_t kHeaderBytes = 64;     // dane wpisu zaczynają się wyrównane
+const size_t kImageHeaderBytes = 16;
+const size_t kMeshHeaderBytes = 64;
+
+enum class EntryKind : uint32_t { Mesh = 1, Image = 2 };
+
+// Początek każdego obiektu. ready zapisywane na końcu (release), czytane
+// acquire - jest, to reszta wpisu też już jest.
+struct EntryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t payloadBytes;
+    uint32_t kind;
+    uint32_t ready;
+};
+static_assert(sizeof(EntryHeader) <= kHeaderBytes);
+
+// --- skrót zawartości ---
+// 64 bity w stylu xxHash64 (cztery niezależne tory po 8 bajtów), ale bez
+// zgodności z nim - to tylko klucz wpisu, nie suma kryptograficzna.
+const uint64_t kP1 = 0x9E3779B185EBCA87ull;
+const uint64_t kP2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t kP3 = 0x165667B19E3779F9ull;
+const uint64_t kP4 = 0x85EBCA77C2B2AE63ull;
+
+uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+uint64_t Round(uint64_t acc, uint64_t w) {
+    return Rotl(acc + w * kP2, 31) * kP1;
+}
+uint64_t Load64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t HashBytes(const void* data, size_t n, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + n;
+    uint64_t h = seed + kP3;
+    if (n >= 32) {
+        uint64_t v[4] = {seed + kP1 + kP2, seed + kP2, seed, seed - kP1};
+        for (; end - p >= 32; p += 32)
+            for (int k = 0; k < 4; k++) v[k] = Round(v[k], Load64(p + 8 * k));
+        h = Rotl(v[0], 1) + Rotl(v[1], 7) + Rotl(v[2], 12) + Rotl(v[3], 18);
+        for (uint64_t x : v) h = (h ^ Round(0, x)) * kP1 + kP4;
+    }
+    h += (uint64_t)n;
+    for (; end - p >= 8; p += 8) h = Rotl(h ^ Round(0, Load64(p)), 27) * kP1 + kP4;
+    for (; p < end; p++) h = Rotl(h ^ (*p * kP3), 11) * kP1;
+    h ^= h >> 33;
+    h *= kP2;
+    h ^= h >> 29;
+    h *= kP3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t HashString(const std::string& s, uint64_t seed) {
+    return HashBytes(s.data(), s.size(), seed);
+}
+
+// Rzuca, gdy pliku nie da się przeczytać
+uint64_t HashFile(const std::string& path, uint64_t seed) {
+    const MappedFile file(path);
+    return HashBytes(file.data(), file.size(), seed);
+}
+
+std::string EntryName(uint64_t key) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "znc-%016llx", (unsigned long long)key);
+    return buf;
+}
+
+// --- obiekt w pamięci współdzielonej ---
+
+// Zmapowany (tylko do odczytu) wpis; żyje, dopóki ktoś trzyma shared_ptr
+class Region {
+public:
+#ifdef _WIN32
+    Region(const void* base, size_t size, HANDLE mapping) : base_(base), size_(size), mapping_(mapping) {}
+#else
+    Region(const void* base, size_t size) : base_(base), size_(size) {}
+#endif
+    ~Region() {
+#ifdef _WIN32
+        UnmapViewOfFile(base_);
+        CloseHandle(mapping_);
+#elif defined(__linux__)
+        munmap((void*)base_, size_);
+#endif
+    }
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+    const EntryHeader& header() const { return *(const EntryHeader*)base_; }
+    const unsigned char* payload() const { return (const unsigned char*)base_ + kHeaderBytes; }
+    size_t payloadBytes() const { return (size_t)header().payloadBytes; }
+
+    bool valid(uint64_t key, EntryKind kind) const {
+        if (size_ < kHeaderBytes) return false;
+        const EntryHeader& h = header();
+        // atomic_ref nie przyjmuje const (C++20), a strona i tak jest tylko do odczytu
+        if (!std::atomic_ref<uint32_t>(const_cast<uint32_t&>(h.ready)).load(std::memory_order_acquire)) return false;
+        return h.magic == kMagic && h.version == kVersion && h.key == key && h.kind == (uint32_t)kind &&
+               h.payloadBytes <= size_ - kHeaderBytes;
+    }
+
+private:
+    const void* base_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE mapping_;
+#endif
+};
+
+// Dane wpisu do zapisania; size == 0: nie zapisuj (np. obraz się nie zdekodował)
+struct Payload {
+    size_t size = 0;
+    std::function<void(unsigned char*)> write;
+};
+
+// Nagłówek, dane i na końcu znacznik gotowości
+void Fill(void* base, uint64_t key, EntryKind kind, const Payload& p) {
+    EntryHeader& h = *(EntryHeader*)base;
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.key = key;
+    h.payloadBytes = p.size;
+    h.kind = (uint32_t)kind;
+    p.write((unsigned char*)base + kHeaderBytes);
+    std::atomic_ref<uint32_t>(h.ready).store(1, std::memory_order_release);
+}
+
+#ifdef _WIN32
+
+std::string ObjectName(uint64_t key) {
+    return "Local\\" + EntryName(key);
+}
+
+std::shared_ptr<const Region> OpenEntry(uint64_t key, EntryKind kind) {
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, ObjectName(key).c_str());
+    if (!mapping) return nullptr;
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION mi;
+    if (!view || !VirtualQuery(view, &mi, sizeof(mi))) {
+        if (view) UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    auto region = std::make_shared<const Region>(view, (size_t)mi.RegionSize, mapping);
+    return region->valid(key, kind) ? region : nullptr;
+}
+
+// Nazwany mutex na wpis. WAIT_ABANDONED (poprzedni właściciel padł) też
+// daje blokadę - wpis i tak sprawdzamy pod nią od nowa.
+class EntryLock {
+public:
+    explicit EntryLock(uint64_t key) {
+        mutex_ = CreateMutexA(nullptr, FALSE, (ObjectName(key) + ".lock").c_str());
+        if (!mutex_) return;
+        const DWORD r = WaitForSingleObject(mutex_, INFINITE);
+        if (r != WAIT_OBJECT_0 && r != WAIT_ABANDONED) {
+            CloseHandle(mutex_);
+            mutex_ = nullptr;
+        }
+    }
+    ~EntryLock() {
+        if (!mutex_) return;
+        ReleaseMutex(mutex_);
+        CloseHandle(mutex_);
+    }
+    EntryLock(const EntryLock&) = delete;
+    EntryLock& operator=(const EntryLock&) = delete;
+    explicit operator bool() const { return mutex_ != nullptr; }
+
+private:
+    HANDLE mutex_ = nullptr;
+};
+
+// Nazwy nie da się usunąć, dopóki ktoś trzyma uchwyt - CreateEntry wtedy odpuszcza
+void RemoveEntry(uint64_t) {}
+
+std::shared_ptr<const Region> CreateEntry(uint64_t key, EntryKind kind, const Payload& p) {
+    const uint64_t total = kHeaderBytes + p.size;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(total >> 32),
+                                        (DWORD)total, ObjectName(key).c_str());
+    if (!mapping) return nullptr;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {   // niedokończony wpis procesu, który padł
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)total);
+    if (!base) {
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    Fill(base, key, kind, p);
+    DWORD old = 0;
+    VirtualProtect(base, (SIZE_T)total, PAGE_READONLY, &old);
+    return std::make_shared<const Region>(base, (size_t)total, mapping);
+}
+
+#elif defined(__linux__)
+
+std::string ObjectName(uint64_t key) {
+    return "/" + EntryName(key);
+}
+
+std::shared_ptr<const Region> OpenEntry(uint64_t key, EntryKind kind) {
+    const int fd = shm_open(ObjectName(key).c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    void* base = MAP_FAILED;
+    // rozmiar ustawia twórca przed zapisem i już go nie zmienia
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= kHeaderBytes)
+        base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);   // mapowanie trzyma obiekt samo
+    if (base == MAP_FAILED) return nullptr;
+    auto region = std::make_shared<const Region>(base, (size_t)st.st_size);
+    return region->valid(key, kind) ? region : nullptr;
+}
+
+// flock na obiekcie "<nazwa>.lock": jądro zwalnia go razem z procesem,
+// więc proces, który padł w trakcie zapełniania, nie blokuje innych
+class EntryLock {
+public:
+    explicit EntryLock(uint64_t key) {
+        fd_ = shm_open((ObjectName(key) + ".lock").c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd_ < 0) return;
+        while (flock(fd_, LOCK_EX) != 0) {
+            if (errno == EINTR) continue;
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+    }
+    ~EntryLock() {
+        if (fd_ < 0) return;
+        flock(fd_, LOCK_UN);
+        ::close(fd_);
+    }
+    EntryLock(const EntryLock&) = delete;
+    EntryLock& operator=(const EntryLock&) = delete;
+    explicit operator bool() const { return fd_ >= 0; }
+
+private:
+    int fd_ = -1;
+};
+
+// Niegotowy wpis pod blokadą to resztka procesu, który padł
+void RemoveEntry(uint64_t key) {
+    shm_unlink(ObjectName(key).c_str());
+}
+
+std::shared_ptr<const Region> CreateEntry(uint64_t key, EntryKind kind, const Payload& p) {
+    const std::string name = ObjectName(key);
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return nullptr;
+    const size_t total = kHeaderBytes + p.size;
+    void* base = MAP_FAILED;
+    // miejsce w tmpfs rezerwujemy od razu: jego brak przy zapisie do mapowania to SIGBUS
+    if (ftruncate(fd, (off_t)total) == 0 && posix_fallocate(fd, 0, (off_t)total) == 0)
+        base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    Fill(base, key, kind, p);
+    mprotect(base, total, PROT_READ);
+    return std::make_shared<const Region>(base, total);
+}
+
+#else
+
+// Bez pamięci współdzielonej: zawsze prywatne dekodowanie
+std::shared_ptr<const Region> OpenEntry(uint64_t, EntryKind) {
+    return nullptr;
+}
+struct EntryLock {
+    explicit EntryLock(uint64_t) {}
+    explicit operator bool() const { return false; }
+};
+void RemoveEntry(uint64_t) {}
+std::shared_ptr<const Region> CreateEntry(uint64_t, EntryKind, const Payload&) {
+    return nullptr;
+}
+
+#endif
+
+// Wpis key: gotowy albo zbudowany przez build() pod blokadą. nullptr, gdy
+// pamięci współdzielonej nie ma - build() mógł się już wykonać.
+std::shared_ptr<const Region> Acquire(uint64_t key, EntryKind kind, const std::function<Payload()>& build) {
+    if (auto region = OpenEntry(key, kind)) return region;
+    EntryLock lock(key);
+    if (!lock) return nullptr;
+    if (auto region = OpenEntry(key, kind)) return region;   // zbudował go proces, na który czekaliśmy
+    RemoveEntry(key);
+    const Payload p = build();
+    if (!p.size) return nullptr;
+    return CreateEntry(key, kind, p);
+}
+
+// --- siatka: nagłówek, wierzchołki, indeksy, potem submeshe i materiały ---
+
+struct MeshHeader {
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t metaBytes;
+};
+static_assert(sizeof(MeshHeader) <= kMeshHeaderBytes);
+
+template <class T>
+void Put(std::vector<unsigned char>& out, const T& v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const unsigned char* p = (const unsigned char*)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+void PutString(std::vector<unsigned char>& out, const std::string& s) {
+    Put(out, (uint32_t)s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+// Odczyt z mapowania; każdy get sprawdza, czy dane jeszcze są
+class Reader {
+public:
+    Reader(const unsigned char* p, size_t n) : p_(p), end_(p + n) {}
+
+    template <class T>
+    bool get(T& v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if ((size_t)(end_ - p_) < sizeof(T)) return false;
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return true;
+    }
+    bool getString(std::string& s) {
+        uint32_t n = 0;
+        if (!get(n) || (size_t)(end_ - p_) < n) return false;
+        s.assign((const char*)p_, n);
+        p_ += n;
+        return true;
+    }
+    bool atEnd() const { return p_ == end_; }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+};
+
+std::vector<unsigned char> MeshMeta(const LoadedModel& model) {
+    std::vector<unsigned char> out;
+    const ObjLoadStats& s = model.stats;
+    for (size_t n : {s.lines, s.positions, s.uvs, s.normals, s.faces}) Put(out, (uint64_t)n);
+    Put(out, (uint32_t)model.submeshes.size());
+    for (const SubMesh& sm : model.submeshes) {
+        PutString(out, sm.materialName);
+        Put(out, sm.indexOffset);
+        Put(out, sm.indexCount);
+        Put(out, sm.boundsMin);
+        Put(out, sm.boundsMax);
+    }
+    Put(out, (uint32_t)model.materials.size());
+    for (const auto& [name, m] : model.materials) {
+        PutString(out, name);
+        Put(out, m.Kd);
+        Put(out, m.Ks);
+        Put(out, m.Ns);
+        PutString(out, m.mapKd);
+        PutString(out, m.mapBump);
+        Put(out, m.bumpScale);
+        Put(out, (uint8_t)m.uvOriginTop);
+    }
+    return out;
+}
+
+Payload MeshPayload(const LoadedModel& model) {
+    auto meta = std::make_shared<std::vector<unsigned char>>(MeshMeta(model));
+    const size_t vertexBytes = model.vertices.size() * sizeof(Vertex);
+    const size_t indexBytes = model.indices.size() * sizeof(uint32_t);
+    Payload p;
+    p.size = kMeshHeaderBytes + vertexBytes + indexBytes + meta->size();
+    p.write = [&model, meta, vertexBytes, indexBytes](unsigned char* dst) {
+        const MeshHeader h = {model.vertices.size(), model.indices.size(), meta->size()};
+        std::memcpy(dst, &h, sizeof(h));
+        dst += kMeshHeaderBytes;
+        std::memcpy(dst, model.vertices.data(), vertexBytes);
+        std::memcpy(dst + vertexBytes, model.indices.data(), indexBytes);
+        std::memcpy(dst + vertexBytes + indexBytes, meta->data(), meta->size());
+    };
+    return p;
+}
+
+// Spany wskazują w region; false, gdy wpis się nie zgadza
+bool ReadMesh(const Region& region, SharedMesh& out) {
+    const size_t bytes = region.payloadBytes();
+    if (bytes < kMeshHeaderBytes) return false;
+    MeshHeader h;
+    std::memcpy(&h, region.payload(), sizeof(h));
+    const uint64_t rest = bytes - kMeshHeaderBytes;
+    if (h.vertexCount > rest / sizeof(Vertex) || h.indexCount > rest / sizeof(uint32_t) ||
+        h.vertexCount * sizeof(Vertex) + h.indexCount * sizeof(uint32_t) + h.metaBytes != rest)
+        return false;
+
+    const unsigned char* p = region.payload() + kMeshHeaderBytes;
+    const size_t vertexBytes = (size_t)h.vertexCount * sizeof(Vertex);
+    const size_t indexBytes = (size_t)h.indexCount * sizeof(uint32_t);
+    out.vertices = {(const Vertex*)p, (size_t)h.vertexCount};
+    out.indices = {(const uint32_t*)(p + vertexBytes), (size_t)h.indexCount};
+
+    Reader r(p + vertexBytes + indexBytes, (size_t)h.metaBytes);
+    uint64_t counts[5];
+    for (uint64_t& c : counts)
+        if (!r.get(c)) return false;
+    out.stats.lines = (size_t)counts[0];
+    out.stats.positions = (size_t)counts[1];
+    out.stats.uvs = (size_t)counts[2];
+    out.stats.normals = (size_t)counts[3];
+    out.stats.faces = (size_t)counts[4];
+
+    uint32_t n = 0;
+    if (!r.get(n) || n > h.metaBytes) return false;
+    out.submeshes.resize(n);
+    for (SubMesh& sm : out.submeshes) {
+        if (!r.getString(sm.materialName) || !r.get(sm.indexOffset) || !r.get(sm.indexCount) ||
+            !r.get(sm.boundsMin) || !r.get(sm.boundsMax))
+            return false;
+        if ((uint64_t)sm.indexOffset + sm.indexCount > h.indexCount) return false;
+    }
+    if (!r.get(n) || n > h.metaBytes) return false;
+    for (uint32_t i = 0; i < n; i++) {
+        Material m;
+        uint8_t uvOriginTop = 0;
+        if (!r.getString(m.name) || !r.get(m.Kd) || !r.get(m.Ks) || !r.get(m.Ns) || !r.getString(m.mapKd) ||
+            !r.getString(m.mapBump) || !r.get(m.bumpScale) || !r.get(uvOriginTop))
+            return false;
+        m.uvOriginTop = uvOriginTop != 0;
+        std::string name = m.name;
+        out.materials[name] = std::move(m);
+    }
+    out.stats.vertices = out.vertices.size();
+    out.stats.indices = out.indices.size();
+    return r.atEnd();
+}
+
+} // namespace
+
+LoadedModel SharedMesh::copy() const {
+    LoadedModel m;
+    m.vertices.assign(vertices.begin(), vertices.end());
+    m.indices.assign(indices.begin(), indices.end());
+    m.submeshes = submeshes;
+    m.materials = materials;
+    m.stats = stats;
+    return m;
+}
+
+SharedMesh LoadOBJShared(const std::string& objPath, const std::string& baseDir, const std::atomic<bool>* cancel,
+                         bool useMeshCache) {
+    PROFILE_ZONE("LoadOBJShared");
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // zawartość OBJ i MTL z nagłówka; baseDir zmienia ścieżki tekstur w materiałach
+    uint64_t key = HashFile(objPath, (uint64_t)EntryKind::Mesh * kP1 + kVersion + sizeof(Vertex));
+    for (const std::string& mtl : FindMtlLibs(objPath, baseDir)) {
+        key = HashString(mtl, key);
+        try {
+            key = HashFile(mtl, key);
+        } catch (const std::exception&) {
+            // brakujący MTL parser i tak pominie; klucz zależy wtedy od samej ścieżki
+        }
+    }
+    key = HashString(baseDir, key);
+
+    auto load = [&] {
+        return std::make_shared<const LoadedModel>(useMeshCache ? LoadOBJCached(objPath, baseDir, cancel)
+                                                                : LoadOBJ_WithMTL(objPath, baseDir, cancel));
+    };
+    std::shared_ptr<const LoadedModel> built;
+    auto region = Acquire(key, EntryKind::Mesh, [&] {
+        built = load();
+        return MeshPayload(*built);
+    });
+
+    SharedMesh mesh;
+    if (region && ReadMesh(*region, mesh)) {
+        mesh.shared = true;
+        mesh.fromCache = !built;
+        mesh.storage = region;
+        if (built) mesh.stats = built->stats;   // czasy z parsowania, które zrobił ten proces
+    } else {
+        // bez pamięci współdzielonej: zwykły prywatny model
+        mesh = SharedMesh{};
+        if (!built) built = load();
+        mesh.vertices = built->vertices;
+        mesh.indices = built->indices;
+        mesh.submeshes = built->submeshes;
+        mesh.materials = built->materials;
+        mesh.stats = built->stats;
+        mesh.storage = built;
+    }
+    if (mesh.fromCache) mesh.stats.mtlMs = 0.0;
+    mesh.stats.totalMs = MsSince(t0);
+    return mesh;
+}
+
+ObjLoadStats EmitSharedMesh(const SharedMesh& mesh, GeometrySink& sink, const std::atomic<bool>* cancel) {
+    PROFILE_ZONE("EmitSharedMesh");
+    sink.expect(mesh.vertices.size(), mesh.indices.size());
+    for (size_t done = 0; done < mesh.vertices.size();) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) throw LoadCancelled();
+        std::span<Vertex> space = sink.vertexSpace();
+        const size_t n = std::min(space.size(), mesh.vertices.size() - done);
+        std::memcpy(space.data(), mesh.vertices.data() + done, n * sizeof(Vertex));
+        sink.commitVertices(n);
+        done += n;
+    }
+    // sink liczy indeksy po kolei, więc submesh dostaje offset w tej kolejności
+    uint32_t indices = 0;
+    for (const SubMesh& src : mesh.submeshes) {
+        SubMesh sm = src;
+        sm.indexOffset = indices;
+        for (size_t done = 0; done < sm.indexCount;) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) throw LoadCancelled();
+            std::span<uint32_t> space = sink.indexSpace();
+            const size_t n = std::min<size_t>(space.size(), sm.indexCount - done);
+            std::memcpy(space.data(), mesh.indices.data() + src.indexOffset + done, n * sizeof(uint32_t));
+            sink.commitIndices(n);
+            done += n;
+        }
+        indices += sm.indexCount;
+        if (!sink.submesh(sm, {})) break;
+    }
+    return mesh.stats;
+}
+
+DecodedImage DecodeImageShared(const std::string& path, bool flipVertically, bool* fromCache) {
+    PROFILE_ZONE("texture decode shared");
+    if (fromCache) *fromCache = false;
+    uint64_t key = 0;
+    try {
+        key = HashFile(path, (uint64_t)EntryKind::Image * kP1 + kVersion + (flipVertically ? 1 : 0));
+    } catch (const std::exception&) {
+        return DecodeImage(path, flipVertically);   // brak pliku zgłosi DecodeImage
+    }
+
+    DecodedImage decoded;
+    bool built = false;
+    auto region = Acquire(key, EntryKind::Image, [&] {
+        decoded = DecodeImage(path, flipVertically);
+        built = true;
+        Payload p;
+        if (!decoded) return p;
+        const size_t bytes = (size_t)decoded.width * decoded.height * decoded.channels;
+        p.size = kImageHeaderBytes + bytes;
+        p.write = [&decoded, bytes](unsigned char* dst) {
+            const int32_t dims[4] = {decoded.width, decoded.height, decoded.channels, 0};
+            std::memcpy(dst, dims, sizeof(dims));
+            std::memcpy(dst + kImageHeaderBytes, decoded.pixels.get(), bytes);
+        };
+        return p;
+    });
+
+    if (region && region->payloadBytes() >= kImageHeaderBytes) {
+        int32_t dims[4];
+        std::memcpy(dims, region->payload(), sizeof(dims));
+        const bool ok = dims[0] > 0 && dims[1] > 0 && dims[2] > 0 && dims[2] <= 4 &&
+                        (uint64_t)dims[0] * dims[1] * dims[2] == region->payloadBytes() - kImageHeaderBytes;
+        if (ok) {
+            DecodedImage img;
+            img.width = dims[0];
+            img.height = dims[1];
+            img.channels = dims[2];
+            // strona tylko do odczytu; UploadTexture2D i tak tylko czyta
+            unsigned char* pixels = const_cast<unsigned char*>(region->payload() + kImageHeaderBytes);
+            img.pixels = std::unique_ptr<unsigned char, ImageFree>(pixels, ImageFree{region});
+            if (fromCache) *fromCache = !built;
+            return img;
+        }
+    }
+    return built ? std::move(decoded) : DecodeImage(path, flipVertically);
+}
+
+size_t ClearSharedAssetCache() {
+    size_t removed = 0;
+#if defined(__linux__)
+    DIR* dir = opendir("/dev/shm");
+    if (!dir) return 0;
+    std::vector<std::string> names;
+    while (const dirent* e = readdir(dir))
+        if (!std::strncmp(e->d_name, "znc-", 4)) names.push_back(e->d_name);
+    closedir(dir);
+    for (const std::string& name : names)
+        if (shm_unlink(("/" + name).c_str()) == 0) removed++;
+#endif
+    return removed;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "ObjLoader.h"
+#include "Texture.h"
+
+// Zdekodowane assety współdzielone między procesami przeglądarki na jednym
+// hoście. Wpis to nazwany obiekt pamięci współdzielonej (Linux: shm_open,
+// /dev/shm/znc-<klucz>; Windows: nazwane mapowanie "Local\znc-<klucz>"),
+// kluczem jest skrót zawartości plików źródłowych, nie ścieżka. Pierwszy
+// proces dekoduje i zapisuje wpis, kolejne mapują go tylko do odczytu - bez
+// parsowania OBJ i dekodowania obrazów, a strony są w RAM raz dla wszystkich.
+//
+// Zapełnianie: blokada na wpis (Linux: flock na obiekcie "<nazwa>.lock",
+// Windows: nazwany mutex). Pod blokadą proces sprawdza wpis jeszcze raz, a
+// jeśli go nie ma, dekoduje, tworzy obiekt (O_EXCL), zapisuje i na końcu
+// ustawia znacznik gotowości - pozostali czekają na blokadzie zamiast
+// dekodować to samo. Gotowy wpis już się nie zmienia, więc trafienie mapuje
+// go bez blokady. Proces, który padł w trakcie, zostawia wpis bez znacznika;
+// jego blokada znika razem z nim, a następny proces wpis usuwa i buduje od
+// nowa. Wpisy na Linuksie przeżywają procesy (do ClearSharedAssetCache albo
+// restartu), na Windows znikają z ostatnim procesem, który je trzyma.
+//
+// Gdy pamięci współdzielonej nie ma (inny system, brak miejsca w tmpfs,
+// wpis zajęty przez niedokończony obiekt na Windows), wszystko działa jak
+// bez cache: dekodowanie do prywatnej pamięci procesu.
+
+// Geometria i materiały OBJ (jak LoadOBJ_WithMTL). Wierzchołki i indeksy
+// wskazują w mapowanie wpisu (albo w prywatny model, gdy shared == false);
+// storage trzyma jedno albo drugie.
+struct SharedMesh {
+    std::span<const Vertex> vertices;
+    std::span<const uint32_t> indices;
+    std::vector<SubMesh> submeshes;
+    MaterialMap materials;
+    ObjLoadStats stats;            // z wczytania, które wpis zbudowało; totalMs: to wczytanie
+    bool shared = false;           // dane w pamięci współdzielonej
+    bool fromCache = false;        // wpis zbudował wcześniej inny proces (albo ten)
+    std::shared_ptr<const void> storage;
+
+    // Kopia do wektorów (Renderer::setModel i tak zwalnia je po uploadzie)
+    LoadedModel copy() const;
+};
+
+// Klucz: zawartość OBJ, mtllib z nagłówka (FindMtlLibs) i baseDir; mtllib
+// spoza nagłówka nie wchodzą do klucza (jak w MeshCache). useMeshCache:
+// wpis budowany przez LoadOBJCached (sidecar .zmesh) zamiast parsera.
+SharedMesh LoadOBJShared(const std::string& objPath, const std::string& baseDir,
+                         const std::atomic<bool>* cancel = nullptr, bool useMeshCache = false);
+// Geometria SharedMesh do sink prosto z mapowania: wszystkie wierzchołki
+// przed pierwszym submeshem, potem indeksy submesh po submeshu
+ObjLoadStats EmitSharedMesh(const SharedMesh& mesh, GeometrySink& sink, const std::atomic<bool>* cancel = nullptr);
+
+// Jak DecodeImage; piksele trafienia wskazują w mapowanie wpisu (tylko do
+// odczytu, zwalnia je ostatni DecodedImage). Klucz: zawartość pliku i flip.
+DecodedImage DecodeImageShared(const std::string& path, bool flipVertically = true, bool* fromCache = nullptr);
+
+// Usuwa wszystkie wpisy (Linux: /dev/shm/znc-*); procesy, które je mapują,
+// dalej mają swoje dane. Zwraca liczbę usuniętych obiektów (Windows: 0).
+size_t ClearSharedAssetCache();
@@ -0,0 +1,114 @@
+﻿#include "StagingBuffer.h"
+#include "GLExt.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+StagingBuffer::StagingBuffer(size_t blockSize, unsigned blocks)
+    : blockSize_(blockSize), persistent_(gExt.bufferStorage), slots_(std::max(1u, blocks)), free_(slots_.size()) {
+    for (size_t i = 0; i < slots_.size(); i++) {
+        Slot& s = slots_[i];
+        glGenBuffers(1, &s.buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+        if (persistent_) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            gExt.BufferStorage(GL_COPY_READ_BUFFER, (GLsizeiptr)blockSize_, nullptr, flags);
+            s.data = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)blockSize_, flags);
+        } else {
+            glBufferData(GL_COPY_READ_BUFFER, (GLsizeiptr)blockSize_, nullptr, GL_STREAM_COPY);
+            map(s);
+        }
+        if (!s.data) throw std::runtime_error("StagingBuffer: nie moge zmapowac bufora");
+        int index = (int)i;
+        free_.tryPush(index);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+StagingBuffer::~StagingBuffer() {
+    for (Slot& s : slots_) {
+        if (s.fence) glDeleteSync(s.fence);
+        if (s.data) {
+            glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+        glDeleteBuffers(1, &s.buffer);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void StagingBuffer::map(Slot& s) {
+    // GPU skończyło z blokiem (płot) - bez synchronizacji i bez starej zawartości
+    glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+    s.data = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)blockSize_,
+                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+StagingBuffer::Block StagingBuffer::acquire(const std::atomic<bool>* cancel) {
+    int index;
+    if (!free_.tryPop(index)) {
+        // bloki wracają w poll() raz na klatkę, więc krótki sen zamiast kręcenia się
+        PROFILE_ZONE("StagingBuffer wait");
+        acquireWaits_.fetch_add(1, std::memory_order_relaxed);
+        while (!free_.tryPop(index)) {
+            if (cancel && cancel->load()) return {};
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return Block{index, slots_[index].data};
+}
+
+void StagingBuffer::copyTo(int block, size_t offset, GLuint dst, GLintptr dstOffset, size_t size) {
+    if (!size) return;
+    Slot& s = slots_[block];
+    glBindBuffer(GL_COPY_READ_BUFFER, s.buffer);
+    if (!persistent_ && s.data) {
+        // ze zmapowanego (nietrwale) bufora kopiować nie wolno
+        if (!glUnmapBuffer(GL_COPY_READ_BUFFER)) throw std::runtime_error("StagingBuffer: dane bloku utracone (glUnmapBuffer)");
+        s.data = nullptr;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)offset, dstOffset, (GLsizeiptr)size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    copies_++;
+    copiedBytes_ += size;
+}
+
+void StagingBuffer::retire(int block) {
+    Slot& s = slots_[block];
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    retired_.push_back(block);
+}
+
+void StagingBuffer::poll() {
+    for (size_t i = 0; i < retired_.size();) {
+        Slot& s = slots_[retired_[i]];
+        const GLenum r = glClientWaitSync(s.fence, 0, 0);
+        if (r == GL_TIMEOUT_EXPIRED) {
+            i++;
+            continue;
+        }
+        glDeleteSync(s.fence);
+        s.fence = nullptr;
+        if (!persistent_) {
+            map(s);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        int index = retired_[i];
+        free_.tryPush(index);   // pojemność = liczba bloków, zawsze się zmieści
+        retired_[i] = retired_.back();
+        retired_.pop_back();
+    }
+}
+
+StagingBuffer::Stats StagingBuffer::stats() const {
+    Stats s;
+    s.acquireWaits = acquireWaits_.load(std::memory_order_relaxed);
+    s.copies = copies_;
+    s.copiedBytes = copiedBytes_;
+    return s;
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "LockFreeQueue.h"
+
+// Kawałek geometrii modelu w bloku (AssetStreamer -> Renderer::copyStaged)
+struct StagedRange {
+    int block = -1;
+    size_t offset = 0;         // w bajtach, w bloku
+    bool indices = false;      // false = wierzchołki
+    uint32_t first = 0;        // pierwszy element w modelu
+    uint32_t count = 0;
+    bool lastInBlock = false;  // po kopii blok wraca do StagingBuffer
+};
+
+// Bloki pamięci GL, do których wątki tła piszą bezpośrednio (np. parser
+// OBJ przez GeometrySink), a wątek GL kopiuje je na GPU glCopyBufferSubData
+// do docelowego bufora - dane nie przechodzą przez wektory na stercie.
+//
+// Każdy blok to osobny bufor. Z GL_ARB_buffer_storage zmapowany raz, na
+// stałe i koherentnie: kopiować można kawałkami, w trakcie dopisywania.
+// Bez rozszerzenia wątek GL mapuje wolny blok glMapBufferRange
+// (UNSYNCHRONIZED - płot już minął) i odmapowuje go przed jedyną kopią,
+// więc wtedy blok oddaje się po każdym kawałku (partialCopies() == false).
+//
+// Wolne bloki krążą w kolejce bez blokad; retire() stawia płot za ostatnią
+// kopią, a poll() (raz na klatkę) zwraca do kolejki bloki, które GPU skończyło.
+class StagingBuffer {
+public:
+    struct Block {
+        int index = -1;
+        unsigned char* data = nullptr;
+        explicit operator bool() const { return index >= 0; }
+    };
+
+    struct Stats {
+        uint64_t acquireWaits = 0;   // acquire, który czekał na wolny blok
+        uint64_t copies = 0;
+        uint64_t copiedBytes = 0;
+    };
+
+    // Wątek GL
+    StagingBuffer(size_t blockSize = 1 << 20, unsigned blocks = 8);
+    ~StagingBuffer();
+    StagingBuffer(const StagingBuffer&) = delete;
+    StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+    // Dowolny wątek: czeka na wolny blok; ustawione cancel = pusty Block
+    Block acquire(const std::atomic<bool>* cancel = nullptr);
+
+    // Wątek GL: [offset, offset+size) bloku do dst od dstOffset
+    void copyTo(int block, size_t offset, GLuint dst, GLintptr dstOffset, size_t size);
+    // Wątek GL: po ostatniej kopii z bloku
+    void retire(int block);
+    // Wątek GL, raz na klatkę
+    void poll();
+
+    bool partialCopies() const { return persistent_; }
+    size_t blockSize() const { return blockSize_; }
+    unsigned blocks() const { return (unsigned)slots_.size(); }
+    Stats stats() const;
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        unsigned char* data = nullptr;   // nullptr = niezmapowany
+        GLsync fence = nullptr;
+    };
+
+    void map(Slot& s);
+
+    size_t blockSize_;
+    bool persistent_ = false;
+    std::vector<Slot> slots_;
+    std::vector<int> retired_;            // czekają na płot (tylko wątek GL)
+    LockFreeQueue<int> free_;
+    std::atomic<uint64_t> acquireWaits_{0};
+    uint64_t copies_ = 0, copiedBytes_ = 0;
+};
@@ -0,0 +1,107 @@
+﻿#include "Startup.h"
+#include "GltfLoader.h"
+#include "MeshCache.h"
+#include "SharedAssetCache.h"
+#include "CpuProfiler.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+StartupResult RunStartup(const StartupConfig& c, JobSystem& jobs) {
+    using Affinity = TaskGraph::Affinity;
+    auto t0 = std::chrono::steady_clock::now();
+
+    StartupResult r;
+    bool glfwReady = false;
+
+    std::vector<std::string> mtlPaths;
+    LoadedModel model;
+    MaterialMap materials;
+    double mtlMs = 0.0;
+    DecodedTextures images;
+    std::mutex imagesMutex;
+
+    TaskGraph g(jobs);
+
+    // --- GL: tylko na tym wątku ---
+    const auto init = g.add("glfw_init", Affinity::Main, [&] {
+        if (!InitGLFW(c.headless, r.offscreenContext)) throw std::runtime_error("GLFW init fail");
+        glfwReady = true;
+    });
+    const auto window = g.add("window", Affinity::Main, [&] {
+        r.window = CreateAppWindow(c.width, c.height, "OBJ Viewer", c.headless, r.offscreenContext);
+        if (!r.window) throw std::runtime_error("Window create fail");
+    }, {init});
+    const auto glad = g.add("glad", Affinity::Main, [&] {
+        if (!LoadGL(c.headless)) throw std::runtime_error("GLAD load fail");
+    }, {window});
+    const auto shader = g.add("shader", Affinity::Main, [&] {
+        r.renderer = std::make_unique<Renderer>(c.render);
+    }, {glad});
+
+    // --- CPU: pliki modelu (bez kontekstu GL); bez objPath model dokłada AssetStreamer ---
+    if (!c.objPath.empty()) {
+        const bool gltf = IsGLTFPath(c.objPath);
+        const auto scan = g.add("find_mtllib", Affinity::Worker, [&] {
+            if (!gltf) mtlPaths = FindMtlLibs(c.objPath, c.baseDir);
+        });
+
+        const auto obj = g.add("obj_load", Affinity::Worker, [&] {
+            if (gltf) {
+                model = LoadGLTF(c.objPath);
+                materials = std::move(model.materials);   // tekstury jak z MTL poniżej
+                model.materials.clear();
+            } else if (c.sharedCache) {
+                model = LoadOBJShared(c.objPath, c.baseDir, nullptr, c.meshCache).copy();   // też z materiałami
+            } else if (c.meshCache) {
+                model = LoadOBJCached(c.objPath, c.baseDir);   // z materiałami; mtl_parse nadpisze te same
+            } else {
+                model = LoadOBJGeometry(c.objPath, c.baseDir, mtlPaths);
+            }
+        }, {scan});
+
+        // MTL obok geometrii; dekodowanie tekstur i upload modelu dokładamy,
+        // kiedy już wiadomo, jakie pliki są w materiałach. glTF: materiały
+        // przychodzą z geometrią.
+        g.add("mtl_parse", Affinity::Worker, [&] {
+            auto m0 = std::chrono::steady_clock::now();
+            for (const std::string& path : mtlPaths)
+                for (auto& [name, mat] : LoadMTL(path, c.baseDir)) materials[name] = std::move(mat);
+            mtlMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m0).count();
+
+            const std::map<std::string, bool> files = MaterialTextureFiles(materials);
+
+            std::vector<TaskGraph::TaskId> deps = {obj, shader};
+            for (const auto& [file, flip] : files) {
+                deps.push_back(g.add("texture_decode", Affinity::Worker, [&, file = file, flip = flip] {
+                    DecodedImage img = c.sharedCache ? DecodeImageShared(file, flip) : DecodeImage(file, flip);
+                    std::lock_guard<std::mutex> lock(imagesMutex);
+                    images[file] = std::move(img);
+                }));
+            }
+
+            g.add("model_upload", Affinity::Main, [&] {
+                // mtllib spoza nagłówka OBJ parser wczytał już sam; z nagłówka dokładamy tu
+                for (auto& [name, mat] : materials) model.materials[name] = std::move(mat);
+                model.stats.mtlMs += mtlMs;
+                r.renderer->setModel(std::move(model), &images);
+            }, deps);
+        }, {gltf ? obj : scan});
+    }
+
+    try {
+        g.run();
+    } catch (...) {
+        // kontekst jest aktywny na tym wątku, więc renderer może zwolnić zasoby GL
+        r.renderer.reset();
+        if (r.window) glfwDestroyWindow(r.window);
+        if (glfwReady) glfwTerminate();
+        throw;
+    }
+
+    r.tasks = g.timings();
+    r.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
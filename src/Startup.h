@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Window.h"
+#include "Renderer.h"
+#include "TaskGraph.h"
+
+struct StartupConfig {
+    std::string objPath, baseDir;
+    int width = 1280, height = 720;
+    bool headless = false;
+    bool meshCache = false;    // OBJ przez sidecar .zmesh (LoadOBJCached)
+    bool sharedCache = false;  // OBJ i tekstury przez SharedAssetCache (pamięć współdzielona procesów)
+    RenderSettings render;
+};
+
+struct StartupResult {
+    GLFWwindow* window = nullptr;
+    bool offscreenContext = false;
+    std::unique_ptr<Renderer> renderer;
+    std::vector<TaskGraph::Timing> tasks;
+    double totalMs = 0.0;
+};
+
+// Start aplikacji jako graf zadań:
+//
+//   [worker] find mtllib --+--> obj parse --------------------------+
+//                          +--> mtl parse --> texture decode (xN) --+--> [main] model upload
+//   [main]   glfw init --> window --> glad --> shader --------------+
+//
+// Parsowanie OBJ/MTL i dekodowanie obrazów ruszają zanim powstanie kontekst
+// GL; wszystko, co woła GL, wykonuje wątek wołający (z kontekstem). Rzuca
+// std::runtime_error - wtedy sam sprząta renderer, okno i GLFW.
+StartupResult RunStartup(const StartupConfig& c, JobSystem& jobs);
@@ -0,0 +1,88 @@
+﻿#include "TaskGraph.h"
+
+#include <stdexcept>
+
+TaskGraph::TaskId TaskGraph::add(std::string name, Affinity affinity, std::function<void()> fn,
+                                 const std::vector<TaskId>& deps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const TaskId id = (TaskId)tasks_.size();
+    tasks_.emplace_back();
+    Task& t = tasks_.back();
+    t.timing.name = std::move(name);
+    t.timing.affinity = affinity;
+    t.fn = std::move(fn);
+    for (TaskId d : deps) {
+        if (tasks_[d].done) continue;   // zależność już spełniona
+        tasks_[d].dependents.push_back(id);
+        t.pendingDeps++;
+    }
+    if (running_ && t.pendingDeps == 0) schedule(id);
+    return id;
+}
+
+void TaskGraph::schedule(TaskId id) {
+    if (tasks_[id].timing.affinity == Affinity::Main) jobs_.runOnMain([this, id] { execute(id); }, &pending_);
+    else jobs_.runBackground([this, id] { execute(id); }, &pending_);   // nie na wątku z GL
+}
+
+void TaskGraph::execute(TaskId id) {
+    std::function<void()> fn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+            fn = std::move(tasks_[id].fn);
+            tasks_[id].timing.startMs = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+            tasks_[id].timing.ran = true;
+        }
+    }
+    if (fn) {
+        try {
+            fn();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+    }
+    finish(id);
+}
+
+void TaskGraph::finish(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Task& t = tasks_[id];
+    t.timing.endMs = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+    t.done = true;
+    for (TaskId d : t.dependents) {
+        if (--tasks_[d].pendingDeps == 0) schedule(d);
+    }
+}
+
+void TaskGraph::run() {
+    if (!jobs_.isMainThread()) throw std::logic_error("TaskGraph::run poza watkiem glownym JobSystem");
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_ = Clock::now();
+        running_ = true;
+        for (TaskId id = 0; id < (TaskId)tasks_.size(); id++) {
+            if (!tasks_[id].done && tasks_[id].pendingDeps == 0) schedule(id);
+        }
+    }
+
+    // Czekając, ten wątek wykonuje tylko zadania Main; Worker idą w tle i
+    // wait() ich nie bierze
+    jobs_.wait(pending_);
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        error = error_;
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+std::vector<TaskGraph::Timing> TaskGraph::timings() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Timing> out;
+    for (const Task& t : tasks_) out.push_back(t.timing);
+    return out;
+}
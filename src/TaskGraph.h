@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <exception>
+#include <chrono>
+
+#include "JobSystem.h"
+
+// Graf zadań z zależnościami na JobSystem. Zadanie Worker idzie do puli
+// jako praca w tle (runBackground), zadanie Main do kolejki wątku głównego
+// JobSystem (z kontekstem GL), który musi wołać run() - czekając, wykonuje
+// tylko zadania Main, a Worker zostają dla puli. Zadania można dodawać
+// także w trakcie run(), z wnętrza innych zadań - tak MTL dokłada
+// dekodowanie tekstur, które zna dopiero po sparsowaniu.
+// Pierwszy wyjątek przerywa graf: nowe zadania już nie startują, a run()
+// rzuca go dalej po zakończeniu tych, które były w toku.
+class TaskGraph {
+public:
+    using TaskId = int;
+    enum class Affinity { Worker, Main };
+
+    struct Timing {
+        std::string name;
+        Affinity affinity = Affinity::Worker;
+        double startMs = 0.0, endMs = 0.0;   // od początku run()
+        bool ran = false;
+    };
+
+    explicit TaskGraph(JobSystem& jobs) : jobs_(jobs) {}
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    TaskId add(std::string name, Affinity affinity, std::function<void()> fn,
+               const std::vector<TaskId>& deps = {});
+
+    // Wykonuje cały graf; wraca gdy wszystkie zadania się skończą.
+    // Tylko z wątku głównego JobSystem (std::logic_error w przeciwnym razie).
+    void run();
+
+    // Czasy zadań z ostatniego run(), w kolejności dodania
+    std::vector<Timing> timings() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task {
+        Timing timing;
+        std::function<void()> fn;
+        int pendingDeps = 0;
+        std::vector<TaskId> dependents;
+        bool done = false;
+    };
+
+    void schedule(TaskId id);   // pod mutexem, zależności spełnione
+    void execute(TaskId id);
+    void finish(TaskId id);
+
+    JobSystem& jobs_;
+    mutable std::mutex mutex_;
+    std::deque<Task> tasks_;    // deque: referencje zostają ważne przy dodawaniu
+    // +1 na każde wysłane zadanie; zależne wysyłamy przed zejściem licznika
+    // poprzednika, więc zero znaczy koniec całego grafu
+    JobCounter pending_;
+    bool running_ = false;
+    std::exception_ptr error_;
+    Clock::time_point start_;
+};
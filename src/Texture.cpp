@@ -0,0 +1,72 @@
+﻿#include "Texture.h"
+#include "GLExt.h"
+#include "CpuProfiler.h"
+
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+void ImageFree::operator()(unsigned char* p) const {
+    if (!owner) stbi_image_free(p);
+}
+
+DecodedImage DecodeImage(const std::string& path, bool flipVertically) {
+    PROFILE_ZONE("texture decode");
+    DecodedImage img;
+    // ustawienie per wątek: dekodujemy w puli wątków w trakcie startu
+    stbi_set_flip_vertically_on_load_thread(flipVertically ? 1 : 0);
+    img.pixels.reset(stbi_load(path.c_str(), &img.width, &img.height, &img.channels, 0));
+    if (!img) std::cerr << "Nie moge wczytac tekstury: " << path << "\n";
+    return img;
+}
+
+std::map<std::string, bool> MaterialTextureFiles(const MaterialMap& materials) {
+    std::map<std::string, bool> files;
+    for (const auto& [name, mat] : materials) {
+        if (!mat.mapKd.empty()) files.emplace(mat.mapKd, !mat.uvOriginTop);
+        if (!mat.mapBump.empty()) files.emplace(mat.mapBump, !mat.uvOriginTop);
+    }
+    return files;
+}
+
+GLuint UploadTexture2D(const DecodedImage& img) {
+    if (!img) return 0;
+    PROFILE_ZONE("texture upload");
+
+    GLenum fmt = (img.channels == 4) ? GL_RGBA : GL_RGB;
+
+    GLuint tex=0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, fmt, img.width, img.height, 0, fmt, GL_UNSIGNED_BYTE, img.pixels.get());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    if (gExt.anisotropic) {
+        float aniso = 0.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &aniso);
+        if (aniso < 1.0f) aniso = 1.0f;
+        if (aniso > 16.0f) aniso = 16.0f; // bezpieczny limit
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, aniso);
+    }
+
+    return tex;
+}
+
+GLuint LoadTexture2D(const std::string& path) {
+    PROFILE_ZONE("LoadTexture2D");
+    return UploadTexture2D(DecodeImage(path));
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <string>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "ObjLoader.h"
+
+// Piksele z stb_image. Z owner należą do kogoś innego (np. mapowanie
+// SharedAssetCache) - wtedy wystarczy puścić właściciela.
+struct ImageFree {
+    std::shared_ptr<const void> owner;
+    void operator()(unsigned char* p) const;
+};
+
+// Zdekodowany obraz w pamięci (stb_image), jeszcze bez GL. DecodeImage
+// można wołać z dowolnego wątku, UploadTexture2D tylko z wątku kontekstu.
+struct DecodedImage {
+    int width = 0, height = 0, channels = 0;
+    std::unique_ptr<unsigned char, ImageFree> pixels;
+
+    explicit operator bool() const { return pixels != nullptr; }
+};
+
+// ścieżka -> obraz zdekodowany wcześniej (np. w puli wątków przy starcie)
+using DecodedTextures = std::unordered_map<std::string, DecodedImage>;
+
+// flipVertically: pierwszy wiersz obrazu na dole tekstury (UV z OBJ, v = 0
+// na dole); false dla materiałów z uvOriginTop (glTF)
+DecodedImage DecodeImage(const std::string& path, bool flipVertically = true);
+// Pliki tekstur materiałów (map_Kd, map_bump), każdy raz -> flipVertically
+// dla DecodeImage (glTF bez odwracania)
+std::map<std::string, bool> MaterialTextureFiles(const MaterialMap& materials);
+// Tekstura 2D z mipmapami. 0 gdy obraz jest pusty.
+GLuint UploadTexture2D(const DecodedImage& img);
+
+// DecodeImage + UploadTexture2D
+GLuint LoadTexture2D(const std::string& path);
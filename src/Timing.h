@@ -0,0 +1,7 @@
+﻿#pragma once
+#include <chrono>
+
+// Milisekundy od t0 - pomiar faz wczytywania i uploadu do statystyk
+inline double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
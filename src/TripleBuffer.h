@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Potrójny bufor jednego pisarza i jednego czytelnika, bez blokad. Pisarz
+// wypełnia swój slot i publish() zamienia go ze środkowym; czytelnik w
+// update() zabiera środkowy, jeśli jest świeższy od tego, który ma. Żadna
+// strona nie czeka na drugą, a czytelnik zawsze widzi pełny, najnowszy
+// opublikowany stan (pośrednie mogą przepaść).
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) {
+        for (T& s : slots_) s = initial;
+    }
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Pisarz
+    T& write() { return slots_[back_]; }
+    void publish() {
+        const uint8_t prev = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = prev & kIndex;
+    }
+
+    // Czytelnik: true, gdy przyszło coś nowego od ostatniego update()
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+        const uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndex;
+        return true;
+    }
+    const T& read() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t kIndex = 3, kFresh = 4;
+
+    T slots_[3];
+    uint8_t back_ = 0;                // tylko pisarz
+    uint8_t front_ = 1;               // tylko czytelnik
+    std::atomic<uint8_t> middle_{2};  // indeks + bit "świeży"
+};
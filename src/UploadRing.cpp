@@ -0,0 +1,96 @@
+﻿#include "UploadRing.h"
+#include "GLExt.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+UploadRing::UploadRing(GLenum target, size_t regionSize, unsigned regions)
+    : target_(target), fences_(std::max(2u, regions), nullptr) {
+    if (target == GL_UNIFORM_BUFFER) {
+        GLint a = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &a);
+        align_ = (size_t)std::max(a, 16);
+    }
+    // każdy region zaczyna się na wyrównaniu
+    regionSize_ = (regionSize + align_ - 1) / align_ * align_;
+    const GLsizeiptr total = (GLsizeiptr)(regionSize_ * fences_.size());
+
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(target_, buffer_);
+    if (gExt.bufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gExt.BufferStorage(target_, total, nullptr, flags);
+        mapped_ = (unsigned char*)glMapBufferRange(target_, 0, total, flags);
+    }
+    if (!mapped_) glBufferData(target_, total, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(target_, 0);
+}
+
+UploadRing::~UploadRing() {
+    for (GLsync f : fences_)
+        if (f) glDeleteSync(f);
+    if (mapped_) {
+        glBindBuffer(target_, buffer_);
+        glUnmapBuffer(target_);
+        glBindBuffer(target_, 0);
+    }
+    glDeleteBuffers(1, &buffer_);
+}
+
+void UploadRing::beginFrame() {
+    if (inFrame_) throw std::logic_error("UploadRing::beginFrame bez endFrame");
+    inFrame_ = true;
+    offset_ = 0;
+
+    GLsync& fence = fences_[region_];
+    if (!fence) return;
+    // najpierw bez czekania: zwykle GPU dawno skończyło ten region
+    GLenum r = glClientWaitSync(fence, 0, 0);
+    if (r == GL_TIMEOUT_EXPIRED) {
+        PROFILE_ZONE("UploadRing wait");
+        auto t0 = std::chrono::steady_clock::now();
+        do {
+            r = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+        } while (r == GL_TIMEOUT_EXPIRED);
+        stats_.waits++;
+        stats_.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+UploadRing::Allocation UploadRing::push(const void* data, size_t size) {
+    if (!inFrame_) throw std::logic_error("UploadRing::push poza klatka");
+    const size_t at = (offset_ + align_ - 1) / align_ * align_;
+    if (at + size > regionSize_) throw std::length_error("UploadRing: region klatki za maly");
+
+    Allocation a;
+    a.buffer = buffer_;
+    a.offset = (GLintptr)(region_ * regionSize_ + at);
+    a.size = (GLsizeiptr)size;
+    if (mapped_) {
+        std::memcpy(mapped_ + a.offset, data, size);
+    } else {
+        glBindBuffer(target_, buffer_);
+        glBufferSubData(target_, a.offset, a.size, data);
+        glBindBuffer(target_, 0);
+    }
+    offset_ = at + size;
+    return a;
+}
+
+void UploadRing::bind(GLuint index, const Allocation& a) const {
+    glBindBufferRange(target_, index, a.buffer, a.offset, a.size);
+}
+
+void UploadRing::endFrame() {
+    if (!inFrame_) return;
+    inFrame_ = false;
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stats_.peakBytes = std::max(stats_.peakBytes, offset_);
+    stats_.frames++;
+    region_ = (region_ + 1) % (unsigned)fences_.size();
+}
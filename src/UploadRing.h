@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Pierścień na dane zmieniane co klatkę (uniformy klatki, później np.
+// transformacje instancji). Jeden bufor podzielony na regions regionów -
+// klatka pisze do swojego, a GPU czyta jeszcze poprzednie. Koniec klatki
+// stawia glFenceSync na jej regionie; zanim pierścień wróci do regionu,
+// beginFrame() czeka na ten płot (i liczy takie czekania).
+//
+// Z GL_ARB_buffer_storage bufor jest zmapowany raz, na stałe i koherentnie:
+// push() to zwykły memcpy. Bez rozszerzenia push() robi glBufferSubData w
+// region, który płot już zwolnił - bez osierocania (glBufferData) bufora.
+class UploadRing {
+public:
+    struct Allocation {
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t waits = 0;        // beginFrame, który musiał czekać na GPU
+        double waitMs = 0.0;
+        size_t peakBytes = 0;      // największe zużycie regionu w jednej klatce
+    };
+
+    // target: GL_UNIFORM_BUFFER (wyrównanie z GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+    // albo inny (wyrównanie 16)
+    UploadRing(GLenum target, size_t regionSize, unsigned regions = 3);
+    ~UploadRing();
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    void beginFrame();
+    // Kopiuje data do bieżącego regionu; rzuca, gdy region się skończy
+    Allocation push(const void* data, size_t size);
+    template <class T>
+    Allocation push(const T& v) { return push(&v, sizeof(T)); }
+    // glBindBufferRange(target, index, ...)
+    void bind(GLuint index, const Allocation& a) const;
+    // Po ostatnim poleceniu GL, które czyta dane tej klatki
+    void endFrame();
+
+    bool persistent() const { return mapped_ != nullptr; }
+    unsigned regions() const { return (unsigned)fences_.size(); }
+    size_t regionSize() const { return regionSize_; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    GLenum target_;
+    GLuint buffer_ = 0;
+    size_t regionSize_;
+    size_t align_ = 16;
+    unsigned char* mapped_ = nullptr;
+    std::vector<GLsync> fences_;
+    unsigned region_ = 0;
+    size_t offset_ = 0;        // w bieżącym regionie
+    bool inFrame_ = false;
+    Stats stats_;
+};
@@ -0,0 +1,56 @@
+﻿#include "Window.h"
+#include "GLExt.h"
+#include "CpuProfiler.h"
+
+#include <iostream>
+
+bool InitGLFW(bool headless, bool& offscreenContext) {
+    PROFILE_ZONE("glfwInit");
+    offscreenContext = false;
+    if (glfwInit()) return true;
+    if (!headless) return false;
+
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (!glfwInit()) return false;
+    offscreenContext = true;
+    return true;
+}
+
+GLFWwindow* CreateAppWindow(int width, int height, const char* title, bool headless, bool offscreenContext) {
+    PROFILE_ZONE("glfwCreateWindow");
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    if (headless) {
+        // rysujemy do FBO, okno jest tylko nosicielem kontekstu
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        if (offscreenContext) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    } else {
+        glfwWindowHint(GLFW_SAMPLES, 4);
+    }
+
+    GLFWwindow* win = glfwCreateWindow(width, height, title, nullptr, nullptr);
+    if (!win) {
+        std::cerr << "Window create fail\n";
+        return nullptr;
+    }
+    glfwMakeContextCurrent(win);
+    return win;
+}
+
+bool LoadGL(bool headless) {
+    PROFILE_ZONE("gladLoadGL");
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "GLAD load fail\n";
+        return false;
+    }
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
+    if (!headless) glEnable(GL_MULTISAMPLE);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+    return true;
+}
@@ -0,0 +1,15 @@
+﻿#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// GLFW bez wyświetlacza (CI na Linuksie): najpierw zwykła platforma, a gdy
+// nie ma serwera X/Wayland i headless - platforma "null" z kontekstem OSMesa
+// (offscreenContext = true).
+bool InitGLFW(bool headless, bool& offscreenContext);
+
+// Okno z kontekstem GL 3.3 core, od razu aktywnym. headless: okno ukryte
+// (rysujemy do FBO), bez MSAA. nullptr gdy się nie udało.
+GLFWwindow* CreateAppWindow(int width, int height, const char* title, bool headless, bool offscreenContext);
+
+// GLAD + rozszerzenia + domyślny stan (głębokość, culling, MSAA gdy jest okno)
+bool LoadGL(bool headless);
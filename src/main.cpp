@@ -1,59 +1,34 @@
 ﻿#include <iostream>
 #include <string>
 #include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <memory>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "Shader.h"
+#include "GLExt.h"
+#include "Window.h"
+#include "Camera.h"
+#include "Renderer.h"
+#include "Benchmark.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
 #include "ObjLoader.h"
-
-#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
-#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
-#endif
-
-#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
-#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
-#endif
-
-
-// ---- Prosta kamera FPS w main.cpp (żeby nie dodawać kolejnego pliku) ----
-struct CameraFPS {
-    glm::vec3 pos{0.f, 1.2f, 3.0f};
-    float yaw = -90.f;
-    float pitch = 0.f;
-    float fov = 60.f;
-
-    float speed = 3.5f;
-    float sensitivity = 0.12f;
-
-    glm::vec3 front() const {
-        float cy = cos(glm::radians(yaw));
-        float sy = sin(glm::radians(yaw));
-        float cp = cos(glm::radians(pitch));
-        float sp = sin(glm::radians(pitch));
-        glm::vec3 f{cy * cp, sp, sy * cp};
-        return glm::normalize(f);
-    }
-    glm::vec3 right() const {
-        return glm::normalize(glm::cross(front(), glm::vec3(0,1,0)));
-    }
-    glm::mat4 view() const {
-        return glm::lookAt(pos, pos + front(), glm::vec3(0,1,0));
-    }
-
-    void mouseDelta(float dx, float dy) {
-        yaw += dx * sensitivity;
-        pitch -= dy * sensitivity;
-        pitch = std::clamp(pitch, -89.f, 89.f);
-    }
-};
+#include "GltfLoader.h"
+#include "MeshCodec.h"
+#include "SharedAssetCache.h"
+#include "Startup.h"
+#include "AssetStreamer.h"
+#include "AsyncAssets.h"
+#include "RenderThread.h"
 
 static int W = 1280, H = 720;
 static CameraFPS cam;
@@ -61,10 +36,13 @@ static bool firstMouse = true;
 static double lastX = 0, lastY = 0;
 static float deltaTime = 0.f;
 static float lastTime = 0.f;
+static bool showProfiler = true;   // F3: nakładka profilera
+static bool f3Down = false;
 
+// Viewport ustawia Renderer::render z FrameParams - tu żadnego GL, bo
+// kontekst może należeć do wątku renderu
 static void framebuffer_size_callback(GLFWwindow*, int w, int h) {
     W = w; H = h;
-    glViewport(0, 0, W, H);
 }
 
 static void mouse_callback(GLFWwindow*, double xpos, double ypos) {
@@ -87,227 +65,596 @@ static void processInput(GLFWwindow* win) {
     if (glfwGetKey(win, GLFW_KEY_S) == GLFW_PRESS) cam.pos -= cam.front() * cam.speed * deltaTime;
     if (glfwGetKey(win, GLFW_KEY_A) == GLFW_PRESS) cam.pos -= cam.right() * cam.speed * deltaTime;
     if (glfwGetKey(win, GLFW_KEY_D) == GLFW_PRESS) cam.pos += cam.right() * cam.speed * deltaTime;
-}
-
-static GLuint LoadTexture2D(const std::string& path) {
-    int w,h,comp;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(path.c_str(), &w, &h, &comp, 0);
-    if (!data) {
-        std::cerr << "Nie moge wczytac tekstury: " << path << "\n";
-        return 0;
-    }
 
-    GLenum fmt = (comp == 4) ? GL_RGBA : GL_RGB;
-
-    GLuint tex=0;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, fmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    if (glfwExtensionSupported("GL_EXT_texture_filter_anisotropic")) {
-        float aniso = 0.0f;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &aniso);
-        if (aniso < 1.0f) aniso = 1.0f;
-        if (aniso > 16.0f) aniso = 16.0f; // bezpieczny limit
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, aniso);
-    }
+    bool f3 = glfwGetKey(win, GLFW_KEY_F3) == GLFW_PRESS;
+    if (f3 && !f3Down) showProfiler = !showProfiler;
+    f3Down = f3;
+}
 
+struct AppOptions {
+    std::string objPath = "assets/girl OBJ.obj";
+    std::string baseDir = "assets";
+    size_t lights = 0;        // --lights N : animowane światła punktowe/spot (clustered)
+    bool lightBench = false;  // --light-bench : czasy klatki dla 1/64/256/1024 świateł
+    bool shadows = true;      // --no-shadows
+
+    bool headless = false;    // --bench : ukryte okno + FBO, trasa kamery, JSON z czasami
+    bool startupBench = false;// --startup-bench : czasy faz startu, zimny + ciepłe przebiegi
+    int iterations = 5;       // --iterations N (startup-bench, format-bench)
+    bool sequential = false;  // --sequential : start bez grafu zadań, krok po kroku
+    bool jobBench = false;    // --job-bench : narzut i skalowanie JobSystem, bez okna
+    bool uploadBench = false; // --upload-bench : szczyt pamięci i czas wczytania geometrii
+    std::vector<std::string> scanPaths;   // --scan PLIK|KATALOG (wiele razy) : metadane OBJ, pliki/s, JSON
+    std::string exportGlb;    // --export-glb PLIK : zapis modelu jako GLB i wyjście
+    bool formatBench = false; // --format-bench : wczytanie OBJ vs GLB (przeplot / osobne widoki) vs .zmesh, JSON
+    bool codecCheck = false;  // --codec-check : koder -> dekoder MeshCodec (SIMD i skalarnie) i wyjście
+    bool meshCache = false;   // --mesh-cache : geometria OBJ z sidecara .zmesh (MeshCodec), zapis przy pierwszym wczytaniu
+    bool sharedCache = false; // --shared-cache : zdekodowany OBJ i tekstury w pamięci współdzielonej procesów
+    bool sharedCacheClear = false;   // --shared-cache-clear : usuń wpisy pamięci współdzielonej i zakończ
+    std::string uploadMode;   // --upload-mode vectors|chunks|direct|ooc (upload-bench)
+    size_t memoryLimitMb = 0; // --memory-limit MB : OBJ większy niż RAM (dwa przebiegi, atrybuty na dysku)
+    bool renderThread = true; // --no-render-thread : wejście, kamera i render w jednej pętli
+    bool asyncLoad = false;   // --async-load : model przez LoadModelAsync (korutyny), pokazany w całości
+    bool lazyLoad = false;    // --lazy : indeks odcinków OBJ, geometria submeshy gdy pierwszy raz widoczne
+    ObjSubset subset;         // --objects A,B --materials C : tylko te obiekty / materiały (z --lazy)
+    JobBenchOptions jobs;
+    BenchOptions bench;
+    std::string recordPath;   // --record-path plik : zapis trasy kamery z trybu interaktywnego
+
+    bool profile = false;     // --profile : czasy przebiegów GPU w tytule okna + nakładka (F3)
+    bool profileDraws = false;// --profile-draws : osobny zakres na każdy submesh
+    std::string profileCsv;   // --profile-csv plik : czasy i liczniki co klatkę
+    CpuTraceOptions trace;    // --trace plik [--trace-frames A-B] : strefy CPU jako Chrome trace
+};
 
-    stbi_image_free(data);
-    return tex;
+static void PrintUsage() {
+    std::cout <<
+        "Opcje:\n"
+        "  --obj PLIK --base-dir KATALOG   model (domyslnie assets/girl OBJ.obj, assets)\n"
+        "                                  OBJ/MTL moga byc w gzip/zstd (po naglowku; bez --lazy i --memory-limit)\n"
+        "                                  .gltf/.glb: glTF 2.0 (bez --lazy i --memory-limit)\n"
+        "  --export-glb PLIK               zapisz model (--obj) jako GLB i zakoncz\n"
+        "  --mesh-cache                    geometria OBJ ze skompresowanego PLIK.zmesh (tworzony przy pierwszym wczytaniu)\n"
+        "  --shared-cache                  zdekodowany OBJ i tekstury wspolne dla procesow na hoscie (pamiec wspoldzielona)\n"
+        "  --shared-cache-clear            usun wpisy pamieci wspoldzielonej i zakoncz\n"
+        "  --lights N                      N animowanych swiatel (clustered forward)\n"
+        "  --light-bench                   czasy klatki dla 1/64/256/1024 swiatel\n"
+        "  --no-shadows                    bez cascaded shadow maps\n"
+        "  --record-path PLIK              nagraj trase kamery (tryb interaktywny)\n"
+        "  --profile                       czasy przebiegow GPU (tytul okna, nakladka F3)\n"
+        "  --profile-draws                 dodatkowo czas kazdego submesha\n"
+        "  --profile-csv PLIK              czasy i liczniki co klatke do CSV (tez z --bench)\n"
+        "  --trace PLIK                    strefy CPU (chrome://tracing) od startu do 1. klatki\n"
+        "    --trace-frames A-B            zamiast startu: klatki A..B\n"
+        "  --bench                         headless: FBO, trasa kamery, JSON z percentylami\n"
+        "    --frames N --warmup N --size WxH --fps F --camera-path PLIK --out PLIK\n"
+        "  --startup-bench                 czasy faz startu (1 zimny + N-1 cieplych), JSON\n"
+        "    --iterations N --size WxH --out PLIK\n"
+        "  --sequential                    start krok po kroku zamiast grafu zadan (porownanie)\n"
+        "  --no-render-thread              wejscie i render w jednym watku (jak --light-bench)\n"
+        "  --async-load                    model przez LoadModelAsync zamiast strumieniowania\n"
+        "  --lazy                          indeks odcinkow OBJ (PLIK.sidx), submeshe doczytywane gdy widoczne\n"
+        "    --objects A,B --materials C   tylko wybrane obiekty (o, bez o: g) / materialy (usemtl)\n"
+        "  --job-bench                     narzut zadan, skalowanie parallelFor i nagrywania komend, JSON\n"
+        "    --workers N --tasks N --draws N --out PLIK\n"
+        "  --memory-limit MB               OBJ wiekszy niz RAM: dwa przebiegi, atrybuty na dysku, parser w limicie\n"
+        "  --upload-bench                  szczyt RSS i czas wczytania geometrii: wektory / kawalki / wprost do GL, JSON\n"
+        "    --upload-mode vectors|chunks|direct|ooc --memory-limit MB --out PLIK\n"
+        "  --scan PLIK|KATALOG             metadane OBJ (liczniki, AABB, materialy, tekstury) bez wczytywania, JSON\n"
+        "    --workers N --out PLIK        (--scan mozna podac wiele razy; katalogi rekurencyjnie)\n"
+        "  --format-bench                  wczytanie modelu jako OBJ, GLB (przeplot / osobne widoki) i .zmesh, JSON\n"
+        "    --iterations N --out PLIK\n"
+        "  --codec-check                   koder -> dekoder MeshCodec na danych testowych (SIMD i skalarnie)\n";
 }
 
-int main() {
-    // GLFW
-    if (!glfwInit()) {
-        std::cerr << "GLFW init fail\n";
-        return 1;
+// "a,b,c" -> {"a", "b", "c"} (puste pomijamy)
+static std::vector<std::string> SplitList(const char* s) {
+    std::vector<std::string> out;
+    std::string cur;
+    for (const char* p = s;; p++) {
+        if (*p == ',' || !*p) {
+            if (!cur.empty()) out.push_back(cur);
+            cur.clear();
+            if (!*p) break;
+        } else {
+            cur.push_back(*p);
+        }
     }
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    return out;
+}
 
-    GLFWwindow* win = glfwCreateWindow(W, H, "OBJ Viewer", nullptr, nullptr);
-    if (!win) {
-        std::cerr << "Window create fail\n";
-        glfwTerminate();
-        return 1;
+static AppOptions ParseArgs(int argc, char** argv) {
+    AppOptions o;
+    for (int i = 1; i < argc; i++) {
+        auto next = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (!std::strcmp(argv[i], "--obj")) o.objPath = next();
+        else if (!std::strcmp(argv[i], "--base-dir")) o.baseDir = next();
+        else if (!std::strcmp(argv[i], "--lights")) o.lights = (size_t)std::atoi(next());
+        else if (!std::strcmp(argv[i], "--light-bench")) o.lightBench = true;
+        else if (!std::strcmp(argv[i], "--no-shadows")) o.shadows = false;
+        else if (!std::strcmp(argv[i], "--record-path")) o.recordPath = next();
+        else if (!std::strcmp(argv[i], "--profile")) o.profile = true;
+        else if (!std::strcmp(argv[i], "--profile-draws")) o.profile = o.profileDraws = true;
+        else if (!std::strcmp(argv[i], "--profile-csv")) { o.profile = true; o.profileCsv = next(); }
+        else if (!std::strcmp(argv[i], "--trace")) o.trace.path = next();
+        else if (!std::strcmp(argv[i], "--trace-frames")) {
+            int a = 0, b = 0;
+            if (std::sscanf(next(), "%d-%d", &a, &b) == 2 && a >= 0 && b >= a) {
+                o.trace.firstFrame = a;
+                o.trace.lastFrame = b;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--bench")) o.headless = true;
+        else if (!std::strcmp(argv[i], "--startup-bench")) o.startupBench = true;
+        else if (!std::strcmp(argv[i], "--iterations")) o.iterations = std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--sequential")) o.sequential = true;
+        else if (!std::strcmp(argv[i], "--job-bench")) o.jobBench = true;
+        else if (!std::strcmp(argv[i], "--upload-bench")) o.uploadBench = true;
+        else if (!std::strcmp(argv[i], "--scan")) o.scanPaths.push_back(next());
+        else if (!std::strcmp(argv[i], "--export-glb")) o.exportGlb = next();
+        else if (!std::strcmp(argv[i], "--format-bench")) o.formatBench = true;
+        else if (!std::strcmp(argv[i], "--codec-check")) o.codecCheck = true;
+        else if (!std::strcmp(argv[i], "--mesh-cache")) o.meshCache = true;
+        else if (!std::strcmp(argv[i], "--shared-cache")) o.sharedCache = true;
+        else if (!std::strcmp(argv[i], "--shared-cache-clear")) o.sharedCacheClear = true;
+        else if (!std::strcmp(argv[i], "--upload-mode")) o.uploadMode = next();
+        else if (!std::strcmp(argv[i], "--memory-limit")) o.memoryLimitMb = (size_t)std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--async-load")) o.asyncLoad = true;
+        else if (!std::strcmp(argv[i], "--lazy")) o.lazyLoad = true;
+        else if (!std::strcmp(argv[i], "--objects")) o.subset.objects = SplitList(next());
+        else if (!std::strcmp(argv[i], "--materials")) o.subset.materials = SplitList(next());
+        else if (!std::strcmp(argv[i], "--no-render-thread")) o.renderThread = false;
+        else if (!std::strcmp(argv[i], "--workers")) o.jobs.maxWorkers = (unsigned)std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--tasks")) o.jobs.tasks = (size_t)std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--draws")) o.jobs.draws = (size_t)std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--frames")) o.bench.frames = std::max(1, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--warmup")) o.bench.warmup = std::max(0, std::atoi(next()));
+        else if (!std::strcmp(argv[i], "--fps")) o.bench.fps = std::max(1.f, (float)std::atof(next()));
+        else if (!std::strcmp(argv[i], "--camera-path")) o.bench.cameraPath = next();
+        else if (!std::strcmp(argv[i], "--out")) o.bench.outPath = next();
+        else if (!std::strcmp(argv[i], "--size")) {
+            int w = 0, h = 0;
+            if (std::sscanf(next(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                o.bench.width = w;
+                o.bench.height = h;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--help")) { PrintUsage(); std::exit(0); }
+        else std::cerr << "Nieznana opcja: " << argv[i] << "\n";
     }
-    glfwMakeContextCurrent(win);
-    glfwSetFramebufferSizeCallback(win, framebuffer_size_callback);
-    glfwSetCursorPosCallback(win, mouse_callback);
-    glfwSetScrollCallback(win, scroll_callback);
-
-    // FPS: schowaj kursor
-    glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    return o;
+}
 
-    // GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "GLAD load fail\n";
-        return 1;
-    }
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-
-    // Shader
-    Shader sh("shaders/phong.vert", "shaders/phong.frag");
-
-    // OBJ + MTL
-    // U Ciebie: assets/girl OBJ.obj i assets/girl OBJ.mtl
-    LoadedModel model = LoadOBJ_WithMTL("assets/girl OBJ.obj", "assets");
-
-    // --- Auto ustawienie kamery na model (bounding box) ---
-    glm::vec3 mn( 1e30f), mx(-1e30f);
-    for (const auto& v : model.vertices) {
-        mn = glm::min(mn, v.pos);
-        mx = glm::max(mx, v.pos);
+// Pomiar czasu klatki przy rosnącej liczbie świateł: rozgrzewka, potem pomiar
+// z glFinish na końcu klatki (żeby liczył się też czas GPU), wynik na stdout.
+struct LightBench {
+    const size_t counts[4] = {1, 64, 256, 1024};
+    const int warmupFrames = 30;
+    const int measureFrames = 200;
+
+    size_t stage = 0;
+    int frame = 0;
+    double frameMsSum = 0.0, assignMsSum = 0.0, indexSum = 0.0;
+
+    size_t lightCount() const { return counts[stage]; }
+
+    // false gdy benchmark się skończył
+    bool record(double frameMs, const ClusteredLighting& cl) {
+        if (frame++ >= warmupFrames) {
+            frameMsSum += frameMs;
+            assignMsSum += cl.assignMs();
+            indexSum += (double)cl.indexCount();
+        }
+        if (frame < warmupFrames + measureFrames) return true;
+
+        std::cout << "lights=" << counts[stage]
+                  << " frame=" << frameMsSum / measureFrames << "ms"
+                  << " assign=" << assignMsSum / measureFrames << "ms"
+                  << " avgIndices=" << (size_t)(indexSum / measureFrames) << "\n";
+        frame = 0;
+        frameMsSum = assignMsSum = indexSum = 0.0;
+        return ++stage < 4;
     }
-    glm::vec3 center = (mn + mx) * 0.5f;
-    float radius = glm::length(mx - mn) * 0.5f;
-    if (radius < 0.0001f) radius = 1.0f;
+};
 
-    // jeśli skalujesz modelM w renderze, musisz uwzględnić tę samą skalę tutaj:
-    float modelScale = 0.02f;  // <- ustaw tak jak w renderze
-    float dist = radius * modelScale * 3.0f; // 3 promienie przed modelem
+// --- Auto ustawienie kamery na model (bounding box) ---
+static void FrameCamera(glm::vec3 center, float radius) {
+    float dist = radius * 3.0f; // 3 promienie przed modelem
 
     // start kamery: przed modelem na osi Z
-    cam.pos = center * modelScale + glm::vec3(0.0f, 0.0f, dist);
+    cam.pos = center + glm::vec3(0.0f, 0.0f, dist);
 
     // ustaw yaw/pitch, żeby patrzeć na środek
-    glm::vec3 dir = glm::normalize(center * modelScale - cam.pos);
+    glm::vec3 dir = glm::normalize(center - cam.pos);
     cam.yaw = glm::degrees(atan2(dir.z, dir.x)) - 90.0f;
     cam.pitch = glm::degrees(asin(dir.y));
+}
 
-
-    // Tekstury materiałów
-    for (auto& [name, mat] : model.materials) {
-        if (!mat.mapKd.empty()) {
-            mat.glTex = LoadTexture2D(mat.mapKd);
-        }
+static const double kStreamBudgetMs = 4.0;   // upload doładowanych kawałków na klatkę
+
+// --async-load: parsowanie i dekodowanie w puli, po co_await już wątek GL
+static Task<void> LoadModelInto(AsyncAssets& assets, Renderer& renderer, std::string objPath,
+                                std::string baseDir, bool& failed) {
+    try {
+        auto t0 = std::chrono::steady_clock::now();
+        ModelAsset asset = co_await LoadModelAsync(assets, objPath, baseDir);
+        renderer.setModel(std::move(asset.model), &asset.images);
+        PrintLoadSummary(std::cout, renderer.model());
+        std::cout << "Model loaded (async): "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count()
+                  << " ms\n";
+    } catch (const LoadCancelled&) {
+        // okno zamknięte w trakcie ładowania
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        failed = true;
     }
+}
 
-    // VAO/VBO/EBO
-    GLuint VAO=0, VBO=0, EBO=0;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+// Przy ładowaniu w tle model rośnie: kamerę dopasowujemy do niego, dopóki
+// użytkownik jej nie ruszy
+struct CameraFraming {
+    uint32_t version = 0;
+    CameraFPS cam;
+
+    void update(uint32_t geometryVersion, glm::vec3 center, float radius) {
+        if (geometryVersion == version) return;
+        const bool untouched = ::cam.pos == cam.pos && ::cam.yaw == cam.yaw && ::cam.pitch == cam.pitch;
+        if (untouched) FrameCamera(center, radius);
+        version = geometryVersion;
+        cam = ::cam;
+    }
+};
 
-    glBindVertexArray(VAO);
+static FrameParams CameraParams(float t) {
+    FrameParams fp;
+    fp.view = cam.view();
+    fp.camPos = cam.pos;
+    fp.fovDeg = cam.fov;
+    fp.width = W;
+    fp.height = H;
+    fp.time = t;
+    return fp;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, model.vertices.size()*sizeof(Vertex), model.vertices.data(), GL_STATIC_DRAW);
+// Wejście i kamera na wątku głównym, render na osobnym wątku z kontekstem GL
+static const double kInputStepSec = 0.004;   // co ile wątek główny wysyła snapshot
+
+static int RunThreaded(GLFWwindow* win, Renderer& renderer, JobSystem& jobs, GpuProfiler* profiler,
+                       const FrameHook& onFrame, const AppOptions& opts) {
+    FrameCamera(renderer.worldCenter(), renderer.worldRadius());
+    CameraFraming framing{renderer.geometryVersion(), cam};
+
+    CameraPath recording;
+    std::string title;
+    uint64_t sequence = 0;
+
+    auto snapshot = [&](float t) {
+        FrameSnapshot s;
+        s.params = CameraParams(t);
+        s.showProfiler = showProfiler;
+        s.sequence = sequence++;
+        s.created = std::chrono::steady_clock::now();
+        return s;
+    };
+
+    RenderThread render(win, renderer, jobs, profiler, onFrame);
+    render.start(snapshot((float)glfwGetTime()));
+
+    while (!glfwWindowShouldClose(win) && !render.failed()) {
+        {
+            PROFILE_ZONE("events");
+            glfwWaitEventsTimeout(kInputStepSec);
+        }
+        float t = (float)glfwGetTime();
+        deltaTime = t - lastTime;
+        lastTime = t;
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model.indices.size()*sizeof(uint32_t), model.indices.data(), GL_STATIC_DRAW);
+        {
+            PROFILE_ZONE("input");
+            processInput(win);
+        }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
-    glEnableVertexAttribArray(0);
+        RenderFeedback fb = render.feedback();
+        framing.update(fb.geometryVersion, fb.center, fb.radius);
+        if (profiler && fb.title != title) {
+            title = fb.title;
+            glfwSetWindowTitle(win, ("OBJ Viewer | " + title).c_str());
+        }
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
-    glEnableVertexAttribArray(1);
+        if (!opts.recordPath.empty()) recording.record(t, cam);
+        render.submit(snapshot(t));
+    }
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, nrm));
-    glEnableVertexAttribArray(2);
+    const bool failed = render.failed();
+    render.stop();
+    std::cout << "Render thread: " << render.framesRendered() << " klatek, "
+              << render.snapshotsUsed() << " snapshotow z " << sequence
+              << ", snapshot->swap " << render.avgLatencyMs() << " ms\n";
+    if (failed) return 1;
+
+    if (!opts.recordPath.empty()) {
+        try {
+            recording.save(opts.recordPath);
+            std::cout << "Camera path: " << recording.keys.size() << " klatek -> " << opts.recordPath << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    glBindVertexArray(0);
+static int RunInteractive(GLFWwindow* win, Renderer& renderer, GpuProfiler* profiler,
+                          const FrameHook& onFrame, const AppOptions& opts) {
+    FrameCamera(renderer.worldCenter(), renderer.worldRadius());
+    CameraFraming framing{renderer.geometryVersion(), cam};
 
-    // domyślna biała tekstura (gdy brak map_Kd)
-    GLuint whiteTex = 0;
-    {
-        unsigned char px[3] = {255,255,255};
-        glGenTextures(1, &whiteTex);
-        glBindTexture(GL_TEXTURE_2D, whiteTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1,1, 0, GL_RGB, GL_UNSIGNED_BYTE, px);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    LightBench lightBench;
+    if (opts.lightBench) {
+        renderer.setLightCount(lightBench.lightCount());
+        renderer.waitForShaders();   // w benchmarku nie mierzymy wariantu zapasowego
+        glfwSwapInterval(0);
     }
 
+    CameraPath recording;
+    float titleTime = 0.f;
+
     // Render
     while (!glfwWindowShouldClose(win)) {
+        auto frameStart = std::chrono::steady_clock::now();
         float t = (float)glfwGetTime();
         deltaTime = t - lastTime;
         lastTime = t;
 
-        processInput(win);
-
-        glClearColor(0.08f, 0.09f, 0.10f, 1.f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glm::mat4 modelM(1.0f);
-        // jeśli model jest gigantyczny/mały, możesz przeskalować:
-        modelM = glm::scale(modelM, glm::vec3(0.02f));
-
-        glm::mat4 view = cam.view();
-        glm::mat4 proj = glm::perspective(glm::radians(cam.fov), (float)W/(float)H, 0.05f, 500.0f);
-
-        sh.use();
-        sh.setMat4("uModel", modelM);
-        sh.setMat4("uView", view);
-        sh.setMat4("uProj", proj);
-
-        sh.setVec3("uViewPos", cam.pos);
-        glm::vec3 camFront = cam.front();
-        glm::vec3 camRight = cam.right();
-        glm::vec3 camUp    = glm::vec3(0,1,0);
-
-        glm::vec3 lightDir = -(camFront * 1.0f + camUp * 0.4f + camRight * 0.2f);
-        sh.setVec3("uLightDir", glm::normalize(lightDir));
-        sh.setVec3("uLightColor", glm::vec3(1.0f));
-        sh.setVec3("uMat.Ks", glm::vec3(0.25f));
-        sh.setFloat("uMat.Ns", 64.0f);
-        sh.setVec3("uLightDir", glm::normalize(glm::vec3(-1.f, -1.f, -0.5f)));
-        sh.setVec3("uLightColor", glm::vec3(1.f));
-        sh.setInt("uDiffuse", 0);
-
-        glBindVertexArray(VAO);
-
-        for (const auto& sm : model.submeshes) {
-            Material mat{};
-            auto it = model.materials.find(sm.materialName);
-            if (it != model.materials.end()) mat = it->second;
-            else {
-                mat.Kd = glm::vec3(1.f);
-                mat.Ks = glm::vec3(0.2f);
-                mat.Ns = 32.f;
-                mat.glTex = 0;
+        {
+            PROFILE_ZONE("input");
+            processInput(win);
+            renderer.update();
+        }
+
+        if (onFrame && !onFrame(renderer)) {
+            glfwSetWindowShouldClose(win, 1);
+            return 1;
+        }
+        framing.update(renderer.geometryVersion(), renderer.worldCenter(), renderer.worldRadius());
+
+        renderer.render(CameraParams(t));
+
+        if (profiler) {
+            if (showProfiler) profiler->drawOverlay(W, H);
+            if (t - titleTime > 0.25f) {
+                glfwSetWindowTitle(win, ("OBJ Viewer | " + profiler->summary()).c_str());
+                titleTime = t;
+            }
+        }
+
+        if (!opts.recordPath.empty()) recording.record(t, cam);
+
+        {
+            PROFILE_ZONE("swap");
+            glfwSwapBuffers(win);
+        }
+        {
+            PROFILE_ZONE("events");
+            glfwPollEvents();
+        }
+        PROFILE_FRAME();
+
+        if (opts.lightBench) {
+            glFinish();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            if (lightBench.record(ms, renderer.lighting())) {
+                renderer.setLightCount(lightBench.lightCount());
+                renderer.waitForShaders();
+            } else {
+                glfwSetWindowShouldClose(win, 1);
             }
+        }
+    }
+
+    if (!opts.recordPath.empty()) {
+        try {
+            recording.save(opts.recordPath);
+            std::cout << "Camera path: " << recording.keys.size() << " klatek -> " << opts.recordPath << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    AppOptions opts = ParseArgs(argc, argv);
+    PROFILE_THREAD("main");
+    if (!opts.trace.path.empty()) StartCpuTrace(opts.trace);
+
+    if (opts.jobBench) {
+        opts.jobs.outPath = opts.bench.outPath;
+        int code = RunJobBenchmark(opts.jobs);
+        FinishCpuTrace();
+        return code;
+    }
+
+    if (!opts.scanPaths.empty()) {
+        ScanBenchOptions so;
+        so.paths = opts.scanPaths;
+        so.workers = opts.jobs.maxWorkers;
+        so.outPath = opts.bench.outPath;
+        int code = RunScanBenchmark(so);
+        FinishCpuTrace();
+        return code;
+    }
 
-            sh.setVec3("uMat.Kd", mat.Kd);
-            sh.setVec3("uMat.Ks", mat.Ks);
-            sh.setFloat("uMat.Ns", mat.Ns);
+    if (opts.sharedCacheClear) {
+        std::cout << "Shared cache: usunieto " << ClearSharedAssetCache() << " obiektow\n";
+        return 0;
+    }
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, mat.glTex ? mat.glTex : whiteTex);
+    if (!opts.exportGlb.empty()) {
+        try {
+            const LoadedModel model = LoadOBJ_WithMTL(opts.objPath, opts.baseDir);
+            SaveGLB(model, opts.exportGlb);
+            std::cout << "GLB: " << model.vertices.size() << " wierzcholkow, " << model.submeshes.size()
+                      << " submeshy -> " << opts.exportGlb << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
 
-            glDrawElements(GL_TRIANGLES,
-                           (GLsizei)sm.indexCount,
-                           GL_UNSIGNED_INT,
-                           (void*)(uintptr_t)(sm.indexOffset * sizeof(uint32_t)));
+    if (opts.codecCheck) {
+        std::string failure;
+        if (!MeshCodec::SelfCheck(&failure)) {
+            std::cerr << failure << "\n";
+            return 1;
         }
+        std::cout << "MeshCodec: OK (" << (MeshCodec::SimdDecoder() ? "SSE2 + skalarnie" : "skalarnie") << ")\n";
+        return 0;
+    }
+
+    if (opts.formatBench) {
+        FormatBenchOptions fo;
+        fo.objPath = opts.objPath;
+        fo.baseDir = opts.baseDir;
+        fo.iterations = opts.iterations;
+        fo.outPath = opts.bench.outPath;
+        int code = RunFormatBenchmark(fo);
+        FinishCpuTrace();
+        return code;
+    }
+
+    if (opts.uploadBench) {
+        UploadBenchOptions uo;
+        uo.objPath = opts.objPath;
+        uo.baseDir = opts.baseDir;
+        uo.mode = opts.uploadMode;
+        uo.outPath = opts.bench.outPath;
+        if (opts.memoryLimitMb) uo.memoryLimit = opts.memoryLimitMb << 20;
+        int code = RunUploadBenchmark(uo);
+        FinishCpuTrace();
+        return code;
+    }
+
+    if (opts.startupBench) {
+        // każda iteracja sama inicjalizuje i zamyka GLFW
+        StartupBenchOptions so;
+        so.iterations = opts.iterations;
+        so.width = opts.bench.width;
+        so.height = opts.bench.height;
+        so.objPath = opts.objPath;
+        so.baseDir = opts.baseDir;
+        so.lights = opts.lights;
+        so.shadows = opts.shadows;
+        so.outPath = opts.bench.outPath;
+        so.sequential = opts.sequential;
+        so.meshCache = opts.meshCache;
+        so.sharedCache = opts.sharedCache;
+        int code = RunStartupBenchmark(so);
+        FinishCpuTrace();
+        return code;
+    }
 
-        glBindVertexArray(0);
+    // Start: okno/GL na tym wątku, OBJ/MTL i tekstury równolegle w puli
+    JobSystem jobs;
+
+    // Interaktywnie model ładuje się w tle, a okno od razu rysuje kolejne
+    // submeshe. Benchmarki mierzą cały model, więc czekają na niego przy starcie.
+    const bool background = !opts.headless && !opts.lightBench;
+    std::unique_ptr<AssetStreamer> streamer;
+    if (background && !opts.asyncLoad) {
+        StreamSettings ss;
+        ss.outOfCore.memoryLimit = opts.memoryLimitMb << 20;
+        ss.meshCache = opts.meshCache;
+        ss.sharedCache = opts.sharedCache;
+        streamer = std::make_unique<AssetStreamer>(jobs, ss);
+        if (opts.lazyLoad || !opts.subset.empty()) streamer->openLazy(opts.objPath, opts.baseDir, opts.subset);
+        else streamer->loadModel(opts.objPath, opts.baseDir);
+    }
 
-        glfwSwapBuffers(win);
-        glfwPollEvents();
+    StartupConfig sc;
+    sc.objPath = background ? "" : opts.objPath;
+    sc.baseDir = opts.baseDir;
+    sc.width = W;
+    sc.height = H;
+    sc.headless = opts.headless;
+    sc.meshCache = opts.meshCache;
+    sc.sharedCache = opts.sharedCache;
+    sc.render.lights = opts.lights;
+    sc.render.shadows = opts.shadows;
+    sc.render.hotReload = !opts.headless;
+
+    StartupResult su;
+    try {
+        su = RunStartup(sc, jobs);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        FinishCpuTrace();
+        return 1;
+    }
+    GLFWwindow* win = su.window;
+    Renderer& renderer = *su.renderer;
+    renderer.setJobSystem(&jobs);
+    if (!background) PrintLoadSummary(std::cout, renderer.model());
+    std::cout << "Startup: " << su.totalMs << " ms\n";
+
+    if (!opts.headless) {
+        glfwSetFramebufferSizeCallback(win, framebuffer_size_callback);
+        glfwSetCursorPosCallback(win, mouse_callback);
+        glfwSetScrollCallback(win, scroll_callback);
+
+        // FPS: schowaj kursor
+        glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    // Korutyna potrzebuje renderera, więc startuje dopiero po RunStartup
+    std::unique_ptr<AsyncAssets> assets;
+    bool assetsFailed = false;
+    if (background && opts.asyncLoad) {
+        assets = std::make_unique<AsyncAssets>(jobs);
+        Spawn(LoadModelInto(*assets, renderer, opts.objPath, opts.baseDir, assetsFailed));
+    }
+
+    int exitCode = 0;
+    {
+        std::unique_ptr<GpuProfiler> profiler;
+        if (opts.profile) {
+            profiler = std::make_unique<GpuProfiler>(opts.profileDraws);
+            if (!opts.profileCsv.empty()) profiler->openCsv(opts.profileCsv);   // bez CSV profiler dalej działa
+            renderer.setProfiler(profiler.get());
+        }
 
+        // Doładowanie modelu na wątku GL, raz na klatkę
+        FrameHook pumpAssets = [&](Renderer& r) {
+            if (streamer && streamer->loading()) {
+                streamer->pump(r, kStreamBudgetMs);
+                if (streamer->failed()) return false;
+            }
+            if (assets) {
+                assets->pump();
+                if (assetsFailed) return false;
+            }
+            return true;
+        };
+
+        if (opts.headless) {
+            glfwSwapInterval(0);
+            exitCode = RunHeadlessBenchmark(renderer, opts.bench, opts.objPath);
+        } else if (opts.renderThread && !opts.lightBench) {
+            exitCode = RunThreaded(win, renderer, jobs, profiler.get(), pumpAssets, opts);
+        } else {
+            exitCode = RunInteractive(win, renderer, profiler.get(), pumpAssets, opts);
+        }
+        renderer.setProfiler(nullptr);
+    }
+
+    streamer.reset();      // przerywa ładowanie, jeśli okno zamknięto wcześniej
+    assets.reset();
+    su.renderer.reset();   // zasoby GL przed zniszczeniem kontekstu
     glfwDestroyWindow(win);
     glfwTerminate();
-    return 0;
+    FinishCpuTrace();
+    return exitCode;
 }